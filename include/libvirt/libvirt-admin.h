@@ -187,6 +187,30 @@ virAdmServerPtr virAdmConnectLookupServer(virAdmConnectPtr conn,
 
 # define VIR_THREADPOOL_JOB_QUEUE_DEPTH "jobQueueDepth"
 
+/**
+ * VIR_THREADPOOL_JOB_QUEUES:
+ * Macro for the threadpool jobQueues attribute: represents the number of
+ * job queues the workers take jobs from and steal jobs from each other,
+ * as VIR_TYPED_PARAM_UINT. Zero means all workers share a single queue.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_QUEUES "jobQueues"
+
+/**
+ * VIR_THREADPOOL_JOBS_STOLEN:
+ * Macro for the threadpool jobsStolen attribute: represents the number of
+ * jobs processed by a worker other than the one owning the queue the job
+ * was submitted to, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOBS_STOLEN "jobsStolen"
+
 /* Tunables for a server workerpool */
 int virAdmServerGetThreadPoolParameters(virAdmServerPtr srv,
                                         virTypedParameterPtr *params,
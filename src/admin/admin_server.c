@@ -81,6 +81,8 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
     size_t freeWorkers;
     size_t nPrioWorkers;
     size_t jobQueueDepth;
+    size_t jobQueues;
+    unsigned long long jobsStolen;
     g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
 
     virCheckFlags(0, -1);
@@ -88,7 +90,9 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
     if (virNetServerGetThreadPoolParameters(srv, &minWorkers, &maxWorkers,
                                             &nWorkers, &freeWorkers,
                                             &nPrioWorkers,
-                                            &jobQueueDepth) < 0) {
+                                            &jobQueueDepth,
+                                            &jobQueues,
+                                            &jobsStolen) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unable to retrieve threadpool parameters"));
         return -1;
@@ -118,6 +122,14 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
                                  "%s", VIR_THREADPOOL_JOB_QUEUE_DEPTH) < 0)
         return -1;
 
+    if (virTypedParamListAddUInt(paramlist, jobQueues,
+                                 "%s", VIR_THREADPOOL_JOB_QUEUES) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(paramlist, jobsStolen,
+                                   "%s", VIR_THREADPOOL_JOBS_STOLEN) < 0)
+        return -1;
+
     *nparams = virTypedParamListStealParams(paramlist, params);
 
     return 0;
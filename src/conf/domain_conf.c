@@ -7513,7 +7513,7 @@ virDomainDeviceInfoFormat(virBufferPtr buf,
                 virBufferAsprintf(buf, " bar='%s'", rombar);
         }
         if (info->romfile)
-            virBufferEscapeString(buf, " file='%s'", info->romfile);
+            virBufferEscapeAttr(buf, "file", info->romfile);
         virBufferAddLit(buf, "/>\n");
     }
 
@@ -24901,7 +24901,7 @@ virSecurityLabelDefFormat(virBufferPtr buf,
     virBufferAsprintf(buf, "<seclabel type='%s'",
                       sectype);
 
-    virBufferEscapeString(buf, " model='%s'", def->model);
+    virBufferEscapeAttr(buf, "model", def->model);
 
     if (def->type == VIR_DOMAIN_SECLABEL_NONE) {
         virBufferAddLit(buf, "/>\n");
@@ -24943,7 +24943,7 @@ virSecurityDeviceLabelDefFormat(virBufferPtr buf,
     virBufferAddLit(buf, "<seclabel");
 
     if (def->model)
-        virBufferEscapeString(buf, " model='%s'", def->model);
+        virBufferEscapeAttr(buf, "model", def->model);
 
     if (def->labelskip)
         virBufferAddLit(buf, " labelskip='yes'");
@@ -24973,7 +24973,7 @@ virDomainLeaseDefFormat(virBufferPtr buf,
     virBufferEscapeString(buf, "<key>%s</key>\n", def->key);
     virBufferEscapeString(buf, "<target path='%s'", def->path);
     if (def->offset)
-        virBufferAsprintf(buf, " offset='%llu'", def->offset);
+        virBufferAddUIntAttr(buf, "offset", def->offset);
     virBufferAddLit(buf, "/>\n");
     virBufferAdjustIndent(buf, -2);
     virBufferAddLit(buf, "</lease>\n");
@@ -24998,7 +24998,7 @@ virDomainDiskGeometryDefFormat(virBufferPtr buf,
                           def->geometry.sectors);
 
         if (def->geometry.trans != VIR_DOMAIN_DISK_TRANS_DEFAULT)
-            virBufferEscapeString(buf, " trans='%s'", trans);
+            virBufferEscapeAttr(buf, "trans", trans);
 
         virBufferAddLit(buf, "/>\n");
     }
@@ -25074,8 +25074,8 @@ virDomainDiskSourceFormatNetwork(virBufferPtr attrBuf,
     if (src->volume)
         path = g_strdup_printf("%s/%s", src->volume, src->path);
 
-    virBufferEscapeString(attrBuf, " name='%s'", path ? path : src->path);
-    virBufferEscapeString(attrBuf, " query='%s'", src->query);
+    virBufferEscapeAttr(attrBuf, "name", path ? path : src->path);
+    virBufferEscapeAttr(attrBuf, "query", src->query);
 
     if (src->haveTLS != VIR_TRISTATE_BOOL_ABSENT &&
         !(flags & VIR_DOMAIN_DEF_FORMAT_MIGRATABLE &&
@@ -25083,20 +25083,20 @@ virDomainDiskSourceFormatNetwork(virBufferPtr attrBuf,
         virBufferAsprintf(attrBuf, " tls='%s'",
                           virTristateBoolTypeToString(src->haveTLS));
     if (flags & VIR_DOMAIN_DEF_FORMAT_STATUS)
-        virBufferAsprintf(attrBuf, " tlsFromConfig='%d'", src->tlsFromConfig);
+        virBufferAddIntAttr(attrBuf, "tlsFromConfig", src->tlsFromConfig);
 
     for (n = 0; n < src->nhosts; n++) {
         virBufferAddLit(childBuf, "<host");
-        virBufferEscapeString(childBuf, " name='%s'", src->hosts[n].name);
+        virBufferEscapeAttr(childBuf, "name", src->hosts[n].name);
 
         if (src->hosts[n].port)
-            virBufferAsprintf(childBuf, " port='%u'", src->hosts[n].port);
+            virBufferAddUIntAttr(childBuf, "port", src->hosts[n].port);
 
         if (src->hosts[n].transport)
             virBufferAsprintf(childBuf, " transport='%s'",
                               virStorageNetHostTransportTypeToString(src->hosts[n].transport));
 
-        virBufferEscapeString(childBuf, " socket='%s'", src->hosts[n].socket);
+        virBufferEscapeAttr(childBuf, "socket", src->hosts[n].socket);
         virBufferAddLit(childBuf, "/>\n");
     }
 
@@ -25131,7 +25131,7 @@ virDomainDiskSourceNVMeFormat(virBufferPtr attrBuf,
     if (nvme->managed != VIR_TRISTATE_BOOL_ABSENT)
         virBufferAsprintf(attrBuf, " managed='%s'",
                           virTristateBoolTypeToString(nvme->managed));
-    virBufferAsprintf(attrBuf, " namespace='%llu'", nvme->namespc);
+    virBufferAddUIntAttr(attrBuf, "namespace", nvme->namespc);
     virPCIDeviceAddressFormat(childBuf, nvme->pciAddr, false);
 }
 
@@ -26004,8 +26004,8 @@ virDomainFSDefFormat(virBufferPtr buf,
 
     case VIR_DOMAIN_FS_TYPE_VOLUME:
         virBufferAddLit(buf, "<source");
-        virBufferEscapeString(buf, " pool='%s'", def->src->srcpool->pool);
-        virBufferEscapeString(buf, " volume='%s'", def->src->srcpool->volume);
+        virBufferEscapeAttr(buf, "pool", def->src->srcpool->pool);
+        virBufferEscapeAttr(buf, "volume", def->src->srcpool->volume);
         virBufferAddLit(buf, "/>\n");
         break;
     }
@@ -26057,7 +26057,7 @@ virDomainNetIPInfoFormat(virBufferPtr buf,
         if (familyStr)
             virBufferAsprintf(buf, " family='%s'", familyStr);
         if (def->ips[i]->prefix)
-            virBufferAsprintf(buf, " prefix='%u'", def->ips[i]->prefix);
+            virBufferAddUIntAttr(buf, "prefix", def->ips[i]->prefix);
         if (VIR_SOCKET_ADDR_VALID(&def->ips[i]->peer)) {
             if (!(ipStr = virSocketAddrFormat(&def->ips[i]->peer)))
                 return -1;
@@ -26334,10 +26334,8 @@ virDomainActualNetDefContentsFormat(virBufferPtr buf,
              * *do* need to output network/portgroup, because the
              * caller won't have done it).
              */
-            virBufferEscapeString(buf, " network='%s'",
-                                  def->data.network.name);
-            virBufferEscapeString(buf, " portgroup='%s'",
-                                  def->data.network.portgroup);
+            virBufferEscapeAttr(buf, "network", def->data.network.name);
+            virBufferEscapeAttr(buf, "portgroup", def->data.network.portgroup);
             if (virUUIDIsValid(def->data.network.portid)) {
                 char uuidstr[VIR_UUID_STRING_BUFLEN];
                 virUUIDFormat(def->data.network.portid, uuidstr);
@@ -26352,8 +26350,8 @@ virDomainActualNetDefContentsFormat(virBufferPtr buf,
              * that is used by the network, whether we are
              * "inSubElement" or not.
              */
-            virBufferEscapeString(buf, " bridge='%s'",
-                                  virDomainNetGetActualBridgeName(def));
+            virBufferEscapeAttr(buf, "bridge",
+                                virDomainNetGetActualBridgeName(def));
             if (macTableManager) {
                 virBufferAsprintf(buf, " macTableManager='%s'",
                                   virNetworkBridgeMACTableManagerTypeToString(macTableManager));
@@ -26361,8 +26359,8 @@ virDomainActualNetDefContentsFormat(virBufferPtr buf,
         } else if (actualType == VIR_DOMAIN_NET_TYPE_DIRECT) {
             const char *mode;
 
-            virBufferEscapeString(buf, " dev='%s'",
-                                  virDomainNetGetActualDirectDev(def));
+            virBufferEscapeAttr(buf, "dev",
+                                virDomainNetGetActualDirectDev(def));
             mode = virNetDevMacVLanModeTypeToString(virDomainNetGetActualDirectMode(def));
             if (!mode) {
                 virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -26555,7 +26553,7 @@ virDomainChrSourceReconnectDefFormat(virBufferPtr buf,
                       virTristateBoolTypeToString(def->enabled));
 
     if (def->enabled == VIR_TRISTATE_BOOL_YES)
-        virBufferAsprintf(buf, " timeout='%u'", def->timeout);
+        virBufferAddUIntAttr(buf, "timeout", def->timeout);
 
     virBufferAddLit(buf, "/>\n");
 }
@@ -26644,13 +26642,12 @@ virDomainNetDefFormat(virBufferPtr buf,
         case VIR_DOMAIN_NET_TYPE_NETWORK:
             virBufferEscapeString(buf, "<source network='%s'",
                                   def->data.network.name);
-            virBufferEscapeString(buf, " portgroup='%s'",
-                                  def->data.network.portgroup);
+            virBufferEscapeAttr(buf, "portgroup", def->data.network.portgroup);
             if (virUUIDIsValid(def->data.network.portid) &&
                 !(flags & (VIR_DOMAIN_DEF_FORMAT_INACTIVE))) {
                 char portidstr[VIR_UUID_STRING_BUFLEN];
                 virUUIDFormat(def->data.network.portid, portidstr);
-                virBufferEscapeString(buf, " portid='%s'", portidstr);
+                virBufferEscapeAttr(buf, "portid", portidstr);
             }
             sourceLines++;
             break;
@@ -26661,8 +26658,8 @@ virDomainNetDefFormat(virBufferPtr buf,
         case VIR_DOMAIN_NET_TYPE_VHOSTUSER:
             if (def->data.vhostuser->type == VIR_DOMAIN_CHR_TYPE_UNIX) {
                 virBufferAddLit(buf, "<source type='unix'");
-                virBufferEscapeString(buf, " path='%s'",
-                                      def->data.vhostuser->data.nix.path);
+                virBufferEscapeAttr(buf, "path",
+                                    def->data.vhostuser->data.nix.path);
                 virBufferAsprintf(buf, " mode='%s'",
                                   def->data.vhostuser->data.nix.listen ?
                                   "server"  : "client");
@@ -26811,11 +26808,11 @@ virDomainNetDefFormat(virBufferPtr buf,
         virBufferAddLit(buf, "<guest");
         /* Skip auto-generated target names for inactive config. */
         if (def->ifname_guest)
-            virBufferEscapeString(buf, " dev='%s'", def->ifname_guest);
+            virBufferEscapeAttr(buf, "dev", def->ifname_guest);
 
         /* Only set if the host is running, so shouldn't pollute output */
         if (def->ifname_guest_actual)
-            virBufferEscapeString(buf, " actual='%s'", def->ifname_guest_actual);
+            virBufferEscapeAttr(buf, "actual", def->ifname_guest_actual);
         virBufferAddLit(buf, "/>\n");
     }
     if (virDomainNetGetModelString(def)) {
@@ -26855,8 +26852,8 @@ virDomainNetDefFormat(virBufferPtr buf,
     }
     if (def->backend.tap || def->backend.vhost) {
         virBufferAddLit(buf, "<backend");
-        virBufferEscapeString(buf, " tap='%s'", def->backend.tap);
-        virBufferEscapeString(buf, " vhost='%s'", def->backend.vhost);
+        virBufferEscapeAttr(buf, "tap", def->backend.tap);
+        virBufferEscapeAttr(buf, "vhost", def->backend.vhost);
         virBufferAddLit(buf, "/>\n");
     }
     if (def->filter) {
@@ -26876,7 +26873,7 @@ virDomainNetDefFormat(virBufferPtr buf,
     if (def->teaming.type != VIR_DOMAIN_NET_TEAMING_TYPE_NONE) {
         virBufferAsprintf(buf, "<teaming type='%s'",
                           virDomainNetTeamingTypeToString(def->teaming.type));
-        virBufferEscapeString(buf, " persistent='%s'", def->teaming.persistent);
+        virBufferEscapeAttr(buf, "persistent", def->teaming.persistent);
         virBufferAddLit(buf, "/>\n");
     }
     if (def->linkstate) {
@@ -26919,8 +26916,7 @@ virDomainChrAttrsDefFormat(virBufferPtr buf,
     /* Compat with legacy <console tty='/dev/pts/5'/> syntax */
     virBufferAsprintf(buf, " type='%s'", type);
     if (tty_compat) {
-        virBufferEscapeString(buf, " tty='%s'",
-                              def->data.file.path);
+        virBufferEscapeAttr(buf, "tty", def->data.file.path);
     }
     return 0;
 }
@@ -26971,15 +26967,15 @@ virDomainChrSourceDefFormat(virBufferPtr buf,
     case VIR_DOMAIN_CHR_TYPE_UDP:
         if (def->data.udp.bindService || def->data.udp.bindHost) {
             virBufferAddLit(buf, "<source mode='bind'");
-            virBufferEscapeString(buf, " host='%s'", def->data.udp.bindHost);
-            virBufferEscapeString(buf, " service='%s'", def->data.udp.bindService);
+            virBufferEscapeAttr(buf, "host", def->data.udp.bindHost);
+            virBufferEscapeAttr(buf, "service", def->data.udp.bindService);
             virBufferAddLit(buf, "/>\n");
         }
 
         if (def->data.udp.connectService || def->data.udp.connectHost) {
             virBufferAddLit(buf, "<source mode='connect'");
-            virBufferEscapeString(buf, " host='%s'", def->data.udp.connectHost);
-            virBufferEscapeString(buf, " service='%s'", def->data.udp.connectService);
+            virBufferEscapeAttr(buf, "host", def->data.udp.connectHost);
+            virBufferEscapeAttr(buf, "service", def->data.udp.connectService);
             virBufferAddLit(buf, "/>\n");
         }
         break;
@@ -27082,7 +27078,7 @@ virDomainChrTargetDefFormat(virBufferPtr buf,
         case VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_XEN:
         case VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_VIRTIO:
             if (def->target.name)
-                virBufferEscapeString(buf, " name='%s'", def->target.name);
+                virBufferEscapeAttr(buf, "name", def->target.name);
 
             if (def->targetType == VIR_DOMAIN_CHR_CHANNEL_TARGET_TYPE_VIRTIO &&
                 def->state != VIR_DOMAIN_CHR_DEVICE_STATE_DEFAULT &&
@@ -27469,8 +27465,8 @@ virDomainShmemDefFormat(virBufferPtr buf,
 {
     virBufferEscapeString(buf, "<shmem name='%s'", def->name);
     if (def->role)
-        virBufferEscapeString(buf, " role='%s'",
-                              virDomainShmemRoleTypeToString(def->role));
+        virBufferEscapeAttr(buf, "role",
+                            virDomainShmemRoleTypeToString(def->role));
 
     virBufferAddLit(buf, ">\n");
     virBufferAdjustIndent(buf, 2);
@@ -27483,14 +27479,14 @@ virDomainShmemDefFormat(virBufferPtr buf,
 
     if (def->server.enabled) {
         virBufferAddLit(buf, "<server");
-        virBufferEscapeString(buf, " path='%s'", def->server.chr.data.nix.path);
+        virBufferEscapeAttr(buf, "path", def->server.chr.data.nix.path);
         virBufferAddLit(buf, "/>\n");
     }
 
     if (def->msi.enabled) {
         virBufferAddLit(buf, "<msi");
         if (def->msi.vectors)
-            virBufferAsprintf(buf, " vectors='%u'", def->msi.vectors);
+            virBufferAddUIntAttr(buf, "vectors", def->msi.vectors);
         if (def->msi.ioeventfd)
             virBufferAsprintf(buf, " ioeventfd='%s'",
                               virTristateSwitchTypeToString(def->msi.ioeventfd));
@@ -27520,7 +27516,7 @@ virDomainRNGDefFormat(virBufferPtr buf,
     if (def->rate) {
         virBufferAsprintf(buf, "<rate bytes='%u'", def->rate);
         if (def->period)
-            virBufferAsprintf(buf, " period='%u'", def->period);
+            virBufferAddUIntAttr(buf, "period", def->period);
         virBufferAddLit(buf, "/>\n");
     }
     virBufferAsprintf(buf, "<backend model='%s'", backend);
@@ -27711,7 +27707,7 @@ virDomainVideoAccelDefFormat(virBufferPtr buf,
         virBufferAsprintf(buf, " accel2d='%s'",
                           virTristateBoolTypeToString(def->accel2d));
     }
-    virBufferEscapeString(buf, " rendernode='%s'", def->rendernode);
+    virBufferEscapeAttr(buf, "rendernode", def->rendernode);
     virBufferAddLit(buf, "/>\n");
 }
 
@@ -27760,15 +27756,15 @@ virDomainVideoDefFormat(virBufferPtr buf,
     virBufferAsprintf(buf, "<model type='%s'",
                       model);
     if (def->ram)
-        virBufferAsprintf(buf, " ram='%u'", def->ram);
+        virBufferAddUIntAttr(buf, "ram", def->ram);
     if (def->vram)
-        virBufferAsprintf(buf, " vram='%u'", def->vram);
+        virBufferAddUIntAttr(buf, "vram", def->vram);
     if (def->vram64)
         virBufferAsprintf(buf, " vram64='%u'", def->vram64);
     if (def->vgamem)
-        virBufferAsprintf(buf, " vgamem='%u'", def->vgamem);
+        virBufferAddUIntAttr(buf, "vgamem", def->vgamem);
     if (def->heads)
-        virBufferAsprintf(buf, " heads='%u'", def->heads);
+        virBufferAddUIntAttr(buf, "heads", def->heads);
     if (def->primary)
         virBufferAddLit(buf, " primary='yes'");
     if (def->accel || def->res) {
@@ -27898,7 +27894,7 @@ virDomainTimerDefFormat(virBufferPtr buf,
 
     if (def->name == VIR_DOMAIN_TIMER_NAME_TSC) {
         if (def->frequency > 0)
-            virBufferAsprintf(buf, " frequency='%lu'", def->frequency);
+            virBufferAddUIntAttr(buf, "frequency", def->frequency);
 
         if (def->mode != -1) {
             const char *mode
@@ -27921,11 +27917,11 @@ virDomainTimerDefFormat(virBufferPtr buf,
         virBufferAdjustIndent(buf, 2);
         virBufferAddLit(buf, "<catchup");
         if (def->catchup.threshold > 0)
-            virBufferAsprintf(buf, " threshold='%lu'", def->catchup.threshold);
+            virBufferAddUIntAttr(buf, "threshold", def->catchup.threshold);
         if (def->catchup.slew > 0)
-            virBufferAsprintf(buf, " slew='%lu'", def->catchup.slew);
+            virBufferAddUIntAttr(buf, "slew", def->catchup.slew);
         if (def->catchup.limit > 0)
-            virBufferAsprintf(buf, " limit='%lu'", def->catchup.limit);
+            virBufferAddUIntAttr(buf, "limit", def->catchup.limit);
         virBufferAddLit(buf, "/>\n");
         virBufferAdjustIndent(buf, -2);
         virBufferAddLit(buf, "</timer>\n");
@@ -27943,8 +27939,7 @@ virDomainGraphicsAuthDefFormatAttr(virBufferPtr buf,
         return;
 
     if (flags & VIR_DOMAIN_DEF_FORMAT_SECURE)
-        virBufferEscapeString(buf, " passwd='%s'",
-                              def->passwd);
+        virBufferEscapeAttr(buf, "passwd", def->passwd);
 
     if (def->expires) {
         g_autoptr(GDateTime) then = NULL;
@@ -27956,8 +27951,8 @@ virDomainGraphicsAuthDefFormatAttr(virBufferPtr buf,
     }
 
     if (def->connected)
-        virBufferEscapeString(buf, " connected='%s'",
-                              virDomainGraphicsAuthConnectedTypeToString(def->connected));
+        virBufferEscapeAttr(buf, "connected",
+                            virDomainGraphicsAuthConnectedTypeToString(def->connected));
 }
 
 
@@ -27986,18 +27981,18 @@ virDomainGraphicsListenDefFormat(virBufferPtr buf,
 
     if (def->network &&
         (def->type == VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_NETWORK)) {
-        virBufferEscapeString(buf, " network='%s'", def->network);
+        virBufferEscapeAttr(buf, "network", def->network);
     }
 
     if (def->socket &&
         def->type == VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_SOCKET &&
         !(def->autoGenerated &&
           (flags & VIR_DOMAIN_DEF_FORMAT_MIGRATABLE))) {
-        virBufferEscapeString(buf, " socket='%s'", def->socket);
+        virBufferEscapeAttr(buf, "socket", def->socket);
     }
 
     if (flags & VIR_DOMAIN_DEF_FORMAT_STATUS) {
-        virBufferAsprintf(buf, " fromConfig='%d'", def->fromConfig);
+        virBufferAddIntAttr(buf, "fromConfig", def->fromConfig);
         virBufferAsprintf(buf, " autoGenerated='%s'",
                           def->autoGenerated ? "yes" : "no");
     }
@@ -28043,7 +28038,7 @@ virDomainSpiceGLDefFormat(virBufferPtr buf, virDomainGraphicsDefPtr def)
 
     virBufferAsprintf(buf, "<gl enable='%s'",
                       virTristateBoolTypeToString(def->data.spice.gl));
-    virBufferEscapeString(buf, " rendernode='%s'", def->data.spice.rendernode);
+    virBufferEscapeAttr(buf, "rendernode", def->data.spice.rendernode);
     virBufferAddLit(buf, "/>\n");
 }
 
@@ -28082,7 +28077,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
             if (glisten->socket &&
                 !((glisten->autoGenerated || glisten->fromConfig) &&
                   (flags & VIR_DOMAIN_DEF_FORMAT_MIGRATABLE))) {
-                virBufferEscapeString(buf, " socket='%s'", glisten->socket);
+                virBufferEscapeAttr(buf, "socket", glisten->socket);
             }
             break;
 
@@ -28090,8 +28085,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
         case VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_NETWORK:
             if (def->data.vnc.port &&
                 (!def->data.vnc.autoport || !(flags & VIR_DOMAIN_DEF_FORMAT_INACTIVE)))
-                virBufferAsprintf(buf, " port='%d'",
-                                  def->data.vnc.port);
+                virBufferAddIntAttr(buf, "port", def->data.vnc.port);
             else if (def->data.vnc.autoport)
                 virBufferAddLit(buf, " port='-1'");
 
@@ -28102,7 +28096,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
                 (flags & VIR_DOMAIN_DEF_FORMAT_INACTIVE))
                 virBufferAddLit(buf, " websocket='-1'");
             else if (def->data.vnc.websocket)
-                virBufferAsprintf(buf, " websocket='%d'", def->data.vnc.websocket);
+                virBufferAddIntAttr(buf, "websocket", def->data.vnc.websocket);
 
             if (flags & VIR_DOMAIN_DEF_FORMAT_STATUS)
                 virBufferAsprintf(buf, " websocketGenerated='%s'",
@@ -28116,8 +28110,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
         }
 
         if (def->data.vnc.keymap)
-            virBufferEscapeString(buf, " keymap='%s'",
-                                  def->data.vnc.keymap);
+            virBufferEscapeAttr(buf, "keymap", def->data.vnc.keymap);
 
         if (def->data.vnc.sharePolicy)
             virBufferAsprintf(buf, " sharePolicy='%s'",
@@ -28129,12 +28122,10 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
 
     case VIR_DOMAIN_GRAPHICS_TYPE_SDL:
         if (def->data.sdl.display)
-            virBufferEscapeString(buf, " display='%s'",
-                                  def->data.sdl.display);
+            virBufferEscapeAttr(buf, "display", def->data.sdl.display);
 
         if (def->data.sdl.xauth)
-            virBufferEscapeString(buf, " xauth='%s'",
-                                  def->data.sdl.xauth);
+            virBufferEscapeAttr(buf, "xauth", def->data.sdl.xauth);
         if (def->data.sdl.fullscreen)
             virBufferAddLit(buf, " fullscreen='yes'");
 
@@ -28154,8 +28145,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
 
     case VIR_DOMAIN_GRAPHICS_TYPE_RDP:
         if (def->data.rdp.port)
-            virBufferAsprintf(buf, " port='%d'",
-                              def->data.rdp.port);
+            virBufferAddIntAttr(buf, "port", def->data.rdp.port);
         else if (def->data.rdp.autoport)
             virBufferAddLit(buf, " port='0'");
 
@@ -28174,8 +28164,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
 
     case VIR_DOMAIN_GRAPHICS_TYPE_DESKTOP:
         if (def->data.desktop.display)
-            virBufferEscapeString(buf, " display='%s'",
-                                  def->data.desktop.display);
+            virBufferEscapeAttr(buf, "display", def->data.desktop.display);
 
         if (def->data.desktop.fullscreen)
             virBufferAddLit(buf, " fullscreen='yes'");
@@ -28193,12 +28182,10 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
         case VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_ADDRESS:
         case VIR_DOMAIN_GRAPHICS_LISTEN_TYPE_NETWORK:
             if (def->data.spice.port)
-                virBufferAsprintf(buf, " port='%d'",
-                                  def->data.spice.port);
+                virBufferAddIntAttr(buf, "port", def->data.spice.port);
 
             if (def->data.spice.tlsPort)
-                virBufferAsprintf(buf, " tlsPort='%d'",
-                                  def->data.spice.tlsPort);
+                virBufferAddIntAttr(buf, "tlsPort", def->data.spice.tlsPort);
 
             virBufferAsprintf(buf, " autoport='%s'",
                               def->data.spice.autoport ? "yes" : "no");
@@ -28229,8 +28216,7 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
         }
 
         if (def->data.spice.keymap)
-            virBufferEscapeString(buf, " keymap='%s'",
-                                  def->data.spice.keymap);
+            virBufferEscapeAttr(buf, "keymap", def->data.spice.keymap);
 
         if (def->data.spice.defaultMode != VIR_DOMAIN_GRAPHICS_SPICE_CHANNEL_MODE_ANY)
             virBufferAsprintf(buf, " defaultMode='%s'",
@@ -28250,8 +28236,8 @@ virDomainGraphicsDefFormat(virBufferPtr buf,
         }
 
         virBufferAddLit(buf, "<gl");
-        virBufferEscapeString(buf, " rendernode='%s'",
-                              def->data.egl_headless.rendernode);
+        virBufferEscapeAttr(buf, "rendernode",
+                            def->data.egl_headless.rendernode);
         virBufferAddLit(buf, "/>\n");
         break;
     case VIR_DOMAIN_GRAPHICS_TYPE_LAST:
@@ -28637,7 +28623,7 @@ virDomainLoaderDefFormat(virBufferPtr buf,
 
     if (loader->nvram || loader->templt) {
         virBufferAddLit(buf, "<nvram");
-        virBufferEscapeString(buf, " template='%s'", loader->templt);
+        virBufferEscapeAttr(buf, "template", loader->templt);
         if (loader->nvram)
             virBufferEscapeString(buf, ">%s</nvram>\n", loader->nvram);
         else
@@ -29045,7 +29031,7 @@ virDomainCpuDefFormat(virBufferPtr buf,
         virBufferAsprintf(buf, " cpuset='%s'", cpumask);
     }
     if (virDomainDefHasVcpusOffline(def))
-        virBufferAsprintf(buf, " current='%u'", virDomainDefGetVcpus(def));
+        virBufferAddUIntAttr(buf, "current", virDomainDefGetVcpus(def));
     virBufferAsprintf(buf, ">%u</vcpu>\n", virDomainDefGetVcpusMax(def));
 
     if (def->individualvcpus) {
@@ -29061,7 +29047,7 @@ virDomainCpuDefFormat(virBufferPtr buf,
                                   virTristateBoolTypeToString(vcpu->hotpluggable));
 
             if (vcpu->order != 0)
-                virBufferAsprintf(buf, " order='%d'", vcpu->order);
+                virBufferAddUIntAttr(buf, "order", vcpu->order);
 
             virBufferAddLit(buf, "/>\n");
         }
@@ -29639,7 +29625,7 @@ virDomainDefFormatInternalSetRootName(virDomainDefPtr def,
 
     virBufferAsprintf(buf, "<%s type='%s'", rootname, type);
     if (!(flags & VIR_DOMAIN_DEF_FORMAT_INACTIVE))
-        virBufferAsprintf(buf, " id='%d'", def->id);
+        virBufferAddIntAttr(buf, "id", def->id);
     if (def->namespaceData && def->ns.format)
         virXMLNamespaceFormatNS(buf, &def->ns);
     virBufferAddLit(buf, ">\n");
@@ -29828,7 +29814,7 @@ virDomainDefFormatInternalSetRootName(virDomainDefPtr def,
             virBufferAsprintf(buf, "<bootmenu enable='%s'",
                               virTristateBoolTypeToString(def->os.bootmenu));
             if (def->os.bm_timeout_set)
-                virBufferAsprintf(buf, " timeout='%u'", def->os.bm_timeout);
+                virBufferAddUIntAttr(buf, "timeout", def->os.bm_timeout);
             virBufferAddLit(buf, "/>\n");
         }
 
@@ -29838,7 +29824,8 @@ virDomainDefFormatInternalSetRootName(virDomainDefPtr def,
                 virBufferAsprintf(buf, " useserial='%s'",
                                   virTristateBoolTypeToString(def->os.bios.useserial));
             if (def->os.bios.rt_set)
-                virBufferAsprintf(buf, " rebootTimeout='%d'", def->os.bios.rt_delay);
+                virBufferAddIntAttr(buf, "rebootTimeout",
+                                    def->os.bios.rt_delay);
 
             virBufferAddLit(buf, "/>\n");
         }
@@ -29906,7 +29893,7 @@ virDomainDefFormatInternalSetRootName(virDomainDefPtr def,
         }
         break;
     case VIR_DOMAIN_CLOCK_OFFSET_TIMEZONE:
-        virBufferEscapeString(buf, " timezone='%s'", def->clock.data.timezone);
+        virBufferEscapeAttr(buf, "timezone", def->clock.data.timezone);
         break;
     }
     if (def->clock.ntimers == 0) {
@@ -30369,11 +30356,36 @@ virDomainObjSave(virDomainObjPtr obj,
                           VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST);
 
     g_autofree char *xml = NULL;
+    g_autofree char *statusFile = NULL;
+    unsigned char hash[VIR_CRYPTO_HASH_SIZE_SHA256];
 
     if (!(xml = virDomainObjFormat(obj, xmlopt, flags)))
         return -1;
 
-    return virDomainDefSaveXML(obj->def, statusDir, xml);
+    if (virCryptoHashBuf(VIR_CRYPTO_HASH_SHA256, xml, hash) < 0)
+        return -1;
+
+    /* Status is saved after most changes of a running domain, many of
+     * which don't end up changing the XML. Don't rewrite and sync the
+     * file again unless it has disappeared in the meantime. */
+    if (obj->statusHashValid &&
+        memcmp(hash, obj->statusHash, sizeof(hash)) == 0) {
+        if (!(statusFile = virDomainConfigFile(statusDir, obj->def->name)))
+            return -1;
+
+        if (virFileExists(statusFile))
+            return 0;
+    }
+
+    obj->statusHashValid = false;
+
+    if (virDomainDefSaveXML(obj->def, statusDir, xml) < 0)
+        return -1;
+
+    memcpy(obj->statusHash, hash, sizeof(hash));
+    obj->statusHashValid = true;
+
+    return 0;
 }
 
 
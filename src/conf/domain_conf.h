@@ -57,6 +57,7 @@
 #include "virsavecookie.h"
 #include "virresctrl.h"
 #include "virenum.h"
+#include "vircrypto.h"
 
 /* Flags for the 'type' field in virDomainDeviceDef */
 typedef enum {
@@ -2745,6 +2746,10 @@ struct _virDomainObj {
 
     unsigned long long original_memlock; /* Original RLIMIT_MEMLOCK, zero if no
                                           * restore will be required later */
+
+    /* Hash of the status XML last written by virDomainObjSave */
+    unsigned char statusHash[VIR_CRYPTO_HASH_SIZE_SHA256];
+    bool statusHashValid;
 };
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainObj, virObjectUnref);
@@ -1982,6 +1982,37 @@ virDomainQemuMonitorEventDispatchFunc(virConnectPtr conn,
 }
 
 
+/**
+ * virDomainEventCoalesce:
+ * @prev: an earlier queued domain event
+ * @event: a later queued domain event with the same ID for the same domain
+ *
+ * A virObjectEventCoalesceFunc for domain events.  Lifecycle events
+ * which repeat the preceding event verbatim are redundant; every other
+ * event is always delivered.  In particular two identical block job
+ * events usually report two different jobs on the same disk.
+ *
+ * Returns true if @event can be dropped.
+ */
+bool
+virDomainEventCoalesce(virObjectEventPtr prev,
+                       virObjectEventPtr event)
+{
+    if (prev->meta.id != event->meta.id)
+        return false;
+
+    if (virObjectIsClass(event, virDomainEventLifecycleClass) &&
+        virObjectIsClass(prev, virDomainEventLifecycleClass)) {
+        virDomainEventLifecyclePtr a = (virDomainEventLifecyclePtr)prev;
+        virDomainEventLifecyclePtr b = (virDomainEventLifecyclePtr)event;
+
+        return a->type == b->type && a->detail == b->detail;
+    }
+
+    return false;
+}
+
+
 /**
  * virDomainEventStateRegister:
  * @conn: connection to associate with callback
@@ -255,6 +255,10 @@ virDomainEventBlockThresholdNewFromDom(virDomainPtr dom,
                                        unsigned long long threshold,
                                        unsigned long long excess);
 
+bool
+virDomainEventCoalesce(virObjectEventPtr prev,
+                       virObjectEventPtr event);
+
 int
 virDomainEventStateRegister(virConnectPtr conn,
                             virObjectEventStatePtr state,
@@ -30,6 +30,7 @@
 #include "datatypes.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virobject.h"
 #include "virstring.h"
 
@@ -79,6 +80,8 @@ struct _virObjectEventState {
     int timer;
     /* Flag if we're in process of dispatching */
     bool isDispatching;
+    /* Drops redundant events within one flush, if set */
+    virObjectEventCoalesceFunc coalesce;
 };
 
 static virClassPtr virObjectEventClass;
@@ -721,6 +724,58 @@ virObjectEventStateQueueDispatch(virObjectEventStatePtr state,
 }
 
 
+/**
+ * virObjectEventStateCoalesce:
+ * @state: the event state object
+ * @queue: queue of events about to be dispatched
+ *
+ * Remove events from @queue which the coalesce function of @state
+ * considers redundant with the preceding event of the same ID for the
+ * same object.  Events which survive keep their relative order.
+ */
+static void
+virObjectEventStateCoalesce(virObjectEventStatePtr state,
+                            virObjectEventQueuePtr queue)
+{
+    g_autoptr(virHashTable) last = NULL;
+    size_t dropped = 0;
+    size_t i;
+    size_t j;
+
+    if (!state->coalesce || queue->count < 2)
+        return;
+
+    if (!(last = virHashNew(NULL)))
+        return;
+
+    for (i = 0, j = 0; i < queue->count; i++) {
+        virObjectEventPtr event = queue->events[i];
+        virObjectEventPtr prev;
+        g_autofree char *key = NULL;
+
+        /* The dispatch function tells apart the event families sharing
+         * one state (e.g. domain and QEMU monitor events) */
+        key = g_strdup_printf("%p:%d:%d:%s", event->dispatch, event->eventID,
+                              event->remoteID, NULLSTR(event->meta.key));
+
+        if ((prev = virHashLookup(last, key)) &&
+            state->coalesce(prev, event)) {
+            virObjectUnref(event);
+            dropped++;
+            continue;
+        }
+
+        if (virHashUpdateEntry(last, key, event) < 0)
+            virResetLastError();
+        queue->events[j++] = event;
+    }
+
+    if (dropped)
+        VIR_DEBUG("Coalesced %zu of %zu queued events", dropped, queue->count);
+    queue->count = j;
+}
+
+
 /**
  * virObjectEventStateQueueRemote:
  * @state: the event state object
@@ -816,6 +871,8 @@ virObjectEventStateFlush(virObjectEventStatePtr state)
     if (state->timer != -1)
         virEventUpdateTimeout(state->timer, -1);
 
+    virObjectEventStateCoalesce(state, &tempQueue);
+
     virObjectEventStateQueueDispatch(state,
                                      &tempQueue,
                                      state->callbacks);
@@ -1076,3 +1133,23 @@ virObjectEventStateSetRemote(virConnectPtr conn,
     }
     virObjectUnlock(state);
 }
+
+
+/**
+ * virObjectEventStateSetCoalesce:
+ * @state: object event state
+ * @func: function deciding which events are redundant, or NULL
+ *
+ * Enable dropping of redundant events.  Every time the queue of
+ * @state is flushed, an event is discarded if @func says it adds
+ * nothing to the previous queued event with the same ID for the same
+ * object.  Passing NULL turns coalescing off again.
+ */
+void
+virObjectEventStateSetCoalesce(virObjectEventStatePtr state,
+                               virObjectEventCoalesceFunc func)
+{
+    virObjectLock(state);
+    state->coalesce = func;
+    virObjectUnlock(state);
+}
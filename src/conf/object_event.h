@@ -81,6 +81,23 @@ virObjectEventStateEventID(virConnectPtr conn,
                            int *remoteID)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 
+/**
+ * virObjectEventCoalesceFunc:
+ * @prev: an earlier queued event
+ * @event: a later queued event
+ *
+ * Both events have the same event ID and describe the same object.
+ * Return true if @event carries no information that @prev did not
+ * already deliver, so that it can be dropped.
+ */
+typedef bool (*virObjectEventCoalesceFunc)(virObjectEventPtr prev,
+                                           virObjectEventPtr event);
+
+void
+virObjectEventStateSetCoalesce(virObjectEventStatePtr state,
+                               virObjectEventCoalesceFunc func)
+    ATTRIBUTE_NONNULL(1);
+
 void
 virObjectEventStateSetRemote(virConnectPtr conn,
                              virObjectEventStatePtr state,
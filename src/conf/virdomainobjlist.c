@@ -29,8 +29,11 @@
 #include "snapshot_conf.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhostcpu.h"
 #include "virlog.h"
+#include "virprobe.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "virdomainsnapshotobjlist.h"
 #include "virdomaincheckpointobjlist.h"
 
@@ -42,6 +45,24 @@ static virClassPtr virDomainObjListClass;
 static void virDomainObjListDispose(void *obj);
 
 
+/*
+ * Lookups by UUID and name are by far the most frequent operation on
+ * the list and all they need is that the hash tables don't change while
+ * they grab a reference to the object. Rather than having all of them
+ * bounce the cacheline of the single RW lock of the list, every thread
+ * uses one of several lookup locks in read mode. Anyone modifying the
+ * list takes all of them in write mode on top of the list lock.
+ */
+#define VIR_DOMAIN_OBJ_LIST_LOOKUP_LOCKS 64
+
+typedef union _virDomainObjListLookupLock virDomainObjListLookupLock;
+union _virDomainObjListLookupLock {
+    virRWLock lock;
+    /* keeps each lock on its own cachelines without relying
+     * on the alignment of the allocation */
+    char pad[128];
+};
+
 struct _virDomainObjList {
     virObjectRWLockable parent;
 
@@ -52,8 +73,15 @@ struct _virDomainObjList {
     /* name -> virDomainObj mapping for O(1),
      * lockless lookup-by-name */
     virHashTable *objsName;
+
+    size_t nlookupLocks;
+    virDomainObjListLookupLock lookupLocks[VIR_DOMAIN_OBJ_LIST_LOOKUP_LOCKS];
 };
 
+/* Index of the lookup lock used by the current thread */
+static __thread int virDomainObjListLookupLockIdx = -1;
+static unsigned int virDomainObjListLookupLockNext;
+
 
 static int virDomainObjListOnceInit(void)
 {
@@ -81,6 +109,15 @@ virDomainObjListPtr virDomainObjListNew(void)
         return NULL;
     }
 
+    for (; doms->nlookupLocks < VIR_DOMAIN_OBJ_LIST_LOOKUP_LOCKS; doms->nlookupLocks++) {
+        if (virRWLockInit(&doms->lookupLocks[doms->nlookupLocks].lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to initialize lookup lock"));
+            virObjectUnref(doms);
+            return NULL;
+        }
+    }
+
     return doms;
 }
 
@@ -88,9 +125,77 @@ virDomainObjListPtr virDomainObjListNew(void)
 static void virDomainObjListDispose(void *obj)
 {
     virDomainObjListPtr doms = obj;
+    size_t i;
 
     virHashFree(doms->objs);
     virHashFree(doms->objsName);
+
+    for (i = 0; i < doms->nlookupLocks; i++)
+        virRWLockDestroy(&doms->lookupLocks[i].lock);
+}
+
+
+/**
+ * virDomainObjListLookupBegin:
+ * @doms: Domain object list
+ *
+ * Locks @doms for reading the hash tables. Unlike virObjectRWLockRead
+ * this only touches a lock which is (mostly) private to the calling
+ * thread, so lookups from many threads don't contend with each other.
+ * Release the lock with virDomainObjListLookupEnd.
+ *
+ * Returns the lock to pass to virDomainObjListLookupEnd.
+ */
+static virRWLockPtr
+virDomainObjListLookupBegin(virDomainObjListPtr doms)
+{
+    virRWLockPtr lock;
+
+    if (virDomainObjListLookupLockIdx < 0) {
+        unsigned int next = g_atomic_int_add(&virDomainObjListLookupLockNext, 1);
+
+        virDomainObjListLookupLockIdx = next % VIR_DOMAIN_OBJ_LIST_LOOKUP_LOCKS;
+    }
+
+    lock = &doms->lookupLocks[virDomainObjListLookupLockIdx].lock;
+    virRWLockRead(lock);
+    return lock;
+}
+
+
+static void
+virDomainObjListLookupEnd(virRWLockPtr lock)
+{
+    virRWLockUnlock(lock);
+}
+
+
+/**
+ * virDomainObjListLockWrite:
+ * @doms: Domain object list
+ *
+ * Locks @doms for modification, excluding both the readers using
+ * virObjectRWLockRead and lookups using virDomainObjListLookupBegin.
+ */
+static void
+virDomainObjListLockWrite(virDomainObjListPtr doms)
+{
+    size_t i;
+
+    virObjectRWLockWrite(doms);
+    for (i = 0; i < doms->nlookupLocks; i++)
+        virRWLockWrite(&doms->lookupLocks[i].lock);
+}
+
+
+static void
+virDomainObjListUnlockWrite(virDomainObjListPtr doms)
+{
+    size_t i;
+
+    for (i = doms->nlookupLocks; i > 0; i--)
+        virRWLockUnlock(&doms->lookupLocks[i - 1].lock);
+    virObjectRWUnlock(doms);
 }
 
 
@@ -111,6 +216,27 @@ static int virDomainObjListSearchID(const void *payload,
 }
 
 
+/*
+ * Locks @obj found by a lookup which already dropped the list lock.
+ * Returns NULL and releases the reference if @obj is being removed.
+ */
+static virDomainObjPtr
+virDomainObjListLockFound(virDomainObjPtr obj)
+{
+    if (!obj)
+        return NULL;
+
+    virObjectLock(obj);
+    if (obj->removing) {
+        virObjectUnlock(obj);
+        virObjectUnref(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+
 virDomainObjPtr
 virDomainObjListFindByID(virDomainObjListPtr doms,
                          int id)
@@ -121,16 +247,8 @@ virDomainObjListFindByID(virDomainObjListPtr doms,
     obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
     virObjectRef(obj);
     virObjectRWUnlock(doms);
-    if (obj) {
-        virObjectLock(obj);
-        if (obj->removing) {
-            virObjectUnlock(obj);
-            virObjectUnref(obj);
-            obj = NULL;
-        }
-    }
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -163,19 +281,17 @@ virDomainObjPtr
 virDomainObjListFindByUUID(virDomainObjListPtr doms,
                            const unsigned char *uuid)
 {
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virRWLockPtr lock;
     virDomainObjPtr obj;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByUUIDLocked(doms, uuid);
-    virObjectRWUnlock(doms);
+    virUUIDFormat(uuid, uuidstr);
 
-    if (obj && obj->removing) {
-        virObjectUnlock(obj);
-        virObjectUnref(obj);
-        obj = NULL;
-    }
+    lock = virDomainObjListLookupBegin(doms);
+    obj = virObjectRef(virHashLookup(doms->objs, uuidstr));
+    virDomainObjListLookupEnd(lock);
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -206,19 +322,14 @@ virDomainObjPtr
 virDomainObjListFindByName(virDomainObjListPtr doms,
                            const char *name)
 {
+    virRWLockPtr lock;
     virDomainObjPtr obj;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByNameLocked(doms, name);
-    virObjectRWUnlock(doms);
-
-    if (obj && obj->removing) {
-        virObjectUnlock(obj);
-        virObjectUnref(obj);
-        obj = NULL;
-    }
+    lock = virDomainObjListLookupBegin(doms);
+    obj = virObjectRef(virHashLookup(doms->objsName, name));
+    virDomainObjListLookupEnd(lock);
 
-    return obj;
+    return virDomainObjListLockFound(obj);
 }
 
 
@@ -359,9 +470,9 @@ virDomainObjPtr virDomainObjListAdd(virDomainObjListPtr doms,
 {
     virDomainObjPtr ret;
 
-    virObjectRWLockWrite(doms);
+    virDomainObjListLockWrite(doms);
     ret = virDomainObjListAddLocked(doms, def, xmlopt, flags, oldDef);
-    virObjectRWUnlock(doms);
+    virDomainObjListUnlockWrite(doms);
     return ret;
 }
 
@@ -405,11 +516,11 @@ virDomainObjListRemove(virDomainObjListPtr doms,
     dom->removing = true;
     virObjectRef(dom);
     virObjectUnlock(dom);
-    virObjectRWLockWrite(doms);
+    virDomainObjListLockWrite(doms);
     virObjectLock(dom);
     virDomainObjListRemoveLocked(doms, dom);
     virObjectUnref(dom);
-    virObjectRWUnlock(doms);
+    virDomainObjListUnlockWrite(doms);
 }
 
 
@@ -447,7 +558,7 @@ virDomainObjListRename(virDomainObjListPtr doms,
      * hold a lock on dom but not refcount it. */
     virObjectRef(dom);
     virObjectUnlock(dom);
-    virObjectRWLockWrite(doms);
+    virDomainObjListLockWrite(doms);
     virObjectLock(dom);
     virObjectUnref(dom);
 
@@ -475,84 +586,158 @@ virDomainObjListRename(virDomainObjListPtr doms,
 
     ret = 0;
  cleanup:
-    virObjectRWUnlock(doms);
+    virDomainObjListUnlockWrite(doms);
     VIR_FREE(old_name);
     return ret;
 }
 
 
-static virDomainObjPtr
-virDomainObjListLoadConfig(virDomainObjListPtr doms,
-                           virDomainXMLOptionPtr xmlopt,
-                           const char *configDir,
-                           const char *autostartDir,
-                           const char *name,
-                           virDomainLoadConfigNotify notify,
-                           void *opaque)
+/* Minimum number of files a worker thread should parse to be
+ * worth spawning */
+#define VIR_DOMAIN_OBJ_LIST_LOAD_PER_WORKER 8
+
+typedef struct _virDomainObjListLoadEntry virDomainObjListLoadEntry;
+typedef virDomainObjListLoadEntry *virDomainObjListLoadEntryPtr;
+struct _virDomainObjListLoadEntry {
+    char *name;
+
+    /* filled in by virDomainObjListLoadParse */
+    virDomainDefPtr def;    /* inactive config */
+    int autostart;
+    virDomainObjPtr obj;    /* live status, unlocked */
+};
+
+typedef struct _virDomainObjListLoadData virDomainObjListLoadData;
+typedef virDomainObjListLoadData *virDomainObjListLoadDataPtr;
+struct _virDomainObjListLoadData {
+    const char *configDir;
+    const char *autostartDir;
+    bool liveStatus;
+    virDomainXMLOptionPtr xmlopt;
+
+    virDomainObjListLoadEntryPtr entries;
+    size_t nentries;
+    int next; /* atomic, index of the next entry to parse */
+};
+
+
+static int
+virDomainObjListParseConfig(virDomainObjListLoadDataPtr data,
+                            virDomainObjListLoadEntryPtr entry)
 {
-    char *configFile = NULL, *autostartLink = NULL;
+    g_autofree char *configFile = NULL;
+    g_autofree char *autostartLink = NULL;
     virDomainDefPtr def = NULL;
-    virDomainObjPtr dom;
-    int autostart;
-    virDomainDefPtr oldDef = NULL;
 
-    if ((configFile = virDomainConfigFile(configDir, name)) == NULL)
-        goto error;
-    if (!(def = virDomainDefParseFile(configFile, xmlopt, NULL,
+    if ((configFile = virDomainConfigFile(data->configDir, entry->name)) == NULL)
+        return -1;
+    if (!(def = virDomainDefParseFile(configFile, data->xmlopt, NULL,
                                       VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                       VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
                                       VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
+        return -1;
 
-    if ((autostartLink = virDomainConfigFile(autostartDir, name)) == NULL)
-        goto error;
+    if ((autostartLink = virDomainConfigFile(data->autostartDir,
+                                             entry->name)) == NULL ||
+        (entry->autostart = virFileLinkPointsTo(autostartLink,
+                                                configFile)) < 0) {
+        virDomainDefFree(def);
+        return -1;
+    }
 
-    if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
-        goto error;
+    entry->def = def;
+    return 0;
+}
 
-    if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef)))
-        goto error;
 
-    dom->autostart = autostart;
+static int
+virDomainObjListParseStatus(virDomainObjListLoadDataPtr data,
+                            virDomainObjListLoadEntryPtr entry)
+{
+    g_autofree char *statusFile = NULL;
+    virDomainObjPtr obj;
+
+    if ((statusFile = virDomainConfigFile(data->configDir, entry->name)) == NULL)
+        return -1;
+
+    if (!(obj = virDomainObjParseFile(statusFile, data->xmlopt,
+                                      VIR_DOMAIN_DEF_PARSE_STATUS |
+                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
+                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
+                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
+        return -1;
+
+    /* The object is handed over to another thread for insertion */
+    virObjectUnlock(obj);
+    entry->obj = obj;
+    return 0;
+}
+
+
+/*
+ * Parses the files of @data in a loop until there are none left. This
+ * runs concurrently in several threads, so it must not touch the
+ * domain list itself.
+ */
+static void
+virDomainObjListLoadParse(void *opaque)
+{
+    virDomainObjListLoadDataPtr data = opaque;
+    size_t i;
+
+    while ((i = g_atomic_int_add(&data->next, 1)) < data->nentries) {
+        virDomainObjListLoadEntryPtr entry = data->entries + i;
+        int rc;
+
+        VIR_INFO("Loading config file '%s.xml'", entry->name);
+        if (data->liveStatus)
+            rc = virDomainObjListParseStatus(data, entry);
+        else
+            rc = virDomainObjListParseConfig(data, entry);
+
+        /* NB: ignoring errors, so one malformed config doesn't
+           kill the whole process */
+        if (rc < 0)
+            VIR_ERROR(_("Failed to load config for domain '%s'"), entry->name);
+    }
+}
+
+
+static virDomainObjPtr
+virDomainObjListLoadConfig(virDomainObjListPtr doms,
+                           virDomainXMLOptionPtr xmlopt,
+                           virDomainObjListLoadEntryPtr entry,
+                           virDomainLoadConfigNotify notify,
+                           void *opaque)
+{
+    virDomainObjPtr dom;
+    virDomainDefPtr oldDef = NULL;
+
+    if (!(dom = virDomainObjListAddLocked(doms, entry->def, xmlopt, 0, &oldDef)))
+        return NULL;
+    entry->def = NULL;
+
+    dom->autostart = entry->autostart;
 
     if (notify)
         (*notify)(dom, oldDef == NULL, opaque);
 
     virDomainDefFree(oldDef);
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
     return dom;
-
- error:
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
-    virDomainDefFree(def);
-    return NULL;
 }
 
 
 static virDomainObjPtr
 virDomainObjListLoadStatus(virDomainObjListPtr doms,
-                           const char *statusDir,
-                           const char *name,
-                           virDomainXMLOptionPtr xmlopt,
+                           virDomainObjListLoadEntryPtr entry,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    char *statusFile = NULL;
-    virDomainObjPtr obj = NULL;
+    virDomainObjPtr obj = g_steal_pointer(&entry->obj);
     char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    if ((statusFile = virDomainConfigFile(statusDir, name)) == NULL)
-        goto error;
-
-    if (!(obj = virDomainObjParseFile(statusFile, xmlopt,
-                                      VIR_DOMAIN_DEF_PARSE_STATUS |
-                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
-                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
+    virObjectLock(obj);
 
     virUUIDFormat(obj->def->uuid, uuidstr);
 
@@ -569,16 +754,68 @@ virDomainObjListLoadStatus(virDomainObjListPtr doms,
     if (notify)
         (*notify)(obj, 1, opaque);
 
-    VIR_FREE(statusFile);
     return obj;
 
  error:
     virDomainObjEndAPI(&obj);
-    VIR_FREE(statusFile);
     return NULL;
 }
 
 
+static size_t
+virDomainObjListLoadWorkers(size_t nentries)
+{
+    int ncpus = virHostCPUGetCount();
+    size_t nworkers = nentries / VIR_DOMAIN_OBJ_LIST_LOAD_PER_WORKER;
+
+    if (ncpus <= 0) {
+        virResetLastError();
+        ncpus = 1;
+    }
+
+    return MAX(1, MIN(nworkers, ncpus));
+}
+
+
+static void
+virDomainObjListLoadParseAll(virDomainObjListLoadDataPtr data,
+                             size_t nworkers)
+{
+    g_autofree virThread *threads = g_new0(virThread, nworkers);
+    size_t nthreads = 0;
+    size_t i;
+
+    /* The calling thread is one of the workers, too */
+    for (i = 1; i < nworkers; i++) {
+        if (virThreadCreateFull(&threads[nthreads], true,
+                                virDomainObjListLoadParse,
+                                "dom-load", false, data) < 0) {
+            VIR_WARN("Failed to spawn domain loading thread: %s",
+                     virGetLastErrorMessage());
+            virResetLastError();
+            break;
+        }
+        nthreads++;
+    }
+
+    virDomainObjListLoadParse(data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+}
+
+
+/**
+ * virDomainObjListLoadAllConfigs:
+ *
+ * Loads all domain configs (or live status XMLs if @liveStatus is true)
+ * found in @configDir into @doms. The XML files are parsed in parallel
+ * on all host CPUs first and then added to the list and passed to
+ * @notify in directory order under a single write lock.
+ *
+ * Returns 0 on success, -1 if reading @configDir failed. Errors in
+ * individual files are only logged.
+ */
 int
 virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
                                const char *configDir,
@@ -588,8 +825,18 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
                                virDomainLoadConfigNotify notify,
                                void *opaque)
 {
+    virDomainObjListLoadData data = {
+        .configDir = configDir,
+        .autostartDir = autostartDir,
+        .liveStatus = liveStatus,
+        .xmlopt = xmlopt,
+    };
+    gint64 start = g_get_monotonic_time();
     DIR *dir;
     struct dirent *entry;
+    size_t nworkers;
+    size_t nloaded = 0;
+    size_t i;
     int ret = -1;
     int rc;
 
@@ -598,43 +845,58 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
-    virObjectRWLockWrite(doms);
-
     while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
-        virDomainObjPtr dom;
+        virDomainObjListLoadEntry item = { 0 };
 
         if (!virStringStripSuffix(entry->d_name, ".xml"))
             continue;
 
-        /* NB: ignoring errors, so one malformed config doesn't
-           kill the whole process */
-        VIR_INFO("Loading config file '%s.xml'", entry->d_name);
-        if (liveStatus)
-            dom = virDomainObjListLoadStatus(doms,
-                                             configDir,
-                                             entry->d_name,
-                                             xmlopt,
-                                             notify,
-                                             opaque);
+        item.name = g_strdup(entry->d_name);
+        ignore_value(VIR_APPEND_ELEMENT(data.entries, data.nentries, item));
+    }
+
+    VIR_DIR_CLOSE(dir);
+
+    nworkers = virDomainObjListLoadWorkers(data.nentries);
+    virDomainObjListLoadParseAll(&data, nworkers);
+
+    virDomainObjListLockWrite(doms);
+
+    for (i = 0; i < data.nentries; i++) {
+        virDomainObjListLoadEntryPtr item = data.entries + i;
+        virDomainObjPtr dom = NULL;
+
+        if (liveStatus && item->obj)
+            dom = virDomainObjListLoadStatus(doms, item, notify, opaque);
+        else if (!liveStatus && item->def)
+            dom = virDomainObjListLoadConfig(doms, xmlopt, item, notify, opaque);
         else
-            dom = virDomainObjListLoadConfig(doms,
-                                             xmlopt,
-                                             configDir,
-                                             autostartDir,
-                                             entry->d_name,
-                                             notify,
-                                             opaque);
+            continue;
+
         if (dom) {
             if (!liveStatus)
                 dom->persistent = 1;
             virDomainObjEndAPI(&dom);
+            nloaded++;
         } else {
-            VIR_ERROR(_("Failed to load config for domain '%s'"), entry->d_name);
+            VIR_ERROR(_("Failed to load config for domain '%s'"), item->name);
         }
     }
 
-    VIR_DIR_CLOSE(dir);
-    virObjectRWUnlock(doms);
+    virDomainObjListUnlockWrite(doms);
+
+    PROBE(DOMAIN_OBJ_LIST_LOAD,
+          "dir=%s live=%d count=%zu loaded=%zu workers=%zu elapsed=%lld",
+          configDir, liveStatus, data.nentries, nloaded, nworkers,
+          (long long)(g_get_monotonic_time() - start));
+
+    for (i = 0; i < data.nentries; i++) {
+        VIR_FREE(data.entries[i].name);
+        virDomainDefFree(data.entries[i].def);
+        virObjectUnref(data.entries[i].obj);
+    }
+    VIR_FREE(data.entries);
+
     return ret;
 }
 
@@ -834,12 +1096,15 @@ virDomainObjListForEach(virDomainObjListPtr doms,
         callback, opaque, 0,
     };
 
-    if (modify)
-        virObjectRWLockWrite(doms);
-    else
+    if (modify) {
+        virDomainObjListLockWrite(doms);
+        virHashForEach(doms->objs, virDomainObjListHelper, &data);
+        virDomainObjListUnlockWrite(doms);
+    } else {
         virObjectRWLockRead(doms);
-    virHashForEach(doms->objs, virDomainObjListHelper, &data);
-    virObjectRWUnlock(doms);
+        virHashForEach(doms->objs, virDomainObjListHelper, &data);
+        virObjectRWUnlock(doms);
+    }
     return data.ret;
 }
 
@@ -124,6 +124,13 @@ typedef enum {
      * Support for driver close callback rpc
      */
     VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK = 15,
+
+    /*
+     * Support for delivering domain events to the client in batches,
+     * which the client then enables with
+     * REMOTE_PROC_CONNECT_ENABLE_EVENT_BATCH
+     */
+    VIR_DRV_FEATURE_REMOTE_EVENT_BATCH = 16,
 } virDrvFeature;
 
 
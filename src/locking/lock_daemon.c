@@ -134,7 +134,7 @@ virLockDaemonNew(virLockDaemonConfigPtr config, bool privileged)
         goto error;
 
     if (!(srv = virNetServerNew("virtlockd", 1,
-                                0, 0, 0, config->max_clients,
+                                0, 0, 0, 0, config->max_clients,
                                 config->max_clients, -1, 0,
                                 virLockDaemonClientNew,
                                 virLockDaemonClientPreExecRestart,
@@ -148,7 +148,7 @@ virLockDaemonNew(virLockDaemonConfigPtr config, bool privileged)
     srv = NULL;
 
     if (!(srv = virNetServerNew("admin", 1,
-                                0, 0, 0, config->admin_max_clients,
+                                0, 0, 0, 0, config->admin_max_clients,
                                 config->admin_max_clients, -1, 0,
                                 remoteAdmClientNew,
                                 remoteAdmClientPreExecRestart,
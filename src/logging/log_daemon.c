@@ -130,7 +130,7 @@ virLogDaemonNew(virLogDaemonConfigPtr config, bool privileged)
         goto error;
 
     if (!(srv = virNetServerNew("virtlogd", 1,
-                                0, 0, 0, config->max_clients,
+                                0, 0, 0, 0, config->max_clients,
                                 config->max_clients, -1, 0,
                                 virLogDaemonClientNew,
                                 virLogDaemonClientPreExecRestart,
@@ -144,7 +144,7 @@ virLogDaemonNew(virLogDaemonConfigPtr config, bool privileged)
     srv = NULL;
 
     if (!(srv = virNetServerNew("admin", 1,
-                                0, 0, 0, config->admin_max_clients,
+                                0, 0, 0, 0, config->admin_max_clients,
                                 config->admin_max_clients, -1, 0,
                                 remoteAdmClientNew,
                                 remoteAdmClientPreExecRestart,
@@ -133,6 +133,24 @@ static int virLXCCgroupGetMemTotal(virCgroupPtr cgroup,
 static int virLXCCgroupGetMemStat(virCgroupPtr cgroup,
                                   virLXCMeminfoPtr meminfo)
 {
+    g_autoptr(virCgroupStatsReader) reader = NULL;
+    virCgroupStats stats;
+
+    if ((reader = virCgroupStatsReaderNew(cgroup, VIR_CGROUP_STATS_MEMORY)) &&
+        virCgroupStatsReaderRead(reader, &stats) == 0) {
+        meminfo->cached = stats.memCache;
+        meminfo->inactive_anon = stats.memInactiveAnon;
+        meminfo->active_anon = stats.memActiveAnon;
+        meminfo->inactive_file = stats.memInactiveFile;
+        meminfo->active_file = stats.memActiveFile;
+        meminfo->unevictable = stats.memUnevictable;
+        return 0;
+    }
+
+    VIR_DEBUG("Falling back to virCgroupGetMemoryStat: %s",
+              virGetLastErrorMessage());
+    virResetLastError();
+
     return virCgroupGetMemoryStat(cgroup,
                                   &meminfo->cached,
                                   &meminfo->inactive_anon,
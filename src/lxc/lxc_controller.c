@@ -791,16 +791,19 @@ static int virLXCControllerGetNumadAdvice(virLXCControllerPtr ctrl,
     virBitmapPtr nodemask = NULL;
     g_autofree char *nodeset = NULL;
 
-    /* Get the advisory nodeset from numad if 'placement' of
-     * either <vcpu> or <numatune> is 'auto'.
+    /* Get the advisory nodeset if 'placement' of either <vcpu>
+     * or <numatune> is 'auto'. The controller doesn't know about
+     * other containers, so only the host state is considered.
      */
     if (virDomainDefNeedsPlacementAdvice(ctrl->def)) {
-        nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(ctrl->def),
-                                                ctrl->def->mem.cur_balloon);
+        nodeset = virNumaGetAutoPlacementAdvice(NULL,
+                                                virDomainDefGetVcpus(ctrl->def),
+                                                ctrl->def->mem.cur_balloon,
+                                                0);
         if (!nodeset)
             return -1;
 
-        VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
+        VIR_DEBUG("Advisory nodeset: %s", nodeset);
 
         if (virBitmapParse(nodeset, &nodemask, VIR_DOMAIN_CPUMASK_LEN) < 0)
             return -1;
@@ -948,7 +951,7 @@ static int virLXCControllerSetupServer(virLXCControllerPtr ctrl)
     sockpath = g_strdup_printf("%s/%s.sock", LXC_STATE_DIR, ctrl->name);
 
     if (!(srv = virNetServerNew("LXC", 1,
-                                0, 0, 0, 1,
+                                0, 0, 0, 0, 1,
                                 0, -1, 0,
                                 virLXCControllerClientPrivateNew,
                                 NULL,
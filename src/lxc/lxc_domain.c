@@ -168,6 +168,7 @@ virLXCDomainObjPrivateFree(void *data)
 {
     virLXCDomainObjPrivatePtr priv = data;
 
+    g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
     virCgroupFree(&priv->cgroup);
     virLXCDomainObjFreeJob(priv);
     g_free(priv);
@@ -86,6 +86,8 @@ struct _virLXCDomainObjPrivate {
     pid_t initpid;
 
     virCgroupPtr cgroup;
+    virCgroupStatsReaderPtr cgroupStats; /* blkio stats of @cgroup, lazily opened */
+    bool cgroupStatsFailed; /* @cgroupStats can't be opened for @cgroup */
     char *machineName;
 
     struct virLXCDomainJobObj job;
@@ -1659,6 +1659,7 @@ lxcConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_EVENT_BATCH:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     default:
@@ -2043,6 +2044,51 @@ lxcDomainGetSchedulerParameters(virDomainPtr domain,
 }
 
 
+/* Domain wide blkio stats are polled by monitoring tools, keep the
+ * cgroup files open between calls instead of parsing them anew each
+ * time. If that is not possible for this cgroup, don't retry on every
+ * call and use virCgroupGetBlkioIoServiced instead. */
+static int
+lxcDomainGetBlkioStats(virLXCDomainObjPrivatePtr priv,
+                       long long *bytes_read,
+                       long long *bytes_write,
+                       long long *requests_read,
+                       long long *requests_write)
+{
+    virCgroupStats stats;
+
+    if (!priv->cgroupStats && !priv->cgroupStatsFailed) {
+        if (!(priv->cgroupStats = virCgroupStatsReaderNew(priv->cgroup,
+                                                          VIR_CGROUP_STATS_BLKIO))) {
+            VIR_DEBUG("Falling back to reading cgroup stats per call: %s",
+                      virGetLastErrorMessage());
+            priv->cgroupStatsFailed = true;
+            virResetLastError();
+        }
+    }
+
+    if (priv->cgroupStats) {
+        if (virCgroupStatsReaderRead(priv->cgroupStats, &stats) == 0) {
+            *bytes_read = stats.blkioBytesRead;
+            *bytes_write = stats.blkioBytesWrite;
+            *requests_read = stats.blkioRequestsRead;
+            *requests_write = stats.blkioRequestsWrite;
+            return 0;
+        }
+
+        /* reopen the files next time, e.g. after the cgroup changed */
+        g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+        virResetLastError();
+    }
+
+    return virCgroupGetBlkioIoServiced(priv->cgroup,
+                                       bytes_read,
+                                       bytes_write,
+                                       requests_read,
+                                       requests_write);
+}
+
+
 static int
 lxcDomainBlockStats(virDomainPtr dom,
                     const char *path,
@@ -2076,11 +2122,11 @@ lxcDomainBlockStats(virDomainPtr dom,
 
     if (!*path) {
         /* empty path - return entire domain blkstats instead */
-        ret = virCgroupGetBlkioIoServiced(priv->cgroup,
-                                          &stats->rd_bytes,
-                                          &stats->wr_bytes,
-                                          &stats->rd_req,
-                                          &stats->wr_req);
+        ret = lxcDomainGetBlkioStats(priv,
+                                     &stats->rd_bytes,
+                                     &stats->wr_bytes,
+                                     &stats->rd_req,
+                                     &stats->wr_req);
         goto endjob;
     }
 
@@ -2159,11 +2205,11 @@ lxcDomainBlockStatsFlags(virDomainPtr dom,
 
     if (!*path) {
         /* empty path - return entire domain blkstats instead */
-        if (virCgroupGetBlkioIoServiced(priv->cgroup,
-                                        &rd_bytes,
-                                        &wr_bytes,
-                                        &rd_req,
-                                        &wr_req) < 0) {
+        if (lxcDomainGetBlkioStats(priv,
+                                   &rd_bytes,
+                                   &wr_bytes,
+                                   &rd_req,
+                                   &wr_req) < 0) {
             virReportError(VIR_ERR_INTERNAL_ERROR,
                            "%s", _("domain stats query failed"));
             goto endjob;
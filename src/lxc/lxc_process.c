@@ -234,6 +234,8 @@ static void virLXCProcessCleanup(virLXCDriverPtr driver,
 
     virDomainConfVMNWFilterTeardown(vm);
 
+    g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+    priv->cgroupStatsFailed = false;
     if (priv->cgroup) {
         virCgroupRemove(priv->cgroup);
         virCgroupFree(&priv->cgroup);
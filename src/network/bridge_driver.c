@@ -67,6 +67,7 @@
 #include "virhook.h"
 #include "virjson.h"
 #include "virnetworkportdef.h"
+#include "virnssindex.h"
 #include "virutil.h"
 
 #include "netdev_bandwidth_conf.h"
@@ -429,6 +430,8 @@ networkRemoveInactive(virNetworkDriverStatePtr driver,
     g_autofree char *radvdpidbase = NULL;
     g_autofree char *statusfile = NULL;
     g_autofree char *macMapFile = NULL;
+    g_autofree char *customleaseindex = NULL;
+    g_autofree char *macMapIndex = NULL;
     g_autoptr(dnsmasqContext) dctx = NULL;
     virNetworkDefPtr def = virNetworkObjGetPersistentDef(obj);
 
@@ -459,14 +462,19 @@ networkRemoveInactive(virNetworkDriverStatePtr driver,
     if (!(macMapFile = virMacMapFileName(driver->dnsmasqStateDir, def->bridge)))
         return -1;
 
+    customleaseindex = virNSSIndexFileName(customleasefile);
+    macMapIndex = virNSSIndexFileName(macMapFile);
+
     /* dnsmasq */
     dnsmasqDelete(dctx);
     unlink(leasefile);
     unlink(customleasefile);
+    unlink(customleaseindex);
     unlink(configfile);
 
     /* MAC map manager */
     unlink(macMapFile);
+    unlink(macMapIndex);
 
     /* radvd */
     unlink(radvdconfigfile);
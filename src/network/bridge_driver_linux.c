@@ -920,7 +920,7 @@ int networkAddFirewallRules(virNetworkDefPtr def)
         }
     }
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     networkAddGeneralFirewallRules(fw, def);
 
@@ -32,6 +32,7 @@
 #include "viralloc.h"
 #include "virjson.h"
 #include "virlease.h"
+#include "virnssindex.h"
 #include "virenum.h"
 #include "configmake.h"
 #include "virgettext.h"
@@ -250,6 +251,12 @@ main(int argc, char **argv)
         break;
     }
 
+    /* The NSS module falls back to parsing the lease file whenever the
+     * index is missing or stale, so failing to update it is not fatal */
+    if (virNSSIndexWriteLeases(custom_lease_file, leases_array_new) < 0)
+        fprintf(stderr, _("Unable to update lease index: %s\n"),
+                virGetLastErrorMessage());
+
     rv = EXIT_SUCCESS;
 
  cleanup:
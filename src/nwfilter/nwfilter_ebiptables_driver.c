@@ -2856,7 +2856,7 @@ ebtablesApplyBasicRules(const char *ifname,
     if (ebiptablesAllTeardown(ifname) < 0)
         return -1;
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     ebtablesCreateTmpRootChainFW(fw, true, ifname);
 
@@ -2926,7 +2926,7 @@ ebtablesApplyDHCPOnlyRules(const char *ifname,
     if (ebiptablesAllTeardown(ifname) < 0)
         return -1;
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     ebtablesCreateTmpRootChainFW(fw, true, ifname);
     ebtablesCreateTmpRootChainFW(fw, false, ifname);
@@ -3026,7 +3026,7 @@ ebtablesApplyDropAllRules(const char *ifname)
     if (ebiptablesAllTeardown(ifname) < 0)
         return -1;
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     ebtablesCreateTmpRootChainFW(fw, true, ifname);
     ebtablesCreateTmpRootChainFW(fw, false, ifname);
@@ -3343,7 +3343,7 @@ ebiptablesApplyNewRules(const char *ifname,
     ebtablesRemoveTmpRootChainFW(fw, true, ifname);
     ebtablesRemoveTmpRootChainFW(fw, false, ifname);
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     /* walk the list of rules and increase the priority
      * of rules in case the chain priority is of higher value;
@@ -53,13 +53,17 @@ VIR_LOG_INIT("qemu.qemu_agent");
 
 /* We read from QEMU until seeing a \r\n pair to indicate a
  * completed reply or event. To avoid memory denial-of-service
- * though, we must have a size limit on amount of data we
- * buffer. 10 MB is large enough that it ought to cope with
+ * though, we must have a size limit on a single reply or event
+ * we parse. 10 MB is large enough that it ought to cope with
  * normal QEMU replies, and small enough that we're not
  * consuming unreasonable mem.
  */
 #define QEMU_AGENT_MAX_RESPONSE (10 * 1024 * 1024)
 
+/* Incoming data is read in chunks of this size which are fed to
+ * the JSON parser right away. */
+#define QEMU_AGENT_READ_SIZE (64 * 1024)
+
 /* When you are the first to uncomment this,
  * don't forget to uncomment the corresponding
  * part in qemuAgentIOProcessEvent as well.
@@ -125,6 +129,9 @@ struct _qemuAgent {
     size_t bufferLength;
     char *buffer;
 
+    /* Parser of the reply or event being received */
+    virJSONStreamParserPtr parser;
+
     /* If anything went wrong, this will be fed back
      * the next agent msg */
     virError lastError;
@@ -178,6 +185,7 @@ static void qemuAgentDispose(void *obj)
         (agent->cb->destroy)(agent, agent->vm);
     virCondDestroy(&agent->notify);
     VIR_FREE(agent->buffer);
+    virJSONStreamParserFree(agent->parser);
     g_main_context_unref(agent->context);
     virResetError(&agent->lastError);
 }
@@ -255,28 +263,21 @@ qemuAgentIOProcessEvent(qemuAgentPtr agent,
 
 static int
 qemuAgentIOProcessLine(qemuAgentPtr agent,
-                       const char *line,
+                       virJSONValuePtr obj,
                        qemuAgentMessagePtr msg)
 {
-    virJSONValuePtr obj = NULL;
     int ret = -1;
 
-    VIR_DEBUG("Line [%s]", line);
-
-    if (!(obj = virJSONValueFromString(line))) {
-        /* receiving garbage on first sync is regular situation */
-        if (msg && msg->sync && msg->first) {
-            VIR_DEBUG("Received garbage on sync");
-            msg->finished = true;
-            return 0;
-        }
-
-        goto cleanup;
+    if (VIR_LOG_ENABLED(VIR_LOG_DEBUG)) {
+        g_autofree char *line = virJSONValueToString(obj, false);
+        VIR_DEBUG("Line [%s]", NULLSTR(line));
     }
 
     if (virJSONValueGetType(obj) != VIR_JSON_TYPE_OBJECT) {
+        g_autofree char *str = virJSONValueToString(obj, false);
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Parsed JSON reply '%s' isn't an object"), line);
+                       _("Parsed JSON reply '%s' isn't an object"),
+                       NULLSTR(str));
         goto cleanup;
     }
 
@@ -314,8 +315,9 @@ qemuAgentIOProcessLine(qemuAgentPtr agent,
         }
         ret = 0;
     } else {
+        g_autofree char *str = virJSONValueToString(obj, false);
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unknown JSON reply '%s'"), line);
+                       _("Unknown JSON reply '%s'"), NULLSTR(str));
     }
 
  cleanup:
@@ -323,13 +325,16 @@ qemuAgentIOProcessLine(qemuAgentPtr agent,
     return ret;
 }
 
+/* Feeds @data into the parser and processes every message
+ * completed by a line ending. Returns the number of messages
+ * processed, or -1 on error. */
 static int qemuAgentIOProcessData(qemuAgentPtr agent,
                                   char *data,
                                   size_t len,
                                   qemuAgentMessagePtr msg)
 {
-    int used = 0;
-    size_t i = 0;
+    size_t used = 0;
+    int nmsgs = 0;
 #if DEBUG_IO
 # if DEBUG_RAW_IO
     g_autofree char *str1 = qemuAgentEscapeNonPrintable(data);
@@ -340,22 +345,46 @@ static int qemuAgentIOProcessData(qemuAgentPtr agent,
 #endif
 
     while (used < len) {
-        char *nl = strstr(data + used, LINE_ENDING);
-
-        if (nl) {
-            int got = nl - (data + used);
-            for (i = 0; i < strlen(LINE_ENDING); i++)
-                data[used + got + i] = '\0';
-            if (qemuAgentIOProcessLine(agent, data + used, msg) < 0)
+        char *nl = memchr(data + used, LINE_ENDING[0], len - used);
+        size_t got = nl ? nl - (data + used) : len - used;
+        virJSONValuePtr obj;
+
+        if (virJSONStreamParserFeed(agent->parser, data + used, got) < 0) {
+            /* receiving garbage on first sync is regular situation,
+             * the rest of the line is skipped by the parser */
+            if (!(msg && msg->sync && msg->first))
                 return -1;
-            used += got + strlen(LINE_ENDING);
-        } else {
+            virResetLastError();
+        }
+
+        used += got;
+        if (!nl)
             break;
+        used += strlen(LINE_ENDING);
+
+        if (virJSONStreamParserFinish(agent->parser, &obj) < 0) {
+            /* receiving garbage on first sync is regular situation */
+            if (msg && msg->sync && msg->first) {
+                VIR_DEBUG("Received garbage on sync");
+                virResetLastError();
+                msg->finished = true;
+                continue;
+            }
+
+            return -1;
         }
+
+        if (!obj)
+            continue;
+
+        if (qemuAgentIOProcessLine(agent, obj, msg) < 0)
+            return -1;
+
+        nmsgs++;
     }
 
-    VIR_DEBUG("Total used %d bytes out of %zd available in buffer", used, len);
-    return used;
+    VIR_DEBUG("Processed %d messages out of %zu bytes", nmsgs, len);
+    return nmsgs;
 }
 
 /* This method processes data that has been received
@@ -392,15 +421,11 @@ qemuAgentIOProcess(qemuAgentPtr agent)
     if (len < 0)
         return -1;
 
-    if (len < agent->bufferOffset) {
-        memmove(agent->buffer, agent->buffer + len, agent->bufferOffset - len);
-        agent->bufferOffset -= len;
-    } else {
-        VIR_FREE(agent->buffer);
-        agent->bufferOffset = agent->bufferLength = 0;
-    }
+    /* Everything was handed over to the parser, including any
+     * incomplete message, so the buffer can be reused */
+    agent->bufferOffset = 0;
 #if DEBUG_IO
-    VIR_DEBUG("Process done %zu used %d", agent->bufferOffset, len);
+    VIR_DEBUG("Process done, %d messages", len);
 #endif
     if (msg && msg->finished)
         virCondBroadcast(&agent->notify);
@@ -446,22 +471,15 @@ qemuAgentIOWrite(qemuAgentPtr agent)
 static int
 qemuAgentIORead(qemuAgentPtr agent)
 {
-    size_t avail = agent->bufferLength - agent->bufferOffset;
+    size_t avail;
     int ret = 0;
 
-    if (avail < 1024) {
-        if (agent->bufferLength >= QEMU_AGENT_MAX_RESPONSE) {
-            virReportSystemError(ERANGE,
-                                 _("No complete agent response found in %d bytes"),
-                                 QEMU_AGENT_MAX_RESPONSE);
-            return -1;
-        }
-        if (VIR_REALLOC_N(agent->buffer,
-                          agent->bufferLength + 1024) < 0)
-            return -1;
-        agent->bufferLength += 1024;
-        avail += 1024;
+    if (!agent->buffer) {
+        agent->buffer = g_new0(char, QEMU_AGENT_READ_SIZE);
+        agent->bufferLength = QEMU_AGENT_READ_SIZE;
+        agent->bufferOffset = 0;
     }
+    avail = agent->bufferLength - agent->bufferOffset;
 
     /* Read as much as we can get into our buffer,
        until we block on EAGAIN, or hit EOF */
@@ -702,6 +720,9 @@ qemuAgentOpen(virDomainObjPtr vm,
     agent->cb = cb;
     agent->singleSync = singleSync;
 
+    if (!(agent->parser = virJSONStreamParserNew(QEMU_AGENT_MAX_RESPONSE)))
+        goto cleanup;
+
     if (config->type != VIR_DOMAIN_CHR_TYPE_UNIX) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("unable to handle agent type: %s"),
@@ -805,7 +805,7 @@ qemuBlockJobEventProcessLegacy(virQEMUDriverPtr driver,
 
     case VIR_DOMAIN_BLOCK_JOB_READY:
         disk->mirrorState = VIR_DOMAIN_DISK_MIRROR_STATE_READY;
-        qemuDomainSaveStatus(vm);
+        qemuDomainSaveStatusLater(vm);
         break;
 
     case VIR_DOMAIN_BLOCK_JOB_FAILED:
@@ -1652,7 +1652,7 @@ qemuBlockJobEventProcessConcluded(qemuBlockJobDataPtr job,
         job->newstate = QEMU_BLOCKJOB_STATE_CANCELLED;
 
     if (refreshed)
-        qemuDomainSaveStatus(vm);
+        qemuDomainSaveStatusLater(vm);
 
     VIR_DEBUG("handling job '%s' state '%d' newstate '%d'", job->name, job->state, job->newstate);
 
@@ -1702,7 +1702,7 @@ qemuBlockJobEventProcess(virQEMUDriverPtr driver,
         }
         job->state = job->newstate;
         job->newstate = -1;
-        qemuDomainSaveStatus(vm);
+        qemuDomainSaveStatusLater(vm);
         break;
 
     case QEMU_BLOCKJOB_STATE_NEW:
@@ -1736,6 +1736,14 @@ qemuBlockJobUpdate(virDomainObjPtr vm,
     if (job->newstate == -1)
         return;
 
+    /* the job may have rewritten images of the chains it worked on */
+    virStorageFileHeaderCacheInvalidateChain(job->chain);
+    virStorageFileHeaderCacheInvalidateChain(job->mirrorChain);
+    if (job->disk) {
+        virStorageFileHeaderCacheInvalidateChain(job->disk->src);
+        virStorageFileHeaderCacheInvalidateChain(job->disk->mirror);
+    }
+
     if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_BLOCKDEV))
         qemuBlockJobEventProcess(priv->driver, vm, job, asyncJob);
     else
@@ -660,8 +660,8 @@ static void virQEMUDomainCapsCacheDispose(void *obj)
 
 
 /*
- * Update the XML parser/formatter when adding more
- * information to this struct so that it gets cached
+ * Update the XML and binary parser/formatter when adding
+ * more information to this struct so that it gets cached
  * correctly. It does not have to be ABI-stable, as
  * the cache will be discarded & repopulated if the
  * timestamp on the libvirtd binary changes.
@@ -4714,6 +4714,492 @@ virQEMUCapsSaveFile(void *data,
 }
 
 
+/*
+ * Binary variant of the capabilities cache. The payload stores the same
+ * data as virQEMUCapsFormatCache in the same order, just without the
+ * cost of formatting and parsing XML. Bump the version whenever the
+ * layout changes.
+ */
+#define QEMU_CAPS_CACHE_BINARY_VERSION 1
+
+static void
+virQEMUCapsFormatBinaryAccel(virQEMUCapsPtr qemuCaps,
+                             virFileCacheWriterPtr writer,
+                             virDomainVirtType type)
+{
+    virQEMUCapsAccelPtr caps = virQEMUCapsGetAccel(qemuCaps, type);
+    qemuMonitorCPUModelInfoPtr model = caps->hostCPU.info;
+    qemuMonitorCPUDefsPtr defs = caps->cpuModels;
+    size_t i;
+    size_t j;
+
+    virFileCacheWriteBool(writer, !!model);
+    if (model) {
+        virFileCacheWriteString(writer, model->name);
+        virFileCacheWriteBool(writer, model->migratability);
+        virFileCacheWriteUInt(writer, model->nprops);
+
+        for (i = 0; i < model->nprops; i++) {
+            qemuMonitorCPUPropertyPtr prop = model->props + i;
+
+            virFileCacheWriteString(writer, prop->name);
+            virFileCacheWriteUInt(writer, prop->type);
+
+            switch (prop->type) {
+            case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+                virFileCacheWriteBool(writer, prop->value.boolean);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_STRING:
+                virFileCacheWriteString(writer, prop->value.string);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+                virFileCacheWriteULLong(writer, prop->value.number);
+                break;
+
+            case QEMU_MONITOR_CPU_PROPERTY_LAST:
+                break;
+            }
+
+            virFileCacheWriteUInt(writer, prop->migratable);
+        }
+    }
+
+    virFileCacheWriteUInt(writer, defs ? defs->ncpus : 0);
+    for (i = 0; defs && i < defs->ncpus; i++) {
+        qemuMonitorCPUDefInfoPtr cpu = defs->cpus + i;
+        size_t nblockers = cpu->blockers ? g_strv_length(cpu->blockers) : 0;
+
+        virFileCacheWriteString(writer, cpu->name);
+        virFileCacheWriteString(writer, cpu->type);
+        virFileCacheWriteUInt(writer, cpu->usable);
+        virFileCacheWriteUInt(writer, nblockers);
+        for (j = 0; j < nblockers; j++)
+            virFileCacheWriteString(writer, cpu->blockers[j]);
+    }
+
+    virFileCacheWriteUInt(writer, caps->nmachineTypes);
+    for (i = 0; i < caps->nmachineTypes; i++) {
+        virQEMUCapsMachineTypePtr mach = caps->machineTypes + i;
+
+        virFileCacheWriteString(writer, mach->name);
+        virFileCacheWriteString(writer, mach->alias);
+        virFileCacheWriteUInt(writer, mach->maxCpus);
+        virFileCacheWriteBool(writer, mach->hotplugCpus);
+        virFileCacheWriteBool(writer, mach->qemuDefault);
+        virFileCacheWriteString(writer, mach->defaultCPU);
+        virFileCacheWriteBool(writer, mach->numaMemSupported);
+    }
+}
+
+
+static void
+virQEMUCapsFormatBinary(virQEMUCapsPtr qemuCaps,
+                        virFileCacheWriterPtr writer)
+{
+    virSEVCapabilityPtr sev = qemuCaps->sevCapabilities;
+    size_t nflags = 0;
+    size_t i;
+
+    virFileCacheWriteULLong(writer, qemuCaps->libvirtCtime);
+    virFileCacheWriteUInt(writer, qemuCaps->libvirtVersion);
+    virFileCacheWriteString(writer, qemuCaps->binary);
+    virFileCacheWriteULLong(writer, qemuCaps->ctime);
+
+    /* Flags are stored by their numeric value, which is stable since
+     * new capabilities are only ever appended to the enum. */
+    for (i = 0; i < QEMU_CAPS_LAST; i++) {
+        if (virQEMUCapsGet(qemuCaps, i))
+            nflags++;
+    }
+    virFileCacheWriteUInt(writer, QEMU_CAPS_LAST);
+    virFileCacheWriteUInt(writer, nflags);
+    for (i = 0; i < QEMU_CAPS_LAST; i++) {
+        if (virQEMUCapsGet(qemuCaps, i))
+            virFileCacheWriteUInt(writer, i);
+    }
+
+    virFileCacheWriteUInt(writer, qemuCaps->version);
+    virFileCacheWriteUInt(writer, qemuCaps->kvmVersion);
+    virFileCacheWriteUInt(writer, qemuCaps->microcodeVersion);
+    virFileCacheWriteString(writer, qemuCaps->hostCPUSignature);
+    virFileCacheWriteString(writer, qemuCaps->package);
+    virFileCacheWriteString(writer, qemuCaps->kernelVersion);
+    virFileCacheWriteUInt(writer, qemuCaps->arch);
+
+    virQEMUCapsFormatBinaryAccel(qemuCaps, writer, VIR_DOMAIN_VIRT_KVM);
+    virQEMUCapsFormatBinaryAccel(qemuCaps, writer, VIR_DOMAIN_VIRT_QEMU);
+
+    virFileCacheWriteUInt(writer, qemuCaps->ngicCapabilities);
+    for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+        virFileCacheWriteUInt(writer, qemuCaps->gicCapabilities[i].version);
+        virFileCacheWriteUInt(writer, qemuCaps->gicCapabilities[i].implementation);
+    }
+
+    virFileCacheWriteBool(writer, !!sev);
+    if (sev) {
+        virFileCacheWriteUInt(writer, sev->cbitpos);
+        virFileCacheWriteUInt(writer, sev->reduced_phys_bits);
+        virFileCacheWriteString(writer, sev->pdh);
+        virFileCacheWriteString(writer, sev->cert_chain);
+    }
+
+    virFileCacheWriteBool(writer, qemuCaps->kvmSupportsNesting);
+    virFileCacheWriteBool(writer, qemuCaps->kvmSupportsSecureGuest);
+}
+
+
+int
+virQEMUCapsSaveBinaryCache(virQEMUCapsPtr qemuCaps,
+                           const char *filename)
+{
+    g_autoptr(virFileCacheWriter) writer = NULL;
+
+    writer = virFileCacheWriterNew(QEMU_CAPS_CACHE_BINARY_VERSION);
+    virQEMUCapsFormatBinary(qemuCaps, writer);
+
+    if (virFileCacheWriterSave(writer, filename, 0600) < 0)
+        return -1;
+
+    VIR_DEBUG("Saved binary caps '%s' for '%s'",
+              filename, qemuCaps->binary);
+    return 0;
+}
+
+
+static int
+virQEMUCapsSaveBinaryFile(void *data,
+                          const char *filename,
+                          void *privData G_GNUC_UNUSED)
+{
+    return virQEMUCapsSaveBinaryCache(data, filename);
+}
+
+
+static int
+virQEMUCapsParseBinaryHostCPU(virQEMUCapsAccelPtr caps,
+                              virFileCacheReaderPtr reader)
+{
+    qemuMonitorCPUModelInfoPtr hostCPU = NULL;
+    unsigned int nprops;
+    bool present;
+    int ret = -1;
+    size_t i;
+
+    if (virFileCacheReadBool(reader, &present) < 0)
+        return -1;
+
+    if (!present)
+        return 0;
+
+    hostCPU = g_new0(qemuMonitorCPUModelInfo, 1);
+
+    if (virFileCacheReadString(reader, &hostCPU->name) < 0 ||
+        virFileCacheReadBool(reader, &hostCPU->migratability) < 0 ||
+        virFileCacheReadUInt(reader, &nprops) < 0)
+        goto cleanup;
+
+    hostCPU->props = g_new0(qemuMonitorCPUProperty, nprops);
+    hostCPU->nprops = nprops;
+
+    for (i = 0; i < nprops; i++) {
+        qemuMonitorCPUPropertyPtr prop = hostCPU->props + i;
+        unsigned long long number;
+        unsigned int val;
+
+        if (virFileCacheReadString(reader, &prop->name) < 0 ||
+            virFileCacheReadUInt(reader, &val) < 0)
+            goto cleanup;
+
+        if (val >= QEMU_MONITOR_CPU_PROPERTY_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("invalid type of '%s' host CPU model property "
+                             "in QEMU capabilities cache"), prop->name);
+            goto cleanup;
+        }
+        prop->type = val;
+
+        switch (prop->type) {
+        case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+            if (virFileCacheReadBool(reader, &prop->value.boolean) < 0)
+                goto cleanup;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_STRING:
+            if (virFileCacheReadString(reader, &prop->value.string) < 0)
+                goto cleanup;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+            if (virFileCacheReadULLong(reader, &number) < 0)
+                goto cleanup;
+            prop->value.number = number;
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_LAST:
+            break;
+        }
+
+        if (virFileCacheReadUInt(reader, &val) < 0)
+            goto cleanup;
+        prop->migratable = val;
+    }
+
+    caps->hostCPU.info = g_steal_pointer(&hostCPU);
+    ret = 0;
+
+ cleanup:
+    qemuMonitorCPUModelInfoFree(hostCPU);
+    return ret;
+}
+
+
+static int
+virQEMUCapsParseBinaryCPUModels(virQEMUCapsAccelPtr caps,
+                                virFileCacheReaderPtr reader)
+{
+    g_autoptr(qemuMonitorCPUDefs) defs = NULL;
+    unsigned int ncpus;
+    size_t i;
+    size_t j;
+
+    if (virFileCacheReadUInt(reader, &ncpus) < 0)
+        return -1;
+
+    if (ncpus == 0)
+        return 0;
+
+    defs = qemuMonitorCPUDefsNew(ncpus);
+
+    for (i = 0; i < ncpus; i++) {
+        qemuMonitorCPUDefInfoPtr cpu = defs->cpus + i;
+        unsigned int usable;
+        unsigned int nblockers;
+
+        if (virFileCacheReadString(reader, &cpu->name) < 0 ||
+            virFileCacheReadString(reader, &cpu->type) < 0 ||
+            virFileCacheReadUInt(reader, &usable) < 0 ||
+            virFileCacheReadUInt(reader, &nblockers) < 0)
+            return -1;
+
+        cpu->usable = usable;
+
+        if (nblockers == 0)
+            continue;
+
+        cpu->blockers = g_new0(char *, nblockers + 1);
+        for (j = 0; j < nblockers; j++) {
+            if (virFileCacheReadString(reader, &cpu->blockers[j]) < 0)
+                return -1;
+        }
+    }
+
+    caps->cpuModels = g_steal_pointer(&defs);
+    return 0;
+}
+
+
+static int
+virQEMUCapsParseBinaryMachines(virQEMUCapsAccelPtr caps,
+                               virFileCacheReaderPtr reader)
+{
+    unsigned int nmachines;
+    size_t i;
+
+    if (virFileCacheReadUInt(reader, &nmachines) < 0)
+        return -1;
+
+    if (nmachines == 0)
+        return 0;
+
+    caps->machineTypes = g_new0(virQEMUCapsMachineType, nmachines);
+    caps->nmachineTypes = nmachines;
+
+    for (i = 0; i < nmachines; i++) {
+        virQEMUCapsMachineTypePtr mach = caps->machineTypes + i;
+
+        if (virFileCacheReadString(reader, &mach->name) < 0 ||
+            virFileCacheReadString(reader, &mach->alias) < 0 ||
+            virFileCacheReadUInt(reader, &mach->maxCpus) < 0 ||
+            virFileCacheReadBool(reader, &mach->hotplugCpus) < 0 ||
+            virFileCacheReadBool(reader, &mach->qemuDefault) < 0 ||
+            virFileCacheReadString(reader, &mach->defaultCPU) < 0 ||
+            virFileCacheReadBool(reader, &mach->numaMemSupported) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virQEMUCapsParseBinaryAccel(virQEMUCapsPtr qemuCaps,
+                            virFileCacheReaderPtr reader,
+                            virDomainVirtType type)
+{
+    virQEMUCapsAccelPtr caps = virQEMUCapsGetAccel(qemuCaps, type);
+
+    if (virQEMUCapsParseBinaryHostCPU(caps, reader) < 0 ||
+        virQEMUCapsParseBinaryCPUModels(caps, reader) < 0 ||
+        virQEMUCapsParseBinaryMachines(caps, reader) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Counterpart of virQEMUCapsLoadCache for files written by
+ * virQEMUCapsSaveBinaryCache.
+ *
+ * Returns 0 on success, 1 if outdated, -1 on error
+ */
+int
+virQEMUCapsLoadBinaryCache(virArch hostArch,
+                           virQEMUCapsPtr qemuCaps,
+                           const char *filename,
+                           bool skipInvalidation)
+{
+    g_autoptr(virFileCacheReader) reader = NULL;
+    g_autofree char *str = NULL;
+    unsigned long long ull;
+    unsigned int val;
+    unsigned int nflags;
+    bool present;
+    size_t i;
+    int rc;
+
+    if ((rc = virFileCacheReaderOpen(filename, QEMU_CAPS_CACHE_BINARY_VERSION,
+                                     &reader)) < 0)
+        return -1;
+    if (rc == 0)
+        return 1;
+
+    if (virFileCacheReadULLong(reader, &ull) < 0 ||
+        virFileCacheReadUInt(reader, &qemuCaps->libvirtVersion) < 0)
+        return -1;
+    qemuCaps->libvirtCtime = (time_t)ull;
+
+    if (!skipInvalidation &&
+        (qemuCaps->libvirtCtime != virGetSelfLastChanged() ||
+         qemuCaps->libvirtVersion != LIBVIR_VERSION_NUMBER)) {
+        VIR_DEBUG("Outdated capabilities in %s: libvirt changed "
+                  "(%lld vs %lld, %lu vs %lu), stopping load",
+                  qemuCaps->binary,
+                  (long long)qemuCaps->libvirtCtime,
+                  (long long)virGetSelfLastChanged(),
+                  (unsigned long)qemuCaps->libvirtVersion,
+                  (unsigned long)LIBVIR_VERSION_NUMBER);
+        return 1;
+    }
+
+    if (virFileCacheReadString(reader, &str) < 0)
+        return -1;
+    if (STRNEQ_NULLABLE(str, qemuCaps->binary)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Expected caps for '%s' but saw '%s'"),
+                       qemuCaps->binary, NULLSTR(str));
+        return -1;
+    }
+
+    if (virFileCacheReadULLong(reader, &ull) < 0)
+        return -1;
+    qemuCaps->ctime = (time_t)ull;
+
+    if (virFileCacheReadUInt(reader, &val) < 0 ||
+        virFileCacheReadUInt(reader, &nflags) < 0)
+        return -1;
+    if (val != QEMU_CAPS_LAST) {
+        VIR_DEBUG("Outdated capabilities in %s: %u flags known, expected %u",
+                  filename, val, QEMU_CAPS_LAST);
+        return 1;
+    }
+    for (i = 0; i < nflags; i++) {
+        if (virFileCacheReadUInt(reader, &val) < 0)
+            return -1;
+        if (val >= QEMU_CAPS_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Unknown qemu capabilities flag %u"), val);
+            return -1;
+        }
+        virQEMUCapsSet(qemuCaps, val);
+    }
+
+    if (virFileCacheReadUInt(reader, &qemuCaps->version) < 0 ||
+        virFileCacheReadUInt(reader, &qemuCaps->kvmVersion) < 0 ||
+        virFileCacheReadUInt(reader, &qemuCaps->microcodeVersion) < 0 ||
+        virFileCacheReadString(reader, &qemuCaps->hostCPUSignature) < 0 ||
+        virFileCacheReadString(reader, &qemuCaps->package) < 0 ||
+        virFileCacheReadString(reader, &qemuCaps->kernelVersion) < 0 ||
+        virFileCacheReadUInt(reader, &val) < 0)
+        return -1;
+
+    if (val == VIR_ARCH_NONE || val >= VIR_ARCH_LAST) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unknown arch %u in QEMU capabilities cache"), val);
+        return -1;
+    }
+    qemuCaps->arch = val;
+
+    if (virQEMUCapsParseBinaryAccel(qemuCaps, reader, VIR_DOMAIN_VIRT_KVM) < 0 ||
+        virQEMUCapsParseBinaryAccel(qemuCaps, reader, VIR_DOMAIN_VIRT_QEMU) < 0)
+        return -1;
+
+    if (virFileCacheReadUInt(reader, &val) < 0)
+        return -1;
+    if (val > 0) {
+        qemuCaps->gicCapabilities = g_new0(virGICCapability, val);
+        qemuCaps->ngicCapabilities = val;
+
+        for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+            virGICCapabilityPtr cap = &qemuCaps->gicCapabilities[i];
+
+            if (virFileCacheReadUInt(reader, &val) < 0)
+                return -1;
+            cap->version = val;
+
+            if (virFileCacheReadUInt(reader, &val) < 0)
+                return -1;
+            cap->implementation = val;
+        }
+    }
+
+    if (virFileCacheReadBool(reader, &present) < 0)
+        return -1;
+    if (present) {
+        g_autoptr(virSEVCapability) sev = g_new0(virSEVCapability, 1);
+
+        if (virFileCacheReadUInt(reader, &sev->cbitpos) < 0 ||
+            virFileCacheReadUInt(reader, &sev->reduced_phys_bits) < 0 ||
+            virFileCacheReadString(reader, &sev->pdh) < 0 ||
+            virFileCacheReadString(reader, &sev->cert_chain) < 0)
+            return -1;
+
+        qemuCaps->sevCapabilities = g_steal_pointer(&sev);
+    }
+
+    if (virFileCacheReadBool(reader, &qemuCaps->kvmSupportsNesting) < 0 ||
+        virFileCacheReadBool(reader, &qemuCaps->kvmSupportsSecureGuest) < 0)
+        return -1;
+
+    if (!virFileCacheReaderAtEnd(reader)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("trailing data in QEMU capabilities cache '%s'"),
+                       filename);
+        return -1;
+    }
+
+    virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_KVM);
+    virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_QEMU);
+
+    if (skipInvalidation)
+        qemuCaps->invalidation = false;
+
+    return 0;
+}
+
+
 /*
  * Check whether IBM Secure Execution (S390) is enabled
  */
@@ -5536,6 +6022,35 @@ virQEMUCapsLoadFile(const char *filename,
 }
 
 
+static void *
+virQEMUCapsLoadBinaryFile(const char *filename,
+                          const char *binary,
+                          void *privData,
+                          bool *outdated)
+{
+    virQEMUCapsPtr qemuCaps = virQEMUCapsNewBinary(binary);
+    virQEMUCapsCachePrivPtr priv = privData;
+    int ret;
+
+    if (!qemuCaps)
+        return NULL;
+
+    ret = virQEMUCapsLoadBinaryCache(priv->hostArch, qemuCaps, filename, false);
+    if (ret < 0)
+        goto error;
+    if (ret == 1) {
+        *outdated = true;
+        goto error;
+    }
+
+    return qemuCaps;
+
+ error:
+    virObjectUnref(qemuCaps);
+    return NULL;
+}
+
+
 struct virQEMUCapsMachineTypeFilter {
     const char *machineType;
     virQEMUCapsFlags *flags;
@@ -5581,6 +6096,8 @@ virFileCacheHandlers qemuCapsCacheHandlers = {
     .loadFile = virQEMUCapsLoadFile,
     .saveFile = virQEMUCapsSaveFile,
     .privFree = virQEMUCapsCachePrivFree,
+    .loadBinaryFile = virQEMUCapsLoadBinaryFile,
+    .saveBinaryFile = virQEMUCapsSaveBinaryFile,
 };
 
 
@@ -43,6 +43,13 @@ int virQEMUCapsLoadCache(virArch hostArch,
                          bool skipInvalidation);
 char *virQEMUCapsFormatCache(virQEMUCapsPtr qemuCaps);
 
+int virQEMUCapsLoadBinaryCache(virArch hostArch,
+                               virQEMUCapsPtr qemuCaps,
+                               const char *filename,
+                               bool skipInvalidation);
+int virQEMUCapsSaveBinaryCache(virQEMUCapsPtr qemuCaps,
+                               const char *filename);
+
 int
 virQEMUCapsInitQMPMonitor(virQEMUCapsPtr qemuCaps,
                           qemuMonitorPtr mon);
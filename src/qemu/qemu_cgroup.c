@@ -921,6 +921,8 @@ qemuInitCgroup(virDomainObjPtr vm,
     if (!virCgroupAvailable())
         return 0;
 
+    g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+    priv->cgroupStatsFailed = false;
     virCgroupFree(&priv->cgroup);
 
     if (!vm->def->resource) {
@@ -1048,6 +1050,8 @@ qemuConnectCgroup(virDomainObjPtr vm)
     if (!virCgroupAvailable())
         return 0;
 
+    g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+    priv->cgroupStatsFailed = false;
     virCgroupFree(&priv->cgroup);
 
     if (virCgroupNewDetectMachine(vm->def->name,
@@ -690,6 +690,15 @@ virQEMUDriverConfigLoadProcessEntry(virQEMUDriverConfigPtr cfg,
 
     if (virConfGetValueBool(conf, "dump_guest_core", &cfg->dumpGuestCore) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "numa_rebalance_interval",
+                            &cfg->numaRebalanceInterval) < 0)
+        return -1;
+    if (cfg->numaRebalanceInterval > INT_MAX / 1000) {
+        virReportError(VIR_ERR_CONF_SYNTAX,
+                       _("numa_rebalance_interval must not exceed %d seconds"),
+                       INT_MAX / 1000);
+        return -1;
+    }
     if (virConfGetValueString(conf, "stdio_handler", &stdioHandler) < 0)
         return -1;
     if (stdioHandler) {
@@ -741,6 +750,8 @@ virQEMUDriverConfigLoadRPCEntry(virQEMUDriverConfigPtr cfg,
 {
     if (virConfGetValueUInt(conf, "max_queued", &cfg->maxQueuedJobs) < 0)
         return -1;
+    if (virConfGetValueBool(conf, "event_coalesce", &cfg->eventCoalesce) < 0)
+        return -1;
     if (virConfGetValueInt(conf, "keepalive_interval", &cfg->keepAliveInterval) < 0)
         return -1;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
@@ -750,6 +761,19 @@ virQEMUDriverConfigLoadRPCEntry(virQEMUDriverConfigPtr cfg,
 }
 
 
+static int
+virQEMUDriverConfigLoadStatsEntry(virQEMUDriverConfigPtr cfg,
+                                  virConfPtr conf)
+{
+    if (virConfGetValueUInt(conf, "stats_workers", &cfg->statsWorkers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_timeout", &cfg->statsTimeout) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 static int
 virQEMUDriverConfigLoadNetworkEntry(virQEMUDriverConfigPtr cfg,
                                     virConfPtr conf,
@@ -1081,6 +1105,9 @@ int virQEMUDriverConfigLoadFile(virQEMUDriverConfigPtr cfg,
     if (virQEMUDriverConfigLoadRPCEntry(cfg, conf) < 0)
         return -1;
 
+    if (virQEMUDriverConfigLoadStatsEntry(cfg, conf) < 0)
+        return -1;
+
     if (virQEMUDriverConfigLoadNetworkEntry(cfg, conf, filename) < 0)
         return -1;
 
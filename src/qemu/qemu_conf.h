@@ -48,6 +48,7 @@
 #include "virfile.h"
 #include "virfilecache.h"
 #include "virfirmware.h"
+#include "virnuma.h"
 
 #define QEMU_DRIVER_NAME "QEMU"
 
@@ -183,8 +184,12 @@ struct _virQEMUDriverConfig {
     unsigned int maxThreadsPerProc;
     unsigned long long maxCore;
     bool dumpGuestCore;
+    unsigned int numaRebalanceInterval;
 
     unsigned int maxQueuedJobs;
+    unsigned int statsWorkers;
+    unsigned int statsTimeout;
+    bool eventCoalesce;
 
     char **securityDriverNames;
     bool securityDefaultConfined;
@@ -322,6 +327,18 @@ struct _virQEMUDriver {
 
     /* Immutable pointer, self-locking APIs */
     virHashAtomicPtr migrationErrors;
+
+    /* Immutable pointer, self-locking APIs */
+    virNumaPlacementPtr numaPlacement;
+
+    /* Immutable value, -1 if NUMA rebalancing is disabled */
+    int numaRebalanceTimer;
+
+    /* Immutable value, -1 if status XML is always saved immediately */
+    int statusSaveTimer;
+
+    /* Atomic access only, whether statusSaveTimer is armed */
+    int statusSaveArmed;
 };
 
 virQEMUDriverConfigPtr virQEMUDriverConfigNew(bool privileged,
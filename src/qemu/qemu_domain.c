@@ -1628,8 +1628,12 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
     g_strfreev(priv->qemuDevices);
     priv->qemuDevices = NULL;
 
+    g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+    priv->cgroupStatsFailed = false;
     virCgroupFree(&priv->cgroup);
 
+    priv->statusDirty = false;
+
     virPerfFree(priv->perf);
     priv->perf = NULL;
 
@@ -5356,8 +5360,10 @@ qemuDomainObjSaveStatus(virQEMUDriverPtr driver,
                         virDomainObjPtr obj)
 {
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivatePtr priv = obj->privateData;
 
     if (virDomainObjIsActive(obj)) {
+        priv->statusDirty = false;
         if (virDomainObjSave(obj, driver->xmlopt, cfg->stateDir) < 0)
             VIR_WARN("Failed to save status on vm %s", obj->def->name);
     }
@@ -5371,6 +5377,52 @@ qemuDomainSaveStatus(virDomainObjPtr obj)
 }
 
 
+/**
+ * qemuDomainSaveStatusLater:
+ * @obj: domain object
+ *
+ * Mark the status of @obj as changed and let the event worker save it
+ * once QEMU_DOMAIN_STATUS_SAVE_DELAY has passed, so that a burst of
+ * changes results in a single write. The previous status stays on disk
+ * until then, so use this only for state which is refreshed from QEMU
+ * when reconnecting to the domain.
+ */
+void
+qemuDomainSaveStatusLater(virDomainObjPtr obj)
+{
+    qemuDomainObjPrivatePtr priv = obj->privateData;
+    virQEMUDriverPtr driver = priv->driver;
+
+    if (driver->statusSaveTimer < 0) {
+        qemuDomainObjSaveStatus(driver, obj);
+        return;
+    }
+
+    priv->statusDirty = true;
+
+    if (g_atomic_int_compare_and_exchange(&driver->statusSaveArmed, 0, 1))
+        virEventUpdateTimeout(driver->statusSaveTimer,
+                              QEMU_DOMAIN_STATUS_SAVE_DELAY);
+}
+
+
+/**
+ * qemuDomainSaveStatusFlush:
+ * @obj: domain object
+ *
+ * Save the status of @obj if qemuDomainSaveStatusLater is still
+ * waiting to do so.
+ */
+void
+qemuDomainSaveStatusFlush(virDomainObjPtr obj)
+{
+    qemuDomainObjPrivatePtr priv = obj->privateData;
+
+    if (priv->statusDirty)
+        qemuDomainObjSaveStatus(priv->driver, obj);
+}
+
+
 void
 qemuDomainSaveConfig(virDomainObjPtr obj)
 {
@@ -10384,6 +10436,8 @@ qemuProcessEventFree(struct qemuProcessEvent *event)
         virObjectUnref(event->data);
         break;
     case QEMU_PROCESS_EVENT_PR_DISCONNECT:
+    case QEMU_PROCESS_EVENT_NUMA_REBALANCE:
+    case QEMU_PROCESS_EVENT_SAVE_STATUS:
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
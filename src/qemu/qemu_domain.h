@@ -60,11 +60,16 @@ typedef void (*qemuDomainCleanupCallback)(virQEMUDriverPtr driver,
 
 #define QEMU_DOMAIN_MASTER_KEY_LEN 32  /* 32 bytes for 256 bit random key */
 
+/* How long qemuDomainSaveStatusLater collects changes, in milliseconds */
+#define QEMU_DOMAIN_STATUS_SAVE_DELAY 200
+
 void
 qemuDomainObjSaveStatus(virQEMUDriverPtr driver,
                         virDomainObjPtr obj);
 
 void qemuDomainSaveStatus(virDomainObjPtr obj);
+void qemuDomainSaveStatusLater(virDomainObjPtr obj);
+void qemuDomainSaveStatusFlush(virDomainObjPtr obj);
 void qemuDomainSaveConfig(virDomainObjPtr obj);
 
 
@@ -176,6 +181,8 @@ struct _qemuDomainObjPrivate {
     size_t ncleanupCallbacks_max;
 
     virCgroupPtr cgroup;
+    virCgroupStatsReaderPtr cgroupStats; /* CPU stats of @cgroup, lazily opened */
+    bool cgroupStatsFailed; /* @cgroupStats can't be opened for @cgroup */
 
     virPerfPtr perf;
 
@@ -185,6 +192,8 @@ struct _qemuDomainObjPrivate {
 
     bool hookRun;  /* true if there was a hook run over this domain */
 
+    bool statusDirty; /* status XML waits for qemuDomainSaveStatusLater */
+
     /* Bitmaps below hold data from the auto NUMA feature */
     virBitmapPtr autoNodeset;
     virBitmapPtr autoCpuset;
@@ -437,6 +446,8 @@ typedef enum {
     QEMU_PROCESS_EVENT_PR_DISCONNECT,
     QEMU_PROCESS_EVENT_RDMA_GID_STATUS_CHANGED,
     QEMU_PROCESS_EVENT_GUEST_CRASHLOADED,
+    QEMU_PROCESS_EVENT_NUMA_REBALANCE,
+    QEMU_PROCESS_EVENT_SAVE_STATUS,
 
     QEMU_PROCESS_EVENT_LAST
 } qemuProcessEventType;
@@ -793,11 +793,12 @@ qemuDomainObjCanSetJob(qemuDomainJobObjPtr job,
  * @job: qemuDomainJob to start
  * @asyncJob: qemuDomainAsyncJob to start
  * @nowait: don't wait trying to acquire @job
+ * @timeout: how long to wait for @job (in milliseconds)
  *
  * Acquires job for a domain object which must be locked before
- * calling. If there's already a job running waits up to
- * QEMU_JOB_WAIT_TIME after which the functions fails reporting
- * an error unless @nowait is set.
+ * calling. If there's already a job running waits up to @timeout
+ * (which is usually QEMU_JOB_WAIT_TIME) after which the functions
+ * fails reporting an error unless @nowait is set.
  *
  * If @nowait is true this function tries to acquire job and if
  * it fails, then it returns immediately without waiting. No
@@ -814,7 +815,8 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
                               qemuDomainJob job,
                               qemuDomainAgentJob agentJob,
                               qemuDomainAsyncJob asyncJob,
-                              bool nowait)
+                              bool nowait,
+                              unsigned long long timeout)
 {
     qemuDomainObjPrivatePtr priv = obj->privateData;
     unsigned long long now;
@@ -843,7 +845,7 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
         return -1;
 
     priv->jobs_queued++;
-    then = now + QEMU_JOB_WAIT_TIME;
+    then = now + timeout;
 
  retry:
     if ((!async && job != QEMU_JOB_DESTROY) &&
@@ -1029,7 +1031,8 @@ int qemuDomainObjBeginJob(virQEMUDriverPtr driver,
 {
     if (qemuDomainObjBeginJobInternal(driver, obj, job,
                                       QEMU_AGENT_JOB_NONE,
-                                      QEMU_ASYNC_JOB_NONE, false) < 0)
+                                      QEMU_ASYNC_JOB_NONE, false,
+                                      QEMU_JOB_WAIT_TIME) < 0)
         return -1;
     else
         return 0;
@@ -1049,7 +1052,8 @@ qemuDomainObjBeginAgentJob(virQEMUDriverPtr driver,
 {
     return qemuDomainObjBeginJobInternal(driver, obj, QEMU_JOB_NONE,
                                          agentJob,
-                                         QEMU_ASYNC_JOB_NONE, false);
+                                         QEMU_ASYNC_JOB_NONE, false,
+                                         QEMU_JOB_WAIT_TIME);
 }
 
 int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
@@ -1062,7 +1066,8 @@ int qemuDomainObjBeginAsyncJob(virQEMUDriverPtr driver,
 
     if (qemuDomainObjBeginJobInternal(driver, obj, QEMU_JOB_ASYNC,
                                       QEMU_AGENT_JOB_NONE,
-                                      asyncJob, false) < 0)
+                                      asyncJob, false,
+                                      QEMU_JOB_WAIT_TIME) < 0)
         return -1;
 
     priv = obj->privateData;
@@ -1094,7 +1099,7 @@ qemuDomainObjBeginNestedJob(virQEMUDriverPtr driver,
                                          QEMU_JOB_ASYNC_NESTED,
                                          QEMU_AGENT_JOB_NONE,
                                          QEMU_ASYNC_JOB_NONE,
-                                         false);
+                                         false, QEMU_JOB_WAIT_TIME);
 }
 
 /**
@@ -1117,7 +1122,37 @@ qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
 {
     return qemuDomainObjBeginJobInternal(driver, obj, job,
                                          QEMU_AGENT_JOB_NONE,
-                                         QEMU_ASYNC_JOB_NONE, true);
+                                         QEMU_ASYNC_JOB_NONE, true, 0);
+}
+
+
+/**
+ * qemuDomainObjBeginJobTimeout:
+ *
+ * @driver: qemu driver
+ * @obj: domain object
+ * @job: qemuDomainJob to start
+ * @timeout: how long to wait for @job (in milliseconds)
+ *
+ * Same as qemuDomainObjBeginJob() except the caller decides how
+ * long to wait for any job already running to finish. If
+ * @timeout is 0 the default QEMU_JOB_WAIT_TIME is used.
+ *
+ * Returns: see qemuDomainObjBeginJobInternal
+ */
+int
+qemuDomainObjBeginJobTimeout(virQEMUDriverPtr driver,
+                             virDomainObjPtr obj,
+                             qemuDomainJob job,
+                             unsigned long long timeout)
+{
+    if (timeout == 0)
+        timeout = QEMU_JOB_WAIT_TIME;
+
+    return qemuDomainObjBeginJobInternal(driver, obj, job,
+                                         QEMU_AGENT_JOB_NONE,
+                                         QEMU_ASYNC_JOB_NONE, false,
+                                         timeout);
 }
 
 /*
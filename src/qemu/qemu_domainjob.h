@@ -238,6 +238,11 @@ int qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
                                 virDomainObjPtr obj,
                                 qemuDomainJob job)
     G_GNUC_WARN_UNUSED_RESULT;
+int qemuDomainObjBeginJobTimeout(virQEMUDriverPtr driver,
+                                 virDomainObjPtr obj,
+                                 qemuDomainJob job,
+                                 unsigned long long timeout)
+    G_GNUC_WARN_UNUSED_RESULT;
 
 void qemuDomainObjEndJob(virQEMUDriverPtr driver,
                          virDomainObjPtr obj);
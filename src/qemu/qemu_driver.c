@@ -135,6 +135,27 @@ VIR_LOG_INIT("qemu.qemu_driver");
 
 #define QEMU_NB_BANDWIDTH_PARAM 7
 
+static void
+processNumaRebalanceEvent(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm)
+{
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        return;
+
+    if (!virDomainObjIsActive(vm)) {
+        VIR_DEBUG("Domain is not running");
+        goto endjob;
+    }
+
+    if (qemuProcessRebalanceNUMA(driver, vm) < 0)
+        VIR_WARN("Unable to rebalance NUMA placement of domain %s: %s",
+                 vm->def->name, virGetLastErrorMessage());
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+}
+
+
 static void qemuProcessEventHandler(void *data, void *opaque);
 
 static int qemuStateCleanup(void);
@@ -621,6 +642,108 @@ qemuDomainFindMaxID(virDomainObjPtr vm,
 }
 
 
+static int
+qemuDomainNumaRebalanceQueue(virDomainObjPtr vm,
+                             void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    qemuDomainObjPrivatePtr priv;
+    struct qemuProcessEvent *processEvent;
+
+    virObjectLock(vm);
+    priv = vm->privateData;
+
+    if (!virDomainObjIsActive(vm) || !priv->autoNodeset)
+        goto cleanup;
+
+    processEvent = g_new0(struct qemuProcessEvent, 1);
+    processEvent->eventType = QEMU_PROCESS_EVENT_NUMA_REBALANCE;
+    processEvent->vm = virObjectRef(vm);
+
+    if (virThreadPoolSendJob(driver->workerPool, 0, processEvent) < 0) {
+        virObjectUnref(vm);
+        qemuProcessEventFree(processEvent);
+    }
+
+ cleanup:
+    virObjectUnlock(vm);
+    return 0;
+}
+
+
+/*
+ * Periodically let the event worker reconsider the NUMA placement of
+ * running domains with automatic placement, one domain at a time.
+ */
+static void
+qemuDomainNumaRebalance(int timer G_GNUC_UNUSED,
+                        void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+
+    virDomainObjListForEach(driver->domains, false,
+                            qemuDomainNumaRebalanceQueue, driver);
+}
+
+
+static int
+qemuDomainSaveStatusQueue(virDomainObjPtr vm,
+                          void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    qemuDomainObjPrivatePtr priv;
+    struct qemuProcessEvent *processEvent;
+
+    virObjectLock(vm);
+    priv = vm->privateData;
+
+    if (!priv->statusDirty)
+        goto cleanup;
+
+    processEvent = g_new0(struct qemuProcessEvent, 1);
+    processEvent->eventType = QEMU_PROCESS_EVENT_SAVE_STATUS;
+    processEvent->vm = virObjectRef(vm);
+
+    if (virThreadPoolSendJob(driver->workerPool, 0, processEvent) < 0) {
+        virObjectUnref(vm);
+        qemuProcessEventFree(processEvent);
+    }
+
+ cleanup:
+    virObjectUnlock(vm);
+    return 0;
+}
+
+
+/*
+ * Let the event worker write the status of domains changed through
+ * qemuDomainSaveStatusLater since the timer was armed.
+ */
+static void
+qemuDomainSaveStatusTimer(int timer,
+                          void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+
+    virEventUpdateTimeout(timer, -1);
+    g_atomic_int_set(&driver->statusSaveArmed, 0);
+
+    virDomainObjListForEach(driver->domains, false,
+                            qemuDomainSaveStatusQueue, driver);
+}
+
+
+static int
+qemuDomainSaveStatusFlushOne(virDomainObjPtr vm,
+                             void *opaque G_GNUC_UNUSED)
+{
+    virObjectLock(vm);
+    qemuDomainSaveStatusFlush(vm);
+    virObjectUnlock(vm);
+    return 0;
+}
+
+
 /**
  * qemuStateInitialize:
  *
@@ -645,6 +768,8 @@ qemuStateInitialize(bool privileged,
         return VIR_DRV_STATE_INIT_ERROR;
 
     qemu_driver->lockFD = -1;
+    qemu_driver->numaRebalanceTimer = -1;
+    qemu_driver->statusSaveTimer = -1;
 
     if (virMutexInit(&qemu_driver->lock) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -688,6 +813,10 @@ qemuStateInitialize(bool privileged,
     if (virQEMUDriverConfigSetDefaults(cfg) < 0)
         goto error;
 
+    if (cfg->eventCoalesce)
+        virObjectEventStateSetCoalesce(qemu_driver->domainEventState,
+                                       virDomainEventCoalesce);
+
     if (virFileMakePath(cfg->stateDir) < 0) {
         virReportSystemError(errno, _("Failed to create state dir %s"),
                              cfg->stateDir);
@@ -997,8 +1126,24 @@ qemuStateInitialize(bool privileged,
     if (!qemu_driver->workerPool)
         goto error;
 
+    if ((qemu_driver->statusSaveTimer =
+         virEventAddTimeout(-1, qemuDomainSaveStatusTimer,
+                            qemu_driver, NULL)) < 0)
+        goto error;
+
+    /* running domains record their NUMA placement when reconnecting */
+    if (!(qemu_driver->numaPlacement = virNumaPlacementNew()))
+        goto error;
+
     qemuProcessReconnectAll(qemu_driver);
 
+    if (cfg->numaRebalanceInterval > 0 && virNumaIsAvailable() &&
+        (qemu_driver->numaRebalanceTimer =
+         virEventAddTimeout(cfg->numaRebalanceInterval * 1000,
+                            qemuDomainNumaRebalance,
+                            qemu_driver, NULL)) < 0)
+        goto error;
+
     if (virDriverShouldAutostart(cfg->stateDir, &autostart) < 0)
         goto error;
 
@@ -1117,6 +1262,15 @@ qemuStateCleanup(void)
     if (!qemu_driver)
         return -1;
 
+    if (qemu_driver->numaRebalanceTimer >= 0)
+        virEventRemoveTimeout(qemu_driver->numaRebalanceTimer);
+
+    /* don't lose status changes which are still waiting for the timer */
+    if (qemu_driver->statusSaveTimer >= 0) {
+        virEventRemoveTimeout(qemu_driver->statusSaveTimer);
+        virDomainObjListForEach(qemu_driver->domains, false,
+                                qemuDomainSaveStatusFlushOne, NULL);
+    }
     virObjectUnref(qemu_driver->migrationErrors);
     virObjectUnref(qemu_driver->closeCallbacks);
     virLockManagerPluginUnref(qemu_driver->lockManager);
@@ -1138,6 +1292,10 @@ qemuStateCleanup(void)
     virObjectUnref(qemu_driver->domains);
     virThreadPoolFree(qemu_driver->workerPool);
 
+    /* workers may still be placing domains until the pool is gone */
+    virNumaPlacementFree(qemu_driver->numaPlacement);
+    qemu_driver->numaPlacement = NULL;
+
     if (qemu_driver->lockFD != -1)
         virPidFileRelease(qemu_driver->config->stateDir, "driver", qemu_driver->lockFD);
 
@@ -1244,6 +1402,7 @@ qemuConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_PROGRAM_KEEPALIVE:
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_EVENT_BATCH:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     default:
         return 0;
@@ -4945,6 +5104,12 @@ static void qemuProcessEventHandler(void *data, void *opaque)
     case QEMU_PROCESS_EVENT_GUEST_CRASHLOADED:
         processGuestCrashloadedEvent(driver, vm);
         break;
+    case QEMU_PROCESS_EVENT_NUMA_REBALANCE:
+        processNumaRebalanceEvent(driver, vm);
+        break;
+    case QEMU_PROCESS_EVENT_SAVE_STATUS:
+        qemuDomainSaveStatusFlush(vm);
+        break;
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
@@ -20951,6 +21116,7 @@ qemuDomainGetStatsCpuCgroup(virDomainObjPtr dom,
                             virTypedParamListPtr params)
 {
     qemuDomainObjPrivatePtr priv = dom->privateData;
+    virCgroupStats stats;
     unsigned long long cpu_time = 0;
     unsigned long long user_time = 0;
     unsigned long long sys_time = 0;
@@ -20959,6 +21125,35 @@ qemuDomainGetStatsCpuCgroup(virDomainObjPtr dom,
     if (!priv->cgroup)
         return 0;
 
+    /* Bulk stats are sampled often, keep the cgroup files open between
+     * calls rather than opening and parsing each of them every time.
+     * If that is not possible for this cgroup, don't retry on every
+     * call and use the getters below instead. */
+    if (!priv->cgroupStats && !priv->cgroupStatsFailed) {
+        if (!(priv->cgroupStats = virCgroupStatsReaderNew(priv->cgroup,
+                                                          VIR_CGROUP_STATS_CPU))) {
+            VIR_DEBUG("Falling back to reading cgroup stats per call: %s",
+                      virGetLastErrorMessage());
+            priv->cgroupStatsFailed = true;
+            virResetLastError();
+        }
+    }
+
+    if (priv->cgroupStats) {
+        if (virCgroupStatsReaderRead(priv->cgroupStats, &stats) == 0) {
+            if (virTypedParamListAddULLong(params, stats.cpuTime, "cpu.time") < 0 ||
+                virTypedParamListAddULLong(params, stats.cpuUser, "cpu.user") < 0 ||
+                virTypedParamListAddULLong(params, stats.cpuSystem, "cpu.system") < 0)
+                return -1;
+
+            return 0;
+        }
+
+        /* reopen the files next time, e.g. after the cgroup changed */
+        g_clear_pointer(&priv->cgroupStats, virCgroupStatsReaderFree);
+        virResetLastError();
+    }
+
     err = virCgroupGetCpuacctUsage(priv->cgroup, &cpu_time);
     if (!err && virTypedParamListAddULLong(params, cpu_time, "cpu.time") < 0)
         return -1;
@@ -21757,6 +21952,155 @@ qemuDomainGetStats(virConnectPtr conn,
 }
 
 
+typedef struct _qemuDomainGetStatsCollector qemuDomainGetStatsCollector;
+typedef qemuDomainGetStatsCollector *qemuDomainGetStatsCollectorPtr;
+struct _qemuDomainGetStatsCollector {
+    virConnectPtr conn;
+    virDomainObjPtr *vms;
+    size_t nvms;
+    unsigned int stats;
+    unsigned int privflags;
+    unsigned int flags;
+    unsigned long long timeout; /* job wait time in ms, 0 for default */
+
+    /* one slot per domain in @vms so that the order is kept */
+    virDomainStatsRecordPtr *records;
+
+    int next; /* index of the next domain to process, atomic */
+    int failed; /* atomic */
+
+    virMutex lock;
+    virErrorPtr err; /* first error reported by any of the workers */
+};
+
+
+static int
+qemuDomainGetStatsCollectOne(qemuDomainGetStatsCollectorPtr data,
+                             virDomainObjPtr vm,
+                             virDomainStatsRecordPtr *record)
+{
+    virQEMUDriverPtr driver = data->conn->privateData;
+    unsigned int domflags = 0;
+    int ret;
+
+    virObjectLock(vm);
+
+    if (HAVE_JOB(data->privflags)) {
+        int rv;
+
+        if (data->flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
+        else
+            rv = qemuDomainObjBeginJobTimeout(driver, vm, QEMU_JOB_QUERY,
+                                              data->timeout);
+
+        if (rv == 0)
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    if (data->flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    ret = qemuDomainGetStats(data->conn, vm, data->stats, record, domflags);
+
+    if (HAVE_JOB(domflags))
+        qemuDomainObjEndJob(driver, vm);
+
+    virObjectUnlock(vm);
+    return ret;
+}
+
+
+static void
+qemuDomainGetStatsCollectWorker(void *opaque)
+{
+    qemuDomainGetStatsCollectorPtr data = opaque;
+    int i;
+
+    while (!g_atomic_int_get(&data->failed)) {
+        i = g_atomic_int_add(&data->next, 1);
+        if ((size_t) i >= data->nvms)
+            break;
+
+        if (qemuDomainGetStatsCollectOne(data, data->vms[i],
+                                         &data->records[i]) < 0) {
+            g_atomic_int_set(&data->failed, 1);
+
+            /* errors are thread local, hand it over to the caller */
+            virMutexLock(&data->lock);
+            if (!data->err)
+                virErrorPreserveLast(&data->err);
+            virMutexUnlock(&data->lock);
+            break;
+        }
+    }
+}
+
+
+/**
+ * qemuDomainGetStatsCollect:
+ * @data: collector
+ * @nworkers: maximum number of threads to use
+ *
+ * Gathers statistics of all domains in @data->vms, using up to
+ * @nworkers threads (including the calling one) so that a domain
+ * which is slow to respond doesn't delay the others. The records
+ * are stored in @data->records at the same index as the domain
+ * they belong to.
+ *
+ * Returns 0 on success, -1 on error (with the error of the first
+ * failing domain reported).
+ */
+static int
+qemuDomainGetStatsCollect(qemuDomainGetStatsCollectorPtr data,
+                          size_t nworkers)
+{
+    g_autofree virThreadPtr threads = NULL;
+    size_t nthreads = 0;
+    size_t i;
+
+    if (nworkers > data->nvms)
+        nworkers = data->nvms;
+
+    if (virMutexInit(&data->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        return -1;
+    }
+
+    if (nworkers > 1) {
+        threads = g_new0(virThread, nworkers - 1);
+
+        for (i = 0; i < nworkers - 1; i++) {
+            if (virThreadCreateFull(&threads[i], true,
+                                    qemuDomainGetStatsCollectWorker,
+                                    "qemu-stats", false, data) < 0) {
+                /* the threads already running and the current one
+                 * will take care of the remaining domains */
+                VIR_WARN("Failed to create stats worker thread");
+                break;
+            }
+            nthreads++;
+        }
+    }
+
+    qemuDomainGetStatsCollectWorker(data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data->lock);
+
+    if (g_atomic_int_get(&data->failed)) {
+        virErrorRestore(&data->err);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 qemuConnectGetAllDomainStats(virConnectPtr conn,
                              virDomainPtr *doms,
@@ -21766,17 +22110,19 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
                              unsigned int flags)
 {
     virQEMUDriverPtr driver = conn->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainGetStatsCollector data = { 0 };
     virErrorPtr orig_err = NULL;
     virDomainObjPtr *vms = NULL;
-    virDomainObjPtr vm;
     size_t nvms;
     virDomainStatsRecordPtr *tmpstats = NULL;
     bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
     int nstats = 0;
+    size_t nworkers;
     size_t i;
+    int rv;
     int ret = -1;
     unsigned int privflags = 0;
-    unsigned int domflags = 0;
     unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
@@ -21812,45 +22158,35 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     if (qemuDomainGetStatsNeedMonitor(stats))
         privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
 
-    for (i = 0; i < nvms; i++) {
-        virDomainStatsRecordPtr tmp = NULL;
-        domflags = 0;
-        vm = vms[i];
-
-        virObjectLock(vm);
+    if ((nworkers = cfg->statsWorkers) == 0) {
+        int ncpus = virHostCPUGetCount();
 
-        if (HAVE_JOB(privflags)) {
-            int rv;
-
-            if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
-                rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
-            else
-                rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+        nworkers = ncpus > 0 ? ncpus : 1;
+    }
 
-            if (rv == 0)
-                domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
-        }
-        /* else: without a job it's still possible to gather some data */
+    data.conn = conn;
+    data.vms = vms;
+    data.nvms = nvms;
+    data.stats = stats;
+    data.privflags = privflags;
+    data.flags = flags;
+    data.timeout = cfg->statsTimeout * 1000ull;
+    data.records = tmpstats;
 
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
-        if (qemuDomainGetStats(conn, vm, stats, &tmp, domflags) < 0) {
-            if (HAVE_JOB(domflags) && vm)
-                qemuDomainObjEndJob(driver, vm);
+    rv = qemuDomainGetStatsCollect(&data, nworkers);
 
-            virObjectUnlock(vm);
-            goto cleanup;
-        }
+    /* squash the list so that it is NULL terminated even if some
+     * of the domains didn't produce any record */
+    for (i = 0; i < nvms; i++) {
+        virDomainStatsRecordPtr tmp = g_steal_pointer(&tmpstats[i]);
 
         if (tmp)
             tmpstats[nstats++] = tmp;
-
-        if (HAVE_JOB(domflags))
-            qemuDomainObjEndJob(driver, vm);
-
-        virObjectUnlock(vm);
     }
 
+    if (rv < 0)
+        goto cleanup;
+
     *retStats = tmpstats;
     tmpstats = NULL;
 
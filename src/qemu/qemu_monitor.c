@@ -60,13 +60,18 @@ VIR_LOG_INIT("qemu.qemu_monitor");
 
 /* We read from QEMU until seeing a \r\n pair to indicate a
  * completed reply or event. To avoid memory denial-of-service
- * though, we must have a size limit on amount of data we
- * buffer. 10 MB is large enough that it ought to cope with
+ * though, we must have a size limit on a single reply or event
+ * we parse. 10 MB is large enough that it ought to cope with
  * normal QEMU replies, and small enough that we're not
  * consuming unreasonable mem.
  */
 #define QEMU_MONITOR_MAX_RESPONSE (10 * 1024 * 1024)
 
+/* Incoming data is read in chunks of this size which are fed to
+ * the JSON parser right away, so a large reply is never held in
+ * memory in its textual form. */
+#define QEMU_MONITOR_READ_SIZE (64 * 1024)
+
 struct _qemuMonitor {
     virObjectLockable parent;
 
@@ -93,6 +98,9 @@ struct _qemuMonitor {
     size_t bufferLength;
     char *buffer;
 
+    /* Parser of the reply or event being received */
+    virJSONStreamParserPtr parser;
+
     /* If anything went wrong, this will be fed back
      * the next monitor msg */
     virError lastError;
@@ -232,6 +240,7 @@ qemuMonitorDispose(void *obj)
     virResetError(&mon->lastError);
     virCondDestroy(&mon->notify);
     VIR_FREE(mon->buffer);
+    virJSONStreamParserFree(mon->parser);
     virJSONValueFree(mon->options);
     VIR_FREE(mon->balloonpath);
 }
@@ -312,7 +321,7 @@ qemuMonitorOpenUnix(const char *monitor,
 static int
 qemuMonitorIOProcess(qemuMonitorPtr mon)
 {
-    int len;
+    int nmsgs;
     qemuMonitorMessagePtr msg = NULL;
 
     /* See if there's a message & whether its ready for its reply
@@ -335,24 +344,20 @@ qemuMonitorIOProcess(qemuMonitorPtr mon)
     PROBE_QUIET(QEMU_MONITOR_IO_PROCESS, "mon=%p buf=%s len=%zu",
                 mon, mon->buffer, mon->bufferOffset);
 
-    len = qemuMonitorJSONIOProcess(mon,
-                                   mon->buffer, mon->bufferOffset,
-                                   msg);
-    if (len < 0)
+    nmsgs = qemuMonitorJSONIOProcess(mon, mon->parser,
+                                     mon->buffer, mon->bufferOffset,
+                                     msg);
+    if (nmsgs < 0)
         return -1;
 
-    if (len && mon->waitGreeting)
+    if (nmsgs && mon->waitGreeting)
         mon->waitGreeting = false;
 
-    if (len < mon->bufferOffset) {
-        memmove(mon->buffer, mon->buffer + len, mon->bufferOffset - len);
-        mon->bufferOffset -= len;
-    } else {
-        VIR_FREE(mon->buffer);
-        mon->bufferOffset = mon->bufferLength = 0;
-    }
+    /* Everything was handed over to the parser, including any
+     * incomplete message, so the buffer can be reused */
+    mon->bufferOffset = 0;
 #if DEBUG_IO
-    VIR_DEBUG("Process done %d used %d", (int)mon->bufferOffset, len);
+    VIR_DEBUG("Process done, %d messages", nmsgs);
 #endif
 
     /* As the monitor mutex was unlocked in qemuMonitorJSONIOProcess()
@@ -360,7 +365,7 @@ qemuMonitorIOProcess(qemuMonitorPtr mon)
      * means the above 'msg' may be invalid, thus we use 'mon->msg' here */
     if (mon->msg && mon->msg->finished)
         virCondBroadcast(&mon->notify);
-    return len;
+    return nmsgs;
 }
 
 
@@ -460,22 +465,15 @@ qemuMonitorIOWrite(qemuMonitorPtr mon)
 static int
 qemuMonitorIORead(qemuMonitorPtr mon)
 {
-    size_t avail = mon->bufferLength - mon->bufferOffset;
+    size_t avail;
     int ret = 0;
 
-    if (avail < 1024) {
-        if (mon->bufferLength >= QEMU_MONITOR_MAX_RESPONSE) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("QEMU monitor reply exceeds buffer size (%d bytes)"),
-                           QEMU_MONITOR_MAX_RESPONSE);
-            return -1;
-        }
-        if (VIR_REALLOC_N(mon->buffer,
-                          mon->bufferLength + 1024) < 0)
-            return -1;
-        mon->bufferLength += 1024;
-        avail += 1024;
+    if (!mon->buffer) {
+        mon->buffer = g_new0(char, QEMU_MONITOR_READ_SIZE);
+        mon->bufferLength = QEMU_MONITOR_READ_SIZE;
+        mon->bufferOffset = 0;
     }
+    avail = mon->bufferLength - mon->bufferOffset;
 
     /* Read as much as we can get into our buffer,
        until we block on EAGAIN, or hit EOF */
@@ -697,6 +695,9 @@ qemuMonitorOpenInternal(virDomainObjPtr vm,
     mon->cb = cb;
     mon->callbackOpaque = opaque;
 
+    if (!(mon->parser = virJSONStreamParserNew(QEMU_MONITOR_MAX_RESPONSE)))
+        goto cleanup;
+
     if (virSetCloseExec(mon->fd) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("Unable to set monitor close-on-exec flag"));
@@ -50,8 +50,6 @@ VIR_LOG_INIT("qemu.qemu_monitor_json");
 
 #define QOM_CPU_PATH  "/machine/unattached/device[0]"
 
-#define LINE_ENDING "\r\n"
-
 VIR_ENUM_IMPL(qemuMonitorJob,
               QEMU_MONITOR_JOB_TYPE_LAST,
               "",
@@ -210,86 +208,119 @@ qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
 }
 
 int
-qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
-                             const char *line,
-                             qemuMonitorMessagePtr msg)
+qemuMonitorJSONIOProcessMessage(qemuMonitorPtr mon,
+                                virJSONValuePtr message,
+                                qemuMonitorMessagePtr msg)
 {
-    virJSONValuePtr obj = NULL;
-    int ret = -1;
+    g_autoptr(virJSONValue) obj = message;
+    g_autofree char *line = NULL;
 
-    VIR_DEBUG("Line [%s]", line);
+    /* The text of the message no longer exists once it was parsed,
+     * format it back only if somebody is going to look at it */
+    if (VIR_LOG_ENABLED(VIR_LOG_DEBUG) ||
+        PROBE_ENABLED(QEMU_MONITOR_RECV_EVENT) ||
+        PROBE_ENABLED(QEMU_MONITOR_RECV_REPLY))
+        line = virJSONValueToString(obj, false);
 
-    if (!(obj = virJSONValueFromString(line)))
-        goto cleanup;
+    VIR_DEBUG("Line [%s]", NULLSTR(line));
 
     if (virJSONValueGetType(obj) != VIR_JSON_TYPE_OBJECT) {
+        if (!line)
+            line = virJSONValueToString(obj, false);
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Parsed JSON reply '%s' isn't an object"), line);
-        goto cleanup;
+                       _("Parsed JSON reply '%s' isn't an object"),
+                       NULLSTR(line));
+        return -1;
     }
 
     if (virJSONValueObjectHasKey(obj, "QMP") == 1) {
-        ret = 0;
+        return 0;
     } else if (virJSONValueObjectHasKey(obj, "event") == 1) {
         PROBE(QEMU_MONITOR_RECV_EVENT,
-              "mon=%p event=%s", mon, line);
-        ret = qemuMonitorJSONIOProcessEvent(mon, obj);
+              "mon=%p event=%s", mon, NULLSTR(line));
+        return qemuMonitorJSONIOProcessEvent(mon, obj);
     } else if (virJSONValueObjectHasKey(obj, "error") == 1 ||
                virJSONValueObjectHasKey(obj, "return") == 1) {
         PROBE(QEMU_MONITOR_RECV_REPLY,
-              "mon=%p reply=%s", mon, line);
+              "mon=%p reply=%s", mon, NULLSTR(line));
         if (msg) {
-            msg->rxObject = obj;
+            msg->rxObject = g_steal_pointer(&obj);
             msg->finished = 1;
-            obj = NULL;
-            ret = 0;
-        } else {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Unexpected JSON reply '%s'"), line);
+            return 0;
         }
+
+        if (!line)
+            line = virJSONValueToString(obj, false);
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unexpected JSON reply '%s'"), NULLSTR(line));
     } else {
+        if (!line)
+            line = virJSONValueToString(obj, false);
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Unknown JSON reply '%s'"), line);
+                       _("Unknown JSON reply '%s'"), NULLSTR(line));
     }
 
- cleanup:
-    virJSONValueFree(obj);
-    return ret;
+    return -1;
 }
 
-int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
-                             const char *data,
-                             size_t len,
-                             qemuMonitorMessagePtr msg)
+
+/**
+ * qemuMonitorJSONIOProcess:
+ * @mon: monitor
+ * @parser: parser of the message currently being received
+ * @data: data read from the monitor
+ * @len: length of @data
+ * @msg: message waiting for a reply (if any)
+ *
+ * Feeds @data into @parser and dispatches every message completed
+ * by a line ending. An incomplete trailing message stays in
+ * @parser and is finished by the next call, so @data is always
+ * consumed in full.
+ *
+ * Returns the number of messages processed, or -1 on error.
+ */
+int
+qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
+                         virJSONStreamParserPtr parser,
+                         const char *data,
+                         size_t len,
+                         qemuMonitorMessagePtr msg)
 {
-    int used = 0;
-    /*VIR_DEBUG("Data %d bytes [%s]", len, data);*/
+    size_t used = 0;
+    int nmsgs = 0;
 
     while (used < len) {
-        char *nl = strstr(data + used, LINE_ENDING);
-
-        if (nl) {
-            int got = nl - (data + used);
-            char *line;
-            line = g_strndup(data + used, got);
-            used += got + strlen(LINE_ENDING);
-            line[got] = '\0'; /* kill \n */
-            if (qemuMonitorJSONIOProcessLine(mon, line, msg) < 0) {
-                VIR_FREE(line);
-                return -1;
-            }
+        /* QEMU never emits a raw newline inside of a message, and
+         * the '\r' preceding it is whitespace to the parser */
+        const char *nl = memchr(data + used, '\n', len - used);
+        size_t got = nl ? nl - (data + used) : len - used;
+        virJSONValuePtr obj;
 
-            VIR_FREE(line);
-        } else {
+        if (virJSONStreamParserFeed(parser, data + used, got) < 0)
+            return -1;
+
+        used += got;
+        if (!nl)
             break;
-        }
+        used++;
+
+        if (virJSONStreamParserFinish(parser, &obj) < 0)
+            return -1;
+
+        if (!obj)
+            continue;
+
+        if (qemuMonitorJSONIOProcessMessage(mon, obj, msg) < 0)
+            return -1;
+
+        nmsgs++;
     }
 
 #if DEBUG_IO
-    VIR_DEBUG("Total used %d bytes out of %zd available in buffer", used, len);
+    VIR_DEBUG("Processed %d messages out of %zu bytes", nmsgs, len);
 #endif
 
-    return used;
+    return nmsgs;
 }
 
 static int
@@ -28,11 +28,12 @@
 #include "cpu/cpu.h"
 #include "util/virgic.h"
 
-int qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
-                                 const char *line,
-                                 qemuMonitorMessagePtr msg) G_GNUC_NO_INLINE;
+int qemuMonitorJSONIOProcessMessage(qemuMonitorPtr mon,
+                                    virJSONValuePtr message,
+                                    qemuMonitorMessagePtr msg) G_GNUC_NO_INLINE;
 
 int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
+                             virJSONStreamParserPtr parser,
                              const char *data,
                              size_t len,
                              qemuMonitorMessagePtr msg);
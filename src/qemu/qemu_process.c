@@ -1145,7 +1145,6 @@ qemuProcessHandleTrayChange(qemuMonitorPtr mon G_GNUC_UNUSED,
     virQEMUDriverPtr driver = opaque;
     virObjectEventPtr event = NULL;
     virDomainDiskDefPtr disk;
-    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
     disk = qemuProcessFindDomainDiskByAliasOrQOM(vm, devAlias, devid);
@@ -1158,10 +1157,8 @@ qemuProcessHandleTrayChange(qemuMonitorPtr mon G_GNUC_UNUSED,
         else if (reason == VIR_DOMAIN_EVENT_TRAY_CHANGE_CLOSE)
             disk->tray_status = VIR_DOMAIN_DISK_TRAY_CLOSED;
 
-        if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0) {
-            VIR_WARN("Unable to save status on vm %s after tray moved event",
-                     vm->def->name);
-        }
+        /* tray status is refreshed from QEMU on reconnect */
+        qemuDomainSaveStatusLater(vm);
 
         virDomainObjBroadcast(vm);
     }
@@ -1258,7 +1255,6 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon G_GNUC_UNUSED,
 {
     virQEMUDriverPtr driver = opaque;
     virObjectEventPtr event = NULL;
-    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
 
     virObjectLock(vm);
     event = virDomainEventBalloonChangeNewFromObj(vm, actual);
@@ -1267,8 +1263,8 @@ qemuProcessHandleBalloonChange(qemuMonitorPtr mon G_GNUC_UNUSED,
               vm->def->mem.cur_balloon, actual);
     vm->def->mem.cur_balloon = actual;
 
-    if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
-        VIR_WARN("unable to save domain status with balloon change");
+    /* balloon size is refreshed from QEMU on reconnect */
+    qemuDomainSaveStatusLater(vm);
 
     virObjectUnlock(vm);
 
@@ -6090,24 +6086,81 @@ qemuProcessUpdateGuestCPU(virDomainDefPtr def,
 }
 
 
+/* Size in KiB of huge pages backing the memory of @def, 0 if there are none */
+static unsigned int
+qemuProcessGetNUMAPageSize(virQEMUDriverPtr driver,
+                           virDomainDefPtr def)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = NULL;
+    virHugeTLBFSPtr p;
+
+    if (def->mem.nhugepages == 0)
+        return 0;
+
+    if (def->mem.hugepages[0].size)
+        return def->mem.hugepages[0].size;
+
+    cfg = virQEMUDriverGetConfig(driver);
+    if (!cfg->nhugetlbfs)
+        return 0;
+
+    if (!(p = virFileGetDefaultHugepage(cfg->hugetlbfs, cfg->nhugetlbfs)))
+        p = &cfg->hugetlbfs[0];
+
+    return p->size;
+}
+
+
+/*
+ * Record the host NUMA nodes @vm is placed on so that placement of
+ * other domains takes its load into account.
+ */
+static void
+qemuProcessUpdateNUMALoad(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virBitmapPtr nodeset = priv->autoNodeset;
+
+    if (!driver->numaPlacement)
+        return;
+
+    if (!nodeset)
+        nodeset = virDomainNumatuneGetNodeset(vm->def->numa, NULL, -1);
+
+    if (!nodeset)
+        return;
+
+    if (virNumaPlacementSetDomain(driver->numaPlacement, vm->def->uuid,
+                                  nodeset, virDomainDefGetVcpus(vm->def),
+                                  virDomainDefGetMemoryTotal(vm->def)) < 0)
+        VIR_WARN("Unable to record NUMA placement of domain %s",
+                 vm->def->name);
+}
+
+
 static int
 qemuProcessPrepareDomainNUMAPlacement(virQEMUDriverPtr driver,
                                       virDomainObjPtr vm)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     g_autofree char *nodeset = NULL;
-    g_autoptr(virBitmap) numadNodeset = NULL;
+    g_autoptr(virBitmap) adviceNodeset = NULL;
     g_autoptr(virBitmap) hostMemoryNodeset = NULL;
     g_autoptr(virCapsHostNUMA) caps = NULL;
 
-    /* Get the advisory nodeset from numad if 'placement' of
-     * either <vcpu> or <numatune> is 'auto'.
+    /* Get the advisory nodeset if 'placement' of either <vcpu>
+     * or <numatune> is 'auto'.
      */
-    if (!virDomainDefNeedsPlacementAdvice(vm->def))
+    if (!virDomainDefNeedsPlacementAdvice(vm->def)) {
+        qemuProcessUpdateNUMALoad(driver, vm);
         return 0;
+    }
 
-    nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(vm->def),
-                                            virDomainDefGetMemoryTotal(vm->def));
+    nodeset = virNumaGetAutoPlacementAdvice(driver->numaPlacement,
+                                            virDomainDefGetVcpus(vm->def),
+                                            virDomainDefGetMemoryTotal(vm->def),
+                                            qemuProcessGetNUMAPageSize(driver, vm->def));
 
     if (!nodeset)
         return -1;
@@ -6115,9 +6168,9 @@ qemuProcessPrepareDomainNUMAPlacement(virQEMUDriverPtr driver,
     if (!(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
         return -1;
 
-    VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
+    VIR_DEBUG("Advisory nodeset: %s", nodeset);
 
-    if (virBitmapParse(nodeset, &numadNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
+    if (virBitmapParse(nodeset, &adviceNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
         return -1;
 
     if (!(caps = virQEMUDriverGetHostNUMACaps(driver)))
@@ -6126,12 +6179,139 @@ qemuProcessPrepareDomainNUMAPlacement(virQEMUDriverPtr driver,
     /* numad may return a nodeset that only contains cpus but cgroups don't play
      * well with that. Set the autoCpuset from all cpus from that nodeset, but
      * assign autoNodeset only with nodes containing memory. */
-    if (!(priv->autoCpuset = virCapabilitiesHostNUMAGetCpus(caps, numadNodeset)))
+    if (!(priv->autoCpuset = virCapabilitiesHostNUMAGetCpus(caps, adviceNodeset)))
         return -1;
 
-    virBitmapIntersect(numadNodeset, hostMemoryNodeset);
+    virBitmapIntersect(adviceNodeset, hostMemoryNodeset);
+
+    priv->autoNodeset = g_steal_pointer(&adviceNodeset);
 
-    priv->autoNodeset = g_steal_pointer(&numadNodeset);
+    qemuProcessUpdateNUMALoad(driver, vm);
+
+    return 0;
+}
+
+
+/* Re-apply CPU and memory placement of all threads of a running @vm */
+static int
+qemuProcessSetupNUMAPlacement(virDomainObjPtr vm)
+{
+    if (qemuProcessSetupEmulator(vm) < 0 ||
+        qemuProcessSetupVcpus(vm) < 0 ||
+        qemuProcessSetupIOThreads(vm) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuProcessRebalanceNUMA:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Moves a running domain with automatic placement to other host NUMA
+ * nodes if they are considerably less loaded than the current ones.
+ * Memory follows through cpuset.mems of the domain cgroups. Domains with
+ * guest NUMA cells or huge pages are left alone as their memory is bound
+ * to the nodes by QEMU itself. The caller must hold a job on @vm.
+ *
+ * Returns 0 on success (even if the domain wasn't moved), -1 on error.
+ */
+int
+qemuProcessRebalanceNUMA(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = NULL;
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autoptr(virBitmap) cpuset = NULL;
+    g_autoptr(virBitmap) allNodeset = NULL;
+    g_autoptr(virBitmap) hostMemoryNodeset = NULL;
+    g_autoptr(virBitmap) oldNodeset = NULL;
+    g_autoptr(virBitmap) oldCpuset = NULL;
+    g_autoptr(virCapsHostNUMA) caps = NULL;
+    g_autofree char *allNodesetStr = NULL;
+    g_autofree char *nodesetStr = NULL;
+    g_autofree char *oldNodesetStr = NULL;
+    virDomainNumatuneMemMode mode;
+    bool bindMemory = false;
+    virErrorPtr orig_err;
+
+    if (!virDomainObjIsActive(vm) ||
+        !priv->autoNodeset ||
+        !driver->numaPlacement ||
+        !virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET) ||
+        vm->def->mem.nhugepages > 0 ||
+        virDomainNumaGetNodeCount(vm->def->numa) > 0)
+        return 0;
+
+    /* Memory bound to static nodes or by a policy other than strict
+     * can't follow the vCPUs */
+    if (virDomainNumatuneGetMode(vm->def->numa, -1, &mode) == 0) {
+        if (mode != VIR_DOMAIN_NUMATUNE_MEM_STRICT ||
+            !virDomainNumatuneHasPlacementAuto(vm->def->numa))
+            return 0;
+        bindMemory = true;
+    }
+
+    if (virNumaPlacementPick(driver->numaPlacement, vm->def->uuid,
+                             virDomainDefGetVcpus(vm->def),
+                             virDomainDefGetMemoryTotal(vm->def), 0,
+                             priv->autoNodeset, &nodeset) < 0)
+        return -1;
+
+    if (!nodeset)
+        return 0;
+
+    if (!(caps = virQEMUDriverGetHostNUMACaps(driver)) ||
+        !(hostMemoryNodeset = virNumaGetHostMemoryNodeset()) ||
+        !(cpuset = virCapabilitiesHostNUMAGetCpus(caps, nodeset)))
+        return -1;
+
+    virBitmapIntersect(nodeset, hostMemoryNodeset);
+
+    if (!(allNodeset = virBitmapNewCopy(priv->autoNodeset)) ||
+        virBitmapUnion(allNodeset, nodeset) < 0 ||
+        !(allNodesetStr = virBitmapFormat(allNodeset)) ||
+        !(nodesetStr = virBitmapFormat(nodeset)) ||
+        !(oldNodesetStr = virBitmapFormat(priv->autoNodeset)))
+        return -1;
+
+    VIR_DEBUG("Moving domain %s to NUMA nodes %s",
+              vm->def->name, nodesetStr);
+
+    /* Threads can only be moved to nodes the domain cgroup allows, so
+     * widen it first and narrow it once all threads were moved. */
+    if (bindMemory &&
+        virCgroupSetCpusetMems(priv->cgroup, allNodesetStr) < 0)
+        return -1;
+
+    oldNodeset = g_steal_pointer(&priv->autoNodeset);
+    oldCpuset = g_steal_pointer(&priv->autoCpuset);
+    priv->autoNodeset = g_steal_pointer(&nodeset);
+    priv->autoCpuset = g_steal_pointer(&cpuset);
+
+    if (qemuProcessSetupNUMAPlacement(vm) < 0 ||
+        (bindMemory &&
+         virCgroupSetCpusetMems(priv->cgroup, nodesetStr) < 0)) {
+        virErrorPreserveLast(&orig_err);
+        virBitmapFree(priv->autoNodeset);
+        virBitmapFree(priv->autoCpuset);
+        priv->autoNodeset = g_steal_pointer(&oldNodeset);
+        priv->autoCpuset = g_steal_pointer(&oldCpuset);
+        ignore_value(qemuProcessSetupNUMAPlacement(vm));
+        if (bindMemory)
+            ignore_value(virCgroupSetCpusetMems(priv->cgroup, oldNodesetStr));
+        virErrorRestore(&orig_err);
+        return -1;
+    }
+
+    cfg = virQEMUDriverGetConfig(driver);
+    if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+        VIR_WARN("Unable to save status of domain %s", vm->def->name);
+
+    qemuProcessUpdateNUMALoad(driver, vm);
 
     return 0;
 }
@@ -7639,6 +7819,9 @@ void qemuProcessStop(virQEMUDriverPtr driver,
         }
     }
 
+    if (driver->numaPlacement)
+        virNumaPlacementRemoveDomain(driver->numaPlacement, vm->def->uuid);
+
     /* clear all private data entries which are no longer needed */
     qemuDomainObjPrivateDataClear(priv);
 
@@ -8092,6 +8275,8 @@ qemuProcessReconnect(void *opaque)
     if (qemuConnectCgroup(obj) < 0)
         goto error;
 
+    qemuProcessUpdateNUMALoad(driver, obj);
+
     if (qemuDomainPerfRestart(obj) < 0)
         goto error;
 
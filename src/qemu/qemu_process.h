@@ -191,6 +191,9 @@ int qemuProcessSetupVcpu(virDomainObjPtr vm,
 int qemuProcessSetupIOThread(virDomainObjPtr vm,
                              virDomainIOThreadIDDefPtr iothread);
 
+int qemuProcessRebalanceNUMA(virQEMUDriverPtr driver,
+                             virDomainObjPtr vm);
+
 int qemuRefreshVirtioChannelState(virQEMUDriverPtr driver,
                                   virDomainObjPtr vm,
                                   qemuDomainAsyncJob asyncJob);
@@ -54,6 +54,7 @@
 #include "viraccessmanager.h"
 #include "virutil.h"
 #include "virgettext.h"
+#include "util/virnetdevbandwidth.h"
 #include "util/virnetdevopenvswitch.h"
 #include "virsystemd.h"
 #include "virhostuptime.h"
@@ -419,6 +420,28 @@ daemonSetupNetDevOpenvswitch(struct daemonConfig *config)
 }
 
 
+/*
+ * Pick how QoS is programmed, keeping the default if unset
+ */
+static int
+daemonSetupNetDevBandwidth(struct daemonConfig *config)
+{
+    int backend;
+
+    if (!config->bandwidth_backend)
+        return 0;
+
+    if ((backend = virNetDevBandwidthBackendTypeFromString(config->bandwidth_backend)) < 0) {
+        virReportError(VIR_ERR_CONF_SYNTAX,
+                       _("unknown bandwidth_backend '%s'"),
+                       config->bandwidth_backend);
+        return -1;
+    }
+
+    return virNetDevBandwidthSetBackend(backend);
+}
+
+
 static int
 daemonSetupAccessManager(struct daemonConfig *config)
 {
@@ -929,6 +952,12 @@ int main(int argc, char **argv) {
 
     daemonSetupNetDevOpenvswitch(config);
 
+    if (daemonSetupNetDevBandwidth(config) < 0) {
+        VIR_ERROR(_("Can't set up bandwidth backend: %s"),
+                  virGetLastErrorMessage());
+        exit(EXIT_FAILURE);
+    }
+
     if (daemonSetupAccessManager(config) < 0) {
         VIR_ERROR(_("Can't initialize access manager"));
         exit(EXIT_FAILURE);
@@ -1011,6 +1040,7 @@ int main(int argc, char **argv) {
                                 config->min_workers,
                                 config->max_workers,
                                 config->prio_workers,
+                                config->worker_queues,
                                 config->max_clients,
                                 config->max_anonymous_clients,
                                 config->keepalive_interval,
@@ -1023,6 +1053,12 @@ int main(int argc, char **argv) {
         goto cleanup;
     }
 
+    if (config->io_threads &&
+        virNetServerSetIOThreads(srv, config->io_threads) < 0) {
+        ret = VIR_DAEMON_ERR_INIT;
+        goto cleanup;
+    }
+
     if (virNetDaemonAddServer(dmn, srv) < 0) {
         ret = VIR_DAEMON_ERR_INIT;
         goto cleanup;
@@ -1078,6 +1114,7 @@ int main(int argc, char **argv) {
                                    config->admin_min_workers,
                                    config->admin_max_workers,
                                    0,
+                                   0,
                                    config->admin_max_clients,
                                    0,
                                    config->admin_keepalive_interval,
@@ -61,6 +61,12 @@ struct daemonClientPrivate {
     size_t nsecretEventCallbacks;
     bool closeRegistered;
 
+    /* Lifecycle events queued for the next batch message, if the
+     * client asked for VIR_DRV_FEATURE_REMOTE_EVENT_BATCH */
+    int eventBatchTimer;
+    remote_domain_event_callback_lifecycle_msg *lifecycleBatch;
+    size_t nlifecycleBatch;
+
 #if WITH_SASL
     virNetSASLSessionPtr sasl;
 #endif
@@ -219,6 +219,7 @@ daemonConfigFree(struct daemonConfig *data)
     VIR_FREE(data->host_uuid_source);
     VIR_FREE(data->log_filters);
     VIR_FREE(data->log_outputs);
+    VIR_FREE(data->bandwidth_backend);
 
     VIR_FREE(data);
 }
@@ -323,6 +324,10 @@ daemonConfigLoadOptions(struct daemonConfig *data,
 
     if (virConfGetValueUInt(conf, "prio_workers", &data->prio_workers) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "worker_queues", &data->worker_queues) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "io_threads", &data->io_threads) < 0)
+        return -1;
 
     if (virConfGetValueUInt(conf, "max_client_requests", &data->max_client_requests) < 0)
         return -1;
@@ -368,6 +373,9 @@ daemonConfigLoadOptions(struct daemonConfig *data,
     if (virConfGetValueUInt(conf, "ovs_timeout", &data->ovs_timeout) < 0)
         return -1;
 
+    if (virConfGetValueString(conf, "bandwidth_backend", &data->bandwidth_backend) < 0)
+        return -1;
+
     return 0;
 }
 
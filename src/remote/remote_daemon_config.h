@@ -72,6 +72,8 @@ struct daemonConfig {
     unsigned int max_anonymous_clients;
 
     unsigned int prio_workers;
+    unsigned int worker_queues;
+    unsigned int io_threads;
 
     unsigned int max_client_requests;
 
@@ -95,6 +97,8 @@ struct daemonConfig {
     unsigned int admin_keepalive_count;
 
     unsigned int ovs_timeout;
+
+    char *bandwidth_backend;
 };
 
 
@@ -143,6 +143,10 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
                               xdrproc_t proc,
                               void *data);
 
+static bool
+remoteEventBatchQueueLifecycle(virNetServerClientPtr client,
+                               remote_domain_event_callback_lifecycle_msg *msg);
+
 static void
 remoteEventCallbackFree(void *opaque)
 {
@@ -343,6 +347,9 @@ remoteRelayDomainEventLifecycle(virConnectPtr conn,
         remote_domain_event_callback_lifecycle_msg msg = { callback->callbackID,
                                                            data };
 
+        if (remoteEventBatchQueueLifecycle(callback->client, &msg))
+            return 0;
+
         remoteDispatchObjectEventSend(callback->client, callback->program,
                                       REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE,
                                       (xdrproc_t)xdr_remote_domain_event_callback_lifecycle_msg,
@@ -1724,10 +1731,23 @@ void remoteClientFree(void *data)
 static void remoteClientCloseFunc(virNetServerClientPtr client)
 {
     struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    size_t i;
 
     daemonRemoveAllClientStreams(priv->streams);
 
     remoteClientFreePrivateCallbacks(priv);
+
+    virMutexLock(&priv->lock);
+    if (priv->eventBatchTimer >= 0) {
+        virEventRemoveTimeout(priv->eventBatchTimer);
+        priv->eventBatchTimer = -1;
+    }
+    for (i = 0; i < priv->nlifecycleBatch; i++)
+        xdr_free((xdrproc_t)xdr_remote_domain_event_callback_lifecycle_msg,
+                 (char *)&priv->lifecycleBatch[i]);
+    VIR_FREE(priv->lifecycleBatch);
+    priv->nlifecycleBatch = 0;
+    virMutexUnlock(&priv->lock);
 }
 
 
@@ -1917,6 +1937,8 @@ void *remoteClientNew(virNetServerClientPtr client,
         return NULL;
     }
 
+    priv->eventBatchTimer = -1;
+
     virNetServerClientSetCloseHook(client, remoteClientCloseFunc);
     return priv;
 }
@@ -4336,6 +4358,126 @@ remoteDispatchConnectDomainEventDeregister(virNetServerPtr server G_GNUC_UNUSED,
     return rv;
 }
 
+/*
+ * Send all lifecycle events queued for @client in a single message.
+ */
+static void
+remoteEventBatchFlush(virNetServerClientPtr client)
+{
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    remote_domain_event_callback_lifecycle_batch_msg data;
+
+    memset(&data, 0, sizeof(data));
+
+    virMutexLock(&priv->lock);
+    if (priv->nlifecycleBatch == 0) {
+        virMutexUnlock(&priv->lock);
+        return;
+    }
+    data.events.events_val = g_steal_pointer(&priv->lifecycleBatch);
+    data.events.events_len = priv->nlifecycleBatch;
+    priv->nlifecycleBatch = 0;
+    if (priv->eventBatchTimer >= 0)
+        virEventUpdateTimeout(priv->eventBatchTimer, -1);
+    virMutexUnlock(&priv->lock);
+
+    VIR_DEBUG("Relaying batch of %u lifecycle events", data.events.events_len);
+
+    remoteDispatchObjectEventSend(client, remoteProgram,
+                                  REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE_BATCH,
+                                  (xdrproc_t)xdr_remote_domain_event_callback_lifecycle_batch_msg,
+                                  &data);
+}
+
+
+static void
+remoteEventBatchTimer(int timer G_GNUC_UNUSED,
+                      void *opaque)
+{
+    virNetServerClientPtr client = opaque;
+
+    remoteEventBatchFlush(client);
+}
+
+
+/*
+ * Start collecting lifecycle events of @client into batches. Events
+ * relayed while the event loop is busy dispatching are sent together
+ * once it gets to the batch timer.
+ */
+static int
+remoteDispatchConnectEnableEventBatch(virNetServerPtr server G_GNUC_UNUSED,
+                                      virNetServerClientPtr client,
+                                      virNetMessagePtr msg G_GNUC_UNUSED,
+                                      virNetMessageErrorPtr rerr)
+{
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    int rv = -1;
+
+    virMutexLock(&priv->lock);
+    if (priv->eventBatchTimer < 0) {
+        if ((priv->eventBatchTimer = virEventAddTimeout(-1, remoteEventBatchTimer,
+                                                        virObjectRef(client),
+                                                        virObjectFreeCallback)) < 0) {
+            virObjectUnref(client);
+            goto cleanup;
+        }
+    }
+    rv = 0;
+
+ cleanup:
+    virMutexUnlock(&priv->lock);
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    return rv;
+}
+
+
+/*
+ * Queue @msg for the next batch, taking ownership of its contents.
+ * Returns false if @client doesn't use batches and @msg must be sent
+ * on its own.
+ */
+static bool
+remoteEventBatchQueueLifecycle(virNetServerClientPtr client,
+                               remote_domain_event_callback_lifecycle_msg *msg)
+{
+    struct daemonClientPrivate *priv = virNetServerClientGetPrivateData(client);
+    bool full;
+
+    virMutexLock(&priv->lock);
+    if (priv->eventBatchTimer < 0) {
+        virMutexUnlock(&priv->lock);
+        return false;
+    }
+    full = priv->nlifecycleBatch >= REMOTE_DOMAIN_EVENT_BATCH_MAX;
+    virMutexUnlock(&priv->lock);
+
+    if (full)
+        remoteEventBatchFlush(client);
+
+    virMutexLock(&priv->lock);
+    /* the client might have been closed meanwhile */
+    if (priv->eventBatchTimer < 0) {
+        virMutexUnlock(&priv->lock);
+        return false;
+    }
+    if (VIR_APPEND_ELEMENT(priv->lifecycleBatch,
+                           priv->nlifecycleBatch, *msg) < 0) {
+        /* @msg is left untouched, the caller sends it on its own after
+         * flushing the events queued so far */
+        virResetLastError();
+        virMutexUnlock(&priv->lock);
+        return false;
+    }
+    if (priv->nlifecycleBatch == 1)
+        virEventUpdateTimeout(priv->eventBatchTimer, 0);
+    virMutexUnlock(&priv->lock);
+
+    return true;
+}
+
+
 static void
 remoteDispatchObjectEventSend(virNetServerClientPtr client,
                               virNetServerProgramPtr program,
@@ -4345,6 +4487,11 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
 {
     virNetMessagePtr msg;
 
+    /* Events must reach the client in the order they were relayed */
+    if (program != remoteProgram ||
+        procnr != REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE_BATCH)
+        remoteEventBatchFlush(client);
+
     if (!(msg = virNetMessageNew(false)))
         goto cleanup;
 
@@ -4995,6 +5142,7 @@ static int remoteDispatchConnectSupportsFeature(virNetServerPtr server G_GNUC_UN
     case VIR_DRV_FEATURE_FD_PASSING:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_EVENT_BATCH:
         supported = 1;
         break;
     case VIR_DRV_FEATURE_MIGRATION_V1:
@@ -932,12 +932,12 @@ daemonStreamHandleRead(virNetServerClientPtr client,
         msg->cb = daemonStreamMessageFinished;
         msg->opaque = stream;
         stream->refs++;
-        if (virNetServerProgramSendStreamData(stream->prog,
-                                              client,
-                                              msg,
-                                              stream->procedure,
-                                              stream->serial,
-                                              buffer, rv) < 0)
+        if (virNetServerProgramSendStreamDataSteal(stream->prog,
+                                                   client,
+                                                   msg,
+                                                   stream->procedure,
+                                                   stream->serial,
+                                                   &buffer, rv) < 0)
             goto cleanup;
         msg = NULL;
     }
@@ -166,6 +166,10 @@ static int callFull(virConnectPtr conn, struct private_data *priv,
                     int proc_nr,
                     xdrproc_t args_filter, char *args,
                     xdrproc_t ret_filter, char *ret);
+static int callMulti(virConnectPtr conn, struct private_data *priv,
+                     unsigned int flags,
+                     virNetClientProgramCallDataPtr calls,
+                     size_t ncalls);
 static int remoteAuthenticate(virConnectPtr conn, struct private_data *priv,
                               virConnectAuthPtr auth, const char *authtype);
 #if WITH_SASL
@@ -253,6 +257,10 @@ static void
 remoteDomainBuildEventCallbackLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSED,
                                         virNetClientPtr client G_GNUC_UNUSED,
                                         void *evdata, void *opaque);
+static void
+remoteDomainBuildEventCallbackLifecycleBatch(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                             virNetClientPtr client G_GNUC_UNUSED,
+                                             void *evdata, void *opaque);
 
 static void
 remoteDomainBuildEventReboot(virNetClientProgramPtr prog G_GNUC_UNUSED,
@@ -679,6 +687,10 @@ static virNetClientProgramEvent remoteEvents[] = {
       remoteDomainBuildEventBlockThreshold,
       sizeof(remote_domain_event_block_threshold_msg),
       (xdrproc_t)xdr_remote_domain_event_block_threshold_msg },
+    { REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE_BATCH,
+      remoteDomainBuildEventCallbackLifecycleBatch,
+      sizeof(remote_domain_event_callback_lifecycle_batch_msg),
+      (xdrproc_t)xdr_remote_domain_event_callback_lifecycle_batch_msg },
 };
 
 static void
@@ -737,6 +749,41 @@ remoteConnectSupportsFeatureUnlocked(virConnectPtr conn,
     return rc != -1 && ret.supported;
 }
 
+/*
+ * Ask for all @nfeatures @features at once instead of one round trip
+ * per feature and store the answers in @supported
+ */
+static void
+remoteConnectSupportsFeaturesUnlocked(virConnectPtr conn,
+                                      struct private_data *priv,
+                                      const int *features,
+                                      bool *supported,
+                                      size_t nfeatures)
+{
+    g_autofree remote_connect_supports_feature_args *args = NULL;
+    g_autofree remote_connect_supports_feature_ret *ret = NULL;
+    g_autofree virNetClientProgramCallData *calls = NULL;
+    size_t i;
+
+    args = g_new0(remote_connect_supports_feature_args, nfeatures);
+    ret = g_new0(remote_connect_supports_feature_ret, nfeatures);
+    calls = g_new0(virNetClientProgramCallData, nfeatures);
+
+    for (i = 0; i < nfeatures; i++) {
+        args[i].feature = features[i];
+        calls[i].proc = REMOTE_PROC_CONNECT_SUPPORTS_FEATURE;
+        calls[i].args_filter = (xdrproc_t)xdr_remote_connect_supports_feature_args;
+        calls[i].args = &args[i];
+        calls[i].ret_filter = (xdrproc_t)xdr_remote_connect_supports_feature_ret;
+        calls[i].ret = &ret[i];
+    }
+
+    ignore_value(callMulti(conn, priv, 0, calls, nfeatures));
+
+    for (i = 0; i < nfeatures; i++)
+        supported[i] = calls[i].rv == 0 && ret[i].supported;
+}
+
 /* helper macro to ease extraction of arguments from the URI */
 #define EXTRACT_URI_ARG_STR(ARG_NAME, ARG_VAR) \
     if (STRCASEEQ(var->name, ARG_NAME)) { \
@@ -1352,18 +1399,41 @@ doRemoteOpen(virConnectPtr conn,
     if (!(priv->eventState = virObjectEventStateNew()))
         goto failed;
 
-    priv->serverEventFilter = remoteConnectSupportsFeatureUnlocked(conn,
-                                priv, VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK);
-    if (!priv->serverEventFilter) {
-        VIR_INFO("Avoiding server event filtering since it is not "
-                 "supported by the server");
-    }
+    /* Batched lifecycle events only work with callback IDs. Servers
+     * which know about batches support callback IDs too, so the feature
+     * can be queried together with the rest. */
+    {
+        const int features[] = {
+            VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK,
+            VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK,
+            VIR_DRV_FEATURE_REMOTE_EVENT_BATCH,
+        };
+        bool supported[G_N_ELEMENTS(features)];
+
+        remoteConnectSupportsFeaturesUnlocked(conn, priv, features, supported,
+                                              G_N_ELEMENTS(features));
+        priv->serverEventFilter = supported[0];
+        priv->serverCloseCallback = supported[1];
+
+        if (!priv->serverEventFilter) {
+            VIR_INFO("Avoiding server event filtering since it is not "
+                     "supported by the server");
+        }
+        if (!priv->serverCloseCallback) {
+            VIR_INFO("Close callback registering isn't supported "
+                     "by the remote side.");
+        }
 
-    priv->serverCloseCallback = remoteConnectSupportsFeatureUnlocked(conn,
-                                    priv, VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK);
-    if (!priv->serverCloseCallback) {
-        VIR_INFO("Close callback registering isn't supported "
-                 "by the remote side.");
+        if (!priv->serverEventFilter || !supported[2]) {
+            VIR_INFO("Batched events aren't supported by the remote side.");
+        } else if (call(conn, priv, 0, REMOTE_PROC_CONNECT_ENABLE_EVENT_BATCH,
+                        (xdrproc_t) xdr_void, (char *) NULL,
+                        (xdrproc_t) xdr_void, (char *) NULL) == -1) {
+            /* The server keeps sending events one by one */
+            VIR_WARN("Unable to enable batched events: %s",
+                     virGetLastErrorMessage());
+            virResetLastError();
+        }
     }
 
     return VIR_DRV_OPEN_SUCCESS;
@@ -4606,6 +4676,21 @@ remoteDomainBuildEventCallbackLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSE
     remote_domain_event_callback_lifecycle_msg *msg = evdata;
     remoteDomainBuildEventLifecycleHelper(conn, &msg->msg, msg->callbackID);
 }
+static void
+remoteDomainBuildEventCallbackLifecycleBatch(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                             virNetClientPtr client G_GNUC_UNUSED,
+                                             void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_lifecycle_batch_msg *msg = evdata;
+    size_t i;
+
+    for (i = 0; i < msg->events.events_len; i++) {
+        remote_domain_event_callback_lifecycle_msg *ev = &msg->events.events_val[i];
+
+        remoteDomainBuildEventLifecycleHelper(conn, &ev->msg, ev->callbackID);
+    }
+}
 
 
 static void
@@ -6781,6 +6866,46 @@ call(virConnectPtr conn,
                     ret_filter, ret);
 }
 
+/*
+ * Send a set of independent method calls to the server without
+ * waiting for the reply to one before sending the next one. The
+ * result of each call is in its rv member.
+ */
+static int
+callMulti(virConnectPtr conn G_GNUC_UNUSED,
+          struct private_data *priv,
+          unsigned int flags,
+          virNetClientProgramCallDataPtr calls,
+          size_t ncalls)
+{
+    int rv;
+    virNetClientProgramPtr prog;
+    virNetClientPtr client = priv->client;
+    size_t i;
+
+    for (i = 0; i < ncalls; i++)
+        calls[i].serial = priv->counter++;
+    priv->localUses++;
+
+    if (flags & REMOTE_CALL_QEMU)
+        prog = priv->qemuProgram;
+    else if (flags & REMOTE_CALL_LXC)
+        prog = priv->lxcProgram;
+    else
+        prog = priv->remoteProgram;
+
+    /* Unlock, so that if we get any async events/stream data
+     * while processing the RPCs, we don't deadlock when our
+     * callbacks for those are invoked
+     */
+    remoteDriverUnlock(priv);
+    rv = virNetClientProgramCallMulti(prog, client, calls, ncalls);
+    remoteDriverLock(priv);
+    priv->localUses--;
+
+    return rv;
+}
+
 
 static int
 remoteDomainGetInterfaceParameters(virDomainPtr domain,
@@ -25,6 +25,7 @@
 #include "virfile.h"
 #include "virlog.h"
 #include "virerror.h"
+#include "vireventglib.h"
 #include "virnetsocket.h"
 #include "virkeepaliveprotocol.h"
 #include "virkeepalive.h"
@@ -43,6 +44,7 @@ struct _virKeepAlive {
     time_t lastPacketReceived;
     time_t intervalStart;
     int timer;
+    GMainContext *context; /* NULL for the default event loop */
 
     virKeepAliveSendFunc sendCB;
     virKeepAliveDeadFunc deadCB;
@@ -221,10 +223,28 @@ virKeepAliveDispose(void *obj)
     PROBE(RPC_KEEPALIVE_DISPOSE,
           "ka=%p", ka);
 
+    if (ka->context)
+        g_main_context_unref(ka->context);
     ka->freeCB(ka->client);
 }
 
 
+/*
+ * Run the keepalive timer from the thread iterating @context rather
+ * than the default event loop. Must be called before virKeepAliveStart.
+ */
+void
+virKeepAliveSetEventContext(virKeepAlivePtr ka,
+                            GMainContext *context)
+{
+    virObjectLock(ka);
+    if (ka->context)
+        g_main_context_unref(ka->context);
+    ka->context = context ? g_main_context_ref(context) : NULL;
+    virObjectUnlock(ka);
+}
+
+
 int
 virKeepAliveStart(virKeepAlivePtr ka,
                   int interval,
@@ -277,8 +297,13 @@ virKeepAliveStart(virKeepAlivePtr ka,
     else
         timeout = ka->interval - delay;
     ka->intervalStart = now - (ka->interval - timeout);
-    ka->timer = virEventAddTimeout(timeout * 1000, virKeepAliveTimer,
-                                   ka, virObjectFreeCallback);
+    if (ka->context)
+        ka->timer = virEventGLibTimeoutAddContext(ka->context, timeout * 1000,
+                                                  virKeepAliveTimer, ka,
+                                                  virObjectFreeCallback);
+    else
+        ka->timer = virEventAddTimeout(timeout * 1000, virKeepAliveTimer,
+                                       ka, virObjectFreeCallback);
     if (ka->timer < 0)
         goto cleanup;
 
@@ -40,6 +40,9 @@ virKeepAlivePtr virKeepAliveNew(int interval,
                                 ATTRIBUTE_NONNULL(3) ATTRIBUTE_NONNULL(4)
                                 ATTRIBUTE_NONNULL(5) ATTRIBUTE_NONNULL(6);
 
+void virKeepAliveSetEventContext(virKeepAlivePtr ka,
+                                 GMainContext *context);
+
 int virKeepAliveStart(virKeepAlivePtr ka,
                       int interval,
                       unsigned int count);
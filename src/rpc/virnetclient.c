@@ -57,6 +57,7 @@ struct _virNetClientCall {
     bool expectReply;
     bool nonBlock;
     bool haveThread;
+    bool pipelined; /* the thread waits for an earlier call first */
 
     virCond cond;
 
@@ -125,6 +126,8 @@ VIR_ONCE_GLOBAL_INIT(virNetClient);
 
 static void virNetClientIOEventLoopPassTheBuck(virNetClientPtr client,
                                                virNetClientCallPtr thiscall);
+static int virNetClientIOWait(virNetClientPtr client,
+                              virNetClientCallPtr thiscall);
 static int virNetClientQueueNonBlocking(virNetClientPtr client,
                                         virNetMessagePtr msg);
 static void virNetClientCloseInternal(virNetClientPtr client,
@@ -1103,13 +1106,8 @@ virNetClientCallDispatchReply(virNetClientPtr client)
         return -1;
     }
 
-    if (VIR_REALLOC_N(thecall->msg->buffer, client->msg.bufferLength) < 0)
-        return -1;
-
-    memcpy(thecall->msg->buffer, client->msg.buffer, client->msg.bufferLength);
+    virNetMessageMoveBuffer(thecall->msg, &client->msg);
     memcpy(&thecall->msg->header, &client->msg.header, sizeof(client->msg.header));
-    thecall->msg->bufferLength = client->msg.bufferLength;
-    thecall->msg->bufferOffset = client->msg.bufferOffset;
 
     thecall->msg->nfds = client->msg.nfds;
     thecall->msg->fds = client->msg.fds;
@@ -1301,19 +1299,20 @@ static ssize_t
 virNetClientIOWriteMessage(virNetClientPtr client,
                            virNetClientCallPtr thecall)
 {
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    size_t niov;
+    size_t remaining = 0;
     ssize_t ret = 0;
 
-    if (thecall->msg->bufferOffset < thecall->msg->bufferLength) {
-        ret = virNetSocketWrite(client->sock,
-                                thecall->msg->buffer + thecall->msg->bufferOffset,
-                                thecall->msg->bufferLength - thecall->msg->bufferOffset);
+    if ((niov = virNetMessageGetIOV(thecall->msg, iov)) > 0) {
+        ret = virNetSocketWritev(client->sock, iov, niov);
         if (ret <= 0)
             return ret;
 
-        thecall->msg->bufferOffset += ret;
+        remaining = virNetMessageAdvance(thecall->msg, ret);
     }
 
-    if (thecall->msg->bufferOffset == thecall->msg->bufferLength) {
+    if (remaining == 0) {
         size_t i;
         for (i = thecall->msg->donefds; i < thecall->msg->nfds; i++) {
             int rv;
@@ -1546,6 +1545,10 @@ virNetClientIOEventLoopRemoveAll(virNetClientCallPtr call,
     if (call == thiscall)
         return false;
 
+    /* Pipelined calls are removed by their thread */
+    if (call->haveThread)
+        return false;
+
     VIR_DEBUG("Removing call %p", call);
     virCondDestroy(&call->cond);
     VIR_FREE(call->msg);
@@ -1563,7 +1566,7 @@ virNetClientIOEventLoopPassTheBuck(virNetClientPtr client,
     /* See if someone else is still waiting
      * and if so, then pass the buck ! */
     while (tmp) {
-        if (tmp != thiscall && tmp->haveThread) {
+        if (tmp != thiscall && tmp->haveThread && !tmp->pipelined) {
             VIR_DEBUG("Passing the buck to %p", tmp);
             virCondSignal(&tmp->cond);
             return;
@@ -1870,8 +1873,6 @@ static void virNetClientIOUpdateCallback(virNetClientPtr client,
 static int virNetClientIO(virNetClientPtr client,
                           virNetClientCallPtr thiscall)
 {
-    int rv = -1;
-
     VIR_DEBUG("Outgoing message prog=%u version=%u serial=%u proc=%d type=%d length=%zu dispatch=%p",
               thiscall->msg->header.prog,
               thiscall->msg->header.vers,
@@ -1884,6 +1885,19 @@ static int virNetClientIO(virNetClientPtr client,
     /* Stick ourselves on the end of the wait queue */
     virNetClientCallQueue(&client->waitDispatch, thiscall);
 
+    return virNetClientIOWait(client, thiscall);
+}
+
+
+/*
+ * Wait for @thiscall, which is already queued, to complete, dispatching
+ * all calls if this thread gets the buck. See virNetClientIO.
+ */
+static int virNetClientIOWait(virNetClientPtr client,
+                              virNetClientCallPtr thiscall)
+{
+    int rv = -1;
+
     /* Check to see if another thread is dispatching */
     if (client->haveTheBuck) {
         /* Force other thread to wakeup from poll */
@@ -2156,6 +2170,90 @@ int virNetClientSendWithReply(virNetClientPtr client,
 }
 
 
+/*
+ * @msgs: messages allocated on heap or stack
+ * @nmsgs: number of messages in @msgs
+ *
+ * Send several messages and wait for all their replies. All messages
+ * are queued before waiting for the first reply, so they are sent
+ * back to back instead of one per round trip. The server may process
+ * them in any order, so they must not depend on each other.
+ *
+ * The caller is responsible for free'ing @msgs
+ *
+ * Returns 0 if all replies arrived, -1 on failure
+ */
+int virNetClientSendWithReplyMulti(virNetClientPtr client,
+                                   virNetMessagePtr *msgs,
+                                   size_t nmsgs)
+{
+    g_autofree virNetClientCallPtr *calls = NULL;
+    size_t ncalls = 0;
+    int ret = -1;
+    size_t i;
+
+    virObjectLock(client);
+
+    if (!client->sock || client->wantClose) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("client socket is closed"));
+        goto cleanup;
+    }
+
+    calls = g_new0(virNetClientCallPtr, nmsgs);
+    for (ncalls = 0; ncalls < nmsgs; ncalls++) {
+        virNetMessagePtr msg = msgs[ncalls];
+
+        PROBE(RPC_CLIENT_MSG_TX_QUEUE,
+              "client=%p len=%zu prog=%u vers=%u proc=%u type=%u status=%u serial=%u",
+              client, msg->bufferLength,
+              msg->header.prog, msg->header.vers, msg->header.proc,
+              msg->header.type, msg->header.status, msg->header.serial);
+
+        if (!(calls[ncalls] = virNetClientCallNew(msg, true, false)))
+            goto cleanup;
+
+        calls[ncalls]->haveThread = true;
+        calls[ncalls]->pipelined = true;
+    }
+
+    for (i = 0; i < ncalls; i++) {
+        VIR_DEBUG("Outgoing message prog=%u version=%u serial=%u proc=%d type=%d length=%zu",
+                  msgs[i]->header.prog, msgs[i]->header.vers,
+                  msgs[i]->header.serial, msgs[i]->header.proc,
+                  msgs[i]->header.type, msgs[i]->bufferLength);
+        virNetClientCallQueue(&client->waitDispatch, calls[i]);
+    }
+
+    /* Replies to later calls may well arrive while we wait for an earlier
+     * one, those calls are then complete and off the queue already. */
+    ret = 0;
+    for (i = 0; i < ncalls; i++) {
+        calls[i]->pipelined = false;
+
+        if (calls[i]->mode == VIR_NET_CLIENT_MODE_COMPLETE)
+            continue;
+
+        if (ret < 0 || !client->sock || client->wantClose) {
+            virNetClientCallRemove(&client->waitDispatch, calls[i]);
+            ret = -1;
+            continue;
+        }
+
+        if (virNetClientIOWait(client, calls[i]) < 0)
+            ret = -1;
+    }
+
+ cleanup:
+    for (i = 0; i < ncalls; i++) {
+        virCondDestroy(&calls[i]->cond);
+        VIR_FREE(calls[i]);
+    }
+    virObjectUnlock(client);
+    return ret;
+}
+
+
 /*
  * @msg: a message allocated on the heap.
  *
@@ -106,6 +106,10 @@ void virNetClientRemoveStream(virNetClientPtr client,
 int virNetClientSendWithReply(virNetClientPtr client,
                               virNetMessagePtr msg);
 
+int virNetClientSendWithReplyMulti(virNetClientPtr client,
+                                   virNetMessagePtr *msgs,
+                                   size_t nmsgs);
+
 int virNetClientSendNonBlock(virNetClientPtr client,
                              virNetMessagePtr msg);
 
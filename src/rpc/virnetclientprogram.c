@@ -263,27 +263,19 @@ int virNetClientProgramDispatch(virNetClientProgramPtr prog,
 }
 
 
-int virNetClientProgramCall(virNetClientProgramPtr prog,
-                            virNetClientPtr client,
-                            unsigned serial,
-                            int proc,
-                            size_t noutfds,
-                            int *outfds,
-                            size_t *ninfds,
-                            int **infds,
-                            xdrproc_t args_filter, void *args,
-                            xdrproc_t ret_filter, void *ret)
+static virNetMessagePtr
+virNetClientProgramCallEncode(virNetClientProgramPtr prog,
+                              unsigned serial,
+                              int proc,
+                              size_t noutfds,
+                              int *outfds,
+                              xdrproc_t args_filter, void *args)
 {
     virNetMessagePtr msg;
     size_t i;
 
-    if (infds)
-        *infds = NULL;
-    if (ninfds)
-        *ninfds = 0;
-
     if (!(msg = virNetMessageNew(false)))
-        return -1;
+        return NULL;
 
     msg->header.prog = prog->program;
     msg->header.vers = prog->version;
@@ -321,8 +313,24 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     if (virNetMessageEncodePayload(msg, args_filter, args) < 0)
         goto error;
 
-    if (virNetClientSendWithReply(client, msg) < 0)
-        goto error;
+    return msg;
+
+ error:
+    virNetMessageFree(msg);
+    return NULL;
+}
+
+
+static int
+virNetClientProgramCallDecode(virNetClientProgramPtr prog,
+                              virNetMessagePtr msg,
+                              unsigned serial,
+                              int proc,
+                              size_t *ninfds,
+                              int **infds,
+                              xdrproc_t ret_filter, void *ret)
+{
+    size_t i;
 
     /* None of these 3 should ever happen here, because
      * virNetClientSend should have validated the reply,
@@ -332,19 +340,19 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
         msg->header.type != VIR_NET_REPLY_WITH_FDS) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message type %d"), msg->header.type);
-        goto error;
+        return -1;
     }
     if (msg->header.proc != proc) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message proc %d != %d"),
                        msg->header.proc, proc);
-        goto error;
+        return -1;
     }
     if (msg->header.serial != serial) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unexpected message serial %d != %d"),
                        msg->header.serial, serial);
-        goto error;
+        return -1;
     }
 
     switch (msg->header.status) {
@@ -352,7 +360,7 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
         if (infds && ninfds) {
             *ninfds = msg->nfds;
             if (VIR_ALLOC_N(*infds, *ninfds) < 0)
-                goto error;
+                return -1;
             for (i = 0; i < *ninfds; i++)
                 (*infds)[i] = -1;
             for (i = 0; i < *ninfds; i++) {
@@ -360,32 +368,68 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
                     virReportSystemError(errno,
                                          _("Cannot duplicate FD %d"),
                                          msg->fds[i]);
-                    goto error;
+                    return -1;
                 }
                 if (virSetInherit((*infds)[i], false) < 0) {
                     virReportSystemError(errno,
                                          _("Cannot set close-on-exec %d"),
                                          (*infds)[i]);
-                    goto error;
+                    return -1;
                 }
             }
 
         }
         if (virNetMessageDecodePayload(msg, ret_filter, ret) < 0)
-            goto error;
+            return -1;
         break;
 
     case VIR_NET_ERROR:
         virNetClientProgramDispatchError(prog, msg);
-        goto error;
+        return -1;
 
     case VIR_NET_CONTINUE:
     default:
         virReportError(VIR_ERR_RPC,
                        _("Unexpected message status %d"), msg->header.status);
-        goto error;
+        return -1;
     }
 
+    return 0;
+}
+
+
+int virNetClientProgramCall(virNetClientProgramPtr prog,
+                            virNetClientPtr client,
+                            unsigned serial,
+                            int proc,
+                            size_t noutfds,
+                            int *outfds,
+                            size_t *ninfds,
+                            int **infds,
+                            xdrproc_t args_filter, void *args,
+                            xdrproc_t ret_filter, void *ret)
+{
+    virNetMessagePtr msg;
+    size_t i;
+
+    if (infds)
+        *infds = NULL;
+    if (ninfds)
+        *ninfds = 0;
+
+    if (!(msg = virNetClientProgramCallEncode(prog, serial, proc,
+                                              noutfds, outfds,
+                                              args_filter, args)))
+        return -1;
+
+    if (virNetClientSendWithReply(client, msg) < 0)
+        goto error;
+
+    if (virNetClientProgramCallDecode(prog, msg, serial, proc,
+                                      ninfds, infds,
+                                      ret_filter, ret) < 0)
+        goto error;
+
     virNetMessageFree(msg);
 
     return 0;
@@ -398,3 +442,58 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     }
     return -1;
 }
+
+
+/*
+ * Make all @ncalls calls described by @calls without waiting for the
+ * reply to one call before sending the next one. The server may run
+ * the calls in any order, so they must not depend on each other.
+ *
+ * The result of each call is stored in its @rv, the error of the last
+ * one which failed is left set.
+ *
+ * Returns 0 if replies to all calls arrived, -1 otherwise
+ */
+int virNetClientProgramCallMulti(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 virNetClientProgramCallDataPtr calls,
+                                 size_t ncalls)
+{
+    virNetMessagePtr *msgs = NULL;
+    size_t nmsgs = 0;
+    int ret = -1;
+    size_t i;
+
+    for (i = 0; i < ncalls; i++)
+        calls[i].rv = -1;
+
+    msgs = g_new0(virNetMessagePtr, ncalls);
+    for (nmsgs = 0; nmsgs < ncalls; nmsgs++) {
+        virNetClientProgramCallDataPtr call = &calls[nmsgs];
+
+        if (!(msgs[nmsgs] = virNetClientProgramCallEncode(prog, call->serial,
+                                                          call->proc, 0, NULL,
+                                                          call->args_filter,
+                                                          call->args)))
+            goto cleanup;
+    }
+
+    if (virNetClientSendWithReplyMulti(client, msgs, nmsgs) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ncalls; i++) {
+        virNetClientProgramCallDataPtr call = &calls[i];
+
+        call->rv = virNetClientProgramCallDecode(prog, msgs[i], call->serial,
+                                                 call->proc, NULL, NULL,
+                                                 call->ret_filter, call->ret);
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nmsgs; i++)
+        virNetMessageFree(msgs[i]);
+    VIR_FREE(msgs);
+    return ret;
+}
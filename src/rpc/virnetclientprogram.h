@@ -35,6 +35,9 @@ typedef virNetClientProgram *virNetClientProgramPtr;
 typedef struct _virNetClientProgramEvent virNetClientProgramEvent;
 typedef virNetClientProgramEvent *virNetClientProgramEventPtr;
 
+typedef struct _virNetClientProgramCallData virNetClientProgramCallData;
+typedef virNetClientProgramCallData *virNetClientProgramCallDataPtr;
+
 typedef struct _virNetClientProgramErrorHandler virNetClientProgramErrorHander;
 typedef virNetClientProgramErrorHander *virNetClientProgramErrorHanderPtr;
 
@@ -51,6 +54,17 @@ struct _virNetClientProgramEvent {
     xdrproc_t msg_filter;
 };
 
+struct _virNetClientProgramCallData {
+    unsigned serial;
+    int proc;
+    xdrproc_t args_filter;
+    void *args;
+    xdrproc_t ret_filter;
+    void *ret;
+
+    int rv; /* 0 on success, -1 on error */
+};
+
 virNetClientProgramPtr virNetClientProgramNew(unsigned program,
                                               unsigned version,
                                               virNetClientProgramEventPtr events,
@@ -77,3 +91,8 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
                             int **infds,
                             xdrproc_t args_filter, void *args,
                             xdrproc_t ret_filter, void *ret);
+
+int virNetClientProgramCallMulti(virNetClientProgramPtr prog,
+                                 virNetClientPtr client,
+                                 virNetClientProgramCallDataPtr calls,
+                                 size_t ncalls);
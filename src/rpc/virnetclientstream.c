@@ -343,11 +343,7 @@ int virNetClientStreamQueuePacket(virNetClientStreamPtr st,
     memcpy(&tmp_msg->header, &msg->header, sizeof(msg->header));
 
     /* Steal message buffer */
-    tmp_msg->buffer = msg->buffer;
-    tmp_msg->bufferLength = msg->bufferLength;
-    tmp_msg->bufferOffset = msg->bufferOffset;
-    msg->buffer = NULL;
-    msg->bufferLength = msg->bufferOffset = 0;
+    virNetMessageMoveBuffer(tmp_msg, msg);
 
     virObjectLock(st);
 
@@ -392,7 +388,8 @@ int virNetClientStreamSendPacket(virNetClientStreamPtr st,
      * need a synchronous confirmation
      */
     if (status == VIR_NET_CONTINUE) {
-        if (virNetMessageEncodePayloadRaw(msg, data, nbytes) < 0)
+        /* Sending is synchronous, so @data outlives @msg */
+        if (virNetMessageEncodePayloadRef(msg, data, nbytes) < 0)
             goto error;
     } else {
         if (virNetMessageEncodePayloadRaw(msg, NULL, 0) < 0)
@@ -29,11 +29,110 @@
 #include "virfile.h"
 #include "virutil.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
 VIR_LOG_INIT("rpc.netmessage");
 
+/* Nearly every message fits into the initial buffer size. Rather than
+ * allocating and freeing such buffers for each request and reply keep
+ * a few of them around for reuse. */
+#define VIR_NET_MESSAGE_POOL_BUFFER \
+    (VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX)
+#define VIR_NET_MESSAGE_POOL_MAX 64
+
+static virMutex virNetMessagePoolLock = VIR_MUTEX_INITIALIZER;
+static char *virNetMessagePool[VIR_NET_MESSAGE_POOL_MAX];
+static size_t virNetMessagePoolCount;
+
+
+static char *
+virNetMessagePoolGet(void)
+{
+    char *buf = NULL;
+
+    virMutexLock(&virNetMessagePoolLock);
+    if (virNetMessagePoolCount > 0)
+        buf = virNetMessagePool[--virNetMessagePoolCount];
+    virMutexUnlock(&virNetMessagePoolLock);
+
+    if (!buf)
+        buf = g_new(char, VIR_NET_MESSAGE_POOL_BUFFER);
+
+    return buf;
+}
+
+
+static void
+virNetMessagePoolPut(char *buf)
+{
+    virMutexLock(&virNetMessagePoolLock);
+    if (virNetMessagePoolCount < VIR_NET_MESSAGE_POOL_MAX) {
+        virNetMessagePool[virNetMessagePoolCount++] = buf;
+        buf = NULL;
+    }
+    virMutexUnlock(&virNetMessagePoolLock);
+
+    g_free(buf);
+}
+
+
+static void
+virNetMessageFreeBuffer(virNetMessagePtr msg)
+{
+    if (msg->buffer && msg->bufferAlloc == VIR_NET_MESSAGE_POOL_BUFFER)
+        virNetMessagePoolPut(msg->buffer);
+    else
+        g_free(msg->buffer);
+
+    msg->buffer = NULL;
+    msg->bufferAlloc = 0;
+}
+
+
+/*
+ * Make room for @len bytes in the buffer of @msg, keeping the first
+ * bufferLength bytes of it. The buffer is taken from the pool if it
+ * fits into a pooled one.
+ */
+static void
+virNetMessageReserveBuffer(virNetMessagePtr msg,
+                           size_t len)
+{
+    char *buf;
+
+    if (msg->buffer && msg->bufferAlloc >= len)
+        return;
+
+    if (len > VIR_NET_MESSAGE_POOL_BUFFER) {
+        msg->buffer = g_renew(char, msg->buffer, len);
+        msg->bufferAlloc = len;
+        return;
+    }
+
+    buf = virNetMessagePoolGet();
+    if (msg->buffer)
+        memcpy(buf, msg->buffer, MIN(msg->bufferLength, len));
+
+    virNetMessageFreeBuffer(msg);
+    msg->buffer = buf;
+    msg->bufferAlloc = VIR_NET_MESSAGE_POOL_BUFFER;
+}
+
+
+static void
+virNetMessageDropPayload(virNetMessagePtr msg)
+{
+    if (!msg->payloadBorrowed)
+        g_free(msg->payload);
+    msg->payload = NULL;
+    msg->payloadLength = 0;
+    msg->payloadOffset = 0;
+    msg->payloadBorrowed = false;
+}
+
+
 virNetMessagePtr virNetMessageNew(bool tracked)
 {
     virNetMessagePtr msg;
@@ -62,7 +161,86 @@ virNetMessageClearPayload(virNetMessagePtr msg)
 
     msg->bufferOffset = 0;
     msg->bufferLength = 0;
-    VIR_FREE(msg->buffer);
+    virNetMessageFreeBuffer(msg);
+    virNetMessageDropPayload(msg);
+}
+
+
+/**
+ * virNetMessageMoveBuffer:
+ * @dst: message to receive the buffer
+ * @src: message to take the buffer from
+ *
+ * Hands the buffer of @src, complete with its length and offset, over
+ * to @dst instead of copying it. Whatever buffer @dst had is released.
+ */
+void
+virNetMessageMoveBuffer(virNetMessagePtr dst,
+                        virNetMessagePtr src)
+{
+    virNetMessageFreeBuffer(dst);
+
+    dst->buffer = g_steal_pointer(&src->buffer);
+    dst->bufferLength = src->bufferLength;
+    dst->bufferOffset = src->bufferOffset;
+    dst->bufferAlloc = src->bufferAlloc;
+
+    src->bufferLength = src->bufferOffset = src->bufferAlloc = 0;
+}
+
+
+/**
+ * virNetMessageGetIOV:
+ * @msg: the outgoing message
+ * @iov: array of VIR_NET_MESSAGE_NIOV elements to fill
+ *
+ * Points @iov at the parts of @msg which are still to be sent: the
+ * rest of its buffer followed by the rest of its payload, if any.
+ *
+ * Returns the number of elements filled in, 0 if all was sent
+ */
+size_t
+virNetMessageGetIOV(virNetMessagePtr msg,
+                    struct iovec *iov)
+{
+    size_t niov = 0;
+
+    if (msg->bufferOffset < msg->bufferLength) {
+        iov[niov].iov_base = msg->buffer + msg->bufferOffset;
+        iov[niov].iov_len = msg->bufferLength - msg->bufferOffset;
+        niov++;
+    }
+
+    if (msg->payloadOffset < msg->payloadLength) {
+        iov[niov].iov_base = msg->payload + msg->payloadOffset;
+        iov[niov].iov_len = msg->payloadLength - msg->payloadOffset;
+        niov++;
+    }
+
+    return niov;
+}
+
+
+/**
+ * virNetMessageAdvance:
+ * @msg: the outgoing message
+ * @len: number of bytes sent
+ *
+ * Marks @len more bytes of @msg as sent.
+ *
+ * Returns the number of bytes still to be sent
+ */
+size_t
+virNetMessageAdvance(virNetMessagePtr msg,
+                     size_t len)
+{
+    size_t n = MIN(len, msg->bufferLength - msg->bufferOffset);
+
+    msg->bufferOffset += n;
+    msg->payloadOffset += MIN(len - n, msg->payloadLength - msg->payloadOffset);
+
+    return (msg->bufferLength - msg->bufferOffset) +
+        (msg->payloadLength - msg->payloadOffset);
 }
 
 
@@ -152,9 +330,8 @@ int virNetMessageDecodeLength(virNetMessagePtr msg)
 
     /* Extend our declared buffer length and carry
        on reading the header + payload */
+    virNetMessageReserveBuffer(msg, msg->bufferLength + len);
     msg->bufferLength += len;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
-        goto cleanup;
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
               msg->bufferLength, len);
@@ -229,9 +406,10 @@ int virNetMessageEncodeHeader(virNetMessagePtr msg)
     int ret = -1;
     unsigned int len = 0;
 
+    virNetMessageDropPayload(msg);
+    msg->bufferLength = 0;
+    virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX);
     msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
-        return ret;
     msg->bufferOffset = 0;
 
     /* Format the header. */
@@ -369,11 +547,9 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 
         xdr_destroy(&xdr);
 
+        virNetMessageReserveBuffer(msg, newlen + VIR_NET_MESSAGE_LEN_MAX);
         msg->bufferLength = newlen + VIR_NET_MESSAGE_LEN_MAX;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
-            goto error;
-
         xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                       msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
 
@@ -453,11 +629,9 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
             return -1;
         }
 
+        virNetMessageReserveBuffer(msg, msg->bufferOffset + len);
         msg->bufferLength = msg->bufferOffset + len;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
-            return -1;
-
         VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
     }
 
@@ -484,6 +658,103 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
 }
 
 
+/*
+ * Attach @data to @msg as its payload instead of copying it into the
+ * message buffer. It is sent straight after the buffer by writers
+ * using virNetMessageGetIOV.
+ */
+static int
+virNetMessageAttachPayload(virNetMessagePtr msg,
+                           char *data,
+                           size_t len,
+                           bool borrowed)
+{
+    XDR xdr;
+    unsigned int msglen;
+
+    if ((msg->bufferOffset + len) >
+        (VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)) {
+        virReportError(VIR_ERR_RPC,
+                       _("Stream data too long to send "
+                         "(%zu bytes needed, %zu bytes available)"),
+                       len,
+                       VIR_NET_MESSAGE_MAX +
+                       VIR_NET_MESSAGE_LEN_MAX -
+                       msg->bufferOffset);
+        return -1;
+    }
+
+    /* Re-encode the length word, covering the payload too. */
+    VIR_DEBUG("Encode length as %zu", msg->bufferOffset + len);
+    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
+    msglen = msg->bufferOffset + len;
+    if (!xdr_u_int(&xdr, &msglen)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
+        xdr_destroy(&xdr);
+        return -1;
+    }
+    xdr_destroy(&xdr);
+
+    msg->payload = data;
+    msg->payloadLength = len;
+    msg->payloadOffset = 0;
+    msg->payloadBorrowed = borrowed;
+
+    msg->bufferLength = msg->bufferOffset;
+    msg->bufferOffset = 0;
+    return 0;
+}
+
+
+/**
+ * virNetMessageEncodePayloadRef:
+ * @msg: the message
+ * @data: the payload
+ * @len: length of @data
+ *
+ * Like virNetMessageEncodePayloadRaw, but @data is not copied. The
+ * caller must keep it around unchanged until @msg has been sent.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetMessageEncodePayloadRef(virNetMessagePtr msg,
+                              const char *data,
+                              size_t len)
+{
+    return virNetMessageAttachPayload(msg, (char *)data, len, true);
+}
+
+
+/**
+ * virNetMessageEncodePayloadSteal:
+ * @msg: the message
+ * @data: the payload
+ * @len: length of @data
+ *
+ * Like virNetMessageEncodePayloadRaw, but @msg takes over @data
+ * instead of copying it. @data is cleared in any case.
+ *
+ * Returns 0 on success, -1 on error
+ */
+int
+virNetMessageEncodePayloadSteal(virNetMessagePtr msg,
+                                char **data,
+                                size_t len)
+{
+    g_autofree char *payload = g_steal_pointer(data);
+
+    if (len == 0)
+        return virNetMessageEncodePayloadEmpty(msg);
+
+    if (virNetMessageAttachPayload(msg, payload, len, false) < 0)
+        return -1;
+
+    payload = NULL;
+    return 0;
+}
+
+
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
 {
     XDR xdr;
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "virnetprotocol.h"
+#include "virsocket.h"
 
 typedef struct virNetMessageHeader *virNetMessageHeaderPtr;
 typedef struct virNetMessageError *virNetMessageErrorPtr;
@@ -30,6 +31,9 @@ typedef virNetMessage *virNetMessagePtr;
 
 typedef void (*virNetMessageFreeCallback)(virNetMessagePtr msg, void *opaque);
 
+/* Number of buffers a message is sent from: header and payload */
+#define VIR_NET_MESSAGE_NIOV 2
+
 struct _virNetMessage {
     bool tracked;
 
@@ -37,6 +41,14 @@ struct _virNetMessage {
                   /* Maximum   VIR_NET_MESSAGE_MAX     + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
     size_t bufferOffset;
+    size_t bufferAlloc; /* Allocated size of buffer, if known */
+
+    /* Stream data sent right after buffer without being copied
+     * into it, see virNetMessageEncodePayloadRef */
+    char *payload;
+    size_t payloadLength;
+    size_t payloadOffset;
+    bool payloadBorrowed;
 
     virNetMessageHeader header;
 
@@ -88,9 +100,28 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *buf,
                                   size_t len)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+int virNetMessageEncodePayloadRef(virNetMessagePtr msg,
+                                  const char *data,
+                                  size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
+int virNetMessageEncodePayloadSteal(virNetMessagePtr msg,
+                                    char **data,
+                                    size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+void virNetMessageMoveBuffer(virNetMessagePtr dst,
+                             virNetMessagePtr src)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
+size_t virNetMessageGetIOV(virNetMessagePtr msg,
+                           struct iovec *iov)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+size_t virNetMessageAdvance(virNetMessagePtr msg,
+                            size_t len)
+    ATTRIBUTE_NONNULL(1);
+
 void virNetMessageSaveError(virNetMessageErrorPtr rerr)
     ATTRIBUTE_NONNULL(1);
 
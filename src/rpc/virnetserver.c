@@ -25,6 +25,7 @@
 #include "virlog.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "vireventthread.h"
 #include "virthread.h"
 #include "virthreadpool.h"
 #include "virstring.h"
@@ -52,6 +53,11 @@ struct _virNetServer {
     /* Immutable pointer, self-locking APIs */
     virThreadPoolPtr workers;
 
+    /* Threads running event loops for client sockets, if any */
+    size_t nioThreads;
+    virEventThread **ioThreads;
+    size_t nextIOThread;
+
     size_t nservices;
     virNetServerServicePtr *services;
 
@@ -288,6 +294,14 @@ int virNetServerAddClient(virNetServerPtr srv,
 {
     virObjectLock(srv);
 
+    if (srv->nioThreads > 0) {
+        virEventThread *evt = srv->ioThreads[srv->nextIOThread++ % srv->nioThreads];
+
+        if (virNetServerClientSetEventContext(client,
+                                              virEventThreadGetContext(evt)) < 0)
+            goto error;
+    }
+
     if (virNetServerClientInit(client) < 0)
         goto error;
 
@@ -352,6 +366,7 @@ virNetServerPtr virNetServerNew(const char *name,
                                 size_t min_workers,
                                 size_t max_workers,
                                 size_t priority_workers,
+                                size_t job_queues,
                                 size_t max_clients,
                                 size_t max_anonymous_clients,
                                 int keepaliveInterval,
@@ -369,11 +384,12 @@ virNetServerPtr virNetServerNew(const char *name,
     if (!(srv = virObjectLockableNew(virNetServerClass)))
         return NULL;
 
-    if (!(srv->workers = virThreadPoolNewFull(min_workers, max_workers,
-                                              priority_workers,
-                                              virNetServerHandleJob,
-                                              "rpc-worker",
-                                              srv)))
+    if (!(srv->workers = virThreadPoolNewSharded(min_workers, max_workers,
+                                                 priority_workers,
+                                                 job_queues,
+                                                 virNetServerHandleJob,
+                                                 "rpc-worker",
+                                                 srv)))
         goto error;
 
     srv->name = g_strdup(name);
@@ -410,6 +426,7 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
     unsigned int min_workers;
     unsigned int max_workers;
     unsigned int priority_workers;
+    unsigned int job_queues = 0;
     unsigned int max_clients;
     unsigned int max_anonymous_clients;
     unsigned int keepaliveInterval;
@@ -431,6 +448,12 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
                        _("Missing priority_workers data in JSON document"));
         goto error;
     }
+    if (virJSONValueObjectHasKey(object, "job_queues") &&
+        virJSONValueObjectGetNumberUint(object, "job_queues", &job_queues) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Malformed job_queues data in JSON document"));
+        goto error;
+    }
     if (virJSONValueObjectGetNumberUint(object, "max_clients", &max_clients) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Missing max_clients data in JSON document"));
@@ -465,7 +488,7 @@ virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
 
     if (!(srv = virNetServerNew(name, next_client_id,
                                 min_workers, max_workers,
-                                priority_workers, max_clients,
+                                priority_workers, job_queues, max_clients,
                                 max_anonymous_clients,
                                 keepaliveInterval, keepaliveCount,
                                 clientPrivNew, clientPrivPreExecRestart,
@@ -574,6 +597,13 @@ virJSONValuePtr virNetServerPreExecRestart(virNetServerPtr srv)
                        _("Cannot set priority_workers data in JSON document"));
         goto error;
     }
+    if (virThreadPoolGetJobQueues(srv->workers) > 0 &&
+        virJSONValueObjectAppendNumberUint(object, "job_queues",
+                                           virThreadPoolGetJobQueues(srv->workers)) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Cannot set job_queues data in JSON document"));
+        goto error;
+    }
     if (virJSONValueObjectAppendNumberUint(object, "max_clients", srv->nclients_max) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Cannot set max_clients data in JSON document"));
@@ -844,6 +874,57 @@ int virNetServerSetTLSContext(virNetServerPtr srv,
 }
 
 
+/**
+ * virNetServerSetIOThreads:
+ * @srv: server object
+ * @nthreads: number of threads
+ *
+ * Start @nthreads threads, each running its own event loop, and
+ * distribute the socket I/O of clients added from now on across them
+ * instead of handling it in the default event loop. This can only be
+ * done once for a server.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNetServerSetIOThreads(virNetServerPtr srv,
+                             size_t nthreads)
+{
+    virEventThread **threads = NULL;
+    size_t i;
+    int ret = -1;
+
+    virObjectLock(srv);
+
+    if (srv->nioThreads > 0) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("I/O threads are already running"));
+        goto cleanup;
+    }
+
+    threads = g_new0(virEventThread *, nthreads);
+    for (i = 0; i < nthreads; i++) {
+        g_autofree char *name = g_strdup_printf("rpc-io-%zu", i);
+
+        if (!(threads[i] = virEventThreadNew(name)))
+            goto cleanup;
+    }
+
+    VIR_DEBUG("Started %zu I/O threads for server %s", nthreads, srv->name);
+    srv->ioThreads = g_steal_pointer(&threads);
+    srv->nioThreads = nthreads;
+    ret = 0;
+
+ cleanup:
+    if (threads) {
+        for (i = 0; i < nthreads && threads[i]; i++)
+            g_object_unref(threads[i]);
+        g_free(threads);
+    }
+    virObjectUnlock(srv);
+    return ret;
+}
+
+
 /**
  * virNetServerSetClientAuthCompletedLocked:
  * @srv: server must be locked by the caller
@@ -925,6 +1006,10 @@ void virNetServerDispose(void *obj)
     for (i = 0; i < srv->nclients; i++)
         virObjectUnref(srv->clients[i]);
     VIR_FREE(srv->clients);
+
+    for (i = 0; i < srv->nioThreads; i++)
+        g_object_unref(srv->ioThreads[i]);
+    VIR_FREE(srv->ioThreads);
 }
 
 void virNetServerClose(virNetServerPtr srv)
@@ -1024,7 +1109,9 @@ virNetServerGetThreadPoolParameters(virNetServerPtr srv,
                                     size_t *nWorkers,
                                     size_t *freeWorkers,
                                     size_t *nPrioWorkers,
-                                    size_t *jobQueueDepth)
+                                    size_t *jobQueueDepth,
+                                    size_t *jobQueues,
+                                    unsigned long long *jobsStolen)
 {
     virObjectLock(srv);
 
@@ -1034,6 +1121,8 @@ virNetServerGetThreadPoolParameters(virNetServerPtr srv,
     *nWorkers = virThreadPoolGetCurrentWorkers(srv->workers);
     *nPrioWorkers = virThreadPoolGetPriorityWorkers(srv->workers);
     *jobQueueDepth = virThreadPoolGetJobQueueDepth(srv->workers);
+    *jobQueues = virThreadPoolGetJobQueues(srv->workers);
+    *jobsStolen = virThreadPoolGetStolenJobs(srv->workers);
 
     virObjectUnlock(srv);
     return 0;
@@ -35,6 +35,7 @@ virNetServerPtr virNetServerNew(const char *name,
                                 size_t min_workers,
                                 size_t max_workers,
                                 size_t priority_workers,
+                                size_t job_queues,
                                 size_t max_clients,
                                 size_t max_anonymous_clients,
                                 int keepaliveInterval,
@@ -43,7 +44,7 @@ virNetServerPtr virNetServerNew(const char *name,
                                 virNetServerClientPrivPreExecRestart clientPrivPreExecRestart,
                                 virFreeCallback clientPrivFree,
                                 void *clientPrivOpaque)
-    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(10) ATTRIBUTE_NONNULL(12);
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(11) ATTRIBUTE_NONNULL(13);
 
 virNetServerPtr virNetServerNewPostExecRestart(virJSONValuePtr object,
                                                const char *name,
@@ -90,6 +91,9 @@ int virNetServerAddProgram(virNetServerPtr srv,
 int virNetServerSetTLSContext(virNetServerPtr srv,
                               virNetTLSContextPtr tls);
 
+int virNetServerSetIOThreads(virNetServerPtr srv,
+                             size_t nthreads);
+
 
 int virNetServerAddClient(virNetServerPtr srv,
                           virNetServerClientPtr client);
@@ -107,7 +111,9 @@ int virNetServerGetThreadPoolParameters(virNetServerPtr srv,
                                         size_t *nWorkers,
                                         size_t *freeWorkers,
                                         size_t *nPrioWorkers,
-                                        size_t *jobQueueDepth);
+                                        size_t *jobQueueDepth,
+                                        size_t *jobQueues,
+                                        unsigned long long *jobsStolen);
 
 int virNetServerSetThreadPoolParameters(virNetServerPtr srv,
                                         long long int minWorkers,
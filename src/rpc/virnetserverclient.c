@@ -32,6 +32,7 @@
 #include "virlog.h"
 #include "virerror.h"
 #include "viralloc.h"
+#include "vireventglib.h"
 #include "virthread.h"
 #include "virkeepalive.h"
 #include "virprobe.h"
@@ -78,6 +79,8 @@ struct _virNetServerClient
 #endif
     int sockTimer; /* Timer to be fired upon cached data,
                     * so we jump out from poll() immediately */
+    GMainContext *eventContext; /* Where socket events are dispatched,
+                                 * NULL for the default event loop */
 
 
     virIdentityPtr identity;
@@ -201,11 +204,12 @@ static int virNetServerClientRegisterEvent(virNetServerClientPtr client)
 
     virObjectRef(client);
     VIR_DEBUG("Registering client event callback %d", mode);
-    if (virNetSocketAddIOCallback(client->sock,
-                                  mode,
-                                  virNetServerClientDispatchEvent,
-                                  client,
-                                  virObjectFreeCallback) < 0) {
+    if (virNetSocketAddIOCallbackContext(client->sock,
+                                         client->eventContext,
+                                         mode,
+                                         virNetServerClientDispatchEvent,
+                                         client,
+                                         virObjectFreeCallback) < 0) {
         virObjectUnref(client);
         return -1;
     }
@@ -983,6 +987,8 @@ void virNetServerClientDispose(void *obj)
 #endif
     if (client->sockTimer > 0)
         virEventRemoveTimeout(client->sockTimer);
+    if (client->eventContext)
+        g_main_context_unref(client->eventContext);
     virObjectUnref(client->tls);
     virObjectUnref(client->tlsCtxt);
     virObjectUnref(client->sock);
@@ -1095,6 +1101,46 @@ virNetServerClientWantCloseLocked(virNetServerClientPtr client)
 }
 
 
+/*
+ * Dispatch socket events and timers of @client from the thread running
+ * @context rather than the default event loop. Must be called before
+ * virNetServerClientInit.
+ */
+int virNetServerClientSetEventContext(virNetServerClientPtr client,
+                                      GMainContext *context)
+{
+    int sockTimer;
+    int ret = -1;
+
+    virObjectLock(client);
+
+    /* The sock timer is dispatched along with the socket callbacks it
+     * kicks, so it has to move to the same context. */
+    if (context)
+        sockTimer = virEventGLibTimeoutAddContext(context, -1,
+                                                  virNetServerClientSockTimerFunc,
+                                                  client, NULL);
+    else
+        sockTimer = virEventAddTimeout(-1, virNetServerClientSockTimerFunc,
+                                       client, NULL);
+    if (sockTimer < 0)
+        goto cleanup;
+
+    if (client->sockTimer > 0)
+        virEventRemoveTimeout(client->sockTimer);
+    client->sockTimer = sockTimer;
+
+    if (client->eventContext)
+        g_main_context_unref(client->eventContext);
+    client->eventContext = context ? g_main_context_ref(context) : NULL;
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(client);
+    return ret;
+}
+
+
 int virNetServerClientInit(virNetServerClientPtr client)
 {
     virObjectLock(client);
@@ -1331,6 +1377,8 @@ static virNetMessagePtr virNetServerClientDispatchRead(virNetServerClientPtr cli
  */
 static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 {
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    size_t niov;
     ssize_t ret;
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
@@ -1341,16 +1389,14 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
         return -1;
     }
 
-    if (client->tx->bufferLength == client->tx->bufferOffset)
+    if ((niov = virNetMessageGetIOV(client->tx, iov)) == 0)
         return 1;
 
-    ret = virNetSocketWrite(client->sock,
-                            client->tx->buffer + client->tx->bufferOffset,
-                            client->tx->bufferLength - client->tx->bufferOffset);
+    ret = virNetSocketWritev(client->sock, iov, niov);
     if (ret <= 0)
         return ret; /* -1 error, 0 = egain */
 
-    client->tx->bufferOffset += ret;
+    virNetMessageAdvance(client->tx, ret);
     return ret;
 }
 
@@ -1363,7 +1409,9 @@ static void
 virNetServerClientDispatchWrite(virNetServerClientPtr client)
 {
     while (client->tx) {
-        if (client->tx->bufferOffset < client->tx->bufferLength) {
+        struct iovec iov[VIR_NET_MESSAGE_NIOV];
+
+        if (virNetMessageGetIOV(client->tx, iov) > 0) {
             ssize_t ret;
             ret = virNetServerClientWrite(client);
             if (ret < 0) {
@@ -1374,7 +1422,7 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
                 return; /* Would block on write EAGAIN */
         }
 
-        if (client->tx->bufferOffset == client->tx->bufferLength) {
+        if (virNetMessageGetIOV(client->tx, iov) == 0) {
             virNetMessagePtr msg;
             size_t i;
 
@@ -1598,6 +1646,9 @@ virNetServerClientInitKeepAlive(virNetServerClientPtr client,
     /* keepalive object has a reference to client */
     virObjectRef(client);
 
+    if (client->eventContext)
+        virKeepAliveSetEventContext(ka, client->eventContext);
+
     client->keepalive = ka;
     ret = 0;
  cleanup:
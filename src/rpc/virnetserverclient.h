@@ -147,6 +147,9 @@ void virNetServerClientDelayedClose(virNetServerClientPtr client);
 void virNetServerClientImmediateClose(virNetServerClientPtr client);
 bool virNetServerClientWantCloseLocked(virNetServerClientPtr client);
 
+int virNetServerClientSetEventContext(virNetServerClientPtr client,
+                                      GMainContext *context);
+
 int virNetServerClientInit(virNetServerClientPtr client);
 
 int virNetServerClientInitKeepAlive(virNetServerClientPtr client,
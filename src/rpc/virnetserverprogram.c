@@ -492,16 +492,16 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
 }
 
 
-int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
-                                      virNetServerClientPtr client,
-                                      virNetMessagePtr msg,
-                                      int procedure,
-                                      unsigned int serial,
-                                      const char *data,
-                                      size_t len)
+static int
+virNetServerProgramSendStreamDataInternal(virNetServerProgramPtr prog,
+                                          virNetServerClientPtr client,
+                                          virNetMessagePtr msg,
+                                          int procedure,
+                                          unsigned int serial,
+                                          const char *data,
+                                          char **stolen,
+                                          size_t len)
 {
-    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, data, len);
-
     /* Return header. We're reusing same message object, so
      * only need to tweak type/status fields */
     msg->header.prog = prog->program;
@@ -520,7 +520,10 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
     if (virNetMessageEncodeHeader(msg) < 0)
         return -1;
 
-    if (data && len) {
+    if (stolen) {
+        if (virNetMessageEncodePayloadSteal(msg, stolen, len) < 0)
+            return -1;
+    } else if (data && len) {
         if (virNetMessageEncodePayloadRaw(msg, data, len) < 0)
             return -1;
 
@@ -528,12 +531,49 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
         if (virNetMessageEncodePayloadEmpty(msg) < 0)
             return -1;
     }
-    VIR_DEBUG("Total %zu", msg->bufferLength);
+    VIR_DEBUG("Total %zu", msg->bufferLength + msg->payloadLength);
 
     return virNetServerClientSendMessage(client, msg);
 }
 
 
+int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
+                                      virNetServerClientPtr client,
+                                      virNetMessagePtr msg,
+                                      int procedure,
+                                      unsigned int serial,
+                                      const char *data,
+                                      size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, data, len);
+
+    return virNetServerProgramSendStreamDataInternal(prog, client, msg,
+                                                     procedure, serial,
+                                                     data, NULL, len);
+}
+
+
+/*
+ * Like virNetServerProgramSendStreamData, but the @len bytes of
+ * @data are attached to @msg rather than copied into it. @data
+ * is cleared once @msg took it over.
+ */
+int virNetServerProgramSendStreamDataSteal(virNetServerProgramPtr prog,
+                                           virNetServerClientPtr client,
+                                           virNetMessagePtr msg,
+                                           int procedure,
+                                           unsigned int serial,
+                                           char **data,
+                                           size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, *data, len);
+
+    return virNetServerProgramSendStreamDataInternal(prog, client, msg,
+                                                     procedure, serial,
+                                                     *data, data, len);
+}
+
+
 int virNetServerProgramSendStreamHole(virNetServerProgramPtr prog,
                                       virNetServerClientPtr client,
                                       virNetMessagePtr msg,
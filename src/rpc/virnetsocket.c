@@ -42,6 +42,7 @@
 #include "virutil.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "vireventglib.h"
 #include "virlog.h"
 #include "virfile.h"
 #include "virthread.h"
@@ -2034,6 +2035,100 @@ ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len)
 }
 
 
+#ifndef WIN32
+static ssize_t virNetSocketWritevWire(virNetSocketPtr sock,
+                                      const struct iovec *iov,
+                                      size_t niov)
+{
+    ssize_t ret;
+
+ rewrite:
+    ret = writev(sock->fd, iov, niov);
+
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto rewrite;
+        if (errno == EAGAIN)
+            return 0;
+
+        virReportSystemError(errno, "%s",
+                             _("Cannot write data"));
+        return -1;
+    }
+    if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while writing data"));
+        return -1;
+    }
+
+    return ret;
+}
+
+
+/*
+ * Whether data is written to the socket FD as it is, so that
+ * several buffers can be handed to the kernel at once.
+ */
+static bool virNetSocketIsPlain(virNetSocketPtr sock)
+{
+#if WITH_SASL
+    if (sock->saslSession)
+        return false;
+#endif
+#if WITH_SSH2
+    if (sock->sshSession)
+        return false;
+#endif
+#if WITH_LIBSSH
+    if (sock->libsshSession)
+        return false;
+#endif
+    if (sock->tlsSession &&
+        virNetTLSSessionGetHandshakeStatus(sock->tlsSession) ==
+        VIR_NET_TLS_HANDSHAKE_COMPLETE)
+        return false;
+
+    return true;
+}
+#endif /* !WIN32 */
+
+
+/*
+ * Write the @niov buffers of @iov in one go where the transport allows
+ * it, otherwise as much of the first non-empty one as possible. Returns
+ * the number of bytes written, 0 if it would block, -1 on error.
+ */
+ssize_t virNetSocketWritev(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov)
+{
+    ssize_t ret;
+
+    while (niov > 0 && iov->iov_len == 0) {
+        iov++;
+        niov--;
+    }
+
+    if (niov == 0)
+        return 0;
+
+    virObjectLock(sock);
+#ifndef WIN32
+    if (niov > 1 && virNetSocketIsPlain(sock))
+        ret = virNetSocketWritevWire(sock, iov, niov);
+    else
+#endif
+#if WITH_SASL
+    if (sock->saslSession)
+        ret = virNetSocketWriteSASL(sock, iov->iov_base, iov->iov_len);
+    else
+#endif
+        ret = virNetSocketWriteWire(sock, iov->iov_base, iov->iov_len);
+    virObjectUnlock(sock);
+    return ret;
+}
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
@@ -2206,6 +2301,22 @@ int virNetSocketAddIOCallback(virNetSocketPtr sock,
                               virNetSocketIOFunc func,
                               void *opaque,
                               virFreeCallback ff)
+{
+    return virNetSocketAddIOCallbackContext(sock, NULL, events,
+                                            func, opaque, ff);
+}
+
+/*
+ * Like virNetSocketAddIOCallback, but if @context is not NULL, @func
+ * is invoked from the thread running @context instead of the default
+ * event loop.
+ */
+int virNetSocketAddIOCallbackContext(virNetSocketPtr sock,
+                                     GMainContext *context,
+                                     int events,
+                                     virNetSocketIOFunc func,
+                                     void *opaque,
+                                     virFreeCallback ff)
 {
     int ret = -1;
 
@@ -2216,11 +2327,20 @@ int virNetSocketAddIOCallback(virNetSocketPtr sock,
         goto cleanup;
     }
 
-    if ((sock->watch = virEventAddHandle(sock->fd,
-                                         events,
-                                         virNetSocketEventHandle,
-                                         sock,
-                                         virNetSocketEventFree)) < 0) {
+    if (context)
+        sock->watch = virEventGLibHandleAddContext(context,
+                                                   sock->fd,
+                                                   events,
+                                                   virNetSocketEventHandle,
+                                                   sock,
+                                                   virNetSocketEventFree);
+    else
+        sock->watch = virEventAddHandle(sock->fd,
+                                        events,
+                                        virNetSocketEventHandle,
+                                        sock,
+                                        virNetSocketEventFree);
+    if (sock->watch < 0) {
         VIR_DEBUG("Failed to register watch on socket %p", sock);
         goto cleanup;
     }
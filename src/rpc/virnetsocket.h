@@ -146,6 +146,9 @@ void virNetSocketSetQuietEOF(virNetSocketPtr sock);
 
 ssize_t virNetSocketRead(virNetSocketPtr sock, char *buf, size_t len);
 ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len);
+ssize_t virNetSocketWritev(virNetSocketPtr sock,
+                           const struct iovec *iov,
+                           size_t niov);
 
 int virNetSocketSendFD(virNetSocketPtr sock, int fd);
 int virNetSocketRecvFD(virNetSocketPtr sock, int *fd);
@@ -173,6 +176,12 @@ int virNetSocketAddIOCallback(virNetSocketPtr sock,
                               virNetSocketIOFunc func,
                               void *opaque,
                               virFreeCallback ff);
+int virNetSocketAddIOCallbackContext(virNetSocketPtr sock,
+                                     GMainContext *context,
+                                     int events,
+                                     virNetSocketIOFunc func,
+                                     void *opaque,
+                                     virFreeCallback ff);
 
 void virNetSocketUpdateIOCallback(virNetSocketPtr sock,
                                   int events);
@@ -117,6 +117,10 @@ struct _virStorageBackend {
     virStorageBackendVolumeUpload uploadVol;
     virStorageBackendVolumeDownload downloadVol;
     virStorageBackendVolumeWipe wipeVol;
+
+    /* refreshPool updates the volumes of the pool itself rather than
+     * expecting them to be cleared first */
+    bool refreshUpdatesVols;
 };
 
 virStorageBackendPtr virStorageBackendForType(int type);
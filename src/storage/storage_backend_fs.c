@@ -365,6 +365,8 @@ virStorageBackendFileSystemStop(virStoragePoolObjPtr pool)
     if (virStorageBackendFileSystemIsValid(pool) < 0)
         return -1;
 
+    virStorageBackendStopLocal(pool);
+
     /* Short-circuit if already unmounted */
     if ((rc = virStorageBackendFileSystemIsMounted(pool)) != 1)
         return rc;
@@ -636,6 +638,8 @@ virStorageBackend virStorageBackendDirectory = {
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshUpdatesVols = true,
+    .stopPool = virStorageBackendStopLocal,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
     .buildVolFrom = virStorageBackendVolBuildFromLocal,
@@ -656,6 +660,7 @@ virStorageBackend virStorageBackendFileSystem = {
     .checkPool = virStorageBackendFileSystemCheck,
     .startPool = virStorageBackendFileSystemStart,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshUpdatesVols = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
@@ -676,6 +681,7 @@ virStorageBackend virStorageBackendNetFileSystem = {
     .startPool = virStorageBackendFileSystemStart,
     .findPoolSources = virStorageBackendFileSystemNetFindPoolSources,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshUpdatesVols = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
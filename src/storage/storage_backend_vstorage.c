@@ -125,6 +125,8 @@ virStorageBackendVzPoolStop(virStoragePoolObjPtr pool)
     int rc;
     g_autoptr(virCommand) cmd = NULL;
 
+    virStorageBackendStopLocal(pool);
+
     /* Short-circuit if already unmounted */
     if ((rc = virStorageBackendVzIsMounted(pool)) != 1)
         return rc;
@@ -161,6 +163,7 @@ virStorageBackend virStorageBackendVstorage = {
     .stopPool = virStorageBackendVzPoolStop,
     .deletePool = virStorageBackendDeleteLocal,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshUpdatesVols = true,
     .checkPool = virStorageBackendVzCheck,
     .buildVol = virStorageBackendVolBuildLocal,
     .buildVolFrom = virStorageBackendVolBuildFromLocal,
@@ -50,6 +50,8 @@
 #include "viraccessapicheck.h"
 #include "storage_util.h"
 #include "virutil.h"
+#include "virthreadpool.h"
+#include "virevent.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -64,6 +66,7 @@ typedef virStorageVolStreamInfo *virStorageVolStreamInfoPtr;
 struct _virStorageVolStreamInfo {
     char *pool_name;
     char *vol_path;
+    char *target_path;
 };
 
 static void storageDriverLock(void)
@@ -75,6 +78,25 @@ static void storageDriverUnlock(void)
     virMutexUnlock(&driver->lock);
 }
 
+/* Files in pool directories which changed, picked up one after
+ * another by storagePoolWatchRefresh in storagePoolWatchWorker */
+typedef struct _storagePoolWatchChange storagePoolWatchChange;
+struct _storagePoolWatchChange {
+    char *pool;
+    char *vol; /* NULL to refresh the whole pool */
+};
+
+static virMutex storagePoolWatchLock = VIR_MUTEX_INITIALIZER;
+static storagePoolWatchChange *storagePoolWatchPending;
+static size_t storagePoolWatchNPending;
+/* changes to pools which were busy, retried once the timer fires */
+static storagePoolWatchChange *storagePoolWatchDelayed;
+static size_t storagePoolWatchNDelayed;
+static int storagePoolWatchTimer = -1;
+static virThreadPoolPtr storagePoolWatchWorker;
+
+#define STORAGE_POOL_WATCH_RETRY_MS 1000
+
 
 static void
 storagePoolRefreshFailCleanup(virStorageBackendPtr backend,
@@ -99,7 +121,8 @@ storagePoolRefreshImpl(virStorageBackendPtr backend,
                        virStoragePoolObjPtr obj,
                        const char *stateFile)
 {
-    virStoragePoolObjClearVols(obj);
+    if (!backend->refreshUpdatesVols)
+        virStoragePoolObjClearVols(obj);
     if (backend->refreshPool(obj) < 0) {
         storagePoolRefreshFailCleanup(backend, obj, stateFile);
         return -1;
@@ -128,6 +151,225 @@ virStoragePoolUpdateInactive(virStoragePoolObjPtr obj)
 }
 
 
+static void
+storagePoolWatchChangesFree(storagePoolWatchChange *changes,
+                            size_t nchanges)
+{
+    size_t i;
+
+    for (i = 0; i < nchanges; i++) {
+        g_free(changes[i].pool);
+        g_free(changes[i].vol);
+    }
+    g_free(changes);
+}
+
+
+/*
+ * Bring pool @change->pool in line with the change to its directory.
+ * A single changed file only updates that volume, and failing to do
+ * so leaves the pool running. If the directory itself went away, the
+ * pool is refreshed the same way as virStoragePoolRefresh() would.
+ *
+ * Returns true if the pool is busy with an async job and has to be
+ * tried again later.
+ */
+static bool
+storagePoolWatchRefreshOne(const storagePoolWatchChange *change)
+{
+    virStoragePoolObjPtr obj;
+    virStoragePoolDefPtr def;
+    virStorageBackendPtr backend;
+    virObjectEventPtr event = NULL;
+    g_autofree char *stateFile = NULL;
+    bool busy = false;
+
+    if (!(obj = virStoragePoolObjFindByName(driver->pools, change->pool)))
+        return false;
+    def = virStoragePoolObjGetDef(obj);
+
+    if (!virStoragePoolObjIsActive(obj) ||
+        virStoragePoolObjIsStarting(obj))
+        goto cleanup;
+
+    if (virStoragePoolObjGetAsyncjobs(obj) > 0) {
+        VIR_DEBUG("Asyncjob in process, refreshing storage pool '%s' later",
+                  change->pool);
+        busy = true;
+        goto cleanup;
+    }
+
+    if (change->vol) {
+        if (virStorageBackendRefreshLocalVol(obj, change->vol) < 0) {
+            VIR_WARN("Failed to refresh volume '%s' of storage pool '%s': %s",
+                     change->vol, change->pool, virGetLastErrorMessage());
+            virResetLastError();
+            goto cleanup;
+        }
+
+        event = virStoragePoolEventRefreshNew(def->name, def->uuid);
+        goto cleanup;
+    }
+
+    if (!(backend = virStorageBackendForType(def->type)))
+        goto cleanup;
+
+    stateFile = virFileBuildPath(driver->stateDir, def->name, ".xml");
+    if (storagePoolRefreshImpl(backend, obj, stateFile) < 0) {
+        VIR_WARN("Failed to refresh storage pool '%s': %s",
+                 change->pool, virGetLastErrorMessage());
+        event = virStoragePoolEventLifecycleNew(def->name,
+                                                def->uuid,
+                                                VIR_STORAGE_POOL_EVENT_STOPPED,
+                                                0);
+        virStoragePoolObjSetActive(obj, false);
+
+        virStoragePoolUpdateInactive(obj);
+
+        goto cleanup;
+    }
+
+    event = virStoragePoolEventRefreshNew(def->name, def->uuid);
+
+ cleanup:
+    virObjectEventStateQueue(driver->storageEventState, event);
+    virStoragePoolObjEndAPI(&obj);
+    return busy;
+}
+
+
+static void storagePoolWatchChanged(const char *poolname,
+                                    const char *volname);
+
+
+static void
+storagePoolWatchRetry(int timer,
+                      void *opaque G_GNUC_UNUSED)
+{
+    storagePoolWatchChange *changes;
+    size_t nchanges;
+    size_t i;
+
+    virEventRemoveTimeout(timer);
+
+    virMutexLock(&storagePoolWatchLock);
+    changes = g_steal_pointer(&storagePoolWatchDelayed);
+    nchanges = storagePoolWatchNDelayed;
+    storagePoolWatchNDelayed = 0;
+    if (storagePoolWatchTimer == timer)
+        storagePoolWatchTimer = -1;
+    virMutexUnlock(&storagePoolWatchLock);
+
+    for (i = 0; i < nchanges; i++)
+        storagePoolWatchChanged(changes[i].pool, changes[i].vol);
+
+    storagePoolWatchChangesFree(changes, nchanges);
+}
+
+
+/*
+ * Retry @change once the pool is likely no longer busy. Waiting is
+ * left to the event loop so that the worker can carry on with changes
+ * to other pools meanwhile.
+ */
+static void
+storagePoolWatchDelay(storagePoolWatchChange *change)
+{
+    virMutexLock(&storagePoolWatchLock);
+
+    if (!storagePoolWatchWorker)
+        goto cleanup;
+
+    if (storagePoolWatchTimer < 0 &&
+        (storagePoolWatchTimer =
+         virEventAddTimeout(STORAGE_POOL_WATCH_RETRY_MS,
+                            storagePoolWatchRetry, NULL, NULL)) < 0) {
+        VIR_WARN("Unable to refresh storage pool '%s' later: %s",
+                 change->pool, virGetLastErrorMessage());
+        virResetLastError();
+        goto cleanup;
+    }
+
+    ignore_value(VIR_APPEND_ELEMENT(storagePoolWatchDelayed,
+                                    storagePoolWatchNDelayed, *change));
+
+ cleanup:
+    virMutexUnlock(&storagePoolWatchLock);
+    g_free(change->pool);
+    g_free(change->vol);
+}
+
+
+static void
+storagePoolWatchRefresh(void *jobdata G_GNUC_UNUSED,
+                        void *opaque G_GNUC_UNUSED)
+{
+    storagePoolWatchChange *changes;
+    size_t nchanges;
+    size_t i;
+
+    virMutexLock(&storagePoolWatchLock);
+    changes = g_steal_pointer(&storagePoolWatchPending);
+    nchanges = storagePoolWatchNPending;
+    storagePoolWatchNPending = 0;
+    virMutexUnlock(&storagePoolWatchLock);
+
+    for (i = 0; i < nchanges; i++) {
+        if (storagePoolWatchRefreshOne(&changes[i]))
+            storagePoolWatchDelay(&changes[i]);
+    }
+
+    storagePoolWatchChangesFree(changes, nchanges);
+}
+
+
+/*
+ * Called from the event loop when the file @volname in the directory
+ * of @poolname changed, or with a NULL @volname when the directory
+ * itself did. Changes coming in while the same one is queued already
+ * are picked up by that same refresh.
+ */
+static void
+storagePoolWatchChanged(const char *poolname,
+                        const char *volname)
+{
+    storagePoolWatchChange change = { 0 };
+    size_t i;
+
+    virMutexLock(&storagePoolWatchLock);
+
+    if (!storagePoolWatchWorker)
+        goto cleanup;
+
+    for (i = 0; i < storagePoolWatchNPending; i++) {
+        storagePoolWatchChange *pending = &storagePoolWatchPending[i];
+
+        if (STRNEQ(pending->pool, poolname))
+            continue;
+
+        /* refreshing the whole pool covers all of its volumes */
+        if (!pending->vol || STREQ_NULLABLE(pending->vol, volname))
+            goto cleanup;
+    }
+
+    if (storagePoolWatchNPending == 0 &&
+        virThreadPoolSendJob(storagePoolWatchWorker, 0, NULL) < 0) {
+        VIR_WARN("Unable to refresh storage pool '%s': %s",
+                 poolname, virGetLastErrorMessage());
+        virResetLastError();
+        goto cleanup;
+    }
+
+    change.pool = g_strdup(poolname);
+    change.vol = g_strdup(volname);
+    ignore_value(VIR_APPEND_ELEMENT(storagePoolWatchPending,
+                                    storagePoolWatchNPending, change));
+
+ cleanup:
+    virMutexUnlock(&storagePoolWatchLock);
+}
+
+
 static void
 storagePoolUpdateStateCallback(virStoragePoolObjPtr obj,
                                const void *opaque G_GNUC_UNUSED)
@@ -278,6 +520,13 @@ storageStateInitialize(bool privileged,
     if (!(driver->pools = virStoragePoolObjListNew()))
         goto error;
 
+    if (!(storagePoolWatchWorker = virThreadPoolNewFull(0, 1, 0,
+                                                        storagePoolWatchRefresh,
+                                                        "storage-watch",
+                                                        NULL)))
+        goto error;
+    virStorageBackendLocalSetChangeCallback(storagePoolWatchChanged);
+
     if (privileged) {
         driver->configDir = g_strdup(SYSCONFDIR "/libvirt/storage");
         driver->autostartDir = g_strdup(SYSCONFDIR "/libvirt/storage/autostart");
@@ -372,9 +621,31 @@ storageStateReload(void)
 static int
 storageStateCleanup(void)
 {
+    virThreadPoolPtr worker;
+
     if (!driver)
         return -1;
 
+    /* the worker uses the pool list, stop it first */
+    virStorageBackendLocalSetChangeCallback(NULL);
+    virMutexLock(&storagePoolWatchLock);
+    worker = g_steal_pointer(&storagePoolWatchWorker);
+    virMutexUnlock(&storagePoolWatchLock);
+    virThreadPoolFree(worker);
+
+    virMutexLock(&storagePoolWatchLock);
+    if (storagePoolWatchTimer >= 0) {
+        virEventRemoveTimeout(storagePoolWatchTimer);
+        storagePoolWatchTimer = -1;
+    }
+    storagePoolWatchChangesFree(g_steal_pointer(&storagePoolWatchPending),
+                                storagePoolWatchNPending);
+    storagePoolWatchNPending = 0;
+    storagePoolWatchChangesFree(g_steal_pointer(&storagePoolWatchDelayed),
+                                storagePoolWatchNDelayed);
+    storagePoolWatchNDelayed = 0;
+    virMutexUnlock(&storagePoolWatchLock);
+
     storageDriverLock();
 
     virObjectUnref(driver->caps);
@@ -1779,6 +2050,8 @@ storageVolDeleteInternal(virStorageBackendPtr backend,
         return -1;
     }
 
+    virStorageFileHeaderCacheInvalidate(voldef->target.path);
+
     if (backend->deleteVol(obj, voldef, flags) < 0)
         return -1;
 
@@ -1973,6 +2246,7 @@ storageVolCreateXML(virStoragePoolPtr pool,
         virObjectUnlock(obj);
 
         buildret = backend->buildVol(obj, buildvoldef, flags);
+        virStorageFileHeaderCacheInvalidate(buildvoldef->target.path);
 
         VIR_FREE(buildvoldef);
 
@@ -2168,6 +2442,7 @@ storageVolCreateXMLFrom(virStoragePoolPtr pool,
     }
 
     buildret = backend->buildVolFrom(obj, shadowvol, voldefsrc, flags);
+    virStorageFileHeaderCacheInvalidate(shadowvol->target.path);
 
     virObjectLock(obj);
     if (objsrc)
@@ -2274,6 +2549,7 @@ virStorageVolPoolRefreshDataFree(void *opaque)
     virStorageVolStreamInfoPtr cbdata = opaque;
 
     VIR_FREE(cbdata->pool_name);
+    VIR_FREE(cbdata->target_path);
     VIR_FREE(cbdata);
 }
 
@@ -2323,6 +2599,8 @@ virStorageVolPoolRefreshThread(void *opaque)
     virStorageBackendPtr backend;
     virObjectEventPtr event = NULL;
 
+    virStorageFileHeaderCacheInvalidate(cbdata->target_path);
+
     if (cbdata->vol_path) {
         if (virStorageBackendPloopRestoreDesc(cbdata->vol_path) < 0)
             goto cleanup;
@@ -2431,6 +2709,7 @@ storageVolUpload(virStorageVolPtr vol,
     if (VIR_ALLOC(cbdata) < 0)
         goto cleanup;
     cbdata->pool_name = g_strdup(def->name);
+    cbdata->target_path = g_strdup(voldef->target.path);
     if (voldef->type == VIR_STORAGE_VOL_PLOOP)
         cbdata->vol_path = g_strdup(voldef->target.path);
 
@@ -2541,6 +2820,8 @@ storageVolResize(virStorageVolPtr vol,
         goto cleanup;
     }
 
+    virStorageFileHeaderCacheInvalidate(voldef->target.path);
+
     if (backend->resizeVol(obj, voldef, abs_capacity, flags) < 0)
         goto cleanup;
 
@@ -2617,6 +2898,7 @@ storageVolWipePattern(virStorageVolPtr vol,
     virObjectUnlock(obj);
 
     rc = backend->wipeVol(obj, voldef, algorithm, flags);
+    virStorageFileHeaderCacheInvalidate(voldef->target.path);
 
     virObjectLock(obj);
     voldef->in_use--;
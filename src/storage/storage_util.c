@@ -27,6 +27,8 @@
 #include <dirent.h>
 #ifdef __linux__
 # include <sys/ioctl.h>
+# include <sys/sysmacros.h>
+# include <sys/inotify.h>
 # include <linux/fs.h>
 # define default_mount_opts "nodev,nosuid,noexec"
 #elif defined(__FreeBSD__)
@@ -71,6 +73,7 @@
 #include "virxml.h"
 #include "virfdstream.h"
 #include "virutil.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -80,6 +83,10 @@ VIR_LOG_INIT("storage.storage_util");
 # define S_IRWXUGO (S_IRWXU | S_IRWXG | S_IRWXO)
 #endif
 
+#ifndef O_DIRECT
+# define O_DIRECT 0
+#endif
+
 /* virStorageBackendNamespaceInit:
  * @poolType: virStoragePoolType
  * @xmlns: Storage Pool specific namespace callback methods
@@ -119,7 +126,173 @@ reflinkCloneFile(int dest_fd G_GNUC_UNUSED,
 #endif
 
 
-static int ATTRIBUTE_NONNULL(2)
+/*
+ * Check whether @len bytes at @buf are all zero. The buffer is compared
+ * with itself shifted by one word, which lets the (vectorized) libc
+ * memcmp do the heavy lifting without a separate zero buffer.
+ */
+static bool
+virStorageBackendIsZero(const char *buf,
+                        size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len && i < sizeof(uint64_t); i++) {
+        if (buf[i])
+            return false;
+    }
+
+    if (len <= sizeof(uint64_t))
+        return true;
+
+    return memcmp(buf, buf + sizeof(uint64_t), len - sizeof(uint64_t)) == 0;
+}
+
+
+#define COPY_PROGRESS_INTERVAL (5 * G_USEC_PER_SEC)
+
+typedef struct _virStorageBackendCopyStats virStorageBackendCopyStats;
+struct _virStorageBackendCopyStats {
+    unsigned long long size;      /* bytes requested */
+    unsigned long long copied;    /* data bytes read and written by us */
+    unsigned long long offloaded; /* data bytes moved by the kernel */
+    unsigned long long skipped;   /* bytes not written: holes, zero blocks */
+    gint64 start;
+    gint64 last;
+};
+
+
+static void
+virStorageBackendCopyProgress(virStorageBackendCopyStats *stats,
+                              virStorageVolDefPtr vol,
+                              virStorageVolDefPtr inputvol,
+                              bool done)
+{
+    gint64 now = g_get_monotonic_time();
+    unsigned long long processed = stats->copied + stats->offloaded + stats->skipped;
+    double elapsed;
+
+    if (!done && now - stats->last < COPY_PROGRESS_INTERVAL)
+        return;
+
+    stats->last = now;
+    elapsed = MAX(now - stats->start, 1) / (double) G_USEC_PER_SEC;
+
+    if (done) {
+        VIR_INFO("copied '%s' to '%s': %llu bytes data (%llu offloaded), "
+                 "%llu bytes sparse, %.1f MiB/s",
+                 inputvol->target.path, vol->target.path,
+                 stats->copied + stats->offloaded, stats->offloaded,
+                 stats->skipped, processed / elapsed / 1024 / 1024);
+    } else {
+        VIR_INFO("copying '%s' to '%s': %llu of %llu bytes, %.1f MiB/s",
+                 inputvol->target.path, vol->target.path,
+                 processed, stats->size, processed / elapsed / 1024 / 1024);
+    }
+}
+
+
+/*
+ * Copy up to @len bytes of data from the current offset of @inputfd to
+ * the current offset of @fd. The kernel is asked to move the data first
+ * if @offload is set; it is cleared once that turns out to be
+ * unsupported for this pair of files. Otherwise the data is read into
+ * @buf, and with @want_sparse blocks of @wbytes zeros are skipped rather
+ * than written.
+ *
+ * Returns the number of bytes consumed from @inputfd, 0 on EOF, or
+ * -errno on error.
+ */
+static ssize_t
+virStorageBackendCopyChunk(virStorageVolDefPtr vol,
+                           virStorageVolDefPtr inputvol,
+                           int inputfd,
+                           int fd,
+                           char *buf,
+                           size_t len,
+                           int wbytes,
+                           bool want_sparse,
+                           bool *offload,
+                           virStorageBackendCopyStats *stats)
+{
+    ssize_t amtread;
+    size_t amtleft;
+    int ret;
+
+    if (*offload) {
+        ssize_t moved = virFileSplice(inputfd, fd, len);
+
+        if (moved > 0) {
+            stats->offloaded += moved;
+            return moved;
+        }
+
+        /* Some filesystems report 0 instead of an error for files
+         * they can't copy, so let read() decide whether this is EOF */
+        if (moved < 0 && errno != ENOSYS) {
+            ret = -errno;
+            virReportSystemError(errno,
+                                 _("failed copying from '%s' to '%s'"),
+                                 inputvol->target.path, vol->target.path);
+            return ret;
+        }
+
+        VIR_DEBUG("kernel copy from '%s' to '%s' not supported, "
+                  "falling back to read/write",
+                  inputvol->target.path, vol->target.path);
+        *offload = false;
+    }
+
+    if ((amtread = saferead(inputfd, buf, len)) < 0) {
+        ret = -errno;
+        virReportSystemError(errno,
+                             _("failed reading from file '%s'"),
+                             inputvol->target.path);
+        return ret;
+    }
+
+    /* Loop over amt read in wbytes increments, looking for sparse
+     * blocks */
+    for (amtleft = amtread; amtleft > 0;) {
+        size_t interval = MIN(amtleft, (size_t) wbytes);
+        size_t offset = amtread - amtleft;
+
+        if (want_sparse && virStorageBackendIsZero(buf + offset, interval)) {
+            if (lseek(fd, interval, SEEK_CUR) < 0) {
+                ret = -errno;
+                virReportSystemError(errno,
+                                     _("cannot extend file '%s'"),
+                                     vol->target.path);
+                return ret;
+            }
+            stats->skipped += interval;
+        } else {
+            if (safewrite(fd, buf + offset, interval) < 0) {
+                ret = -errno;
+                virReportSystemError(errno,
+                                     _("failed writing to file '%s'"),
+                                     vol->target.path);
+                return ret;
+            }
+            stats->copied += interval;
+        }
+
+        amtleft -= interval;
+    }
+
+    return amtread;
+}
+
+
+/*
+ * Copy @inputvol into @fd. With @want_sparse, holes in the input are
+ * found with SEEK_DATA/SEEK_HOLE and skipped without being read, and
+ * zero blocks within the data are not written either. A non-sparse
+ * copy is handed to copy_file_range() where the filesystems allow it;
+ * a sparse one is not, as the kernel would allocate every zero block
+ * within the data extents.
+ */
+int
 virStorageBackendCopyToFD(virStorageVolDefPtr vol,
                           virStorageVolDefPtr inputvol,
                           int fd,
@@ -127,13 +300,13 @@ virStorageBackendCopyToFD(virStorageVolDefPtr vol,
                           bool want_sparse,
                           bool reflink_copy)
 {
-    int amtread = -1;
     int ret = 0;
     size_t rbytes = READ_BLOCK_SIZE_DEFAULT;
     int wbytes = 0;
-    int interval;
     struct stat st;
-    g_autofree char *zerobuf = NULL;
+    bool extents = false;
+    bool offload = !want_sparse;
+    virStorageBackendCopyStats stats = { 0 };
     g_autofree char *buf = NULL;
     VIR_AUTOCLOSE inputfd = -1;
 
@@ -154,9 +327,6 @@ virStorageBackendCopyToFD(virStorageVolDefPtr vol,
     if (wbytes < WRITE_BLOCK_SIZE_DEFAULT)
         wbytes = WRITE_BLOCK_SIZE_DEFAULT;
 
-    if (VIR_ALLOC_N(zerobuf, wbytes) < 0)
-        return -errno;
-
     if (VIR_ALLOC_N(buf, rbytes) < 0)
         return -errno;
 
@@ -173,47 +343,77 @@ virStorageBackendCopyToFD(virStorageVolDefPtr vol,
         }
     }
 
-    while (amtread != 0) {
-        int amtleft;
-
-        if (*total < rbytes)
-            rbytes = *total;
-
-        if ((amtread = saferead(inputfd, buf, rbytes)) < 0) {
-            ret = -errno;
-            virReportSystemError(errno,
-                                 _("failed reading from file '%s'"),
-                                 inputvol->target.path);
-            return ret;
+    /* Only regular files can tell us where their holes are. Data
+     * extents may still contain zero blocks, so a sparse copy always
+     * reads them back to check. */
+    if (want_sparse && fstat(inputfd, &st) == 0 && S_ISREG(st.st_mode))
+        extents = true;
+
+    stats.size = *total;
+    stats.start = stats.last = g_get_monotonic_time();
+
+    while (*total > 0) {
+        unsigned long long len = *total;
+        int inData = 1;
+
+        if (extents) {
+            long long extent;
+
+            if (virFileInData(inputfd, &inData, &extent) < 0) {
+                VIR_DEBUG("cannot find holes in '%s', checking data for zeros",
+                          inputvol->target.path);
+                virResetLastError();
+                extents = false;
+                offload = false;
+                inData = 1;
+            } else if (extent == 0) {
+                /* end of file */
+                break;
+            } else if ((unsigned long long) extent < len) {
+                len = extent;
+            }
         }
-        *total -= amtread;
-
-        /* Loop over amt read in 512 byte increments, looking for sparse
-         * blocks */
-        amtleft = amtread;
-        do {
-            interval = ((wbytes > amtleft) ? amtleft : wbytes);
-            int offset = amtread - amtleft;
-
-            if (want_sparse && memcmp(buf+offset, zerobuf, interval) == 0) {
-                if (lseek(fd, interval, SEEK_CUR) < 0) {
-                    ret = -errno;
-                    virReportSystemError(errno,
-                                         _("cannot extend file '%s'"),
-                                         vol->target.path);
-                    return ret;
-                }
-            } else if (safewrite(fd, buf+offset, interval) < 0) {
+
+        if (!inData) {
+            if (lseek(inputfd, len, SEEK_CUR) < 0) {
                 ret = -errno;
                 virReportSystemError(errno,
-                                     _("failed writing to file '%s'"),
+                                     _("cannot seek in file '%s'"),
+                                     inputvol->target.path);
+                return ret;
+            }
+            if (lseek(fd, len, SEEK_CUR) < 0) {
+                ret = -errno;
+                virReportSystemError(errno,
+                                     _("cannot extend file '%s'"),
                                      vol->target.path);
                 return ret;
-
             }
-        } while ((amtleft -= interval) > 0);
+            stats.skipped += len;
+            *total -= len;
+            virStorageBackendCopyProgress(&stats, vol, inputvol, false);
+            continue;
+        }
+
+        while (len > 0) {
+            ssize_t amt = virStorageBackendCopyChunk(vol, inputvol,
+                                                     inputfd, fd, buf,
+                                                     MIN(len, rbytes),
+                                                     wbytes, want_sparse,
+                                                     &offload, &stats);
+
+            if (amt < 0)
+                return amt;
+            if (amt == 0)
+                goto done;
+
+            len -= amt;
+            *total -= amt;
+            virStorageBackendCopyProgress(&stats, vol, inputvol, false);
+        }
     }
 
+ done:
     if (virFileDataSync(fd) < 0) {
         ret = -errno;
         virReportSystemError(errno, _("cannot sync data to file '%s'"),
@@ -229,6 +429,8 @@ virStorageBackendCopyToFD(virStorageVolDefPtr vol,
         return ret;
     }
 
+    virStorageBackendCopyProgress(&stats, vol, inputvol, true);
+
     return 0;
 }
 
@@ -2478,41 +2680,269 @@ storageBackendVolZeroSparseFileLocal(const char *path,
 }
 
 
+#define WIPE_DIRECT_THREADS 4
+#define WIPE_DIRECT_BUF_SIZE (1024 * 1024)
+#define WIPE_DIRECT_ALIGN 4096
+
+
+#ifdef __linux__
+/*
+ * Older kernels tell whether discarded blocks of a device are
+ * guaranteed to read back as zeroes. Newer ones always claim they are
+ * not and leave it to BLKZEROOUT to pick the fastest safe method.
+ */
+static bool
+storageBackendWipeDiscardZeroes(dev_t dev)
+{
+    int val = 0;
+
+    if (virFileReadValueInt(&val, "/sys/dev/block/%u:%u/queue/discard_zeroes_data",
+                            major(dev), minor(dev)) < 0) {
+        virResetLastError();
+        return false;
+    }
+
+    return val == 1;
+}
+#endif /* __linux__ */
+
+
+/*
+ * Let the kernel zero @len bytes at @offset of @fd: block devices are
+ * discarded or zeroed out by the device itself, regular files get their
+ * range converted to unwritten extents.
+ *
+ * Returns 0 on success, 1 if not supported for @fd (without reporting
+ * an error), or -1 on error.
+ */
 static int
-storageBackendWipeLocal(const char *path,
-                        int fd,
-                        unsigned long long wipe_len,
-                        size_t writebuf_length,
-                        bool zero_end)
+storageBackendWipeOffload(const char *path G_GNUC_UNUSED,
+                          int fd G_GNUC_UNUSED,
+                          const struct stat *st G_GNUC_UNUSED,
+                          off_t offset G_GNUC_UNUSED,
+                          unsigned long long len G_GNUC_UNUSED,
+                          const char **method G_GNUC_UNUSED)
 {
-    int written = 0;
-    unsigned long long remaining = 0;
-    off_t size;
-    size_t write_size = 0;
-    g_autofree char *writebuf = NULL;
+#ifdef __linux__
+    if (S_ISBLK(st->st_mode)) {
+        uint64_t range[2] = { offset, len };
+        int sectorSize = 0;
 
-    if (VIR_ALLOC_N(writebuf, writebuf_length) < 0)
+        if (ioctl(fd, BLKSSZGET, &sectorSize) < 0 || sectorSize <= 0)
+            sectorSize = 512;
+
+        if (offset % sectorSize != 0 || len % sectorSize != 0)
+            return 1;
+
+        if (storageBackendWipeDiscardZeroes(st->st_rdev) &&
+            ioctl(fd, BLKDISCARD, range) == 0) {
+            *method = "discard";
+            return 0;
+        }
+
+        if (ioctl(fd, BLKZEROOUT, range) == 0) {
+            *method = "zeroout";
+            return 0;
+        }
+
+        if (errno == EOPNOTSUPP || errno == EINVAL || errno == ENOTTY)
+            return 1;
+
+        virReportSystemError(errno,
+                             _("Failed to zero out %llu bytes of storage "
+                               "volume with path '%s'"),
+                             len, path);
         return -1;
+    }
+#endif /* __linux__ */
 
-    if (!zero_end) {
-        if ((size = lseek(fd, 0, SEEK_SET)) < 0) {
-            virReportSystemError(errno,
-                                 _("Failed to seek to the start in volume "
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_ZERO_RANGE) && \
+    defined(FALLOC_FL_PUNCH_HOLE)
+    if (S_ISREG(st->st_mode)) {
+        if (fallocate(fd, FALLOC_FL_ZERO_RANGE, offset, len) == 0) {
+            *method = "zero range";
+            return 0;
+        }
+
+        /* Punching a hole works on more filesystems; allocate the range
+         * again afterwards so that the volume doesn't become sparse. */
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      offset, len) == 0 &&
+            fallocate(fd, 0, offset, len) == 0) {
+            *method = "punch hole";
+            return 0;
+        }
+
+        if (errno == EOPNOTSUPP || errno == EINVAL || errno == ENOSYS)
+            return 1;
+
+        virReportSystemError(errno,
+                             _("Failed to zero out %llu bytes of storage "
+                               "volume with path '%s'"),
+                             len, path);
+        return -1;
+    }
+#endif
+
+    return 1;
+}
+
+
+typedef struct _storageBackendWipeJob storageBackendWipeJob;
+struct _storageBackendWipeJob {
+    virThread thread;
+    int fd;
+    const char *buf;
+    off_t offset;
+    unsigned long long len;
+    int err;
+};
+
+
+static void
+storageBackendWipeDirectWorker(void *opaque)
+{
+    storageBackendWipeJob *job = opaque;
+
+    while (job->len > 0) {
+        size_t n = MIN(job->len, WIPE_DIRECT_BUF_SIZE);
+        ssize_t written = pwrite(job->fd, job->buf, n, job->offset);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            job->err = errno;
+            return;
+        }
+
+        /* Nothing written means we hit the end of the volume. A short
+         * write that isn't aligned would make every following write
+         * fail with EINVAL, so give up on both. */
+        if (written == 0) {
+            job->err = ENOSPC;
+            return;
+        }
+
+        if (written % WIPE_DIRECT_ALIGN != 0) {
+            job->err = EIO;
+            return;
+        }
+
+        job->offset += written;
+        job->len -= written;
+    }
+}
+
+
+/*
+ * Write zeroes to @len bytes at @offset of @path from several threads
+ * at once, bypassing the page cache.
+ *
+ * Returns 0 on success, 1 if O_DIRECT can't be used for this range or
+ * file (without reporting an error), or -1 on error.
+ */
+static int
+storageBackendWipeDirect(const char *path,
+                         off_t offset,
+                         unsigned long long len)
+{
+    storageBackendWipeJob jobs[WIPE_DIRECT_THREADS] = { 0 };
+    unsigned long long slice;
+    void *base = NULL;
+    char *buf = NULL;
+    size_t njobs = 0;
+    size_t i;
+    int ret = -1;
+    VIR_AUTOCLOSE fd = -1;
+
+    if (!O_DIRECT ||
+        offset % WIPE_DIRECT_ALIGN != 0 ||
+        len % WIPE_DIRECT_ALIGN != 0)
+        return 1;
+
+    if ((fd = open(path, O_WRONLY | O_DIRECT)) < 0) {
+        VIR_DEBUG("Cannot open '%s' with O_DIRECT: %s",
+                  path, g_strerror(errno));
+        return 1;
+    }
+
+#if HAVE_POSIX_MEMALIGN
+    if (posix_memalign(&base, WIPE_DIRECT_ALIGN, WIPE_DIRECT_BUF_SIZE)) {
+        virReportOOMError();
+        return -1;
+    }
+    buf = base;
+#else
+    if (VIR_ALLOC_N(buf, WIPE_DIRECT_BUF_SIZE + WIPE_DIRECT_ALIGN - 1) < 0)
+        return -1;
+    base = buf;
+    buf = (char *) VIR_ROUND_UP((intptr_t) base, WIPE_DIRECT_ALIGN);
+#endif
+    memset(buf, 0, WIPE_DIRECT_BUF_SIZE);
+
+    slice = VIR_ROUND_UP(VIR_DIV_UP(len, WIPE_DIRECT_THREADS), WIPE_DIRECT_ALIGN);
+
+    for (i = 0; i < WIPE_DIRECT_THREADS && len > 0; i++) {
+        storageBackendWipeJob *job = &jobs[njobs];
+
+        job->fd = fd;
+        job->buf = buf;
+        job->offset = offset;
+        job->len = MIN(slice, len);
+
+        if (virThreadCreateFull(&job->thread, true,
+                                storageBackendWipeDirectWorker,
+                                "vol-wipe", false, job) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create wipe thread"));
+            goto cleanup;
+        }
+
+        njobs++;
+        offset += job->len;
+        len -= job->len;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < njobs; i++) {
+        virThreadJoin(&jobs[i].thread);
+
+        if (ret == 0 && jobs[i].err != 0) {
+            virReportSystemError(jobs[i].err,
+                                 _("Failed to write to storage volume "
                                    "with path '%s'"),
                                  path);
-            return -1;
-        }
-    } else {
-        if ((size = lseek(fd, -wipe_len, SEEK_END)) < 0) {
-            virReportSystemError(errno,
-                                 _("Failed to seek to %llu bytes to the end "
-                                   "in volume with path '%s'"),
-                                 wipe_len, path);
-            return -1;
+            ret = -1;
         }
     }
 
-    VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
+    if (ret == 0 && virFileDataSync(fd) < 0) {
+        virReportSystemError(errno,
+                             _("cannot sync data to volume with path '%s'"),
+                             path);
+        ret = -1;
+    }
+
+    VIR_FREE(base);
+    return ret;
+}
+
+
+static int
+storageBackendWipeBuffered(const char *path,
+                           int fd,
+                           unsigned long long wipe_len,
+                           size_t writebuf_length)
+{
+    int written = 0;
+    unsigned long long remaining = 0;
+    size_t write_size = 0;
+    g_autofree char *writebuf = NULL;
+
+    if (VIR_ALLOC_N(writebuf, writebuf_length) < 0)
+        return -1;
 
     remaining = wipe_len;
     while (remaining > 0) {
@@ -2531,28 +2961,93 @@ storageBackendWipeLocal(const char *path,
         remaining -= written;
     }
 
-    if (virFileDataSync(fd) < 0) {
-        virReportSystemError(errno,
-                             _("cannot sync data to volume with path '%s'"),
-                             path);
-        return -1;
-    }
-
-    VIR_DEBUG("Wrote %llu bytes to volume with path '%s'", wipe_len, path);
-
     return 0;
 }
 
 
+/*
+ * Zero @wipe_len bytes at the start (or with @zero_end, at the end) of
+ * @path. The kernel is asked to do this without moving any data first,
+ * then zeroes are written with O_DIRECT from several threads, and as a
+ * last resort through the page cache.
+ */
 static int
-storageBackendVolWipeLocalFile(const char *path,
-                               unsigned int algorithm,
-                               unsigned long long allocation,
-                               bool zero_end)
+storageBackendWipeLocal(const char *path,
+                        int fd,
+                        const struct stat *st,
+                        unsigned long long wipe_len,
+                        bool zero_end)
 {
-    const char *alg_char = NULL;
-    struct stat st;
-    VIR_AUTOCLOSE fd = -1;
+    const char *method = "buffered write";
+    off_t size;
+    gint64 start;
+    double elapsed;
+    int rc;
+
+    if (!zero_end) {
+        if ((size = lseek(fd, 0, SEEK_SET)) < 0) {
+            virReportSystemError(errno,
+                                 _("Failed to seek to the start in volume "
+                                   "with path '%s'"),
+                                 path);
+            return -1;
+        }
+    } else {
+        if ((size = lseek(fd, -wipe_len, SEEK_END)) < 0) {
+            virReportSystemError(errno,
+                                 _("Failed to seek to %llu bytes to the end "
+                                   "in volume with path '%s'"),
+                                 wipe_len, path);
+            return -1;
+        }
+    }
+
+    VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
+
+    start = g_get_monotonic_time();
+
+    if ((rc = storageBackendWipeOffload(path, fd, st, size,
+                                        wipe_len, &method)) < 0)
+        return -1;
+
+    if (rc > 0) {
+        method = "direct write";
+        if ((rc = storageBackendWipeDirect(path, size, wipe_len)) < 0)
+            return -1;
+    }
+
+    if (rc > 0) {
+        method = "buffered write";
+        if (storageBackendWipeBuffered(path, fd, wipe_len, st->st_blksize) < 0)
+            return -1;
+    }
+
+    if (virFileDataSync(fd) < 0) {
+        virReportSystemError(errno,
+                             _("cannot sync data to volume with path '%s'"),
+                             path);
+        return -1;
+    }
+
+    elapsed = MAX(g_get_monotonic_time() - start, 1) / (double) G_USEC_PER_SEC;
+    VIR_INFO("Wiped %llu bytes of volume with path '%s' using %s "
+             "in %.1f s (%.1f MiB/s)",
+             wipe_len, path, method, elapsed,
+             wipe_len / elapsed / 1024 / 1024);
+
+    return 0;
+}
+
+
+static int
+storageBackendVolWipeLocalFile(const char *path,
+                               unsigned int algorithm,
+                               unsigned long long allocation,
+                               bool zero_end)
+{
+    const char *alg_char = NULL;
+    struct stat st;
+    VIR_AUTOCLOSE fd = -1;
     g_autoptr(virCommand) cmd = NULL;
 
     fd = open(path, O_RDWR);
@@ -2621,8 +3116,7 @@ storageBackendVolWipeLocalFile(const char *path,
     if (S_ISREG(st.st_mode) && st.st_blocks < (st.st_size / DEV_BSIZE))
         return storageBackendVolZeroSparseFileLocal(path, st.st_size, fd);
 
-    return storageBackendWipeLocal(path, fd, allocation, st.st_blksize,
-                                   zero_end);
+    return storageBackendWipeLocal(path, fd, &st, allocation, zero_end);
 }
 
 
@@ -3419,19 +3913,21 @@ storageBackendProbeTarget(virStorageSourcePtr target,
 }
 
 
-/**
- * virStorageBackendRefreshVolTargetUpdate:
- * @vol: Volume def that needs updating
- *
- * Attempt to probe the volume in order to get more details.
+/*
+ * Probe @vol to fill in the details of its target. @complete is set to
+ * false if some of them, like the backing file, could not be found out
+ * for reasons that may be temporary.
  *
  * Returns 0 on success, -2 to ignore failure, -1 on failure
  */
-int
-virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
+static int
+storageBackendRefreshVolTarget(virStorageVolDefPtr vol,
+                               bool *complete)
 {
     int err;
 
+    *complete = true;
+
     /* Real value is filled in during probe */
     vol->target.format = VIR_STORAGE_FILE_RAW;
 
@@ -3445,6 +3941,7 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
              * failed: continue with faked RAW format, since AUTO will
              * break virStorageVolTargetDefFormat() generating the line
              * <format type='...'/>. */
+            *complete = false;
         } else {
             return -1;
         }
@@ -3458,10 +3955,11 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
         vol->type = VIR_STORAGE_VOL_PLOOP;
 
     if (virStorageSourceHasBacking(&vol->target)) {
-        ignore_value(storageBackendUpdateVolTargetInfo(VIR_STORAGE_VOL_FILE,
-                                                       vol->target.backingStore,
-                                                       false,
-                                                       VIR_STORAGE_VOL_OPEN_DEFAULT, 0));
+        if (storageBackendUpdateVolTargetInfo(VIR_STORAGE_VOL_FILE,
+                                              vol->target.backingStore,
+                                              false,
+                                              VIR_STORAGE_VOL_OPEN_DEFAULT, 0) < 0)
+            *complete = false;
         /* If this failed, the backing file is currently unavailable,
          * the capacity, allocation, owner, group and mode are unknown.
          * An error message was raised, but we just continue. */
@@ -3472,90 +3970,429 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
 
 
 /**
- * Iterate over the pool's directory and enumerate all disk images
- * within it. This is non-recursive.
+ * virStorageBackendRefreshVolTargetUpdate:
+ * @vol: Volume def that needs updating
+ *
+ * Attempt to probe the volume in order to get more details.
+ *
+ * Returns 0 on success, -2 to ignore failure, -1 on failure
  */
 int
-virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
+virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
 {
-    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
-    DIR *dir;
-    struct dirent *ent;
-    struct statvfs sb;
-    struct stat statbuf;
-    int direrr;
-    int ret = -1;
-    g_autoptr(virStorageVolDef) vol = NULL;
-    VIR_AUTOCLOSE fd = -1;
-    g_autoptr(virStorageSource) target = NULL;
+    bool complete;
 
-    if (virDirOpen(&dir, def->target.path) < 0)
-        goto cleanup;
+    return storageBackendRefreshVolTarget(vol, &complete);
+}
 
-    while ((direrr = virDirRead(dir, &ent, def->target.path)) > 0) {
-        int err;
 
-        if (virStringHasControlChars(ent->d_name)) {
-            VIR_WARN("Ignoring file '%s' with control characters under '%s'",
-                     ent->d_name, def->target.path);
-            continue;
+/*
+ * Header metadata of volumes in local pools, keyed by the path of the
+ * volume. An entry is only used while the file, and the backing file
+ * whose details were probed along with it, still have the same device,
+ * inode, size, mtime and ctime as when they were probed, which spares
+ * re-reading the headers of unchanged images on every refresh.
+ */
+typedef struct _storageBackendProbeCacheStamp storageBackendProbeCacheStamp;
+struct _storageBackendProbeCacheStamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+};
+
+typedef struct _storageBackendProbeCacheEntry storageBackendProbeCacheEntry;
+struct _storageBackendProbeCacheEntry {
+    storageBackendProbeCacheStamp stamp;
+    char *backingPath; /* NULL if the volume has no backing file */
+    storageBackendProbeCacheStamp backingStamp;
+    unsigned long long generation;
+
+    int type; /* virStorageVolType */
+    virStorageSourcePtr target;
+};
+
+static virMutex storageBackendProbeCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr storageBackendProbeCache;
+static unsigned long long storageBackendProbeCacheGeneration;
+
+
+static void
+storageBackendProbeCacheEntryFree(void *opaque)
+{
+    storageBackendProbeCacheEntry *entry = opaque;
+
+    if (!entry)
+        return;
+
+    virObjectUnref(entry->target);
+    g_free(entry->backingPath);
+    g_free(entry);
+}
+
+
+static void
+storageBackendProbeCacheStampFill(storageBackendProbeCacheStamp *stamp,
+                                  const struct stat *sb)
+{
+    stamp->dev = sb->st_dev;
+    stamp->ino = sb->st_ino;
+    stamp->size = sb->st_size;
+#ifdef __APPLE__
+    stamp->mtime = sb->st_mtimespec;
+    stamp->ctime = sb->st_ctimespec;
+#else /* ! __APPLE__ */
+    stamp->mtime = sb->st_mtim;
+    stamp->ctime = sb->st_ctim;
+#endif /* ! __APPLE__ */
+}
+
+
+static bool
+storageBackendProbeCacheStampMatch(const storageBackendProbeCacheStamp *stamp,
+                                   const struct stat *sb)
+{
+    storageBackendProbeCacheStamp now;
+
+    storageBackendProbeCacheStampFill(&now, sb);
+
+    return stamp->dev == now.dev &&
+        stamp->ino == now.ino &&
+        stamp->size == now.size &&
+        stamp->mtime.tv_sec == now.mtime.tv_sec &&
+        stamp->mtime.tv_nsec == now.mtime.tv_nsec &&
+        stamp->ctime.tv_sec == now.ctime.tv_sec &&
+        stamp->ctime.tv_nsec == now.ctime.tv_nsec;
+}
+
+
+/* Must be called with storageBackendProbeCacheLock held */
+static bool
+storageBackendProbeCacheEntryValid(const storageBackendProbeCacheEntry *entry,
+                                   const struct stat *sb)
+{
+    struct stat backing;
+
+    if (!storageBackendProbeCacheStampMatch(&entry->stamp, sb))
+        return false;
+
+    if (!entry->backingPath)
+        return true;
+
+    return stat(entry->backingPath, &backing) == 0 &&
+        storageBackendProbeCacheStampMatch(&entry->backingStamp, &backing);
+}
+
+
+/*
+ * Fill in @vol from the cache if the file described by @sb was probed
+ * before and neither it nor its backing file changed since.
+ *
+ * Returns true on a cache hit.
+ */
+static bool
+storageBackendProbeCacheGet(virStorageVolDefPtr vol,
+                            const struct stat *sb,
+                            unsigned long long generation)
+{
+    storageBackendProbeCacheEntry *entry;
+    g_autoptr(virStorageSource) copy = NULL;
+
+    virMutexLock(&storageBackendProbeCacheLock);
+
+    if (!storageBackendProbeCache ||
+        !(entry = virHashLookup(storageBackendProbeCache, vol->target.path)) ||
+        !storageBackendProbeCacheEntryValid(entry, sb)) {
+        virMutexUnlock(&storageBackendProbeCacheLock);
+        return false;
+    }
+
+    if (!(copy = virStorageSourceCopy(entry->target, true))) {
+        virMutexUnlock(&storageBackendProbeCacheLock);
+        /* just probe the volume again */
+        virResetLastError();
+        return false;
+    }
+
+    entry->generation = generation;
+    vol->type = entry->type;
+
+    virMutexUnlock(&storageBackendProbeCacheLock);
+
+    vol->target.type = copy->type;
+    vol->target.format = copy->format;
+    vol->target.capacity = copy->capacity;
+    vol->target.allocation = copy->allocation;
+    vol->target.physical = copy->physical;
+    vol->target.perms = g_steal_pointer(&copy->perms);
+    vol->target.timestamps = g_steal_pointer(&copy->timestamps);
+    vol->target.features = g_steal_pointer(&copy->features);
+    vol->target.compat = g_steal_pointer(&copy->compat);
+    vol->target.encryption = g_steal_pointer(&copy->encryption);
+    vol->target.backingStore = g_steal_pointer(&copy->backingStore);
+
+    return true;
+}
+
+
+static void
+storageBackendProbeCachePut(virStorageVolDefPtr vol,
+                            const struct stat *sb,
+                            unsigned long long generation)
+{
+    virStorageSourcePtr backing = vol->target.backingStore;
+    storageBackendProbeCacheEntry *entry;
+    struct stat backingsb;
+
+    entry = g_new0(storageBackendProbeCacheEntry, 1);
+    storageBackendProbeCacheStampFill(&entry->stamp, sb);
+    entry->generation = generation;
+    entry->type = vol->type;
+
+    /* The details of the backing file are part of the result, so it
+     * is only valid while that file is unchanged too. Backing files
+     * we can't stat() are not cached at all. */
+    if (virStorageSourceHasBacking(&vol->target)) {
+        if (!virStorageSourceIsLocalStorage(backing) ||
+            !backing->path ||
+            stat(backing->path, &backingsb) < 0) {
+            storageBackendProbeCacheEntryFree(entry);
+            return;
         }
+        entry->backingPath = g_strdup(backing->path);
+        storageBackendProbeCacheStampFill(&entry->backingStamp, &backingsb);
+    }
 
-        if (VIR_ALLOC(vol) < 0)
-            goto cleanup;
+    if (!(entry->target = virStorageSourceCopy(&vol->target, true))) {
+        storageBackendProbeCacheEntryFree(entry);
+        virResetLastError();
+        return;
+    }
 
-        vol->name = g_strdup(ent->d_name);
+    virMutexLock(&storageBackendProbeCacheLock);
 
-        vol->type = VIR_STORAGE_VOL_FILE;
-        vol->target.path = g_strdup_printf("%s/%s", def->target.path, vol->name);
+    if (!storageBackendProbeCache)
+        storageBackendProbeCache = virHashNew(storageBackendProbeCacheEntryFree);
 
-        vol->key = g_strdup(vol->target.path);
+    if (virHashUpdateEntry(storageBackendProbeCache, vol->target.path, entry) < 0) {
+        storageBackendProbeCacheEntryFree(entry);
+        virResetLastError();
+    }
 
-        if ((err = virStorageBackendRefreshVolTargetUpdate(vol)) < 0) {
-            if (err == -2) {
-                /* Silently ignore non-regular files,
-                 * eg 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
-                continue;
-            }
-            goto cleanup;
+    virMutexUnlock(&storageBackendProbeCacheLock);
+}
+
+
+struct storageBackendProbeCachePruneData {
+    const char *dir;
+    unsigned long long generation;
+};
+
+
+static int
+storageBackendProbeCachePruneOne(const void *payload,
+                                 const void *name,
+                                 const void *opaque)
+{
+    const storageBackendProbeCacheEntry *entry = payload;
+    const struct storageBackendProbeCachePruneData *data = opaque;
+    const char *path = name;
+    size_t len = strlen(data->dir);
+
+    /* only entries directly within @dir that weren't seen this time */
+    return STREQLEN(path, data->dir, len) &&
+        path[len] == '/' &&
+        !strchr(path + len + 1, '/') &&
+        entry->generation < data->generation;
+}
+
+
+static void
+storageBackendProbeCachePrune(const char *dir,
+                              unsigned long long generation)
+{
+    struct storageBackendProbeCachePruneData data = { dir, generation };
+
+    virMutexLock(&storageBackendProbeCacheLock);
+    if (storageBackendProbeCache)
+        virHashRemoveSet(storageBackendProbeCache,
+                         storageBackendProbeCachePruneOne, &data);
+    virMutexUnlock(&storageBackendProbeCacheLock);
+}
+
+
+/*
+ * Probe @vol, using the cache for regular files that didn't change
+ * since they were last probed.
+ *
+ * Returns 0 on success, -2 to ignore the volume, -1 on failure
+ */
+static int
+storageBackendRefreshLocalProbe(virStorageVolDefPtr vol,
+                                unsigned long long generation)
+{
+    struct stat sb;
+    bool cacheable = false;
+    bool complete;
+    int rc;
+
+    if (stat(vol->target.path, &sb) == 0 && S_ISREG(sb.st_mode)) {
+        if (storageBackendProbeCacheGet(vol, &sb, generation))
+            return 0;
+        cacheable = true;
+    }
+
+    if ((rc = storageBackendRefreshVolTarget(vol, &complete)) < 0)
+        return rc;
+
+    /* Don't remember results based on temporary failures */
+    if (cacheable && complete)
+        storageBackendProbeCachePut(vol, &sb, generation);
+
+    return 0;
+}
+
+
+static virStorageVolDefPtr
+storageBackendLocalVolNew(virStoragePoolDefPtr def,
+                          const char *name)
+{
+    virStorageVolDefPtr vol;
+
+    if (VIR_ALLOC(vol) < 0)
+        return NULL;
+
+    vol->name = g_strdup(name);
+
+    vol->type = VIR_STORAGE_VOL_FILE;
+    vol->target.path = g_strdup_printf("%s/%s", def->target.path, vol->name);
+
+    vol->key = g_strdup(vol->target.path);
+
+    return vol;
+}
+
+
+#define REFRESH_THREADS_MAX 8
+
+typedef struct _storageBackendRefreshJob storageBackendRefreshJob;
+struct _storageBackendRefreshJob {
+    virStorageVolDefPtr *vols;
+    int *results;
+    int nvols;
+    unsigned long long generation;
+
+    int next;
+    int failed;
+    virMutex lock;
+    virErrorPtr error;
+};
+
+
+static void
+storageBackendRefreshLocalWorker(void *opaque)
+{
+    storageBackendRefreshJob *job = opaque;
+    int i;
+
+    while (!g_atomic_int_get(&job->failed) &&
+           (i = g_atomic_int_add(&job->next, 1)) < job->nvols) {
+        job->results[i] = storageBackendRefreshLocalProbe(job->vols[i],
+                                                          job->generation);
+
+        if (job->results[i] == -1) {
+            g_atomic_int_set(&job->failed, 1);
+
+            /* errors are thread local, hand the first one over */
+            virMutexLock(&job->lock);
+            if (!job->error)
+                virErrorPreserveLast(&job->error);
+            virMutexUnlock(&job->lock);
         }
+    }
+}
 
-        if (virStoragePoolObjAddVol(pool, vol) < 0)
-            goto cleanup;
-        vol = NULL;
+
+/*
+ * Probe all volumes in @job, from several threads if there are enough
+ * of them. The probes are mostly waiting for the storage, which on
+ * network filesystems can take a while for each of them.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+storageBackendRefreshLocalProbeAll(storageBackendRefreshJob *job)
+{
+    virThread threads[REFRESH_THREADS_MAX];
+    size_t nthreads = MIN(REFRESH_THREADS_MAX, job->nvols / 4);
+    size_t i;
+
+    if (virMutexInit(&job->lock) < 0) {
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        return -1;
     }
-    if (direrr < 0)
-        goto cleanup;
-    VIR_DIR_CLOSE(dir);
+
+    for (i = 0; i < nthreads; i++) {
+        if (virThreadCreateFull(&threads[i], true,
+                                storageBackendRefreshLocalWorker,
+                                "vol-probe", false, job) < 0)
+            break;
+    }
+
+    /* do our share, or all of it if no thread could be started */
+    storageBackendRefreshLocalWorker(job);
+
+    nthreads = i;
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&job->lock);
+
+    if (job->failed) {
+        virErrorRestore(&job->error);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+storageBackendRefreshLocalPool(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    struct statvfs sb;
+    struct stat statbuf;
+    VIR_AUTOCLOSE fd = -1;
+    g_autoptr(virStorageSource) target = NULL;
 
     if (!(target = virStorageSourceNew()))
-        goto cleanup;
+        return -1;
 
     if ((fd = open(def->target.path, O_RDONLY)) < 0) {
         virReportSystemError(errno,
                              _("cannot open path '%s'"),
                              def->target.path);
-        goto cleanup;
+        return -1;
     }
 
     if (fstat(fd, &statbuf) < 0) {
         virReportSystemError(errno,
                              _("cannot stat path '%s'"),
                              def->target.path);
-        goto cleanup;
+        return -1;
     }
 
     if (virStorageBackendUpdateVolTargetInfoFD(target, fd, &statbuf) < 0)
-        goto cleanup;
+        return -1;
 
     /* VolTargetInfoFD doesn't update capacity correctly for the pool case */
     if (statvfs(def->target.path, &sb) < 0) {
         virReportSystemError(errno,
                              _("cannot statvfs path '%s'"),
                              def->target.path);
-        goto cleanup;
+        return -1;
     }
 
     def->capacity = ((unsigned long long)sb.f_frsize *
@@ -3570,13 +4407,494 @@ virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
     VIR_FREE(def->target.perms.label);
     def->target.perms.label = g_strdup(target->perms->label);
 
+    return 0;
+}
+
+
+static virMutex storageBackendLocalWatchLock = VIR_MUTEX_INITIALIZER;
+static virStorageBackendLocalChangeFunc storageBackendLocalChangeCb;
+
+
+/**
+ * virStorageBackendLocalSetChangeCallback:
+ * @cb: function to call with the name of a pool whose directory changed
+ *
+ * Active local pools have their directory watched, where supported, so
+ * that volumes created, changed or removed behind our back show up
+ * without an explicit refresh. @cb is invoked from the event loop with
+ * the names of the pool and of the file that changed, or with a NULL
+ * file name if the directory itself went away. It is expected to
+ * schedule a refresh elsewhere.
+ */
+void
+virStorageBackendLocalSetChangeCallback(virStorageBackendLocalChangeFunc cb)
+{
+    virMutexLock(&storageBackendLocalWatchLock);
+    storageBackendLocalChangeCb = cb;
+    virMutexUnlock(&storageBackendLocalWatchLock);
+}
+
+
+#ifdef __linux__
+/*
+ * Changes made on other hosts of a network filesystem are not reported
+ * by the kernel; those still need a refresh. Permission changes alone
+ * don't trigger one either.
+ */
+# define LOCAL_WATCH_MASK \
+    (IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | \
+     IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+typedef struct _storageBackendLocalWatch storageBackendLocalWatch;
+struct _storageBackendLocalWatch {
+    int wd;
+    virStoragePoolObjPtr pool;
+    char *name;
+};
+
+static int storageBackendLocalWatchFD = -1;
+static int storageBackendLocalWatchHandle = -1;
+static storageBackendLocalWatch *storageBackendLocalWatches;
+static size_t storageBackendLocalNWatches;
+
+
+/* Must be called with storageBackendLocalWatchLock held */
+static void
+storageBackendLocalWatchRemoveLocked(virStoragePoolObjPtr pool)
+{
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < storageBackendLocalNWatches; i++) {
+        storageBackendLocalWatch *watch = &storageBackendLocalWatches[i];
+        bool shared = false;
+
+        if (watch->pool != pool)
+            continue;
+
+        /* the kernel hands out the same descriptor for the same
+         * directory, which might be watched for another pool too */
+        for (j = 0; j < storageBackendLocalNWatches; j++) {
+            if (j != i && storageBackendLocalWatches[j].wd == watch->wd)
+                shared = true;
+        }
+        if (!shared)
+            inotify_rm_watch(storageBackendLocalWatchFD, watch->wd);
+
+        virObjectUnref(watch->pool);
+        g_free(watch->name);
+        VIR_DELETE_ELEMENT(storageBackendLocalWatches, i,
+                           storageBackendLocalNWatches);
+        return;
+    }
+}
+
+
+static void
+storageBackendLocalWatchRead(int handle G_GNUC_UNUSED,
+                             int fd,
+                             int events G_GNUC_UNUSED,
+                             void *opaque G_GNUC_UNUSED)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    virStorageBackendLocalChangeFunc cb;
+    g_auto(GStrv) pools = NULL;
+    g_auto(GStrv) vols = NULL;
+    size_t nchanged = 0;
+    g_autofree virStoragePoolObjPtr *gone = NULL;
+    size_t ngone = 0;
+    ssize_t len;
+    size_t i;
+
+    virMutexLock(&storageBackendLocalWatchLock);
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        char *p;
+
+        for (p = buf; p < buf + len;) {
+            struct inotify_event *ev = (struct inotify_event *) p;
+            bool self = ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF);
+
+            p += sizeof(*ev) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                VIR_WARN("Too many changes in storage pool directories, "
+                         "pools need to be refreshed");
+                continue;
+            }
+
+            if (!self &&
+                (ev->len == 0 || virStringHasControlChars(ev->name)))
+                continue;
+
+            for (i = 0; i < storageBackendLocalNWatches; i++) {
+                storageBackendLocalWatch *watch = &storageBackendLocalWatches[i];
+
+                if (watch->wd != ev->wd)
+                    continue;
+
+                /* a refresh notices the directory went away, and the
+                 * watch is useless from now on */
+                if (self)
+                    ignore_value(VIR_APPEND_ELEMENT(gone, ngone, watch->pool));
+
+                /* an empty volume name asks for a refresh of the
+                 * whole pool */
+                if (virStringListAdd(&pools, watch->name) < 0 ||
+                    virStringListAdd(&vols, self ? "" : ev->name) < 0)
+                    break;
+                nchanged++;
+            }
+        }
+    }
+
+    for (i = 0; i < ngone; i++)
+        storageBackendLocalWatchRemoveLocked(gone[i]);
+
+    cb = storageBackendLocalChangeCb;
+
+    virMutexUnlock(&storageBackendLocalWatchLock);
+
+    /* Refreshing may block on the storage for a long time, so it's up
+     * to the driver to do that from a worker thread. */
+    for (i = 0; cb && i < nchanged; i++)
+        cb(pools[i], *vols[i] ? vols[i] : NULL);
+}
+
+
+static void
+storageBackendLocalWatchAdd(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    storageBackendLocalWatch watch = { 0 };
+    size_t i;
+
+    virMutexLock(&storageBackendLocalWatchLock);
+
+    if (!storageBackendLocalChangeCb)
+        goto cleanup;
+
+    for (i = 0; i < storageBackendLocalNWatches; i++) {
+        if (storageBackendLocalWatches[i].pool == pool)
+            goto cleanup;
+    }
+
+    if (storageBackendLocalWatchFD < 0) {
+        int fd;
+
+        if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+            VIR_DEBUG("Cannot watch storage pools: %s", g_strerror(errno));
+            goto cleanup;
+        }
+
+        if ((storageBackendLocalWatchHandle =
+             virEventAddHandle(fd, VIR_EVENT_HANDLE_READABLE,
+                               storageBackendLocalWatchRead,
+                               NULL, NULL)) < 0) {
+            VIR_DEBUG("Cannot watch storage pools without an event loop");
+            virResetLastError();
+            VIR_FORCE_CLOSE(fd);
+            goto cleanup;
+        }
+
+        storageBackendLocalWatchFD = fd;
+    }
+
+    if ((watch.wd = inotify_add_watch(storageBackendLocalWatchFD,
+                                      def->target.path,
+                                      LOCAL_WATCH_MASK)) < 0) {
+        VIR_DEBUG("Cannot watch '%s': %s", def->target.path, g_strerror(errno));
+        goto cleanup;
+    }
+
+    watch.pool = virObjectRef(pool);
+    watch.name = g_strdup(def->name);
+    ignore_value(VIR_APPEND_ELEMENT(storageBackendLocalWatches,
+                                    storageBackendLocalNWatches, watch));
+
+ cleanup:
+    virMutexUnlock(&storageBackendLocalWatchLock);
+}
+
+
+static void
+storageBackendLocalWatchRemove(virStoragePoolObjPtr pool)
+{
+    virMutexLock(&storageBackendLocalWatchLock);
+    storageBackendLocalWatchRemoveLocked(pool);
+    virMutexUnlock(&storageBackendLocalWatchLock);
+}
+#else /* !__linux__ */
+static void
+storageBackendLocalWatchAdd(virStoragePoolObjPtr pool G_GNUC_UNUSED)
+{
+}
+
+
+static void
+storageBackendLocalWatchRemove(virStoragePoolObjPtr pool G_GNUC_UNUSED)
+{
+}
+#endif /* !__linux__ */
+
+
+static int
+storageBackendLocalCollectVol(virStorageVolDefPtr voldef,
+                              const void *opaque)
+{
+    virHashTablePtr names = (virHashTablePtr) opaque;
+
+    return virHashAddEntry(names, voldef->name, (void *) 1);
+}
+
+
+struct storageBackendLocalStaleData {
+    virHashTablePtr before; /* volumes of the pool before probing */
+    virHashTablePtr found; /* volumes found in the directory */
+    char **stale;
+};
+
+
+static int
+storageBackendLocalCollectStale(virStorageVolDefPtr voldef,
+                                const void *opaque)
+{
+    struct storageBackendLocalStaleData *data;
+
+    data = (struct storageBackendLocalStaleData *)opaque;
+
+    if (virHashLookup(data->before, voldef->name) &&
+        !virHashLookup(data->found, voldef->name) &&
+        !voldef->building && voldef->in_use == 0)
+        ignore_value(virStringListAdd(&data->stale, voldef->name));
+
+    return 0;
+}
+
+
+/*
+ * Replace the volumes of @pool with those found by @job. Volumes
+ * created or deleted through the API while the pool was unlocked for
+ * probing are left alone, and so are volumes which are being built
+ * or are in use.
+ */
+static int
+storageBackendLocalUpdateVols(virStoragePoolObjPtr pool,
+                              storageBackendRefreshJob *job,
+                              virHashTablePtr before)
+{
+    struct storageBackendLocalStaleData data = { .before = before };
+    int ret = -1;
+    int i;
+
+    if (!(data.found = virHashNew(NULL)))
+        return -1;
+
+    for (i = 0; i < job->nvols; i++) {
+        virStorageVolDefPtr vol = job->vols[i];
+        virStorageVolDefPtr old;
+
+        /* Silently ignore non-regular files,
+         * eg 'lost+found', dangling symbolic link */
+        if (job->results[i] == -2)
+            continue;
+
+        if (virHashAddEntry(data.found, vol->name, (void *) 1) < 0)
+            goto cleanup;
+
+        if ((old = virStorageVolDefFindByName(pool, vol->name))) {
+            if (!virHashLookup(before, vol->name) ||
+                old->building || old->in_use > 0)
+                continue;
+            virStoragePoolObjRemoveVol(pool, old);
+        } else if (virHashLookup(before, vol->name)) {
+            continue;
+        }
+
+        if (virStoragePoolObjAddVol(pool, vol) < 0)
+            goto cleanup;
+        job->vols[i] = NULL;
+    }
+
+    virStoragePoolObjForEachVolume(pool, storageBackendLocalCollectStale,
+                                   &data);
+
+    for (i = 0; data.stale && data.stale[i]; i++) {
+        virStorageVolDefPtr vol;
+
+        if ((vol = virStorageVolDefFindByName(pool, data.stale[i])))
+            virStoragePoolObjRemoveVol(pool, vol);
+    }
+
     ret = 0;
+
  cleanup:
+    virHashFree(data.found);
+    virStringListFree(data.stale);
+    return ret;
+}
+
+
+/**
+ * Iterate over the pool's directory and enumerate all disk images
+ * within it. This is non-recursive.
+ *
+ * Volumes are probed in parallel with the pool unlocked, and the
+ * headers of those that didn't change since the previous refresh are
+ * not read again. The volumes the pool had before stay visible until
+ * the new ones are swapped in. Afterwards, changes to the directory
+ * are tracked until the pool is stopped.
+ */
+int
+virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    DIR *dir;
+    struct dirent *ent;
+    int direrr;
+    int ret = -1;
+    int rc;
+    storageBackendRefreshJob job = { 0 };
+    virHashTablePtr before = NULL;
+    size_t nvols = 0;
+    int i;
+
+    if (virDirOpen(&dir, def->target.path) < 0)
+        goto cleanup;
+
+    while ((direrr = virDirRead(dir, &ent, def->target.path)) > 0) {
+        virStorageVolDefPtr vol;
+
+        if (virStringHasControlChars(ent->d_name)) {
+            VIR_WARN("Ignoring file '%s' with control characters under '%s'",
+                     ent->d_name, def->target.path);
+            continue;
+        }
+
+        if (!(vol = storageBackendLocalVolNew(def, ent->d_name)))
+            goto cleanup;
+
+        if (VIR_APPEND_ELEMENT(job.vols, nvols, vol) < 0) {
+            virStorageVolDefFree(vol);
+            goto cleanup;
+        }
+    }
+    if (direrr < 0)
+        goto cleanup;
     VIR_DIR_CLOSE(dir);
+
+    virMutexLock(&storageBackendProbeCacheLock);
+    job.generation = ++storageBackendProbeCacheGeneration;
+    virMutexUnlock(&storageBackendProbeCacheLock);
+
+    job.nvols = nvols;
+    job.results = g_new0(int, nvols);
+
+    if (!(before = virHashNew(NULL)))
+        goto cleanup;
+    virStoragePoolObjForEachVolume(pool, storageBackendLocalCollectVol, before);
+
+    /* Probing may wait on the storage for a long time. Counting it as
+     * an async job keeps the pool from being destroyed or refreshed
+     * meanwhile, like building a volume does. */
+    virStoragePoolObjIncrAsyncjobs(pool);
+    virObjectUnlock(pool);
+
+    rc = storageBackendRefreshLocalProbeAll(&job);
+
+    virObjectLock(pool);
+    virStoragePoolObjDecrAsyncjobs(pool);
+
+    if (rc < 0 ||
+        storageBackendLocalUpdateVols(pool, &job, before) < 0)
+        goto cleanup;
+
+    storageBackendProbeCachePrune(def->target.path, job.generation);
+
+    if (storageBackendRefreshLocalPool(pool) < 0)
+        goto cleanup;
+
+    storageBackendLocalWatchAdd(pool);
+
+    ret = 0;
+ cleanup:
+    VIR_DIR_CLOSE(dir);
+    virHashFree(before);
+    for (i = 0; i < (int) nvols; i++)
+        virStorageVolDefFree(job.vols[i]);
+    g_free(job.vols);
+    g_free(job.results);
     return ret;
 }
 
 
+/**
+ * virStorageBackendRefreshLocalVol:
+ * @pool: locked pool object
+ * @name: name of a file in the directory of @pool
+ *
+ * Update, add or remove the volume @name of a local pool after its
+ * file changed behind our back, leaving all other volumes alone.
+ * Volumes which are being built or are in use are not touched.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virStorageBackendRefreshLocalVol(virStoragePoolObjPtr pool,
+                                 const char *name)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    g_autoptr(virStorageVolDef) vol = NULL;
+    virStorageVolDefPtr old;
+    unsigned long long generation;
+    int rc;
+
+    if ((old = virStorageVolDefFindByName(pool, name)) &&
+        (old->building || old->in_use > 0)) {
+        VIR_DEBUG("Volume '%s' is busy, not refreshing it", name);
+        return 0;
+    }
+
+    if (!(vol = storageBackendLocalVolNew(def, name)))
+        return -1;
+
+    virMutexLock(&storageBackendProbeCacheLock);
+    generation = storageBackendProbeCacheGeneration;
+    virMutexUnlock(&storageBackendProbeCacheLock);
+
+    if ((rc = storageBackendRefreshLocalProbe(vol, generation)) == -1)
+        return -1;
+
+    if (old)
+        virStoragePoolObjRemoveVol(pool, old);
+
+    /* -2 means the file is gone or isn't a volume anymore */
+    if (rc == 0) {
+        if (virStoragePoolObjAddVol(pool, vol) < 0)
+            return -1;
+        vol = NULL;
+    }
+
+    return storageBackendRefreshLocalPool(pool);
+}
+
+
+/**
+ * virStorageBackendStopLocal:
+ * @pool: pool object
+ *
+ * Stop tracking changes to the directory of a local pool.
+ *
+ * Returns 0.
+ */
+int
+virStorageBackendStopLocal(virStoragePoolObjPtr pool)
+{
+    storageBackendLocalWatchRemove(pool);
+    return 0;
+}
+
+
 static char *
 virStorageBackendSCSISerial(const char *dev,
                             bool isNPIV)
@@ -47,6 +47,15 @@ virStorageBackendCreateVolUsingQemuImg(virStoragePoolObjPtr pool,
                                        virStorageVolDefPtr inputvol,
                                        unsigned int flags);
 
+int
+virStorageBackendCopyToFD(virStorageVolDefPtr vol,
+                          virStorageVolDefPtr inputvol,
+                          int fd,
+                          unsigned long long *total,
+                          bool want_sparse,
+                          bool reflink_copy)
+    ATTRIBUTE_NONNULL(2);
+
 virStorageBackendBuildVolFrom
 virStorageBackendGetBuildVolFromFunction(virStorageVolDefPtr vol,
                                          virStorageVolDefPtr inputvol);
@@ -105,6 +114,17 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol);
 
 int virStorageBackendRefreshLocal(virStoragePoolObjPtr pool);
 
+int virStorageBackendRefreshLocalVol(virStoragePoolObjPtr pool,
+                                     const char *name);
+
+int virStorageBackendStopLocal(virStoragePoolObjPtr pool);
+
+typedef void (*virStorageBackendLocalChangeFunc)(const char *poolname,
+                                                 const char *volname);
+
+void
+virStorageBackendLocalSetChangeCallback(virStorageBackendLocalChangeFunc cb);
+
 int virStorageUtilGlusterExtractPoolSources(const char *host,
                                             const char *xml,
                                             virStoragePoolSourceListPtr list,
@@ -35,9 +35,12 @@
 #include "virrandom.h"
 #include "virstring.h"
 #include "virgettext.h"
+#include "virlog.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
+VIR_LOG_INIT("util.iohelper");
+
 #ifndef O_DIRECT
 # define O_DIRECT 0
 #endif
@@ -53,8 +56,11 @@ runIO(const char *path, int fd, int oflags)
     int fdin, fdout;
     const char *fdinname, *fdoutname;
     unsigned long long total = 0;
+    unsigned long long spliced = 0;
     bool direct = O_DIRECT && ((oflags & O_DIRECT) != 0);
+    bool eof = false;
     off_t end = 0;
+    gint64 start;
 
 #if HAVE_POSIX_MEMALIGN
     if (posix_memalign(&base, alignMask + 1, buflen)) {
@@ -105,7 +111,32 @@ runIO(const char *path, int fd, int oflags)
         goto cleanup;
     }
 
-    while (1) {
+    start = g_get_monotonic_time();
+
+    /* Let the kernel move the data between the file and the pipe. With
+     * O_DIRECT the transfers have to go through the aligned buffer. */
+    while (!direct) {
+        ssize_t got;
+
+        if ((got = virFileSplice(fdin, fdout, buflen)) < 0) {
+            if (errno == ENOSYS)
+                break;
+
+            virReportSystemError(errno, _("Unable to copy %s to %s"),
+                                 fdinname, fdoutname);
+            goto cleanup;
+        }
+
+        if (got == 0) {
+            eof = true;
+            break;
+        }
+
+        total += got;
+        spliced += got;
+    }
+
+    while (!eof) {
         ssize_t got;
 
         /* If we read with O_DIRECT from file we can't use saferead as
@@ -165,6 +196,10 @@ runIO(const char *path, int fd, int oflags)
         }
     }
 
+    VIR_DEBUG("%s: transferred %llu bytes (%llu in kernel) in %lld ms",
+              path, total, spliced,
+              (long long) ((g_get_monotonic_time() - start) / 1000));
+
     ret = 0;
 
  cleanup:
@@ -204,6 +239,8 @@ main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    virLogSetFromEnv();
+
     path = argv[1];
 
     if (argc > 1 && STREQ(argv[1], "--help"))
@@ -127,19 +127,130 @@ virBufferInitialize(virBufferPtr buf)
 static void
 virBufferApplyIndent(virBufferPtr buf)
 {
-    const char space[] = "                               ";
-    size_t spacesz = sizeof(space) - 1;
     size_t toindent = virBufferGetEffectiveIndent(buf);
+    size_t len = buf->str->len;
 
     if (toindent == 0)
         return;
 
-    while (toindent > spacesz) {
-        g_string_append_len(buf->str, space, spacesz);
-        toindent -= spacesz;
+    g_string_set_size(buf->str, len + toindent);
+    memset(buf->str->str + len, ' ', toindent);
+}
+
+
+/* Characters that need to be escaped or dropped in XML text and
+ * attribute values, see virBufferEscapeString */
+static const char virBufferXMLForbiddenChars[] = {
+    0x01,   0x02,   0x03,   0x04,   0x05,   0x06,   0x07,   0x08,
+    /*\t*/  /*\n*/  0x0B,   0x0C,   /*\r*/  0x0E,   0x0F,   0x10,
+    0x11,   0x12,   0x13,   0x14,   0x15,   0x16,   0x17,   0x18,
+    0x19,   '"',    '&',    '\'',   '<',    '>',
+    '\0'
+};
+
+
+/**
+ * virBufferAppendEscapedXML:
+ * @str: the string to append to
+ * @value: the string to escape
+ *
+ * Append @value escaped for use in XML to @str in runs between the
+ * characters that need escaping, without a temporary copy.
+ */
+static void
+virBufferAppendEscapedXML(GString *str, const char *value)
+{
+    while (*value) {
+        size_t len = strcspn(value, virBufferXMLForbiddenChars);
+
+        g_string_append_len(str, value, len);
+        value += len;
+
+        switch (*value) {
+        case '\0':
+            return;
+        case '<':
+            g_string_append_len(str, "&lt;", 4);
+            break;
+        case '>':
+            g_string_append_len(str, "&gt;", 4);
+            break;
+        case '&':
+            g_string_append_len(str, "&amp;", 5);
+            break;
+        case '"':
+            g_string_append_len(str, "&quot;", 6);
+            break;
+        case '\'':
+            g_string_append_len(str, "&apos;", 6);
+            break;
+        default:
+            /* silently ignore control characters */
+            break;
+        }
+        value++;
+    }
+}
+
+
+/**
+ * virBufferFormatUInt:
+ * @end: pointer right behind the space for the digits
+ * @val: the number to format
+ *
+ * Write the decimal digits of @val backwards from @end, which needs to
+ * have VIR_INT64_STR_BUFLEN bytes in front of it.
+ *
+ * Returns a pointer to the first digit.
+ */
+static char *
+virBufferFormatUInt(char *end, unsigned long long val)
+{
+    do {
+        *--end = '0' + val % 10;
+        val /= 10;
+    } while (val);
+
+    return end;
+}
+
+
+static void
+virBufferAppendInt(GString *str, long long val)
+{
+    char digits[VIR_INT64_STR_BUFLEN];
+    char *end = digits + sizeof(digits);
+    char *start;
+
+    if (val < 0) {
+        start = virBufferFormatUInt(end, -(unsigned long long)val);
+        *--start = '-';
+    } else {
+        start = virBufferFormatUInt(end, val);
     }
 
-    g_string_append_len(buf->str, space, toindent);
+    g_string_append_len(str, start, end - start);
+}
+
+
+static void
+virBufferAppendUInt(GString *str, unsigned long long val)
+{
+    char digits[VIR_INT64_STR_BUFLEN];
+    char *end = digits + sizeof(digits);
+    char *start = virBufferFormatUInt(end, val);
+
+    g_string_append_len(str, start, end - start);
+}
+
+
+/* Start an attribute, that is append " @name='" */
+static void
+virBufferAppendAttrName(GString *str, const char *name)
+{
+    g_string_append_c(str, ' ');
+    g_string_append(str, name);
+    g_string_append_len(str, "='", 2);
 }
 
 
@@ -209,6 +320,92 @@ virBufferAddChar(virBufferPtr buf, char c)
     virBufferAdd(buf, &c, 1);
 }
 
+/**
+ * virBufferAddInt:
+ * @buf: the buffer to append to
+ * @val: the number to add
+ *
+ * Add @val in decimal to a buffer, like virBufferAsprintf(buf, "%lld", val)
+ * but without going through printf.  Auto indentation may be applied.
+ */
+void
+virBufferAddInt(virBufferPtr buf, long long val)
+{
+    if (!buf)
+        return;
+
+    virBufferInitialize(buf);
+    virBufferApplyIndent(buf);
+
+    virBufferAppendInt(buf->str, val);
+}
+
+/**
+ * virBufferAddUInt:
+ * @buf: the buffer to append to
+ * @val: the number to add
+ *
+ * Add @val in decimal to a buffer, like virBufferAsprintf(buf, "%llu", val)
+ * but without going through printf.  Auto indentation may be applied.
+ */
+void
+virBufferAddUInt(virBufferPtr buf, unsigned long long val)
+{
+    if (!buf)
+        return;
+
+    virBufferInitialize(buf);
+    virBufferApplyIndent(buf);
+
+    virBufferAppendUInt(buf->str, val);
+}
+
+/**
+ * virBufferAddIntAttr:
+ * @buf: the buffer to append to
+ * @name: name of the attribute
+ * @val: value of the attribute
+ *
+ * Append " @name='@val'" with @val in decimal to a buffer.  Auto
+ * indentation may be applied.
+ */
+void
+virBufferAddIntAttr(virBufferPtr buf, const char *name, long long val)
+{
+    if (!buf || !name)
+        return;
+
+    virBufferInitialize(buf);
+    virBufferApplyIndent(buf);
+
+    virBufferAppendAttrName(buf->str, name);
+    virBufferAppendInt(buf->str, val);
+    g_string_append_c(buf->str, '\'');
+}
+
+/**
+ * virBufferAddUIntAttr:
+ * @buf: the buffer to append to
+ * @name: name of the attribute
+ * @val: value of the attribute
+ *
+ * Append " @name='@val'" with @val in decimal to a buffer.  Auto
+ * indentation may be applied.
+ */
+void
+virBufferAddUIntAttr(virBufferPtr buf, const char *name, unsigned long long val)
+{
+    if (!buf || !name)
+        return;
+
+    virBufferInitialize(buf);
+    virBufferApplyIndent(buf);
+
+    virBufferAppendAttrName(buf->str, name);
+    virBufferAppendUInt(buf->str, val);
+    g_string_append_c(buf->str, '\'');
+}
+
 /**
  * virBufferCurrentContent:
  * @buf: Buffer
@@ -347,19 +544,27 @@ virBufferEscapeString(virBufferPtr buf, const char *format, const char *str)
     g_autofree char *escaped = NULL;
     char *out;
     const char *cur;
-    const char forbidden_characters[] = {
-        0x01,   0x02,   0x03,   0x04,   0x05,   0x06,   0x07,   0x08,
-        /*\t*/  /*\n*/  0x0B,   0x0C,   /*\r*/  0x0E,   0x0F,   0x10,
-        0x11,   0x12,   0x13,   0x14,   0x15,   0x16,   0x17,   0x18,
-        0x19,   '"',    '&',    '\'',   '<',    '>',
-        '\0'
-    };
+    const char *conv;
 
     if ((format == NULL) || (buf == NULL) || (str == NULL))
         return;
 
+    /* Almost all callers pass a format with a single %s and nothing
+     * else to expand, copy that around @str instead of printing it */
+    if ((conv = strstr(format, "%s")) &&
+        !memchr(format, '%', conv - format) &&
+        !strchr(conv + 2, '%')) {
+        virBufferInitialize(buf);
+        virBufferApplyIndent(buf);
+
+        g_string_append_len(buf->str, format, conv - format);
+        virBufferAppendEscapedXML(buf->str, str);
+        g_string_append(buf->str, conv + 2);
+        return;
+    }
+
     len = strlen(str);
-    if (strcspn(str, forbidden_characters) == len) {
+    if (strcspn(str, virBufferXMLForbiddenChars) == len) {
         virBufferAsprintf(buf, format, str);
         return;
     }
@@ -399,7 +604,7 @@ virBufferEscapeString(virBufferPtr buf, const char *format, const char *str)
             *out++ = 'o';
             *out++ = 's';
             *out++ = ';';
-        } else if (!strchr(forbidden_characters, *cur)) {
+        } else if (!strchr(virBufferXMLForbiddenChars, *cur)) {
             /*
              * default case, just copy !
              * Note that character over 0x80 are likely to give problem
@@ -417,6 +622,32 @@ virBufferEscapeString(virBufferPtr buf, const char *format, const char *str)
     virBufferAsprintf(buf, format, escaped);
 }
 
+
+/**
+ * virBufferEscapeAttr:
+ * @buf: the buffer to append to
+ * @name: name of the attribute
+ * @value: value of the attribute, escaped for use in XML
+ *
+ * Append " @name='@value'" to @buf, the same output as
+ * virBufferEscapeString(buf, " name='%s'", value) without having to
+ * parse a format string.  If @value is NULL, nothing is added.  Auto
+ * indentation may be applied.
+ */
+void
+virBufferEscapeAttr(virBufferPtr buf, const char *name, const char *value)
+{
+    if (!buf || !name || !value)
+        return;
+
+    virBufferInitialize(buf);
+    virBufferApplyIndent(buf);
+
+    virBufferAppendAttrName(buf->str, name);
+    virBufferAppendEscapedXML(buf->str, value);
+    g_string_append_c(buf->str, '\'');
+}
+
 /**
  * virBufferEscapeSexpr:
  * @buf: the buffer to append to
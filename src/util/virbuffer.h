@@ -59,6 +59,11 @@ size_t virBufferUse(const virBuffer *buf);
 void virBufferAdd(virBufferPtr buf, const char *str, int len);
 void virBufferAddBuffer(virBufferPtr buf, virBufferPtr toadd);
 void virBufferAddChar(virBufferPtr buf, char c);
+void virBufferAddInt(virBufferPtr buf, long long val);
+void virBufferAddUInt(virBufferPtr buf, unsigned long long val);
+void virBufferAddIntAttr(virBufferPtr buf, const char *name, long long val);
+void virBufferAddUIntAttr(virBufferPtr buf, const char *name,
+                          unsigned long long val);
 void virBufferAsprintf(virBufferPtr buf, const char *format, ...)
   G_GNUC_PRINTF(2, 3);
 void virBufferVasprintf(virBufferPtr buf, const char *format, va_list ap)
@@ -71,6 +76,8 @@ void virBufferEscape(virBufferPtr buf, char escape, const char *toescape,
                      const char *format, const char *str);
 void virBufferEscapeString(virBufferPtr buf, const char *format,
                            const char *str);
+void virBufferEscapeAttr(virBufferPtr buf, const char *name,
+                         const char *value);
 void virBufferEscapeSexpr(virBufferPtr buf, const char *format,
                           const char *str);
 void virBufferEscapeRegex(virBufferPtr buf,
@@ -102,6 +102,27 @@ virCgroupGetDevicePermsString(int perms)
 }
 
 
+/* Largest cgroup file virCgroupStatsReader is willing to read */
+#define VIR_CGROUP_STATS_MAX_SIZE (1024 * 1024)
+
+typedef struct _virCgroupStatsReaderFile virCgroupStatsReaderFile;
+typedef virCgroupStatsReaderFile *virCgroupStatsReaderFilePtr;
+struct _virCgroupStatsReaderFile {
+    int fd;
+    char *path;
+    virCgroupStatsParseCB parse;
+};
+
+struct _virCgroupStatsReader {
+    virCgroupStatsReaderFilePtr files;
+    size_t nfiles;
+
+    /* Shared by all files, grown on demand */
+    char *buf;
+    size_t bufsize;
+};
+
+
 #ifdef __linux__
 bool
 virCgroupAvailable(void)
@@ -2776,6 +2797,246 @@ virCgroupControllerAvailable(int controller)
     return ret;
 }
 
+
+/**
+ * virCgroupStatsParseKeys:
+ * @buf: contents of a cgroup file made of "key value" lines
+ * @keys: names of the keys to look for
+ * @values: filled with the values of @keys
+ * @nkeys: number of items in @keys and @values
+ *
+ * Parse @buf without modifying or copying it. Values of keys missing
+ * from @buf are left untouched.
+ *
+ * Returns the number of keys found or -1 on error.
+ */
+int
+virCgroupStatsParseKeys(const char *buf,
+                        const char *const *keys,
+                        unsigned long long *values,
+                        size_t nkeys)
+{
+    const char *line = buf;
+    int found = 0;
+
+    while (*line) {
+        const char *eol = strchr(line, '\n');
+        const char *sep;
+        size_t i;
+
+        if (!eol)
+            eol = line + strlen(line);
+
+        if (!(sep = memchr(line, ' ', eol - line))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Cannot parse cgroup stats line '%.*s'"),
+                           (int)(eol - line), line);
+            return -1;
+        }
+
+        for (i = 0; i < nkeys; i++) {
+            if (strlen(keys[i]) == (size_t)(sep - line) &&
+                STREQLEN(line, keys[i], sep - line))
+                break;
+        }
+
+        if (i < nkeys) {
+            char *end;
+
+            if (virStrToLong_ull(sep + 1, &end, 10, &values[i]) < 0 ||
+                end != eol) {
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("Unable to parse '%.*s' as an integer"),
+                               (int)(eol - sep - 1), sep + 1);
+                return -1;
+            }
+            found++;
+        }
+
+        if (!*eol)
+            break;
+        line = eol + 1;
+    }
+
+    return found;
+}
+
+
+/**
+ * virCgroupStatsSumField:
+ * @buf: contents of a cgroup file
+ * @field: prefix of the values to sum, e.g. "rbytes="
+ * @sum: filled with the sum
+ *
+ * Sum up the values following every occurrence of @field in @buf,
+ * which is how per-device blkio statistics are added up.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virCgroupStatsSumField(const char *buf,
+                       const char *field,
+                       long long *sum)
+{
+    const char *p = buf;
+
+    *sum = 0;
+
+    while ((p = strstr(p, field))) {
+        long long val;
+        char *end;
+
+        p += strlen(field);
+        if (virStrToLong_ll(p, &end, 10, &val) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Cannot parse '%s' stat '%s'"), field, p);
+            return -1;
+        }
+
+        if (val < 0 || (val > 0 && *sum > (LLONG_MAX - val))) {
+            virReportError(VIR_ERR_OVERFLOW,
+                           _("Sum of '%s' stat overflows"), field);
+            return -1;
+        }
+        *sum += val;
+        p = end;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virCgroupStatsReaderNew:
+ * @group: the cgroup to sample
+ * @flags: bitwise-OR of virCgroupStatsFlags
+ *
+ * Open every file of @group needed for the statistics selected by
+ * @flags, whichever backend provides the controller. The files stay
+ * open so that virCgroupStatsReaderRead costs a single pread() per
+ * file. The reader does not keep a reference to @group.
+ *
+ * Returns the reader or NULL on error.
+ */
+virCgroupStatsReaderPtr
+virCgroupStatsReaderNew(virCgroupPtr group,
+                        unsigned int flags)
+{
+    g_autoptr(virCgroupStatsReader) reader = g_new0(virCgroupStatsReader, 1);
+    unsigned int found = 0;
+    size_t i;
+
+    reader->bufsize = 4096;
+    reader->buf = g_new0(char, reader->bufsize);
+
+    for (i = 0; i < VIR_CGROUP_BACKEND_TYPE_LAST; i++) {
+        virCgroupBackendPtr backend = group->backends[i];
+        const virCgroupStatsFile *file;
+
+        if (!backend || !backend->statsFiles)
+            continue;
+
+        for (file = backend->statsFiles; file->name; file++) {
+            virCgroupStatsReaderFile entry = { .fd = -1, .parse = file->parse };
+
+            if (!(file->flags & flags) ||
+                virCgroupBackendForController(group, file->controller) != backend)
+                continue;
+
+            if (virCgroupPathOfController(group, file->controller,
+                                          file->name, &entry.path) < 0)
+                return NULL;
+
+            VIR_DEBUG("Open stats file %s", entry.path);
+
+            if ((entry.fd = open(entry.path, O_RDONLY | O_CLOEXEC)) < 0) {
+                virReportSystemError(errno, _("Unable to open '%s'"),
+                                     entry.path);
+                g_free(entry.path);
+                return NULL;
+            }
+
+            if (VIR_APPEND_ELEMENT(reader->files, reader->nfiles, entry) < 0) {
+                VIR_FORCE_CLOSE(entry.fd);
+                g_free(entry.path);
+                return NULL;
+            }
+            found |= file->flags;
+        }
+    }
+
+    if (flags & ~found) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("cgroup statistics 0x%x are not available"),
+                       flags & ~found);
+        return NULL;
+    }
+
+    return g_steal_pointer(&reader);
+}
+
+
+static int
+virCgroupStatsReaderReadFile(virCgroupStatsReaderPtr reader,
+                             virCgroupStatsReaderFilePtr file)
+{
+    size_t len = 0;
+    ssize_t got;
+
+    while ((got = pread(file->fd, reader->buf + len,
+                        reader->bufsize - len - 1, len)) > 0) {
+        len += got;
+
+        if (len < reader->bufsize - 1)
+            continue;
+
+        if (reader->bufsize >= VIR_CGROUP_STATS_MAX_SIZE) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("cgroup file '%s' is too large"), file->path);
+            return -1;
+        }
+        reader->bufsize *= 2;
+        reader->buf = g_renew(char, reader->buf, reader->bufsize);
+    }
+
+    if (got < 0) {
+        virReportSystemError(errno, _("Unable to read from '%s'"),
+                             file->path);
+        return -1;
+    }
+
+    reader->buf[len] = '\0';
+    return 0;
+}
+
+
+/**
+ * virCgroupStatsReaderRead:
+ * @reader: reader created by virCgroupStatsReaderNew
+ * @stats: filled with the current statistics
+ *
+ * Sample all the files of @reader. Only the fields selected when
+ * creating @reader are filled in, the rest are zeroed.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virCgroupStatsReaderRead(virCgroupStatsReaderPtr reader,
+                         virCgroupStatsPtr stats)
+{
+    size_t i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (i = 0; i < reader->nfiles; i++) {
+        if (virCgroupStatsReaderReadFile(reader, &reader->files[i]) < 0 ||
+            reader->files[i].parse(reader->buf, stats) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
 #else /* !__linux__ */
 
 bool
@@ -3530,6 +3791,26 @@ virCgroupControllerAvailable(int controller G_GNUC_UNUSED)
 {
     return false;
 }
+
+
+virCgroupStatsReaderPtr
+virCgroupStatsReaderNew(virCgroupPtr group G_GNUC_UNUSED,
+                        unsigned int flags G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return NULL;
+}
+
+
+int
+virCgroupStatsReaderRead(virCgroupStatsReaderPtr reader G_GNUC_UNUSED,
+                         virCgroupStatsPtr stats G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return -1;
+}
 #endif /* !__linux__ */
 
 
@@ -3560,6 +3841,30 @@ virCgroupFree(virCgroupPtr *group)
 }
 
 
+/**
+ * virCgroupStatsReaderFree:
+ *
+ * @reader: The reader to free
+ */
+void
+virCgroupStatsReaderFree(virCgroupStatsReaderPtr reader)
+{
+    size_t i;
+
+    if (!reader)
+        return;
+
+    for (i = 0; i < reader->nfiles; i++) {
+        VIR_FORCE_CLOSE(reader->files[i].fd);
+        g_free(reader->files[i].path);
+    }
+
+    g_free(reader->files);
+    g_free(reader->buf);
+    g_free(reader);
+}
+
+
 int
 virCgroupDelThread(virCgroupPtr cgroup,
                    virCgroupThreadName nameval,
@@ -239,6 +239,46 @@ int virCgroupGetCpuacctPercpuUsage(virCgroupPtr group, char **usage);
 int virCgroupGetCpuacctStat(virCgroupPtr group, unsigned long long *user,
                             unsigned long long *sys);
 
+typedef enum {
+    VIR_CGROUP_STATS_CPU = (1 << 0),
+    VIR_CGROUP_STATS_MEMORY = (1 << 1),
+    VIR_CGROUP_STATS_BLKIO = (1 << 2),
+} virCgroupStatsFlags;
+
+typedef struct _virCgroupStats virCgroupStats;
+typedef virCgroupStats *virCgroupStatsPtr;
+struct _virCgroupStats {
+    /* VIR_CGROUP_STATS_CPU, in nanoseconds */
+    unsigned long long cpuTime;
+    unsigned long long cpuUser;
+    unsigned long long cpuSystem;
+
+    /* VIR_CGROUP_STATS_MEMORY, in KiB */
+    unsigned long long memCache;
+    unsigned long long memActiveAnon;
+    unsigned long long memInactiveAnon;
+    unsigned long long memActiveFile;
+    unsigned long long memInactiveFile;
+    unsigned long long memUnevictable;
+
+    /* VIR_CGROUP_STATS_BLKIO, summed over all devices */
+    long long blkioBytesRead;
+    long long blkioBytesWrite;
+    long long blkioRequestsRead;
+    long long blkioRequestsWrite;
+};
+
+typedef struct _virCgroupStatsReader virCgroupStatsReader;
+typedef virCgroupStatsReader *virCgroupStatsReaderPtr;
+
+virCgroupStatsReaderPtr virCgroupStatsReaderNew(virCgroupPtr group,
+                                                unsigned int flags);
+void virCgroupStatsReaderFree(virCgroupStatsReaderPtr reader);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virCgroupStatsReader, virCgroupStatsReaderFree);
+
+int virCgroupStatsReaderRead(virCgroupStatsReaderPtr reader,
+                             virCgroupStatsPtr stats);
+
 int virCgroupSetFreezerState(virCgroupPtr group, const char *state);
 int virCgroupGetFreezerState(virCgroupPtr group, char **state);
 
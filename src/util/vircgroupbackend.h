@@ -360,6 +360,19 @@ typedef int
 (*virCgroupGetCpusetCpusCB)(virCgroupPtr group,
                             char **cpus);
 
+typedef int
+(*virCgroupStatsParseCB)(const char *buf,
+                         virCgroupStatsPtr stats);
+
+/* A cgroup file read by virCgroupStatsReader */
+typedef struct _virCgroupStatsFile virCgroupStatsFile;
+struct _virCgroupStatsFile {
+    unsigned int flags; /* virCgroupStatsFlags the file provides */
+    int controller;
+    const char *name;
+    virCgroupStatsParseCB parse;
+};
+
 struct _virCgroupBackend {
     virCgroupBackendType type;
 
@@ -437,6 +450,9 @@ struct _virCgroupBackend {
     virCgroupGetCpusetMemoryMigrateCB getCpusetMemoryMigrate;
     virCgroupSetCpusetCpusCB setCpusetCpus;
     virCgroupGetCpusetCpusCB getCpusetCpus;
+
+    /* Files providing virCgroupStats, terminated by an entry with NULL name */
+    const virCgroupStatsFile *statsFiles;
 };
 typedef struct _virCgroupBackend virCgroupBackend;
 typedef virCgroupBackend *virCgroupBackendPtr;
@@ -104,6 +104,15 @@ int virCgroupGetValueI64(virCgroupPtr group,
                          const char *key,
                          long long int *value);
 
+int virCgroupStatsParseKeys(const char *buf,
+                            const char *const *keys,
+                            unsigned long long *values,
+                            size_t nkeys);
+
+int virCgroupStatsSumField(const char *buf,
+                           const char *field,
+                           long long *sum);
+
 int virCgroupPartitionEscape(char **path);
 
 char *virCgroupGetBlockDevString(const char *path);
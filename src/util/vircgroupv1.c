@@ -1963,6 +1963,29 @@ virCgroupV1GetCpuacctPercpuUsage(virCgroupPtr group,
 }
 
 
+/* times reported are in system ticks (generally 100 Hz), but that
+ * rate can theoretically vary between machines.  Scale things
+ * into approximate nanoseconds.  */
+static int
+virCgroupV1GetTickScale(double *ret)
+{
+    static double scale = -1.0;
+
+    if (scale < 0) {
+        long ticks_per_sec = sysconf(_SC_CLK_TCK);
+        if (ticks_per_sec == -1) {
+            virReportSystemError(errno, "%s",
+                                 _("Cannot determine system clock HZ"));
+            return -1;
+        }
+        scale = 1000000000.0 / ticks_per_sec;
+    }
+
+    *ret = scale;
+    return 0;
+}
+
+
 static int
 virCgroupV1GetCpuacctStat(virCgroupPtr group,
                           unsigned long long *user,
@@ -1970,7 +1993,7 @@ virCgroupV1GetCpuacctStat(virCgroupPtr group,
 {
     g_autofree char *str = NULL;
     char *p;
-    static double scale = -1.0;
+    double scale;
 
     if (virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
                              "cpuacct.stat", &str) < 0)
@@ -1990,18 +2013,8 @@ virCgroupV1GetCpuacctStat(virCgroupPtr group,
                        p);
         return -1;
     }
-    /* times reported are in system ticks (generally 100 Hz), but that
-     * rate can theoretically vary between machines.  Scale things
-     * into approximate nanoseconds.  */
-    if (scale < 0) {
-        long ticks_per_sec = sysconf(_SC_CLK_TCK);
-        if (ticks_per_sec == -1) {
-            virReportSystemError(errno, "%s",
-                                 _("Cannot determine system clock HZ"));
-            return -1;
-        }
-        scale = 1000000000.0 / ticks_per_sec;
-    }
+    if (virCgroupV1GetTickScale(&scale) < 0)
+        return -1;
     *user *= scale;
     *sys *= scale;
 
@@ -2098,6 +2111,115 @@ virCgroupV1GetCpusetCpus(virCgroupPtr group,
 }
 
 
+static int
+virCgroupV1ParseCpuacctUsage(const char *buf,
+                             virCgroupStatsPtr stats)
+{
+    char *end;
+
+    if (virStrToLong_ull(buf, &end, 10, &stats->cpuTime) < 0 ||
+        (*end && *end != '\n')) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Cannot parse cpu usage stat '%s'"), buf);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virCgroupV1ParseCpuacctStat(const char *buf,
+                            virCgroupStatsPtr stats)
+{
+    const char *const keys[] = { "user", "system" };
+    unsigned long long values[G_N_ELEMENTS(keys)];
+    double scale;
+    int rc;
+
+    if ((rc = virCgroupStatsParseKeys(buf, keys, values,
+                                      G_N_ELEMENTS(keys))) < 0)
+        return -1;
+
+    if (rc != G_N_ELEMENTS(keys)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Cannot parse cpu stat '%s'"), buf);
+        return -1;
+    }
+
+    if (virCgroupV1GetTickScale(&scale) < 0)
+        return -1;
+
+    stats->cpuUser = values[0] * scale;
+    stats->cpuSystem = values[1] * scale;
+
+    return 0;
+}
+
+
+static int
+virCgroupV1ParseMemoryStat(const char *buf,
+                           virCgroupStatsPtr stats)
+{
+    const char *const keys[] = {
+        "cache", "active_anon", "inactive_anon",
+        "active_file", "inactive_file", "unevictable",
+    };
+    unsigned long long values[G_N_ELEMENTS(keys)] = { 0 };
+
+    if (virCgroupStatsParseKeys(buf, keys, values, G_N_ELEMENTS(keys)) < 0)
+        return -1;
+
+    stats->memCache = values[0] >> 10;
+    stats->memActiveAnon = values[1] >> 10;
+    stats->memInactiveAnon = values[2] >> 10;
+    stats->memActiveFile = values[3] >> 10;
+    stats->memInactiveFile = values[4] >> 10;
+    stats->memUnevictable = values[5] >> 10;
+
+    return 0;
+}
+
+
+static int
+virCgroupV1ParseBlkioServiceBytes(const char *buf,
+                                  virCgroupStatsPtr stats)
+{
+    if (virCgroupStatsSumField(buf, " Read ", &stats->blkioBytesRead) < 0 ||
+        virCgroupStatsSumField(buf, " Write ", &stats->blkioBytesWrite) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virCgroupV1ParseBlkioServiced(const char *buf,
+                              virCgroupStatsPtr stats)
+{
+    if (virCgroupStatsSumField(buf, " Read ", &stats->blkioRequestsRead) < 0 ||
+        virCgroupStatsSumField(buf, " Write ", &stats->blkioRequestsWrite) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static const virCgroupStatsFile virCgroupV1StatsFiles[] = {
+    { VIR_CGROUP_STATS_CPU, VIR_CGROUP_CONTROLLER_CPUACCT,
+      "cpuacct.usage", virCgroupV1ParseCpuacctUsage },
+    { VIR_CGROUP_STATS_CPU, VIR_CGROUP_CONTROLLER_CPUACCT,
+      "cpuacct.stat", virCgroupV1ParseCpuacctStat },
+    { VIR_CGROUP_STATS_MEMORY, VIR_CGROUP_CONTROLLER_MEMORY,
+      "memory.stat", virCgroupV1ParseMemoryStat },
+    { VIR_CGROUP_STATS_BLKIO, VIR_CGROUP_CONTROLLER_BLKIO,
+      "blkio.throttle.io_service_bytes", virCgroupV1ParseBlkioServiceBytes },
+    { VIR_CGROUP_STATS_BLKIO, VIR_CGROUP_CONTROLLER_BLKIO,
+      "blkio.throttle.io_serviced", virCgroupV1ParseBlkioServiced },
+    { 0, 0, NULL, NULL },
+};
+
+
 virCgroupBackend virCgroupV1Backend = {
     .type = VIR_CGROUP_BACKEND_TYPE_V1,
 
@@ -2173,6 +2295,8 @@ virCgroupBackend virCgroupV1Backend = {
     .getCpusetMemoryMigrate = virCgroupV1GetCpusetMemoryMigrate,
     .setCpusetCpus = virCgroupV1SetCpusetCpus,
     .getCpusetCpus = virCgroupV1GetCpusetCpus,
+
+    .statsFiles = virCgroupV1StatsFiles,
 };
 
 
@@ -1835,6 +1835,81 @@ virCgroupV2DenyAllDevices(virCgroupPtr group)
 }
 
 
+static int
+virCgroupV2ParseCpuStat(const char *buf,
+                        virCgroupStatsPtr stats)
+{
+    const char *const keys[] = { "usage_usec", "user_usec", "system_usec" };
+    unsigned long long values[G_N_ELEMENTS(keys)];
+    int rc;
+
+    if ((rc = virCgroupStatsParseKeys(buf, keys, values,
+                                      G_N_ELEMENTS(keys))) < 0)
+        return -1;
+
+    if (rc != G_N_ELEMENTS(keys)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse cpu stat '%s'"), buf);
+        return -1;
+    }
+
+    stats->cpuTime = values[0] * 1000;
+    stats->cpuUser = values[1] * 1000;
+    stats->cpuSystem = values[2] * 1000;
+
+    return 0;
+}
+
+
+static int
+virCgroupV2ParseMemoryStat(const char *buf,
+                           virCgroupStatsPtr stats)
+{
+    const char *const keys[] = {
+        "file", "active_anon", "inactive_anon",
+        "active_file", "inactive_file", "unevictable",
+    };
+    unsigned long long values[G_N_ELEMENTS(keys)] = { 0 };
+
+    if (virCgroupStatsParseKeys(buf, keys, values, G_N_ELEMENTS(keys)) < 0)
+        return -1;
+
+    stats->memCache = values[0] >> 10;
+    stats->memActiveAnon = values[1] >> 10;
+    stats->memInactiveAnon = values[2] >> 10;
+    stats->memActiveFile = values[3] >> 10;
+    stats->memInactiveFile = values[4] >> 10;
+    stats->memUnevictable = values[5] >> 10;
+
+    return 0;
+}
+
+
+static int
+virCgroupV2ParseIoStat(const char *buf,
+                       virCgroupStatsPtr stats)
+{
+    if (virCgroupStatsSumField(buf, "rbytes=", &stats->blkioBytesRead) < 0 ||
+        virCgroupStatsSumField(buf, "wbytes=", &stats->blkioBytesWrite) < 0 ||
+        virCgroupStatsSumField(buf, "rios=", &stats->blkioRequestsRead) < 0 ||
+        virCgroupStatsSumField(buf, "wios=", &stats->blkioRequestsWrite) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static const virCgroupStatsFile virCgroupV2StatsFiles[] = {
+    { VIR_CGROUP_STATS_CPU, VIR_CGROUP_CONTROLLER_CPUACCT,
+      "cpu.stat", virCgroupV2ParseCpuStat },
+    { VIR_CGROUP_STATS_MEMORY, VIR_CGROUP_CONTROLLER_MEMORY,
+      "memory.stat", virCgroupV2ParseMemoryStat },
+    { VIR_CGROUP_STATS_BLKIO, VIR_CGROUP_CONTROLLER_BLKIO,
+      "io.stat", virCgroupV2ParseIoStat },
+    { 0, 0, NULL, NULL },
+};
+
+
 virCgroupBackend virCgroupV2Backend = {
     .type = VIR_CGROUP_BACKEND_TYPE_V2,
 
@@ -1906,6 +1981,8 @@ virCgroupBackend virCgroupV2Backend = {
     .getCpusetMemoryMigrate = virCgroupV2GetCpusetMemoryMigrate,
     .setCpusetCpus = virCgroupV2SetCpusetCpus,
     .getCpusetCpus = virCgroupV2GetCpusetCpus,
+
+    .statsFiles = virCgroupV2StatsFiles,
 };
 
 
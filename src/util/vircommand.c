@@ -32,6 +32,10 @@
 #endif
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef __linux__
+# include <sched.h>
+# include <sys/syscall.h>
+#endif
 
 #if WITH_CAPNG
 # include <cap-ng.h>
@@ -600,6 +604,272 @@ virCommandMassClose(virCommandPtr cmd,
 
 # endif /* ! __FreeBSD__ */
 
+# ifdef __linux__
+
+#  ifndef __NR_close_range
+#   define __NR_close_range 436
+#  endif
+
+/* Stack used by the child of virExecSpawn until it calls exec */
+#  define VIR_EXEC_SPAWN_STACK_SIZE (64 * 1024)
+
+typedef struct _virExecSpawnData virExecSpawnData;
+typedef virExecSpawnData *virExecSpawnDataPtr;
+struct _virExecSpawnData {
+    virCommandPtr cmd;
+    const char *binary;
+    int childin;
+    int childout;
+    int childerr;
+    int *keepfds; /* sorted FDs above stderr to pass on */
+    size_t nkeepfds;
+
+    /* Set by the child if it fails before or in exec */
+    const char *failed;
+    bool execFailed;
+    int err;
+};
+
+static bool virExecHaveCloseRange;
+
+static int
+virExecSpawnOnceInit(void)
+{
+    /* This only fails if the syscall is missing or filtered out */
+    virExecHaveCloseRange = syscall(__NR_close_range, ~0U, ~0U, 0) == 0;
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virExecSpawn);
+
+
+/*
+ * virExecCanSpawn:
+ * @cmd: command to run
+ *
+ * Check whether nothing but setting up file descriptors needs to happen
+ * between fork and exec of @cmd, so that virExecSpawn can start it.
+ */
+static bool
+virExecCanSpawn(virCommandPtr cmd)
+{
+    if (cmd->hook || cmd->handshake || cmd->pidfile ||
+        cmd->pwd || cmd->mask ||
+        (cmd->flags & (VIR_EXEC_DAEMON | VIR_EXEC_CLEAR_CAPS)) ||
+        cmd->uid != (uid_t)-1 || cmd->gid != (gid_t)-1 ||
+        cmd->capabilities ||
+        cmd->maxMemLock || cmd->maxProcesses || cmd->maxFiles ||
+        cmd->setMaxCore)
+        return false;
+
+#  if defined(WITH_SECDRIVER_SELINUX)
+    if (cmd->seLinuxLabel)
+        return false;
+#  endif
+#  if defined(WITH_SECDRIVER_APPARMOR)
+    if (cmd->appArmorProfile)
+        return false;
+#  endif
+
+    if (virExecSpawnInitialize() < 0)
+        return false;
+
+    return virExecHaveCloseRange;
+}
+
+
+/* The child shares our memory, stick to async-signal-safe calls and
+ * leave reporting of errors to the parent */
+static int
+virExecSpawnChild(void *opaque)
+{
+    virExecSpawnDataPtr data = opaque;
+    virCommandPtr cmd = data->cmd;
+    struct sigaction sig_action;
+    sigset_t mask;
+    unsigned int first = STDERR_FILENO + 1;
+    size_t i;
+
+    /* Signals are blocked by the parent, don't let any of its handlers
+     * run in here once we unblock them. SIGPIPE is no-op until exec
+     * resets it, just like in virFork. */
+    sig_action.sa_handler = SIG_DFL;
+    sig_action.sa_flags = 0;
+    sigemptyset(&sig_action.sa_mask);
+
+    for (i = 1; i < NSIG; i++)
+        ignore_value(sigaction(i, &sig_action, NULL));
+
+    sig_action.sa_handler = virDummyHandler;
+    ignore_value(sigaction(SIGPIPE, &sig_action, NULL));
+
+    sigemptyset(&mask);
+    if (sigprocmask(SIG_SETMASK, &mask, NULL) < 0) {
+        data->failed = "cannot unblock signals";
+        goto error;
+    }
+
+    if (prepareStdFd(data->childin, STDIN_FILENO) < 0) {
+        data->failed = "failed to setup stdin file handle";
+        goto error;
+    }
+    if (data->childout > 0 &&
+        prepareStdFd(data->childout, STDOUT_FILENO) < 0) {
+        data->failed = "failed to setup stdout file handle";
+        goto error;
+    }
+    if (data->childerr > 0 &&
+        prepareStdFd(data->childerr, STDERR_FILENO) < 0) {
+        data->failed = "failed to setup stderr file handle";
+        goto error;
+    }
+
+    /* Close everything above stderr except the FDs we pass on, this
+     * takes a few syscalls regardless of how many FDs are open */
+    for (i = 0; i < data->nkeepfds; i++) {
+        unsigned int fd = data->keepfds[i];
+
+        if (virSetInherit(fd, true) < 0) {
+            data->failed = "failed to preserve fd";
+            goto error;
+        }
+
+        if (fd > first)
+            ignore_value(syscall(__NR_close_range, first, fd - 1, 0));
+        first = fd + 1;
+    }
+    ignore_value(syscall(__NR_close_range, first, ~0U, 0));
+
+    if (cmd->env)
+        execve(data->binary, cmd->args, cmd->env);
+    else
+        execv(data->binary, cmd->args);
+
+    data->execFailed = true;
+    data->err = errno;
+    _exit(errno == ENOENT ? EXIT_ENOENT : EXIT_CANNOT_INVOKE);
+
+ error:
+    data->err = errno;
+    _exit(EXIT_CANCELED);
+}
+
+
+static int
+virExecSpawnCompareFD(const void *a,
+                      const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+
+/*
+ * virExecSpawn:
+ * @cmd: command to run, virExecCanSpawn must be true for it
+ * @binary: resolved path of the binary to execute
+ * @childin: FD to become stdin of the child
+ * @childout: FD to become stdout of the child
+ * @childerr: FD to become stderr of the child
+ *
+ * Start @cmd without copying our address space as fork does, which
+ * gets more and more expensive as the daemon grows. The child runs in
+ * our memory (CLONE_VM) while we are suspended (CLONE_VFORK) until it
+ * calls exec, and closes all FDs it should not inherit with
+ * close_range() rather than one by one.
+ *
+ * Like with virExec, failures in the child result in its exit status.
+ * The reason is written to @childerr, where the child would have
+ * reported it.
+ *
+ * Returns the PID of the child or -1 on error.
+ */
+static pid_t
+virExecSpawn(virCommandPtr cmd,
+             const char *binary,
+             int childin,
+             int childout,
+             int childerr)
+{
+    virExecSpawnData data = {
+        .cmd = cmd,
+        .binary = binary,
+        .childin = childin,
+        .childout = childout,
+        .childerr = childerr,
+    };
+    g_autofree int *keepfds = g_new0(int, cmd->npassfd);
+    g_autofree char *stack = g_new(char, VIR_EXEC_SPAWN_STACK_SIZE);
+    sigset_t oldmask, newmask;
+    int saved_errno;
+    pid_t pid;
+    size_t i;
+
+    for (i = 0; i < cmd->npassfd; i++) {
+        if (cmd->passfd[i].fd > STDERR_FILENO)
+            keepfds[data.nkeepfds++] = cmd->passfd[i].fd;
+    }
+    qsort(keepfds, data.nkeepfds, sizeof(*keepfds), virExecSpawnCompareFD);
+    data.keepfds = keepfds;
+
+    sigfillset(&newmask);
+    if (pthread_sigmask(SIG_SETMASK, &newmask, &oldmask) != 0) {
+        virReportSystemError(errno,
+                             "%s", _("cannot block signals"));
+        return -1;
+    }
+
+    pid = clone(virExecSpawnChild, stack + VIR_EXEC_SPAWN_STACK_SIZE,
+                CLONE_VM | CLONE_VFORK | SIGCHLD, &data);
+    saved_errno = errno;
+
+    ignore_value(pthread_sigmask(SIG_SETMASK, &oldmask, NULL));
+
+    if (pid < 0) {
+        virReportSystemError(saved_errno,
+                             "%s", _("cannot fork child process"));
+        return -1;
+    }
+
+    if (data.failed || data.execFailed) {
+        g_autofree char *msg = NULL;
+
+        if (data.execFailed)
+            msg = g_strdup_printf("cannot execute binary %s: %s\n",
+                                  cmd->args[0], g_strerror(data.err));
+        else
+            msg = g_strdup_printf("%s: %s\n",
+                                  data.failed, g_strerror(data.err));
+
+        VIR_DEBUG("Child %lld failed: %s", (long long) pid, msg);
+        ignore_value(safewrite(childerr, msg, strlen(msg)));
+    }
+
+    return pid;
+}
+
+# else /* !__linux__ */
+
+static bool
+virExecCanSpawn(virCommandPtr cmd G_GNUC_UNUSED)
+{
+    return false;
+}
+
+
+static pid_t
+virExecSpawn(virCommandPtr cmd G_GNUC_UNUSED,
+             const char *binary G_GNUC_UNUSED,
+             int childin G_GNUC_UNUSED,
+             int childout G_GNUC_UNUSED,
+             int childerr G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Spawning processes is not supported on this platform"));
+    return -1;
+}
+
+# endif /* !__linux__ */
+
 /*
  * virExec:
  * @cmd virCommandPtr containing all information about the program to
@@ -620,7 +890,7 @@ virExec(virCommandPtr cmd)
     const char *binary = NULL;
     int ret;
     g_autofree gid_t *groups = NULL;
-    int ngroups;
+    int ngroups = 0;
 
     if (cmd->args[0][0] != '/') {
         if (!(binary = binarystr = virFindFileInPath(cmd->args[0]))) {
@@ -685,10 +955,14 @@ virExec(virCommandPtr cmd)
         childerr = null;
     }
 
-    if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
-        goto cleanup;
+    if (virExecCanSpawn(cmd)) {
+        pid = virExecSpawn(cmd, binary, childin, childout, childerr);
+    } else {
+        if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
+            goto cleanup;
 
-    pid = virFork();
+        pid = virFork();
+    }
 
     if (pid < 0)
         goto cleanup;
@@ -45,6 +45,7 @@ struct virEventGLibHandle
     int fd;
     int events;
     int removed;
+    GMainContext *context;
     GSource *source;
     virEventHandleCallback cb;
     void *opaque;
@@ -56,6 +57,7 @@ struct virEventGLibTimeout
     int timer;
     int interval;
     int removed;
+    GMainContext *context;
     GSource *source;
     virEventTimeoutCallback cb;
     void *opaque;
@@ -124,11 +126,12 @@ virEventGLibHandleDispatch(int fd G_GNUC_UNUSED,
 
 
 static int
-virEventGLibHandleAdd(int fd,
-                      int events,
-                      virEventHandleCallback cb,
-                      void *opaque,
-                      virFreeCallback ff)
+virEventGLibHandleAddInternal(GMainContext *context,
+                              int fd,
+                              int events,
+                              virEventHandleCallback cb,
+                              void *opaque,
+                              virFreeCallback ff)
 {
     struct virEventGLibHandle *data;
     GIOCondition cond = virEventGLibEventsToCondition(events);
@@ -141,16 +144,18 @@ virEventGLibHandleAdd(int fd,
     data->watch = nextwatch++;
     data->fd = fd;
     data->events = events;
+    if (context)
+        data->context = g_main_context_ref(context);
     data->cb = cb;
     data->opaque = opaque;
     data->ff = ff;
 
-    VIR_DEBUG("Add handle data=%p watch=%d fd=%d events=%d opaque=%p",
-              data, data->watch, data->fd, events, data->opaque);
+    VIR_DEBUG("Add handle data=%p watch=%d fd=%d events=%d opaque=%p context=%p",
+              data, data->watch, data->fd, events, data->opaque, context);
 
     if (events != 0) {
         data->source = virEventGLibAddSocketWatch(
-            fd, cond, NULL, virEventGLibHandleDispatch, data, NULL);
+            fd, cond, data->context, virEventGLibHandleDispatch, data, NULL);
     }
 
     g_ptr_array_add(handles, data);
@@ -165,6 +170,52 @@ virEventGLibHandleAdd(int fd,
     return ret;
 }
 
+
+static int
+virEventGLibHandleAdd(int fd,
+                      int events,
+                      virEventHandleCallback cb,
+                      void *opaque,
+                      virFreeCallback ff)
+{
+    return virEventGLibHandleAddInternal(NULL, fd, events, cb, opaque, ff);
+}
+
+
+/**
+ * virEventGLibHandleAddContext:
+ * @context: the main context to watch @fd from
+ * @fd: file descriptor to watch
+ * @events: bitset of VIR_EVENT_HANDLE_* flags
+ * @cb: callback to invoke when an event occurs
+ * @opaque: data to pass to @cb
+ * @ff: callback to free @opaque when the handle is removed
+ *
+ * Like virEventAddHandle(), but @cb is invoked from whichever thread
+ * iterates @context rather than the default main loop.  The returned
+ * watch is updated and removed with virEventUpdateHandle() and
+ * virEventRemoveHandle() as usual; this requires the GLib event loop
+ * implementation to be registered.
+ *
+ * Returns the watch number or -1 on failure.
+ */
+int
+virEventGLibHandleAddContext(GMainContext *context,
+                             int fd,
+                             int events,
+                             virEventHandleCallback cb,
+                             void *opaque,
+                             virFreeCallback ff)
+{
+    if (!handles) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("GLib event loop implementation is not registered"));
+        return -1;
+    }
+
+    return virEventGLibHandleAddInternal(context, fd, events, cb, opaque, ff);
+}
+
 static struct virEventGLibHandle *
 virEventGLibHandleFind(int watch)
 {
@@ -203,6 +254,24 @@ virEventGLibSourceUnrefIdle(gpointer data)
 }
 
 
+/*
+ * Sources watched from an I/O thread context may be dispatching in
+ * that thread right now, so anything releasing them must run from
+ * the same context, after the dispatch has returned.
+ */
+static void
+virEventGLibIdleAdd(GMainContext *context,
+                    GSourceFunc func,
+                    gpointer data)
+{
+    GSource *source = g_idle_source_new();
+
+    g_source_set_callback(source, func, data, NULL);
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+
 static void
 virEventGLibHandleUpdate(int watch,
                          int events)
@@ -231,11 +300,11 @@ virEventGLibHandleUpdate(int watch,
         if (data->source != NULL) {
             VIR_DEBUG("Removed old handle source=%p", data->source);
             g_source_destroy(data->source);
-            g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+            virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         }
 
         data->source = virEventGLibAddSocketWatch(
-            data->fd, cond, NULL, virEventGLibHandleDispatch, data, NULL);
+            data->fd, cond, data->context, virEventGLibHandleDispatch, data, NULL);
 
         data->events = events;
         VIR_DEBUG("Added new handle source=%p", data->source);
@@ -245,7 +314,7 @@ virEventGLibHandleUpdate(int watch,
 
         VIR_DEBUG("Removed old handle source=%p", data->source);
         g_source_destroy(data->source);
-        g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+        virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         data->source = NULL;
         data->events = 0;
     }
@@ -265,6 +334,9 @@ virEventGLibHandleRemoveIdle(gpointer data)
     if (h->ff)
         (h->ff)(h->opaque);
 
+    if (h->context)
+        g_main_context_unref(h->context);
+
     g_mutex_lock(eventlock);
     g_ptr_array_remove_fast(handles, h);
     g_mutex_unlock(eventlock);
@@ -294,7 +366,7 @@ virEventGLibHandleRemove(int watch)
 
     if (data->source != NULL) {
         g_source_destroy(data->source);
-        g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+        virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         data->source = NULL;
         data->events = 0;
     }
@@ -304,7 +376,7 @@ virEventGLibHandleRemove(int watch)
      * 'removed' to prevent reuse
      */
     data->removed = TRUE;
-    g_idle_add(virEventGLibHandleRemoveIdle, data);
+    virEventGLibIdleAdd(data->context, virEventGLibHandleRemoveIdle, data);
 
     ret = 0;
 
@@ -340,17 +412,18 @@ virEventGLibTimeoutCreate(int interval,
     g_source_set_callback(source,
                           virEventGLibTimeoutDispatch,
                           data, NULL);
-    g_source_attach(source, NULL);
+    g_source_attach(source, data->context);
 
     return source;
 }
 
 
 static int
-virEventGLibTimeoutAdd(int interval,
-                       virEventTimeoutCallback cb,
-                       void *opaque,
-                       virFreeCallback ff)
+virEventGLibTimeoutAddInternal(GMainContext *context,
+                               int interval,
+                               virEventTimeoutCallback cb,
+                               void *opaque,
+                               virFreeCallback ff)
 {
     struct virEventGLibTimeout *data;
     int ret;
@@ -363,13 +436,15 @@ virEventGLibTimeoutAdd(int interval,
     data->cb = cb;
     data->opaque = opaque;
     data->ff = ff;
+    if (context)
+        data->context = g_main_context_ref(context);
     if (interval >= 0)
         data->source = virEventGLibTimeoutCreate(interval, data);
 
     g_ptr_array_add(timeouts, data);
 
-    VIR_DEBUG("Add timeout data=%p interval=%d ms cb=%p opaque=%p timer=%d",
-              data, interval, cb, opaque, data->timer);
+    VIR_DEBUG("Add timeout data=%p interval=%d ms cb=%p opaque=%p timer=%d context=%p",
+              data, interval, cb, opaque, data->timer, context);
 
     ret = data->timer;
 
@@ -382,6 +457,48 @@ virEventGLibTimeoutAdd(int interval,
 }
 
 
+static int
+virEventGLibTimeoutAdd(int interval,
+                       virEventTimeoutCallback cb,
+                       void *opaque,
+                       virFreeCallback ff)
+{
+    return virEventGLibTimeoutAddInternal(NULL, interval, cb, opaque, ff);
+}
+
+
+/**
+ * virEventGLibTimeoutAddContext:
+ * @context: the main context to run the timer from
+ * @interval: timeout in milliseconds, or -1 to create it disabled
+ * @cb: callback to invoke when the timer fires
+ * @opaque: data to pass to @cb
+ * @ff: callback to free @opaque when the timer is removed
+ *
+ * Like virEventAddTimeout(), but @cb is invoked from whichever thread
+ * iterates @context.  The timer is updated and removed with
+ * virEventUpdateTimeout() and virEventRemoveTimeout(); this requires
+ * the GLib event loop implementation to be registered.
+ *
+ * Returns the timer number or -1 on failure.
+ */
+int
+virEventGLibTimeoutAddContext(GMainContext *context,
+                              int interval,
+                              virEventTimeoutCallback cb,
+                              void *opaque,
+                              virFreeCallback ff)
+{
+    if (!timeouts) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("GLib event loop implementation is not registered"));
+        return -1;
+    }
+
+    return virEventGLibTimeoutAddInternal(context, interval, cb, opaque, ff);
+}
+
+
 static struct virEventGLibTimeout *
 virEventGLibTimeoutFind(int timer)
 {
@@ -427,7 +544,7 @@ virEventGLibTimeoutUpdate(int timer,
     if (interval >= 0) {
         if (data->source != NULL) {
             g_source_destroy(data->source);
-            g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+            virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         }
 
         data->interval = interval;
@@ -437,7 +554,7 @@ virEventGLibTimeoutUpdate(int timer,
             goto cleanup;
 
         g_source_destroy(data->source);
-        g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+        virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         data->source = NULL;
     }
 
@@ -457,6 +574,9 @@ virEventGLibTimeoutRemoveIdle(gpointer data)
     if (t->ff)
         (t->ff)(t->opaque);
 
+    if (t->context)
+        g_main_context_unref(t->context);
+
     g_mutex_lock(eventlock);
     g_ptr_array_remove_fast(timeouts, t);
     g_mutex_unlock(eventlock);
@@ -486,7 +606,7 @@ virEventGLibTimeoutRemove(int timer)
 
     if (data->source != NULL) {
         g_source_destroy(data->source);
-        g_idle_add(virEventGLibSourceUnrefIdle, data->source);
+        virEventGLibIdleAdd(data->context, virEventGLibSourceUnrefIdle, data->source);
         data->source = NULL;
     }
 
@@ -495,7 +615,7 @@ virEventGLibTimeoutRemove(int timer)
      * 'removed' to prevent reuse
      */
     data->removed = TRUE;
-    g_idle_add(virEventGLibTimeoutRemoveIdle, data);
+    virEventGLibIdleAdd(data->context, virEventGLibTimeoutRemoveIdle, data);
 
     ret = 0;
 
@@ -25,4 +25,17 @@
 
 void virEventGLibRegister(void);
 
+int virEventGLibHandleAddContext(GMainContext *context,
+                                 int fd,
+                                 int events,
+                                 virEventHandleCallback cb,
+                                 void *opaque,
+                                 virFreeCallback ff);
+
+int virEventGLibTimeoutAddContext(GMainContext *context,
+                                  int interval,
+                                  virEventTimeoutCallback cb,
+                                  void *opaque,
+                                  virFreeCallback ff);
+
 int virEventGLibRunOnce(void);
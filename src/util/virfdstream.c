@@ -40,6 +40,7 @@
 #include "virstring.h"
 #include "virtime.h"
 #include "virprocess.h"
+#include "virprobe.h"
 #include "virsocket.h"
 
 #define VIR_FROM_THIS VIR_FROM_STREAMS
@@ -584,6 +585,7 @@ virFDStreamThread(void *opaque)
     size_t buflen = 256 * 1024;
     size_t total = 0;
     size_t dataLen = 0;
+    gint64 start = g_get_monotonic_time();
 
     virObjectRef(fdst);
     virObjectLock(fdst);
@@ -631,6 +633,10 @@ virFDStreamThread(void *opaque)
     }
 
  cleanup:
+    PROBE(FDSTREAM_TRANSFER,
+          "st=%p read=%d bytes=%zu elapsed=%lld",
+          st, doRead, total,
+          (long long) (g_get_monotonic_time() - start));
     fdst->threadQuit = true;
     virObjectUnlock(fdst);
     virFDStreamDataDisposed = false;
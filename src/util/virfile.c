@@ -4479,6 +4479,64 @@ virFileDataSync(int fd)
 }
 
 
+/**
+ * virFileSplice:
+ * @fdin: file descriptor to read from
+ * @fdout: file descriptor to write to
+ * @len: maximum number of bytes to transfer
+ *
+ * Transfer up to @len bytes from @fdin to @fdout at their current
+ * offsets without copying them through userspace: splice() is used
+ * when either of the descriptors is a pipe, copy_file_range() between
+ * two files.
+ *
+ * Returns the number of bytes transferred, 0 on EOF or -1 with errno
+ * set on failure. If the kernel can't transfer data between the two
+ * descriptors, errno is set to ENOSYS and nothing was transferred, so
+ * the caller can fall back to read() and write().
+ */
+ssize_t
+virFileSplice(int fdin G_GNUC_UNUSED,
+              int fdout G_GNUC_UNUSED,
+              size_t len G_GNUC_UNUSED)
+{
+#if defined(HAVE_SPLICE) || defined(HAVE_COPY_FILE_RANGE)
+    ssize_t ret;
+#endif
+
+#ifdef HAVE_SPLICE
+    do {
+        ret = splice(fdin, NULL, fdout, NULL, len,
+                     SPLICE_F_MOVE | SPLICE_F_MORE);
+    } while (ret < 0 && errno == EINTR);
+
+    /* EINVAL means neither side is a pipe or that either side
+     * doesn't support splicing */
+    if (ret >= 0 || errno != EINVAL)
+        return ret;
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+    do {
+        ret = copy_file_range(fdin, NULL, fdout, NULL, len, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret >= 0)
+        return ret;
+
+    if (errno != EINVAL &&
+        errno != EXDEV &&
+        errno != EOPNOTSUPP &&
+        errno != EBADF &&
+        errno != ENOSYS)
+        return -1;
+#endif
+
+    errno = ENOSYS;
+    return -1;
+}
+
+
 /**
  * virFileSetCow:
  * @path: file or directory to control the COW flag on
@@ -373,5 +373,7 @@ int virFileRemoveXAttr(const char *path,
 
 int virFileDataSync(int fd);
 
+ssize_t virFileSplice(int fdin, int fdout, size_t len);
+
 int virFileSetCOW(const char *path,
                   virTristateBool state);
@@ -35,9 +35,13 @@
 #include "virobject.h"
 #include "virstring.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -58,6 +62,46 @@ struct _virFileCache {
 };
 
 
+/*
+ * Binary cache files start with this header followed by @length bytes
+ * of payload produced by the virFileCacheWrite* functions. The files
+ * never leave the host which created them so all values are stored in
+ * native byte order; a file from a host with a different byte order
+ * simply fails the @format check and is treated as outdated.
+ */
+#define VIR_FILE_CACHE_MAGIC "LVFCACHE"
+#define VIR_FILE_CACHE_FORMAT 1
+
+typedef struct _virFileCacheHeader virFileCacheHeader;
+struct _virFileCacheHeader {
+    char magic[8];
+    uint32_t format;    /* VIR_FILE_CACHE_FORMAT */
+    uint32_t version;   /* version of the payload defined by the user */
+    uint64_t length;    /* length of the payload */
+    uint64_t checksum;  /* FNV-1a hash of the payload */
+};
+
+G_STATIC_ASSERT(sizeof(virFileCacheHeader) == 32);
+
+struct _virFileCacheReader {
+    char *filename;
+    char *map;
+    size_t maplen;
+    bool mapped;
+
+    const char *payload;
+    size_t len;
+    size_t pos;
+};
+
+struct _virFileCacheWriter {
+    unsigned int version;
+    char *buf;
+    size_t len;
+    size_t alloc;
+};
+
+
 static virClassPtr virFileCacheClass;
 
 
@@ -98,7 +142,8 @@ VIR_ONCE_GLOBAL_INIT(virFileCache);
 
 static char *
 virFileCacheGetFileName(virFileCachePtr cache,
-                        const char *name)
+                        const char *name,
+                        const char *suffix)
 {
     g_autofree char *namehash = NULL;
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
@@ -115,41 +160,45 @@ virFileCacheGetFileName(virFileCachePtr cache,
 
     virBufferAsprintf(&buf, "%s/%s", cache->dir, namehash);
 
-    if (cache->suffix)
-        virBufferAsprintf(&buf, ".%s", cache->suffix);
+    if (suffix)
+        virBufferAsprintf(&buf, ".%s", suffix);
 
     return virBufferContentAndReset(&buf);
 }
 
 
+static bool
+virFileCacheHasBinary(virFileCachePtr cache)
+{
+    return cache->handlers.loadBinaryFile && cache->handlers.saveBinaryFile;
+}
+
+
 static int
-virFileCacheLoad(virFileCachePtr cache,
-                 const char *name,
-                 void **data)
+virFileCacheLoadFile(virFileCachePtr cache,
+                     const char *name,
+                     const char *file,
+                     virFileCacheLoadFilePtr loadFile,
+                     void **data)
 {
-    g_autofree char *file = NULL;
-    int ret = -1;
     void *loadData = NULL;
     bool outdated = false;
+    int ret = -1;
 
     *data = NULL;
 
-    if (!(file = virFileCacheGetFileName(cache, name)))
-        return ret;
-
     if (!virFileExists(file)) {
         if (errno == ENOENT) {
             VIR_DEBUG("No cached data '%s' for '%s'", file, name);
-            ret = 0;
-            goto cleanup;
+            return 0;
         }
         virReportSystemError(errno,
                              _("Unable to access cache '%s' for '%s'"),
                              file, name);
-        goto cleanup;
+        return -1;
     }
 
-    if (!(loadData = cache->handlers.loadFile(file, name, cache->priv, &outdated))) {
+    if (!(loadData = loadFile(file, name, cache->priv, &outdated))) {
         if (!outdated) {
             VIR_WARN("Failed to load cached data from '%s' for '%s': %s",
                      file, name, virGetLastErrorMessage());
@@ -177,6 +226,69 @@ virFileCacheLoad(virFileCachePtr cache,
 }
 
 
+static void
+virFileCacheSaveBinary(virFileCachePtr cache,
+                       const char *name,
+                       void *data)
+{
+    g_autofree char *file = NULL;
+
+    /* The binary file is only an accelerator for the regular one so
+     * failing to write it must not fail the lookup. */
+    if (!(file = virFileCacheGetFileName(cache, name, "bin")) ||
+        cache->handlers.saveBinaryFile(data, file, cache->priv) < 0) {
+        VIR_WARN("Failed to save binary cache for '%s': %s",
+                 name, virGetLastErrorMessage());
+        virResetLastError();
+    }
+}
+
+
+static int
+virFileCacheLoad(virFileCachePtr cache,
+                 const char *name,
+                 void **data)
+{
+    g_autofree char *file = NULL;
+    int rc;
+
+    *data = NULL;
+
+    if (virFileCacheHasBinary(cache)) {
+        g_autofree char *binFile = NULL;
+
+        if (!(binFile = virFileCacheGetFileName(cache, name, "bin")))
+            return -1;
+
+        /* The binary file is only an accelerator for the regular one,
+         * so any problem with it, such as an unreadable file, is just
+         * a cache miss. */
+        rc = virFileCacheLoadFile(cache, name, binFile,
+                                  cache->handlers.loadBinaryFile, data);
+        if (rc == 1)
+            return rc;
+        if (rc < 0) {
+            VIR_WARN("Ignoring binary cache '%s' for '%s': %s",
+                     binFile, name, virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    if (!(file = virFileCacheGetFileName(cache, name, cache->suffix)))
+        return -1;
+
+    rc = virFileCacheLoadFile(cache, name, file,
+                              cache->handlers.loadFile, data);
+
+    /* Create the binary file for the next time if we only had the
+     * regular one, e.g. after upgrading from an older version. */
+    if (rc == 1 && virFileCacheHasBinary(cache))
+        virFileCacheSaveBinary(cache, name, *data);
+
+    return rc;
+}
+
+
 static int
 virFileCacheSave(virFileCachePtr cache,
                  const char *name,
@@ -184,12 +296,15 @@ virFileCacheSave(virFileCachePtr cache,
 {
     g_autofree char *file = NULL;
 
-    if (!(file = virFileCacheGetFileName(cache, name)))
+    if (!(file = virFileCacheGetFileName(cache, name, cache->suffix)))
         return -1;
 
     if (cache->handlers.saveFile(data, file, cache->priv) < 0)
         return -1;
 
+    if (virFileCacheHasBinary(cache))
+        virFileCacheSaveBinary(cache, name, data);
+
     return 0;
 }
 
@@ -416,3 +531,386 @@ virFileCacheInsertData(virFileCachePtr cache,
 
     return ret;
 }
+
+
+static uint64_t
+virFileCacheChecksum(const char *data,
+                     size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+
+/**
+ * virFileCacheReaderOpen:
+ * @filename: binary cache file to open
+ * @version: expected version of the payload
+ * @reader: filled with the new reader on success
+ *
+ * Maps the binary cache file @filename into memory and validates its
+ * header and checksum. Values are then read from the payload in the
+ * same order they were written by virFileCacheWrite* functions.
+ *
+ * Returns 1 on success, 0 if the file was written by a different
+ * format or payload @version and -1 on error.
+ */
+int
+virFileCacheReaderOpen(const char *filename,
+                       unsigned int version,
+                       virFileCacheReaderPtr *reader)
+{
+    g_autoptr(virFileCacheReader) rd = NULL;
+    virFileCacheHeader hdr;
+    VIR_AUTOCLOSE fd = -1;
+    struct stat sb;
+
+    *reader = NULL;
+
+    if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0 ||
+        fstat(fd, &sb) < 0) {
+        virReportSystemError(errno, _("Unable to open cache file '%s'"),
+                             filename);
+        return -1;
+    }
+
+    if (sb.st_size < (off_t) sizeof(hdr)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cache file '%s' is truncated"), filename);
+        return -1;
+    }
+
+    rd = g_new0(virFileCacheReader, 1);
+    rd->filename = g_strdup(filename);
+    rd->maplen = sb.st_size;
+
+#ifdef HAVE_MMAP
+    rd->map = mmap(NULL, rd->maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (rd->map == MAP_FAILED) {
+        rd->map = NULL;
+        virReportSystemError(errno, _("Unable to map cache file '%s'"),
+                             filename);
+        return -1;
+    }
+    rd->mapped = true;
+#else /* !HAVE_MMAP */
+    rd->map = g_new0(char, rd->maplen);
+    if (saferead(fd, rd->map, rd->maplen) != (ssize_t) rd->maplen) {
+        virReportSystemError(errno, _("Unable to read cache file '%s'"),
+                             filename);
+        return -1;
+    }
+#endif /* !HAVE_MMAP */
+
+    memcpy(&hdr, rd->map, sizeof(hdr));
+
+    if (memcmp(hdr.magic, VIR_FILE_CACHE_MAGIC, sizeof(hdr.magic)) != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("'%s' is not a binary cache file"), filename);
+        return -1;
+    }
+
+    if (hdr.format != VIR_FILE_CACHE_FORMAT || hdr.version != version) {
+        VIR_DEBUG("Outdated binary cache '%s': format %u version %u, "
+                  "expected %u %u", filename, hdr.format, hdr.version,
+                  VIR_FILE_CACHE_FORMAT, version);
+        return 0;
+    }
+
+    if (hdr.length != rd->maplen - sizeof(hdr)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cache file '%s' has unexpected length"), filename);
+        return -1;
+    }
+
+    rd->payload = rd->map + sizeof(hdr);
+    rd->len = hdr.length;
+
+    if (virFileCacheChecksum(rd->payload, rd->len) != hdr.checksum) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("checksum mismatch in cache file '%s'"), filename);
+        return -1;
+    }
+
+    *reader = g_steal_pointer(&rd);
+    return 1;
+}
+
+
+void
+virFileCacheReaderFree(virFileCacheReaderPtr reader)
+{
+    if (!reader)
+        return;
+
+#ifdef HAVE_MMAP
+    if (reader->mapped)
+        munmap(reader->map, reader->maplen);
+#else /* !HAVE_MMAP */
+    g_free(reader->map);
+#endif /* !HAVE_MMAP */
+    g_free(reader->filename);
+    g_free(reader);
+}
+
+
+static const char *
+virFileCacheReadBytes(virFileCacheReaderPtr reader,
+                      size_t len)
+{
+    const char *ret;
+
+    if (len > reader->len - reader->pos) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unexpected end of data in cache file '%s'"),
+                       reader->filename);
+        return NULL;
+    }
+
+    ret = reader->payload + reader->pos;
+    reader->pos += len;
+    return ret;
+}
+
+
+int
+virFileCacheReadUInt(virFileCacheReaderPtr reader,
+                     unsigned int *val)
+{
+    const char *data;
+    uint32_t tmp;
+
+    if (!(data = virFileCacheReadBytes(reader, sizeof(tmp))))
+        return -1;
+
+    memcpy(&tmp, data, sizeof(tmp));
+    *val = tmp;
+    return 0;
+}
+
+
+int
+virFileCacheReadULLong(virFileCacheReaderPtr reader,
+                       unsigned long long *val)
+{
+    const char *data;
+    uint64_t tmp;
+
+    if (!(data = virFileCacheReadBytes(reader, sizeof(tmp))))
+        return -1;
+
+    memcpy(&tmp, data, sizeof(tmp));
+    *val = tmp;
+    return 0;
+}
+
+
+int
+virFileCacheReadBool(virFileCacheReaderPtr reader,
+                     bool *val)
+{
+    const char *data;
+
+    if (!(data = virFileCacheReadBytes(reader, 1)))
+        return -1;
+
+    *val = !!*data;
+    return 0;
+}
+
+
+/**
+ * virFileCacheReadString:
+ * @reader: binary cache reader
+ * @val: filled with a newly allocated copy of the string
+ *
+ * Reads a string written by virFileCacheWriteString. @val is set to
+ * NULL if NULL was written.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virFileCacheReadString(virFileCacheReaderPtr reader,
+                       char **val)
+{
+    const char *data;
+    unsigned int len;
+
+    *val = NULL;
+
+    if (virFileCacheReadUInt(reader, &len) < 0)
+        return -1;
+
+    /* 0 encodes NULL, otherwise the length is stored incremented */
+    if (len == 0)
+        return 0;
+
+    if (!(data = virFileCacheReadBytes(reader, len - 1)))
+        return -1;
+
+    *val = g_strndup(data, len - 1);
+    return 0;
+}
+
+
+bool
+virFileCacheReaderAtEnd(virFileCacheReaderPtr reader)
+{
+    return reader->pos == reader->len;
+}
+
+
+/**
+ * virFileCacheWriterNew:
+ * @version: version of the payload
+ *
+ * Creates a new writer for a binary cache file. The @version is stored
+ * in the file header and has to be bumped whenever the layout of the
+ * payload changes so that virFileCacheReaderOpen refuses old files.
+ *
+ * Returns new writer object.
+ */
+virFileCacheWriterPtr
+virFileCacheWriterNew(unsigned int version)
+{
+    virFileCacheWriterPtr writer = g_new0(virFileCacheWriter, 1);
+
+    writer->version = version;
+
+    return writer;
+}
+
+
+void
+virFileCacheWriterFree(virFileCacheWriterPtr writer)
+{
+    if (!writer)
+        return;
+
+    g_free(writer->buf);
+    g_free(writer);
+}
+
+
+static void
+virFileCacheWriteBytes(virFileCacheWriterPtr writer,
+                       const void *data,
+                       size_t len)
+{
+    ignore_value(VIR_RESIZE_N(writer->buf, writer->alloc, writer->len, len));
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+
+void
+virFileCacheWriteUInt(virFileCacheWriterPtr writer,
+                      unsigned int val)
+{
+    uint32_t tmp = val;
+
+    virFileCacheWriteBytes(writer, &tmp, sizeof(tmp));
+}
+
+
+void
+virFileCacheWriteULLong(virFileCacheWriterPtr writer,
+                        unsigned long long val)
+{
+    uint64_t tmp = val;
+
+    virFileCacheWriteBytes(writer, &tmp, sizeof(tmp));
+}
+
+
+void
+virFileCacheWriteBool(virFileCacheWriterPtr writer,
+                      bool val)
+{
+    char tmp = val ? 1 : 0;
+
+    virFileCacheWriteBytes(writer, &tmp, 1);
+}
+
+
+void
+virFileCacheWriteString(virFileCacheWriterPtr writer,
+                        const char *val)
+{
+    size_t len;
+
+    if (!val) {
+        virFileCacheWriteUInt(writer, 0);
+        return;
+    }
+
+    len = strlen(val);
+    virFileCacheWriteUInt(writer, len + 1);
+    virFileCacheWriteBytes(writer, val, len);
+}
+
+
+/**
+ * virFileCacheWriterSave:
+ * @writer: binary cache writer
+ * @filename: file to store the data in
+ * @mode: permissions of the file
+ *
+ * Writes header and payload collected in @writer into @filename. The
+ * data is written to a temporary file first which is then renamed over
+ * @filename so that readers which still have the old file mapped never
+ * see it truncated.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virFileCacheWriterSave(virFileCacheWriterPtr writer,
+                       const char *filename,
+                       mode_t mode)
+{
+    g_autofree char *tmp = g_strdup_printf("%s.new", filename);
+    virFileCacheHeader hdr;
+    VIR_AUTOCLOSE fd = -1;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, VIR_FILE_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.format = VIR_FILE_CACHE_FORMAT;
+    hdr.version = writer->version;
+    hdr.length = writer->len;
+    hdr.checksum = virFileCacheChecksum(writer->buf, writer->len);
+
+    if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode)) < 0) {
+        virReportSystemError(errno, _("Unable to create '%s'"), tmp);
+        return -1;
+    }
+
+    if (safewrite(fd, &hdr, sizeof(hdr)) < 0 ||
+        safewrite(fd, writer->buf, writer->len) < 0) {
+        virReportSystemError(errno, _("Unable to write '%s'"), tmp);
+        goto error;
+    }
+
+    if (VIR_CLOSE(fd) < 0) {
+        virReportSystemError(errno, _("Unable to close '%s'"), tmp);
+        goto error;
+    }
+
+    if (rename(tmp, filename) < 0) {
+        virReportSystemError(errno, _("Unable to rename '%s' to '%s'"),
+                             tmp, filename);
+        goto error;
+    }
+
+    return 0;
+
+ error:
+    unlink(tmp);
+    return -1;
+}
@@ -29,6 +29,12 @@
 typedef struct _virFileCache virFileCache;
 typedef virFileCache *virFileCachePtr;
 
+typedef struct _virFileCacheReader virFileCacheReader;
+typedef virFileCacheReader *virFileCacheReaderPtr;
+
+typedef struct _virFileCacheWriter virFileCacheWriter;
+typedef virFileCacheWriter *virFileCacheWriterPtr;
+
 /**
  * virFileCacheIsValidPtr:
  * @data: data object to validate
@@ -110,6 +116,12 @@ struct _virFileCacheHandlers {
     virFileCacheLoadFilePtr loadFile;
     virFileCacheSaveFilePtr saveFile;
     virFileCachePrivFreePtr privFree;
+
+    /* Optional binary variant of loadFile/saveFile. If both are set
+     * the cache prefers a "<hash>.bin" file next to the regular one
+     * and falls back to @loadFile if it is missing or unusable. */
+    virFileCacheLoadFilePtr loadBinaryFile;
+    virFileCacheSaveFilePtr saveBinaryFile;
 };
 
 virFileCachePtr
@@ -137,3 +149,61 @@ int
 virFileCacheInsertData(virFileCachePtr cache,
                        const char *name,
                        void *data);
+
+int
+virFileCacheReaderOpen(const char *filename,
+                       unsigned int version,
+                       virFileCacheReaderPtr *reader);
+
+void
+virFileCacheReaderFree(virFileCacheReaderPtr reader);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFileCacheReader, virFileCacheReaderFree);
+
+int
+virFileCacheReadUInt(virFileCacheReaderPtr reader,
+                     unsigned int *val);
+
+int
+virFileCacheReadULLong(virFileCacheReaderPtr reader,
+                       unsigned long long *val);
+
+int
+virFileCacheReadBool(virFileCacheReaderPtr reader,
+                     bool *val);
+
+int
+virFileCacheReadString(virFileCacheReaderPtr reader,
+                       char **val);
+
+bool
+virFileCacheReaderAtEnd(virFileCacheReaderPtr reader);
+
+virFileCacheWriterPtr
+virFileCacheWriterNew(unsigned int version);
+
+void
+virFileCacheWriterFree(virFileCacheWriterPtr writer);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFileCacheWriter, virFileCacheWriterFree);
+
+void
+virFileCacheWriteUInt(virFileCacheWriterPtr writer,
+                      unsigned int val);
+
+void
+virFileCacheWriteULLong(virFileCacheWriterPtr writer,
+                        unsigned long long val);
+
+void
+virFileCacheWriteBool(virFileCacheWriterPtr writer,
+                      bool val);
+
+void
+virFileCacheWriteString(virFileCacheWriterPtr writer,
+                        const char *val);
+
+int
+virFileCacheWriterSave(virFileCacheWriterPtr writer,
+                       const char *filename,
+                       mode_t mode);
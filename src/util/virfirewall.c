@@ -48,6 +48,14 @@ VIR_ENUM_IMPL(virFirewallLayerCommand,
               IP6TABLES_PATH,
 );
 
+VIR_ENUM_DECL(virFirewallLayerRestoreCommand);
+VIR_ENUM_IMPL(virFirewallLayerRestoreCommand,
+              VIR_FIREWALL_LAYER_LAST,
+              EBTABLES_RESTORE_PATH,
+              IPTABLES_RESTORE_PATH,
+              IP6TABLES_RESTORE_PATH,
+);
+
 struct _virFirewallRule {
     virFirewallLayer layer;
 
@@ -100,6 +108,8 @@ static bool iptablesUseLock;
 static bool ip6tablesUseLock;
 static bool ebtablesUseLock;
 static bool lockOverride; /* true to avoid lock probes */
+static bool restoreUsable[VIR_FIREWALL_LAYER_LAST];
+static bool restoreOverride; /* true to use restore commands unprobed */
 
 void
 virFirewallSetLockOverride(bool avoid)
@@ -107,6 +117,29 @@ virFirewallSetLockOverride(bool avoid)
     lockOverride = avoid;
 }
 
+void
+virFirewallSetRestoreOverride(bool enable)
+{
+    restoreOverride = enable;
+}
+
+static bool
+virFirewallRestoreUseLock(virFirewallLayer layer)
+{
+    /* ebtables-restore has no locking option */
+    switch (layer) {
+    case VIR_FIREWALL_LAYER_IPV4:
+        return iptablesUseLock;
+    case VIR_FIREWALL_LAYER_IPV6:
+        return ip6tablesUseLock;
+    case VIR_FIREWALL_LAYER_ETHERNET:
+    case VIR_FIREWALL_LAYER_LAST:
+        break;
+    }
+
+    return false;
+}
+
 static void
 virFirewallCheckUpdateLock(bool *lockflag,
                            const char *const*args)
@@ -143,6 +176,46 @@ virFirewallCheckUpdateLocking(void)
                                ebtablesArgs);
 }
 
+/*
+ * Transactions are fed to the restore commands without flushing the
+ * tables first, which not every implementation supports, so try an
+ * empty transaction the way it would be applied.
+ */
+static void
+virFirewallCheckUpdateRestore(void)
+{
+    size_t i;
+
+    if (lockOverride)
+        return;
+
+    for (i = 0; i < VIR_FIREWALL_LAYER_LAST; i++) {
+        const char *bin = virFirewallLayerRestoreCommandTypeToString(i);
+        g_autoptr(virCommand) cmd = NULL;
+        int status;
+
+        restoreUsable[i] = false;
+
+        if (!virFileIsExecutable(bin)) {
+            VIR_INFO("%s is not available", bin);
+            continue;
+        }
+
+        cmd = virCommandNewArgList(bin, "--noflush", NULL);
+        if (virFirewallRestoreUseLock(i))
+            virCommandAddArg(cmd, "-w");
+        virCommandSetInputBuffer(cmd, "");
+
+        /* Ignore failed commands without logging them */
+        if (virCommandRun(cmd, &status) < 0 || status) {
+            VIR_INFO("batching not supported by %s", bin);
+        } else {
+            VIR_INFO("using %s for batching", bin);
+            restoreUsable[i] = true;
+        }
+    }
+}
+
 static int
 virFirewallValidateBackend(virFirewallBackend backend)
 {
@@ -191,6 +264,8 @@ virFirewallValidateBackend(virFirewallBackend backend)
     currentBackend = backend;
 
     virFirewallCheckUpdateLocking();
+    if (backend == VIR_FIREWALL_BACKEND_DIRECT)
+        virFirewallCheckUpdateRestore();
 
     return 0;
 }
@@ -761,23 +836,268 @@ virFirewallApplyRule(virFirewallPtr firewall,
     return 0;
 }
 
+static const char *const virFirewallRestoreCommands[] = {
+    "-A", "--append",
+    "-I", "--insert",
+    "-D", "--delete",
+    "-R", "--replace",
+    "-N", "--new-chain",
+    "-X", "--delete-chain",
+    "-F", "--flush",
+    "-P", "--policy",
+    "-E", "--rename-chain",
+    "-Z", "--zero",
+    NULL,
+};
+
+static size_t
+virFirewallRuleGetLockArgs(virFirewallRulePtr rule)
+{
+    const char *lock = "-w";
+
+    if (rule->layer == VIR_FIREWALL_LAYER_ETHERNET)
+        lock = "--concurrent";
+
+    if (rule->argsLen > 0 && STREQ(rule->args[0], lock))
+        return 1;
+    return 0;
+}
+
+static bool
+virFirewallArgIsTable(const char *arg)
+{
+    return STREQ(arg, "-t") || STREQ(arg, "--table");
+}
+
+/*
+ * Returns the table @rule changes if it can be expressed as a line of
+ * input to the restore command of its layer, or NULL if it has to be
+ * run on its own.
+ */
+static const char *
+virFirewallRuleGetRestoreTable(virFirewallRulePtr rule)
+{
+    const char *table = "filter";
+    bool haveCommand = false;
+    size_t i;
+
+    if (rule->queryCB || rule->ignoreErrors)
+        return NULL;
+
+    for (i = virFirewallRuleGetLockArgs(rule); i < rule->argsLen; i++) {
+        const char *arg = rule->args[i];
+
+        if (virFirewallArgIsTable(arg)) {
+            if (++i == rule->argsLen)
+                return NULL;
+            table = rule->args[i];
+            continue;
+        }
+
+        if (!haveCommand) {
+            if (!g_strv_contains(virFirewallRestoreCommands, arg))
+                return NULL;
+            haveCommand = true;
+        }
+
+        /* Restore commands split lines at whitespace outside of
+         * double quotes and have no reliable way to escape them */
+        if (!*arg || strpbrk(arg, "\"'\\\n"))
+            return NULL;
+    }
+
+    if (!haveCommand || !*table || strpbrk(table, " \t\"'\\\n"))
+        return NULL;
+
+    return table;
+}
+
+static void
+virFirewallRuleFormatRestore(virFirewallRulePtr rule,
+                             virBufferPtr buf)
+{
+    bool first = true;
+    size_t i;
+
+    for (i = virFirewallRuleGetLockArgs(rule); i < rule->argsLen; i++) {
+        const char *arg = rule->args[i];
+
+        if (virFirewallArgIsTable(arg)) {
+            i++;
+            continue;
+        }
+
+        if (!first)
+            virBufferAddChar(buf, ' ');
+        first = false;
+
+        if (strpbrk(arg, " \t"))
+            virBufferAsprintf(buf, "\"%s\"", arg);
+        else
+            virBufferAdd(buf, arg, -1);
+    }
+    virBufferAddChar(buf, '\n');
+}
+
+/*
+ * Returns the table @rule changes if it can be applied by the restore
+ * command of its layer with the current backend, or NULL otherwise.
+ */
+static const char *
+virFirewallRuleGetBatchTable(virFirewallRulePtr rule)
+{
+    if (currentBackend != VIR_FIREWALL_BACKEND_DIRECT ||
+        !(restoreOverride || restoreUsable[rule->layer]))
+        return NULL;
+
+    return virFirewallRuleGetRestoreTable(rule);
+}
+
+/*
+ * Feeds the @nrules rules starting at @rules, which all change @table
+ * of the same layer, to the restore command of the layer. The table
+ * is committed as a whole, so either all of the rules take effect or
+ * none does.
+ *
+ * Returns 0 if the rules were applied,
+ *         1 if the restore command rejected them,
+ *        -1 on error.
+ */
+static int
+virFirewallApplyRestore(virFirewallRulePtr *rules,
+                        size_t nrules,
+                        const char *table)
+{
+    virFirewallLayer layer = rules[0]->layer;
+    const char *bin = virFirewallLayerRestoreCommandTypeToString(layer);
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *input = NULL;
+    g_autofree char *error = NULL;
+    int status;
+    size_t i;
+
+    virBufferAsprintf(&buf, "*%s\n", table);
+    for (i = 0; i < nrules; i++) {
+        g_autofree char *str = virFirewallRuleToString(rules[i]);
+        VIR_INFO("Applying rule '%s'", NULLSTR(str));
+        virFirewallRuleFormatRestore(rules[i], &buf);
+    }
+    virBufferAddLit(&buf, "COMMIT\n");
+    input = virBufferContentAndReset(&buf);
+
+    cmd = virCommandNewArgList(bin, "--noflush", NULL);
+    if (virFirewallRestoreUseLock(layer))
+        virCommandAddArg(cmd, "-w");
+    virCommandSetInputBuffer(cmd, input);
+    virCommandSetErrorBuffer(cmd, &error);
+
+    if (virCommandRun(cmd, &status) < 0)
+        return -1;
+
+    if (status != 0) {
+        VIR_DEBUG("%s rejected %zu rules: %s", bin, nrules, NULLSTR(error));
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Applies the rules of @group from @start up to @end, all of which
+ * can be batched, with one restore command per table. Tables do not
+ * affect each other, so only the order of the rules within a table
+ * needs to be kept.
+ */
+static int
+virFirewallApplyGroupBatches(virFirewallPtr firewall,
+                             virFirewallGroupPtr group,
+                             size_t start,
+                             size_t end)
+{
+    g_autofree virFirewallRulePtr *batch = g_new0(virFirewallRulePtr, end - start);
+    g_autofree bool *done = g_new0(bool, end - start);
+    size_t i;
+    size_t j;
+
+    for (i = start; i < end; i++) {
+        virFirewallLayer layer = group->action[i]->layer;
+        const char *table = virFirewallRuleGetBatchTable(group->action[i]);
+        size_t nbatch = 0;
+        int rc = 1;
+
+        if (done[i - start])
+            continue;
+
+        for (j = i; j < end; j++) {
+            virFirewallRulePtr rule = group->action[j];
+
+            if (done[j - start] ||
+                rule->layer != layer ||
+                STRNEQ(virFirewallRuleGetBatchTable(rule), table))
+                continue;
+
+            batch[nbatch++] = rule;
+            done[j - start] = true;
+        }
+
+        if (nbatch > 1 &&
+            (rc = virFirewallApplyRestore(batch, nbatch, table)) < 0)
+            return -1;
+
+        if (rc == 0)
+            continue;
+
+        /* Nothing of the table was applied, so find the culprit rule by
+         * rule and leave it to the rollback to undo what worked */
+        if (nbatch > 1)
+            VIR_DEBUG("Applying %zu rules one by one", nbatch);
+
+        for (j = 0; j < nbatch; j++) {
+            if (virFirewallApplyRule(firewall, batch[j], false) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int
 virFirewallApplyGroup(virFirewallPtr firewall,
                       size_t idx)
 {
     virFirewallGroupPtr group = firewall->groups[idx];
     bool ignoreErrors = (group->actionFlags & VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
-    size_t i;
+    bool atomic = (group->actionFlags & VIR_FIREWALL_TRANSACTION_ATOMIC);
+    size_t i = 0;
 
     VIR_INFO("Starting transaction for firewall=%p group=%p flags=0x%x",
              firewall, group, group->actionFlags);
     firewall->currentGroup = idx;
     group->addingRollback = false;
-    for (i = 0; i < group->naction; i++) {
+    while (i < group->naction) {
+        size_t end = i;
+
+        /* Rules that cannot be batched keep their place among the
+         * others, e.g. query callbacks may depend on earlier rules */
+        if (atomic && !ignoreErrors) {
+            while (end < group->naction &&
+                   virFirewallRuleGetBatchTable(group->action[end]))
+                end++;
+        }
+
+        if (end - i > 1) {
+            if (virFirewallApplyGroupBatches(firewall, group, i, end) < 0)
+                return -1;
+            i = end;
+            continue;
+        }
+
         if (virFirewallApplyRule(firewall,
                                  group->action[i],
                                  ignoreErrors) < 0)
             return -1;
+        i++;
     }
     return 0;
 }
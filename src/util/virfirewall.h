@@ -95,6 +95,9 @@ typedef enum {
     /* Ignore all errors when applying rules, so no
      * rollback block will be required */
     VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS = (1 << 0),
+    /* Apply the rules changing the same table with a
+     * single restore command where possible */
+    VIR_FIREWALL_TRANSACTION_ATOMIC = (1 << 1),
 } virFirewallTransactionFlags;
 
 void virFirewallStartTransaction(virFirewallPtr firewall,
@@ -113,4 +116,6 @@ int virFirewallApply(virFirewallPtr firewall);
 
 void virFirewallSetLockOverride(bool avoid);
 
+void virFirewallSetRestoreOverride(bool enable);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFirewall, virFirewallFree);
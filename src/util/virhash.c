@@ -1,5 +1,5 @@
 /*
- * virhash.c: chained hash tables
+ * virhash.c: open addressing hash tables
  *
  * Reference: Your favorite introductory book on algorithms
  *
@@ -18,6 +18,9 @@
 
 #include <config.h>
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #include "virerror.h"
 #include "virhash.h"
@@ -32,9 +35,34 @@
 
 VIR_LOG_INIT("util.hash");
 
-#define MAX_HASH_LEN 8
+/*
+ * The table is split into groups of VIR_HASH_GROUP_WIDTH slots. Every
+ * slot has a control byte which is either VIR_HASH_CTRL_EMPTY,
+ * VIR_HASH_CTRL_DELETED or, for used slots, the low 7 bits of the hash
+ * code of its key. A lookup compares the control bytes of a whole group
+ * at once and only looks at the slots whose control byte matches, so
+ * that keys are rarely compared in vain. Groups are probed
+ * triangularly, i.e. with strides 1, 2, 3, ... starting from the one
+ * selected by the remaining bits of the hash code, until a group with
+ * an empty slot is found.
+ *
+ * Only the slots move when the table is rehashed. Keys are copied
+ * into separate allocations, so the key pointers handed to iterators
+ * and returned by virHashGetItems stay valid for as long as their
+ * entry is in the table, just like with the chained table before.
+ */
+#define VIR_HASH_GROUP_WIDTH 16
+#define VIR_HASH_MIN_SIZE VIR_HASH_GROUP_WIDTH
+
+#define VIR_HASH_CTRL_EMPTY ((int8_t) -128)
+#define VIR_HASH_CTRL_DELETED ((int8_t) -2)
 
-/* #define DEBUG_GROW */
+#define VIR_HASH_H1(code) ((code) >> 7)
+#define VIR_HASH_H2(code) ((int8_t) ((code) & 0x7f))
+
+/* Up to 7/8 of the slots may be used or deleted before the table is
+ * rehashed. */
+#define VIR_HASH_MAX_LOAD(size) ((size) - (size) / 8)
 
 /*
  * A single entry in the hash table
@@ -42,19 +70,21 @@ VIR_LOG_INIT("util.hash");
 typedef struct _virHashEntry virHashEntry;
 typedef virHashEntry *virHashEntryPtr;
 struct _virHashEntry {
-    struct _virHashEntry *next;
-    void *name;
     void *payload;
+    void *name;
+    uint32_t code;
 };
 
 /*
  * The entire hash table
  */
 struct _virHashTable {
-    virHashEntryPtr *table;
+    int8_t *ctrl;
+    virHashEntryPtr table;
     uint32_t seed;
     size_t size;
     size_t nbElems;
+    size_t nbDeleted;
     virHashDataFree dataFree;
     virHashKeyCode keyCode;
     virHashKeyEqual keyEqual;
@@ -118,13 +148,166 @@ virHashValueFree(void *value)
 }
 
 
+/*
+ * Returns a bitmask of the slots in the group starting at @group whose
+ * control byte equals @value.
+ */
+static inline unsigned int
+virHashGroupMatch(const int8_t *group, int8_t value)
+{
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+
+    return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl,
+                                                           _mm_set1_epi8(value)));
+#else
+    unsigned int mask = 0;
+    size_t i;
+
+    for (i = 0; i < VIR_HASH_GROUP_WIDTH; i++) {
+        if (group[i] == value)
+            mask |= 1U << i;
+    }
+
+    return mask;
+#endif
+}
+
+
+/*
+ * Returns a bitmask of the slots in the group starting at @group which
+ * are either empty or deleted, i.e. whose control byte has the sign bit
+ * set.
+ */
+static inline unsigned int
+virHashGroupMatchFree(const int8_t *group)
+{
+#ifdef __SSE2__
+    return (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+    unsigned int mask = 0;
+    size_t i;
+
+    for (i = 0; i < VIR_HASH_GROUP_WIDTH; i++) {
+        if (group[i] < 0)
+            mask |= 1U << i;
+    }
+
+    return mask;
+#endif
+}
+
+
+static inline unsigned int
+virHashGroupMatchFull(const int8_t *group)
+{
+    return ~virHashGroupMatchFree(group) & ((1U << VIR_HASH_GROUP_WIDTH) - 1);
+}
+
+
+/*
+ * Returns a bitmask of the used slots in the group starting at @group
+ * which follow the slot @slot. Iterators call this after every
+ * callback instead of keeping a mask of the group across it, so that
+ * they never visit a slot which the callback released.
+ */
+static inline unsigned int
+virHashGroupMatchFullAfter(const virHashTable *table,
+                           size_t group,
+                           size_t slot)
+{
+    return virHashGroupMatchFull(table->ctrl + group) &
+        ~((2U << (slot - group)) - 1);
+}
+
+
 static size_t
-virHashComputeKey(const virHashTable *table, const void *name)
+virHashRoundSize(size_t size)
+{
+    size_t ret = VIR_HASH_MIN_SIZE;
+
+    while (ret < size)
+        ret <<= 1;
+
+    return ret;
+}
+
+
+static void
+virHashAllocTable(virHashTablePtr table, size_t size)
 {
-    uint32_t value = table->keyCode(name, table->seed);
-    return value % table->size;
+    table->size = size;
+    table->nbDeleted = 0;
+    table->ctrl = g_new(int8_t, size);
+    memset(table->ctrl, VIR_HASH_CTRL_EMPTY, size);
+    table->table = g_new(virHashEntry, size);
 }
 
+
+/*
+ * Returns the index of the slot holding @name or -1 if there's none.
+ */
+static ssize_t
+virHashFindSlot(const virHashTable *table,
+                const void *name,
+                uint32_t code)
+{
+    size_t mask = table->size / VIR_HASH_GROUP_WIDTH - 1;
+    size_t group = VIR_HASH_H1(code) & mask;
+    size_t probe = 0;
+
+    for (;;) {
+        const int8_t *ctrl = table->ctrl + group * VIR_HASH_GROUP_WIDTH;
+        unsigned int match = virHashGroupMatch(ctrl, VIR_HASH_H2(code));
+
+        while (match) {
+            size_t i = group * VIR_HASH_GROUP_WIDTH + __builtin_ffs(match) - 1;
+            const virHashEntry *entry = table->table + i;
+
+            if (entry->code == code &&
+                table->keyEqual(entry->name, name))
+                return i;
+
+            match &= match - 1;
+        }
+
+        /* The key would have been stored in the empty slot */
+        if (virHashGroupMatch(ctrl, VIR_HASH_CTRL_EMPTY))
+            return -1;
+
+        /* The load limit guarantees an empty slot somewhere and the
+         * triangular probe sequence visits every group eventually */
+        probe++;
+        group = (group + probe) & mask;
+    }
+}
+
+
+/*
+ * Returns the index of the first empty or deleted slot in the probe
+ * sequence of @code.
+ */
+static size_t
+virHashFindFreeSlot(const virHashTable *table,
+                    uint32_t code)
+{
+    size_t mask = table->size / VIR_HASH_GROUP_WIDTH - 1;
+    size_t group = VIR_HASH_H1(code) & mask;
+    size_t probe = 0;
+
+    for (;;) {
+        unsigned int match;
+
+        match = virHashGroupMatchFree(table->ctrl + group * VIR_HASH_GROUP_WIDTH);
+        if (match)
+            return group * VIR_HASH_GROUP_WIDTH + __builtin_ffs(match) - 1;
+
+        probe++;
+        group = (group + probe) & mask;
+    }
+}
+
+
 /**
  * virHashCreateFull:
  * @size: the size of the hash table
@@ -149,12 +332,11 @@ virHashTablePtr virHashCreateFull(ssize_t size,
     virHashTablePtr table = NULL;
 
     if (size <= 0)
-        size = 256;
+        size = 32;
 
     table = g_new0(virHashTable, 1);
 
     table->seed = virRandomBits(32);
-    table->size = size;
     table->nbElems = 0;
     table->dataFree = dataFree;
     table->keyCode = keyCode;
@@ -163,7 +345,7 @@ virHashTablePtr virHashCreateFull(ssize_t size,
     table->keyPrint = keyPrint;
     table->keyFree = keyFree;
 
-    table->table = g_new0(virHashEntryPtr, table->size);
+    virHashAllocTable(table, virHashRoundSize(size));
 
     return table;
 }
@@ -241,66 +423,40 @@ virHashAtomicDispose(void *obj)
 
 
 /**
- * virHashGrow:
+ * virHashResize:
  * @table: the hash table
- * @size: the new size of the hash table
  *
- * resize the hash table
- *
- * Returns 0 in case of success, -1 in case of failure
+ * Rehash the table into a new slot array, doubling its size unless most
+ * of the used slots were taken by deleted entries which are simply
+ * dropped.
  */
-static int
-virHashGrow(virHashTablePtr table, size_t size)
+static void
+virHashResize(virHashTablePtr table)
 {
-    size_t oldsize, i;
-    virHashEntryPtr *oldtable;
-
-#ifdef DEBUG_GROW
-    size_t nbElem = 0;
-#endif
-
-    if (table == NULL)
-        return -1;
-    if (size < 8)
-        return -1;
-    if (size > 8 * 2048)
-        return -1;
+    int8_t *oldctrl = table->ctrl;
+    virHashEntryPtr oldtable = table->table;
+    size_t oldsize = table->size;
+    size_t size = oldsize;
+    size_t i;
 
-    oldsize = table->size;
-    oldtable = table->table;
-    if (oldtable == NULL)
-        return -1;
+    if (table->nbElems >= VIR_HASH_MAX_LOAD(oldsize) / 2)
+        size *= 2;
 
-    if (VIR_ALLOC_N(table->table, size) < 0) {
-        table->table = oldtable;
-        return -1;
-    }
-    table->size = size;
+    virHashAllocTable(table, size);
 
     for (i = 0; i < oldsize; i++) {
-        virHashEntryPtr iter = oldtable[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
-            size_t key = virHashComputeKey(table, iter->name);
+        size_t slot;
 
-            iter->next = table->table[key];
-            table->table[key] = iter;
+        if (oldctrl[i] < 0)
+            continue;
 
-#ifdef DEBUG_GROW
-            nbElem++;
-#endif
-            iter = next;
-        }
+        slot = virHashFindFreeSlot(table, oldtable[i].code);
+        table->ctrl[slot] = oldctrl[i];
+        table->table[slot] = oldtable[i];
     }
 
-    VIR_FREE(oldtable);
-
-#ifdef DEBUG_GROW
-    VIR_DEBUG("virHashGrow : from %d to %d, %ld elems", oldsize,
-              size, nbElem);
-#endif
-
-    return 0;
+    g_free(oldctrl);
+    g_free(oldtable);
 }
 
 /**
@@ -319,73 +475,108 @@ virHashFree(virHashTablePtr table)
         return;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr iter = table->table[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
+        virHashEntryPtr entry = table->table + i;
 
-            if (table->dataFree)
-                table->dataFree(iter->payload);
-            if (table->keyFree)
-                table->keyFree(iter->name);
-            VIR_FREE(iter);
-            iter = next;
-        }
+        if (table->ctrl[i] < 0)
+            continue;
+
+        if (table->dataFree)
+            table->dataFree(entry->payload);
+        if (table->keyFree)
+            table->keyFree(entry->name);
     }
 
-    VIR_FREE(table->table);
+    g_free(table->ctrl);
+    g_free(table->table);
     VIR_FREE(table);
 }
 
+static void
+virHashInsert(virHashTablePtr table,
+              const void *name,
+              uint32_t code,
+              void *userdata)
+{
+    virHashEntryPtr entry;
+    size_t slot;
+
+    if (table->nbElems + table->nbDeleted >= VIR_HASH_MAX_LOAD(table->size))
+        virHashResize(table);
+
+    slot = virHashFindFreeSlot(table, code);
+    if (table->ctrl[slot] == VIR_HASH_CTRL_DELETED)
+        table->nbDeleted--;
+
+    table->ctrl[slot] = VIR_HASH_H2(code);
+    entry = table->table + slot;
+    entry->payload = userdata;
+    entry->code = code;
+    entry->name = table->keyCopy(name);
+
+    table->nbElems++;
+}
+
+/*
+ * Releases the slot @slot. Other entries are never moved so that
+ * iteration can continue after the current entry was removed.
+ */
+static void
+virHashRemoveSlot(virHashTablePtr table, size_t slot)
+{
+    virHashEntry entry = table->table[slot];
+    size_t group = slot & ~((size_t) VIR_HASH_GROUP_WIDTH - 1);
+
+    /* A lookup only continues past a group without empty slots, so if
+     * there is one already the slot doesn't need a tombstone. */
+    if (virHashGroupMatch(table->ctrl + group, VIR_HASH_CTRL_EMPTY)) {
+        table->ctrl[slot] = VIR_HASH_CTRL_EMPTY;
+    } else {
+        table->ctrl[slot] = VIR_HASH_CTRL_DELETED;
+        table->nbDeleted++;
+    }
+    table->nbElems--;
+
+    if (table->dataFree)
+        table->dataFree(entry.payload);
+    if (table->keyFree)
+        table->keyFree(entry.name);
+}
+
 static int
 virHashAddOrUpdateEntry(virHashTablePtr table, const void *name,
                         void *userdata,
                         bool is_update)
 {
-    size_t key, len = 0;
-    virHashEntryPtr entry;
-    virHashEntryPtr last = NULL;
+    uint32_t code;
+    ssize_t slot;
 
     if ((table == NULL) || (name == NULL))
         return -1;
 
-    key = virHashComputeKey(table, name);
+    code = table->keyCode(name, table->seed);
 
     /* Check for duplicate entry */
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (is_update) {
-                if (table->dataFree)
-                    table->dataFree(entry->payload);
-                entry->payload = userdata;
-                return 0;
-            } else {
-                g_autofree char *keystr = NULL;
-
-                if (table->keyPrint)
-                    keystr = table->keyPrint(name);
-
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Duplicate hash table key '%s'"), NULLSTR(keystr));
-                return -1;
-            }
-        }
-        last = entry;
-        len++;
-    }
+    if ((slot = virHashFindSlot(table, name, code)) >= 0) {
+        virHashEntryPtr entry = table->table + slot;
 
-    entry = g_new0(virHashEntry, 1);
-    entry->name = table->keyCopy(name);
-    entry->payload = userdata;
+        if (is_update) {
+            if (table->dataFree)
+                table->dataFree(entry->payload);
+            entry->payload = userdata;
+            return 0;
+        } else {
+            g_autofree char *keystr = NULL;
 
-    if (last)
-        last->next = entry;
-    else
-        table->table[key] = entry;
+            if (table->keyPrint)
+                keystr = table->keyPrint(name);
 
-    table->nbElems++;
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Duplicate hash table key '%s'"), NULLSTR(keystr));
+            return -1;
+        }
+    }
 
-    if (len > MAX_HASH_LEN)
-        virHashGrow(table, MAX_HASH_LEN * table->size);
+    virHashInsert(table, name, code, userdata);
 
     return 0;
 }
@@ -445,19 +636,16 @@ static virHashEntryPtr
 virHashGetEntry(const virHashTable *table,
                 const void *name)
 {
-    size_t key;
-    virHashEntryPtr entry;
+    ssize_t slot;
 
     if (!table || !name)
         return NULL;
 
-    key = virHashComputeKey(table, name);
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name))
-            return entry;
-    }
+    slot = virHashFindSlot(table, name, table->keyCode(name, table->seed));
+    if (slot < 0)
+        return NULL;
 
-    return NULL;
+    return table->table + slot;
 }
 
 
@@ -556,7 +744,7 @@ virHashSize(const virHashTable *table)
  * virHashTableSize:
  * @table: the hash table
  *
- * Query the size of the hash @table, i.e., number of buckets in the table.
+ * Query the size of the hash @table, i.e., number of slots in the table.
  *
  * Returns the number of keys in the hash table or
  * -1 in case of error
@@ -584,28 +772,17 @@ virHashTableSize(const virHashTable *table)
 int
 virHashRemoveEntry(virHashTablePtr table, const void *name)
 {
-    virHashEntryPtr entry;
-    virHashEntryPtr *nextptr;
+    ssize_t slot;
 
     if (table == NULL || name == NULL)
         return -1;
 
-    nextptr = table->table + virHashComputeKey(table, name);
-    for (entry = *nextptr; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (table->dataFree)
-                table->dataFree(entry->payload);
-            if (table->keyFree)
-                table->keyFree(entry->name);
-            *nextptr = entry->next;
-            VIR_FREE(entry);
-            table->nbElems--;
-            return 0;
-        }
-        nextptr = &entry->next;
-    }
+    slot = virHashFindSlot(table, name, table->keyCode(name, table->seed));
+    if (slot < 0)
+        return -1;
 
-    return -1;
+    virHashRemoveSlot(table, slot);
+    return 0;
 }
 
 
@@ -626,22 +803,25 @@ virHashRemoveEntry(virHashTablePtr table, const void *name)
 int
 virHashForEach(virHashTablePtr table, virHashIterator iter, void *data)
 {
-    size_t i;
+    size_t group;
     int ret = -1;
 
     if (table == NULL || iter == NULL)
         return -1;
 
-    for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry = table->table[i];
-        while (entry) {
-            virHashEntryPtr next = entry->next;
+    for (group = 0; group < table->size; group += VIR_HASH_GROUP_WIDTH) {
+        unsigned int full = virHashGroupMatchFull(table->ctrl + group);
+
+        while (full) {
+            size_t slot = group + __builtin_ffs(full) - 1;
+            virHashEntryPtr entry = table->table + slot;
+
             ret = iter(entry->payload, entry->name, data);
 
             if (ret < 0)
                 return ret;
 
-            entry = next;
+            full = virHashGroupMatchFullAfter(table, group, slot);
         }
     }
 
@@ -667,28 +847,24 @@ virHashRemoveSet(virHashTablePtr table,
                  virHashSearcher iter,
                  const void *data)
 {
-    size_t i, count = 0;
+    size_t group, count = 0;
 
     if (table == NULL || iter == NULL)
         return -1;
 
-    for (i = 0; i < table->size; i++) {
-        virHashEntryPtr *nextptr = table->table + i;
+    for (group = 0; group < table->size; group += VIR_HASH_GROUP_WIDTH) {
+        unsigned int full = virHashGroupMatchFull(table->ctrl + group);
+
+        while (full) {
+            size_t slot = group + __builtin_ffs(full) - 1;
+            virHashEntryPtr entry = table->table + slot;
 
-        while (*nextptr) {
-            virHashEntryPtr entry = *nextptr;
-            if (!iter(entry->payload, entry->name, data)) {
-                nextptr = &entry->next;
-            } else {
+            if (iter(entry->payload, entry->name, data)) {
                 count++;
-                if (table->dataFree)
-                    table->dataFree(entry->payload);
-                if (table->keyFree)
-                    table->keyFree(entry->name);
-                *nextptr = entry->next;
-                VIR_FREE(entry);
-                table->nbElems--;
+                virHashRemoveSlot(table, slot);
             }
+
+            full = virHashGroupMatchFullAfter(table, group, slot);
         }
     }
 
@@ -738,7 +914,7 @@ void *virHashSearch(const virHashTable *ctable,
                     const void *data,
                     void **name)
 {
-    size_t i;
+    size_t group;
 
     /* Cast away const for internal detection of misuse.  */
     virHashTablePtr table = (virHashTablePtr)ctable;
@@ -746,9 +922,13 @@ void *virHashSearch(const virHashTable *ctable,
     if (table == NULL || iter == NULL)
         return NULL;
 
-    for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry;
-        for (entry = table->table[i]; entry; entry = entry->next) {
+    for (group = 0; group < table->size; group += VIR_HASH_GROUP_WIDTH) {
+        unsigned int full = virHashGroupMatchFull(table->ctrl + group);
+
+        while (full) {
+            virHashEntryPtr entry = table->table + group + __builtin_ffs(full) - 1;
+
+            full &= full - 1;
             if (iter(entry->payload, entry->name, data)) {
                 if (name)
                     *name = table->keyCopy(entry->name);
@@ -150,7 +150,7 @@ iptablesSetupPrivateChains(virFirewallLayer layer)
     };
     size_t i;
 
-    virFirewallStartTransaction(fw, 0);
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
 
     for (i = 0; i < G_N_ELEMENTS(data); i++)
         virFirewallAddRuleFull(fw, data[i].layer,
@@ -1839,7 +1839,6 @@ static const yajl_callbacks parserCallbacks = {
 };
 
 
-/* XXX add an incremental streaming parser - yajl trivially supports it */
 virJSONValuePtr
 virJSONValueFromString(const char *jsonstring)
 {
@@ -1899,6 +1898,191 @@ virJSONValueFromString(const char *jsonstring)
 }
 
 
+struct _virJSONStreamParser {
+    yajl_handle hand;
+    virJSONParser parser;
+    size_t maxlen; /* 0 means unlimited */
+    size_t len; /* bytes fed into the current document */
+    bool empty; /* only whitespace was fed so far */
+    bool failed;
+};
+
+
+static void
+virJSONStreamParserReset(virJSONStreamParserPtr stream)
+{
+    size_t i;
+
+    if (stream->hand) {
+        yajl_free(stream->hand);
+        stream->hand = NULL;
+    }
+
+    virJSONValueFree(stream->parser.head);
+    for (i = 0; i < stream->parser.nstate; i++)
+        VIR_FREE(stream->parser.state[i].key);
+    VIR_FREE(stream->parser.state);
+    memset(&stream->parser, 0, sizeof(stream->parser));
+
+    stream->len = 0;
+    stream->empty = true;
+    stream->failed = false;
+}
+
+
+/**
+ * virJSONStreamParserNew:
+ * @maxlen: maximum size of a single document in bytes (0 for unlimited)
+ *
+ * Creates a push-mode parser which is fed a JSON document piece
+ * by piece using virJSONStreamParserFeed() as the data arrives, so
+ * that the document doesn't have to be buffered in full before
+ * parsing it. Once the end of the document is known to the
+ * caller (e.g. a line ending in line based protocols) the value
+ * is retrieved by virJSONStreamParserFinish() and the parser is
+ * ready to accept the next document.
+ *
+ * Returns the new parser, or NULL on error.
+ */
+virJSONStreamParserPtr
+virJSONStreamParserNew(size_t maxlen)
+{
+    virJSONStreamParserPtr stream = g_new0(virJSONStreamParser, 1);
+
+    stream->maxlen = maxlen;
+    stream->empty = true;
+
+    return stream;
+}
+
+
+void
+virJSONStreamParserFree(virJSONStreamParserPtr stream)
+{
+    if (!stream)
+        return;
+
+    virJSONStreamParserReset(stream);
+    g_free(stream);
+}
+
+
+/**
+ * virJSONStreamParserFeed:
+ * @stream: parser
+ * @data: next piece of the document
+ * @len: length of @data
+ *
+ * Parses @data as a continuation of the current document. Once
+ * parsing fails the rest of the document is ignored and -1 is
+ * returned (reporting an error only the first time) until
+ * virJSONStreamParserFinish() is called.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONStreamParserFeed(virJSONStreamParserPtr stream,
+                        const char *data,
+                        size_t len)
+{
+    size_t i;
+
+    if (stream->failed)
+        return -1;
+
+    if (len == 0)
+        return 0;
+
+    if (stream->maxlen && len > stream->maxlen - stream->len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("JSON document exceeds maximum size (%zu bytes)"),
+                       stream->maxlen);
+        stream->failed = true;
+        return -1;
+    }
+    stream->len += len;
+
+    for (i = 0; stream->empty && i < len; i++) {
+        if (!g_ascii_isspace(data[i]))
+            stream->empty = false;
+    }
+
+    if (!stream->hand &&
+        !(stream->hand = yajl_alloc(&parserCallbacks, NULL, &stream->parser))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to create JSON parser"));
+        stream->failed = true;
+        return -1;
+    }
+
+    if (yajl_parse(stream->hand, (const unsigned char *)data, len) != yajl_status_ok) {
+        unsigned char *errstr = yajl_get_error(stream->hand, 1,
+                                               (const unsigned char *)data,
+                                               len);
+
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse json: %s"), (const char *) errstr);
+        yajl_free_error(stream->hand, errstr);
+        stream->failed = true;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virJSONStreamParserFinish:
+ * @stream: parser
+ * @value: filled with the parsed document
+ *
+ * Terminates the current document and resets @stream so that it
+ * can be fed the next one. If nothing but whitespace was fed,
+ * @value is set to NULL and success is returned. If feeding the
+ * document failed, no new error is reported.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONStreamParserFinish(virJSONStreamParserPtr stream,
+                          virJSONValuePtr *value)
+{
+    int ret = -1;
+
+    *value = NULL;
+
+    if (stream->failed)
+        goto cleanup;
+
+    if (stream->empty) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (yajl_complete_parse(stream->hand) != yajl_status_ok) {
+        unsigned char *errstr = yajl_get_error(stream->hand, 0, NULL, 0);
+
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse json: %s"), (const char *) errstr);
+        yajl_free_error(stream->hand, errstr);
+        goto cleanup;
+    }
+
+    if (stream->parser.nstate != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot parse json: unterminated string/map/array"));
+        goto cleanup;
+    }
+
+    *value = g_steal_pointer(&stream->parser.head);
+    ret = 0;
+
+ cleanup:
+    virJSONStreamParserReset(stream);
+    return ret;
+}
+
+
 static int
 virJSONValueToStringOne(virJSONValuePtr object,
                         yajl_gen g)
@@ -2016,6 +2200,43 @@ virJSONValueFromString(const char *jsonstring G_GNUC_UNUSED)
 }
 
 
+virJSONStreamParserPtr
+virJSONStreamParserNew(size_t maxlen G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
+
+
+void
+virJSONStreamParserFree(virJSONStreamParserPtr stream G_GNUC_UNUSED)
+{
+}
+
+
+int
+virJSONStreamParserFeed(virJSONStreamParserPtr stream G_GNUC_UNUSED,
+                        const char *data G_GNUC_UNUSED,
+                        size_t len G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
+int
+virJSONStreamParserFinish(virJSONStreamParserPtr stream G_GNUC_UNUSED,
+                          virJSONValuePtr *value)
+{
+    *value = NULL;
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
 int
 virJSONValueToBuffer(virJSONValuePtr object G_GNUC_UNUSED,
                      virBufferPtr buf G_GNUC_UNUSED,
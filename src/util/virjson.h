@@ -145,6 +145,19 @@ int virJSONValueObjectRemoveKey(virJSONValuePtr object, const char *key,
 int virJSONValueArrayAppendString(virJSONValuePtr object, const char *value);
 
 virJSONValuePtr virJSONValueFromString(const char *jsonstring);
+
+typedef struct _virJSONStreamParser virJSONStreamParser;
+typedef virJSONStreamParser *virJSONStreamParserPtr;
+
+virJSONStreamParserPtr virJSONStreamParserNew(size_t maxlen);
+void virJSONStreamParserFree(virJSONStreamParserPtr stream);
+int virJSONStreamParserFeed(virJSONStreamParserPtr stream,
+                            const char *data,
+                            size_t len)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+int virJSONStreamParserFinish(virJSONStreamParserPtr stream,
+                              virJSONValuePtr *value)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
 char *virJSONValueToString(virJSONValuePtr object,
                            bool pretty);
 int virJSONValueToBuffer(virJSONValuePtr object,
@@ -167,3 +180,4 @@ char *virJSONStringReformat(const char *jsonstr, bool pretty);
 virJSONValuePtr virJSONValueObjectDeflatten(virJSONValuePtr json);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONValue, virJSONValueFree);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONStreamParser, virJSONStreamParserFree);
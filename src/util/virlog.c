@@ -479,6 +479,30 @@ virLogSourceUpdate(virLogSourcePtr source)
 }
 
 
+/**
+ * virLogSourceIsEnabled:
+ * @source: where messages would come from
+ * @priority: the priority level
+ *
+ * Check whether a message of @priority from @source would be logged,
+ * so that callers can skip preparing expensive message arguments.
+ *
+ * Returns true if the message would be logged.
+ */
+bool
+virLogSourceIsEnabled(virLogSourcePtr source,
+                      virLogPriority priority)
+{
+    if (virLogInitialize() < 0)
+        return false;
+
+    if (source->serial < virLogFiltersSerial)
+        virLogSourceUpdate(source);
+
+    return priority >= source->priority;
+}
+
+
 /**
  * virLogVMessage:
  * @source: where is that message coming from
@@ -95,6 +95,9 @@ struct _virLogSource {
 #define VIR_ERROR(...) \
     VIR_ERROR_INT(&virLogSelf, __FILE__, __LINE__, __func__, __VA_ARGS__)
 
+#define VIR_LOG_ENABLED(priority) \
+    virLogSourceIsEnabled(&virLogSelf, priority)
+
 
 struct _virLogMetadata {
     const char *key;
@@ -150,6 +153,8 @@ int virLogGetNbOutputs(void);
 char *virLogGetFilters(void);
 char *virLogGetOutputs(void);
 virLogPriority virLogGetDefaultPriority(void);
+bool virLogSourceIsEnabled(virLogSourcePtr source,
+                           virLogPriority priority);
 int virLogSetDefaultPriority(virLogPriority priority);
 void virLogSetFromEnv(void);
 void virLogOutputFree(virLogOutputPtr output);
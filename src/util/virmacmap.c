@@ -23,9 +23,11 @@
 #include "virmacmap.h"
 #include "virobject.h"
 #include "virlog.h"
+#include "virerror.h"
 #include "virjson.h"
 #include "virfile.h"
 #include "virhash.h"
+#include "virnssindex.h"
 #include "virstring.h"
 #include "viralloc.h"
 
@@ -235,25 +237,35 @@ virMACMapHashDumper(void *payload,
 }
 
 
-static int
-virMacMapDumpStrLocked(virMacMapPtr mgr,
-                       char **str)
+static virJSONValuePtr
+virMacMapDumpJSONLocked(virMacMapPtr mgr)
 {
     virJSONValuePtr arr;
-    int ret = -1;
 
     arr = virJSONValueNewArray();
 
-    if (virHashForEach(mgr->macs, virMACMapHashDumper, arr) < 0)
-        goto cleanup;
+    if (virHashForEach(mgr->macs, virMACMapHashDumper, arr) < 0) {
+        virJSONValueFree(arr);
+        return NULL;
+    }
+
+    return arr;
+}
+
+
+static int
+virMacMapDumpStrLocked(virMacMapPtr mgr,
+                       char **str)
+{
+    g_autoptr(virJSONValue) arr = NULL;
+
+    if (!(arr = virMacMapDumpJSONLocked(mgr)))
+        return -1;
 
     if (!(*str = virJSONValueToString(arr, true)))
-        goto cleanup;
+        return -1;
 
-    ret = 0;
- cleanup:
-    virJSONValueFree(arr);
-    return ret;
+    return 0;
 }
 
 
@@ -261,14 +273,27 @@ static int
 virMacMapWriteFileLocked(virMacMapPtr mgr,
                          const char *file)
 {
+    g_autoptr(virJSONValue) arr = NULL;
     g_autofree char *str = NULL;
 
-    if (virMacMapDumpStrLocked(mgr, &str) < 0)
+    if (!(arr = virMacMapDumpJSONLocked(mgr)))
+        return -1;
+
+    if (!(str = virJSONValueToString(arr, true)))
         return -1;
 
     if (virFileRewriteStr(file, 0644, str) < 0)
         return -1;
 
+    /* Let the NSS module look up MACs without parsing the file. The
+     * index is only an optimization, the module falls back to the
+     * file itself when it is missing or stale. */
+    if (virNSSIndexWriteMACs(file, arr) < 0) {
+        VIR_WARN("Unable to write MAC index for %s: %s",
+                 file, virGetLastErrorMessage());
+        virResetLastError();
+    }
+
     return 0;
 }
 
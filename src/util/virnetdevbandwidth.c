@@ -19,15 +19,67 @@
 #include <config.h>
 #include <unistd.h>
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+# include <arpa/inet.h>
+# include <net/if.h>
+# include <linux/if_ether.h>
+# include <linux/pkt_cls.h>
+# include <linux/pkt_sched.h>
+# include <linux/rtnetlink.h>
+#endif
+
 #include "virnetdevbandwidth.h"
 #include "vircommand.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "virlog.h"
+#include "virnetlink.h"
 #include "virstring.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+VIR_LOG_INIT("util.netdevbandwidth");
+
+VIR_ENUM_IMPL(virNetDevBandwidthBackend,
+              VIR_NETDEV_BANDWIDTH_BACKEND_LAST,
+              "netlink",
+              "tc",
+);
+
+#if defined(__linux__) && defined(HAVE_LIBNL)
+static virNetDevBandwidthBackend backend = VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK;
+#else
+static virNetDevBandwidthBackend backend = VIR_NETDEV_BANDWIDTH_BACKEND_TC;
+#endif
+
+
+/**
+ * virNetDevBandwidthSetBackend:
+ * @newBackend: how to program QoS
+ *
+ * By default QoS is programmed by talking rtnetlink directly where
+ * available and by running tc otherwise. The daemons let the admin
+ * pick either, tests use this to check both.
+ *
+ * Returns 0 on success, -1 if @newBackend is not available.
+ */
+int
+virNetDevBandwidthSetBackend(virNetDevBandwidthBackend newBackend)
+{
+#if !defined(__linux__) || !defined(HAVE_LIBNL)
+    if (newBackend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                       _("the netlink bandwidth backend is not supported "
+                         "on this platform"));
+        return -1;
+    }
+#endif
+
+    backend = newBackend;
+    return 0;
+}
+
 void
 virNetDevBandwidthFree(virNetDevBandwidthPtr def)
 {
@@ -39,9 +91,8 @@ virNetDevBandwidthFree(virNetDevBandwidthPtr def)
     VIR_FREE(def);
 }
 
-static void
-virNetDevBandwidthCmdAddOptimalQuantum(virCommandPtr cmd,
-                                       const virNetDevBandwidthRate *rate)
+static unsigned long long
+virNetDevBandwidthGetOptimalQuantum(const virNetDevBandwidthRate *rate)
 {
     const unsigned long long mtu = 1500;
     unsigned long long r2q;
@@ -58,8 +109,16 @@ virNetDevBandwidthCmdAddOptimalQuantum(virCommandPtr cmd,
     if (!r2q)
         r2q = 1;
 
+    return r2q;
+}
+
+static void
+virNetDevBandwidthCmdAddOptimalQuantum(virCommandPtr cmd,
+                                       const virNetDevBandwidthRate *rate)
+{
     virCommandAddArg(cmd, "quantum");
-    virCommandAddArgFormat(cmd, "%llu", r2q);
+    virCommandAddArgFormat(cmd, "%llu",
+                           virNetDevBandwidthGetOptimalQuantum(rate));
 }
 
 /**
@@ -163,6 +222,785 @@ virNetDevBandwidthManipulateFilter(const char *ifname,
 }
 
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+
+/* tc measures time in ticks of the packet scheduler clock */
+# define VIR_NETDEV_BANDWIDTH_TICK_NSEC 64
+
+/* MTUs tc uses for rate tables of classes and policers */
+# define VIR_NETDEV_BANDWIDTH_HTB_MTU 1600
+# define VIR_NETDEV_BANDWIDTH_POLICE_MTU (64 * 1024)
+
+# define VIR_NETDEV_BANDWIDTH_RTAB_SIZE 256
+
+/* Handles of the qdiscs and classes set up by virNetDevBandwidthSet */
+# define VIR_NETDEV_BANDWIDTH_HANDLE(maj, min) TC_H_MAKE((maj) << 16, (min))
+
+typedef struct _virNetDevBandwidthRequest virNetDevBandwidthRequest;
+struct _virNetDevBandwidthRequest {
+    struct nl_msg *msg;
+    bool ignoreErrors;
+};
+
+/*
+ * All the requests needed to configure QoS on one interface. They are
+ * built up front so that nothing is changed if any of them cannot be
+ * constructed, and then sent in order.
+ */
+typedef struct _virNetDevBandwidthBatch virNetDevBandwidthBatch;
+typedef virNetDevBandwidthBatch *virNetDevBandwidthBatchPtr;
+struct _virNetDevBandwidthBatch {
+    const char *ifname;
+    int ifindex;
+
+    size_t nrequests;
+    virNetDevBandwidthRequest *requests;
+};
+
+
+/*
+ * Returns 1 if @ifname exists, 0 if it does not and @missingOK is set,
+ * in which case there is nothing to remove from it, and -1 on error.
+ */
+static int
+virNetDevBandwidthBatchInit(virNetDevBandwidthBatchPtr batch,
+                            const char *ifname,
+                            bool missingOK)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->ifname = ifname;
+
+    if ((batch->ifindex = if_nametoindex(ifname)) == 0) {
+        if (missingOK && (errno == ENODEV || errno == ENXIO))
+            return 0;
+
+        virReportSystemError(errno,
+                             _("Unable to get index for interface %s"),
+                             ifname);
+        return -1;
+    }
+
+    return 1;
+}
+
+
+static void
+virNetDevBandwidthBatchClear(virNetDevBandwidthBatchPtr batch)
+{
+    size_t i;
+
+    for (i = 0; i < batch->nrequests; i++)
+        nlmsg_free(batch->requests[i].msg);
+    VIR_FREE(batch->requests);
+    batch->nrequests = 0;
+}
+
+
+/*
+ * Appends a traffic control request of @type to @batch and returns the
+ * message for the caller to add options to. The message is owned by
+ * @batch.
+ */
+static struct nl_msg *
+virNetDevBandwidthBatchAdd(virNetDevBandwidthBatchPtr batch,
+                           int type,
+                           unsigned int flags,
+                           uint32_t parent,
+                           uint32_t handle,
+                           uint32_t info,
+                           const char *kind,
+                           bool ignoreErrors)
+{
+    virNetDevBandwidthRequest req = { NULL, ignoreErrors };
+    struct nl_msg *msg;
+    struct tcmsg tcm;
+
+    if (!(msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | flags))) {
+        virReportOOMError();
+        return NULL;
+    }
+    req.msg = msg;
+
+    memset(&tcm, 0, sizeof(tcm));
+    tcm.tcm_family = AF_UNSPEC;
+    tcm.tcm_ifindex = batch->ifindex;
+    tcm.tcm_parent = parent;
+    tcm.tcm_handle = handle;
+    tcm.tcm_info = info;
+
+    if (nlmsg_append(msg, &tcm, sizeof(tcm), NLMSG_ALIGNTO) < 0)
+        goto buffer_too_small;
+
+    if (kind)
+        NETLINK_MSG_PUT(msg, TCA_KIND, strlen(kind) + 1, kind);
+
+    if (VIR_APPEND_ELEMENT(batch->requests, batch->nrequests, req) < 0) {
+        nlmsg_free(msg);
+        return NULL;
+    }
+
+    return msg;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    nlmsg_free(msg);
+    return NULL;
+}
+
+
+static int
+virNetDevBandwidthBatchRun(virNetDevBandwidthBatchPtr batch)
+{
+    size_t i;
+
+    VIR_DEBUG("Sending %zu QoS requests for %s",
+              batch->nrequests, batch->ifname);
+
+    for (i = 0; i < batch->nrequests; i++) {
+        g_autofree struct nlmsghdr *resp = NULL;
+        unsigned int recvbuflen;
+        int rc;
+
+        if (virNetlinkCommand(batch->requests[i].msg, &resp, &recvbuflen,
+                              0, 0, NETLINK_ROUTE, 0) < 0)
+            return -1;
+
+        if ((rc = virNetlinkGetErrorCode(resp, recvbuflen)) < 0 &&
+            !batch->requests[i].ignoreErrors) {
+            virReportSystemError(-rc,
+                                 _("Unable to set QoS on interface %s"),
+                                 batch->ifname);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* tc's kbps are 1000 bytes per second */
+static unsigned long long
+virNetDevBandwidthRateToBytes(unsigned long long kbps)
+{
+    return kbps * 1000;
+}
+
+
+/*
+ * Time to send @size bytes at @rate bytes per second, in ticks. Like
+ * tc, round down to whole microseconds first so that the kernel ends
+ * up with exactly the same values either way.
+ */
+static uint32_t
+virNetDevBandwidthXmitTime(unsigned long long rate,
+                           unsigned long long size)
+{
+    double usec;
+    double ticks;
+
+    if (!rate)
+        return 0;
+
+    usec = 1000000 * ((double) size / rate);
+    if (usec >= UINT32_MAX)
+        return UINT32_MAX;
+
+    ticks = (double) (uint32_t) usec * 1000 / VIR_NETDEV_BANDWIDTH_TICK_NSEC;
+
+    return ticks < UINT32_MAX ? ticks : UINT32_MAX;
+}
+
+
+/* Rates from here on need a separate 64 bit attribute */
+#define VIR_NETDEV_BANDWIDTH_RATE64 (1ULL << 32)
+
+
+/*
+ * Set @rate in @spec and compute the rate table older kernels need,
+ * both the way tc does for Ethernet. Like tc, rates which do not fit
+ * 32 bits are saturated in @spec and the caller has to pass them in
+ * full in the qdisc specific 64 bit attribute.
+ */
+static void
+virNetDevBandwidthFillRate(struct tc_ratespec *spec,
+                           uint32_t *rtab,
+                           unsigned long long rate,
+                           unsigned int mtu)
+{
+    int cell_log = 0;
+    size_t i;
+
+    memset(spec, 0, sizeof(*spec));
+    spec->rate = rate >= VIR_NETDEV_BANDWIDTH_RATE64 ? UINT32_MAX : rate;
+
+    while ((mtu >> cell_log) > 255)
+        cell_log++;
+
+    for (i = 0; i < VIR_NETDEV_BANDWIDTH_RTAB_SIZE; i++)
+        rtab[i] = virNetDevBandwidthXmitTime(rate, (i + 1) << cell_log);
+
+    spec->cell_align = -1;
+    spec->cell_log = cell_log;
+    spec->linklayer = TC_LINKLAYER_ETHERNET;
+}
+
+
+static int
+virNetDevBandwidthBatchAddHTBQdisc(virNetDevBandwidthBatchPtr batch,
+                                   uint32_t defcls)
+{
+    struct tc_htb_glob glob;
+    struct nlattr *options;
+    struct nl_msg *msg;
+
+    memset(&glob, 0, sizeof(glob));
+    glob.version = TC_HTB_PROTOVER;
+    glob.rate2quantum = 10;
+    glob.defcls = defcls;
+
+    if (!(msg = virNetDevBandwidthBatchAdd(batch, RTM_NEWQDISC,
+                                           NLM_F_CREATE | NLM_F_EXCL,
+                                           TC_H_ROOT,
+                                           VIR_NETDEV_BANDWIDTH_HANDLE(1, 0),
+                                           0, "htb", false)))
+        return -1;
+
+    NETLINK_MSG_NEST_START(msg, options, TCA_OPTIONS);
+    NETLINK_MSG_PUT(msg, TCA_HTB_INIT, sizeof(glob), &glob);
+    NETLINK_MSG_NEST_END(msg, options);
+
+    return 0;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    return -1;
+}
+
+
+/*
+ * Adds or, if @change is set, changes the HTB class @classid. @rate and
+ * @ceil are in bytes per second and @burst in bytes, zero meaning the
+ * default tc would pick.
+ */
+static int
+virNetDevBandwidthBatchAddHTBClass(virNetDevBandwidthBatchPtr batch,
+                                   bool change,
+                                   uint32_t parent,
+                                   uint32_t classid,
+                                   unsigned long long rate,
+                                   unsigned long long ceil,
+                                   unsigned long long burst,
+                                   unsigned long long quantum)
+{
+    uint32_t rtab[VIR_NETDEV_BANDWIDTH_RTAB_SIZE];
+    uint32_t ctab[VIR_NETDEV_BANDWIDTH_RTAB_SIZE];
+    unsigned long long cburst;
+    struct tc_htb_opt opt;
+    struct nlattr *options;
+    struct nl_msg *msg;
+
+    /* what tc picks on hosts with high resolution timers */
+    if (!burst)
+        burst = rate / 1000000000 + VIR_NETDEV_BANDWIDTH_HTB_MTU;
+    cburst = ceil / 1000000000 + VIR_NETDEV_BANDWIDTH_HTB_MTU;
+
+    memset(&opt, 0, sizeof(opt));
+    virNetDevBandwidthFillRate(&opt.rate, rtab, rate,
+                               VIR_NETDEV_BANDWIDTH_HTB_MTU);
+    virNetDevBandwidthFillRate(&opt.ceil, ctab, ceil,
+                               VIR_NETDEV_BANDWIDTH_HTB_MTU);
+    opt.buffer = virNetDevBandwidthXmitTime(rate, burst);
+    opt.cbuffer = virNetDevBandwidthXmitTime(ceil, cburst);
+    opt.quantum = MIN(quantum, UINT32_MAX);
+
+    if (!(msg = virNetDevBandwidthBatchAdd(batch, RTM_NEWTCLASS,
+                                           change ? 0 : NLM_F_CREATE | NLM_F_EXCL,
+                                           parent, classid, 0, "htb", false)))
+        return -1;
+
+    NETLINK_MSG_NEST_START(msg, options, TCA_OPTIONS);
+    if (rate >= VIR_NETDEV_BANDWIDTH_RATE64) {
+        uint64_t rate64 = rate;
+
+        NETLINK_MSG_PUT(msg, TCA_HTB_RATE64, sizeof(rate64), &rate64);
+    }
+    if (ceil >= VIR_NETDEV_BANDWIDTH_RATE64) {
+        uint64_t ceil64 = ceil;
+
+        NETLINK_MSG_PUT(msg, TCA_HTB_CEIL64, sizeof(ceil64), &ceil64);
+    }
+    NETLINK_MSG_PUT(msg, TCA_HTB_PARMS, sizeof(opt), &opt);
+    NETLINK_MSG_PUT(msg, TCA_HTB_RTAB, sizeof(rtab), rtab);
+    NETLINK_MSG_PUT(msg, TCA_HTB_CTAB, sizeof(ctab), ctab);
+    NETLINK_MSG_NEST_END(msg, options);
+
+    return 0;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    return -1;
+}
+
+
+static int
+virNetDevBandwidthBatchAddSFQQdisc(virNetDevBandwidthBatchPtr batch,
+                                   uint32_t parent,
+                                   uint32_t handle)
+{
+    struct tc_sfq_qopt opt;
+    struct nl_msg *msg;
+
+    memset(&opt, 0, sizeof(opt));
+    opt.perturb_period = 10;
+
+    if (!(msg = virNetDevBandwidthBatchAdd(batch, RTM_NEWQDISC,
+                                           NLM_F_CREATE | NLM_F_EXCL,
+                                           parent, handle, 0, "sfq", false)))
+        return -1;
+
+    NETLINK_MSG_PUT(msg, TCA_OPTIONS, sizeof(opt), &opt);
+
+    return 0;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    return -1;
+}
+
+
+/* Steers all traffic marked by the firewall into class 1 */
+static int
+virNetDevBandwidthBatchAddFWFilter(virNetDevBandwidthBatchPtr batch)
+{
+    uint32_t classid = 1;
+    struct nlattr *options;
+    struct nl_msg *msg;
+
+    if (!(msg = virNetDevBandwidthBatchAdd(batch, RTM_NEWTFILTER,
+                                           NLM_F_CREATE | NLM_F_EXCL,
+                                           VIR_NETDEV_BANDWIDTH_HANDLE(1, 0), 1,
+                                           TC_H_MAKE(1 << 16, htons(ETH_P_ALL)),
+                                           "fw", false)))
+        return -1;
+
+    NETLINK_MSG_NEST_START(msg, options, TCA_OPTIONS);
+    NETLINK_MSG_PUT(msg, TCA_FW_CLASSID, sizeof(classid), &classid);
+    NETLINK_MSG_NEST_END(msg, options);
+
+    return 0;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    return -1;
+}
+
+
+/*
+ * Adds a u32 filter matching @keys, which are in network byte order,
+ * and placing traffic into @classid. If @policeRate is not zero, the
+ * traffic exceeding it, in bytes per second, with bursts of up to
+ * @policeBurst bytes is dropped.
+ */
+static int
+virNetDevBandwidthBatchAddU32Filter(virNetDevBandwidthBatchPtr batch,
+                                    uint32_t parent,
+                                    uint32_t handle,
+                                    uint16_t prio,
+                                    uint16_t protocol,
+                                    const struct tc_u32_key *keys,
+                                    size_t nkeys,
+                                    uint32_t classid,
+                                    unsigned long long policeRate,
+                                    unsigned long long policeBurst)
+{
+    size_t sellen = sizeof(struct tc_u32_sel) + nkeys * sizeof(*keys);
+    g_autofree struct tc_u32_sel *sel = g_malloc0(sellen);
+    struct nlattr *options;
+    struct nl_msg *msg;
+
+    sel->flags = TC_U32_TERMINAL;
+    sel->nkeys = nkeys;
+    memcpy(sel->keys, keys, nkeys * sizeof(*keys));
+
+#if !HAVE_DECL_TCA_POLICE_RATE64
+    if (policeRate >= VIR_NETDEV_BANDWIDTH_RATE64) {
+        virReportError(VIR_ERR_OPERATION_UNSUPPORTED,
+                       _("policing rate %llu bytes/s is not supported over "
+                         "netlink by this build, use the tc bandwidth backend"),
+                       policeRate);
+        return -1;
+    }
+#endif
+
+    if (!(msg = virNetDevBandwidthBatchAdd(batch, RTM_NEWTFILTER,
+                                           NLM_F_CREATE | NLM_F_EXCL,
+                                           parent, handle,
+                                           TC_H_MAKE(prio << 16, htons(protocol)),
+                                           "u32", false)))
+        return -1;
+
+    NETLINK_MSG_NEST_START(msg, options, TCA_OPTIONS);
+    NETLINK_MSG_PUT(msg, TCA_U32_CLASSID, sizeof(classid), &classid);
+
+    if (policeRate) {
+        uint32_t rtab[VIR_NETDEV_BANDWIDTH_RTAB_SIZE];
+        struct tc_police police;
+        struct nlattr *nest;
+
+        memset(&police, 0, sizeof(police));
+        police.action = TC_POLICE_SHOT;
+        police.mtu = VIR_NETDEV_BANDWIDTH_POLICE_MTU;
+        virNetDevBandwidthFillRate(&police.rate, rtab, policeRate,
+                                   VIR_NETDEV_BANDWIDTH_POLICE_MTU);
+        police.burst = virNetDevBandwidthXmitTime(policeRate, policeBurst);
+
+        NETLINK_MSG_NEST_START(msg, nest, TCA_U32_POLICE);
+        NETLINK_MSG_PUT(msg, TCA_POLICE_TBF, sizeof(police), &police);
+        NETLINK_MSG_PUT(msg, TCA_POLICE_RATE, sizeof(rtab), rtab);
+#if HAVE_DECL_TCA_POLICE_RATE64
+        if (policeRate >= VIR_NETDEV_BANDWIDTH_RATE64) {
+            uint64_t rate64 = policeRate;
+
+            NETLINK_MSG_PUT(msg, TCA_POLICE_RATE64, sizeof(rate64), &rate64);
+        }
+#endif
+        NETLINK_MSG_NEST_END(msg, nest);
+    }
+
+    NETLINK_MSG_PUT(msg, TCA_U32_SEL, sellen, sel);
+    NETLINK_MSG_NEST_END(msg, options);
+
+    return 0;
+
+ buffer_too_small:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+    return -1;
+}
+
+
+/*
+ * Filters matching guest MACs on a bridge have always been created
+ * by tc as "800::@id", which takes the decimal @id for a hexadecimal
+ * node ID. Keep it that way so that existing filters can be found.
+ */
+static int
+virNetDevBandwidthGetFilterHandle(unsigned int id,
+                                  uint32_t *handle)
+{
+    char idstr[32];
+    unsigned int node;
+
+    g_snprintf(idstr, sizeof(idstr), "%u", id);
+
+    if (virStrToLong_ui(idstr, NULL, 16, &node) < 0 || node > 0xfff) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Invalid filter ID %u"), id);
+        return -1;
+    }
+
+    *handle = (0x800 << 20) | node;
+    return 0;
+}
+
+
+static int
+virNetDevBandwidthBatchAddMACFilter(virNetDevBandwidthBatchPtr batch,
+                                    const virMacAddr *ifmac_ptr,
+                                    unsigned int id,
+                                    uint32_t classid)
+{
+    unsigned char ifmac[VIR_MAC_BUFLEN];
+    struct tc_u32_key keys[3];
+    uint32_t handle;
+
+    if (virNetDevBandwidthGetFilterHandle(id, &handle) < 0)
+        return -1;
+
+    virMacAddrGetRaw(ifmac_ptr, ifmac);
+    memset(keys, 0, sizeof(keys));
+
+    /* See virNetDevBandwidthManipulateFilter for the tc equivalent. The
+     * offsets are relative to the IP header and aligned to 32 bits. */
+    keys[0].mask = htonl(0xffff);
+    keys[0].val = htonl(ETH_P_IP);
+    keys[0].off = -4;
+
+    keys[1].mask = htonl(0xffffffff);
+    keys[1].val = htonl((ifmac[2] << 24) | (ifmac[3] << 16) |
+                        (ifmac[4] << 8) | ifmac[5]);
+    keys[1].off = -12;
+
+    keys[2].mask = htonl(0xffff);
+    keys[2].val = htonl((ifmac[0] << 8) | ifmac[1]);
+    keys[2].off = -16;
+
+    return virNetDevBandwidthBatchAddU32Filter(batch, 0, handle, 2, ETH_P_IP,
+                                               keys, G_N_ELEMENTS(keys),
+                                               classid, 0, 0);
+}
+
+
+static int
+virNetDevBandwidthBatchDelMACFilter(virNetDevBandwidthBatchPtr batch,
+                                    unsigned int id)
+{
+    uint32_t handle;
+
+    /* tc could not have created the filter either */
+    if (virNetDevBandwidthGetFilterHandle(id, &handle) < 0) {
+        virResetLastError();
+        return 0;
+    }
+
+    if (!virNetDevBandwidthBatchAdd(batch, RTM_DELTFILTER, 0, 0, handle,
+                                    TC_H_MAKE(2 << 16, 0), "u32", true))
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virNetDevBandwidthBatchAddClear(virNetDevBandwidthBatchPtr batch)
+{
+    /* Removing the default qdiscs fails, which is fine */
+    if (!virNetDevBandwidthBatchAdd(batch, RTM_DELQDISC, 0, TC_H_ROOT, 0,
+                                    0, NULL, true) ||
+        !virNetDevBandwidthBatchAdd(batch, RTM_DELQDISC, 0, TC_H_INGRESS,
+                                    TC_H_MAKE(TC_H_INGRESS, 0),
+                                    0, NULL, true))
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Netlink counterpart of the tc commands run by virNetDevBandwidthSet,
+ * see there for the hierarchy that is created.
+ */
+static int
+virNetDevBandwidthSetNetlink(const char *ifname,
+                             const virNetDevBandwidthRate *rx,
+                             const virNetDevBandwidthRate *tx,
+                             bool hierarchical_class)
+{
+    virNetDevBandwidthBatch batch;
+    int ret = -1;
+
+    if (virNetDevBandwidthBatchInit(&batch, ifname, false) < 0)
+        return -1;
+
+    if (virNetDevBandwidthBatchAddClear(&batch) < 0)
+        goto cleanup;
+
+    if (tx && tx->average) {
+        unsigned long long average = virNetDevBandwidthRateToBytes(tx->average);
+        unsigned long long peak = virNetDevBandwidthRateToBytes(tx->peak);
+        unsigned long long quantum = virNetDevBandwidthGetOptimalQuantum(tx);
+        uint32_t parent = VIR_NETDEV_BANDWIDTH_HANDLE(1, hierarchical_class ? 1 : 0);
+        uint32_t leaf = VIR_NETDEV_BANDWIDTH_HANDLE(1, hierarchical_class ? 2 : 1);
+
+        if (virNetDevBandwidthBatchAddHTBQdisc(&batch,
+                                               hierarchical_class ? 2 : 1) < 0)
+            goto cleanup;
+
+        if (hierarchical_class &&
+            virNetDevBandwidthBatchAddHTBClass(&batch, false,
+                                               VIR_NETDEV_BANDWIDTH_HANDLE(1, 0),
+                                               VIR_NETDEV_BANDWIDTH_HANDLE(1, 1),
+                                               average, peak ? peak : average,
+                                               0, quantum) < 0)
+            goto cleanup;
+
+        if (virNetDevBandwidthBatchAddHTBClass(&batch, false, parent, leaf,
+                                               average, peak ? peak : average,
+                                               tx->burst * 1024, quantum) < 0)
+            goto cleanup;
+
+        if (virNetDevBandwidthBatchAddSFQQdisc(&batch, leaf,
+                                               VIR_NETDEV_BANDWIDTH_HANDLE(2, 0)) < 0)
+            goto cleanup;
+
+        if (virNetDevBandwidthBatchAddFWFilter(&batch) < 0)
+            goto cleanup;
+    }
+
+    if (rx) {
+        struct tc_u32_key matchAll;
+
+        memset(&matchAll, 0, sizeof(matchAll));
+
+        if (!virNetDevBandwidthBatchAdd(&batch, RTM_NEWQDISC,
+                                        NLM_F_CREATE | NLM_F_EXCL,
+                                        TC_H_INGRESS,
+                                        TC_H_MAKE(TC_H_INGRESS, 0),
+                                        0, "ingress", false))
+            goto cleanup;
+
+        if (virNetDevBandwidthBatchAddU32Filter(&batch,
+                                                TC_H_MAKE(TC_H_INGRESS, 0),
+                                                0, 0, ETH_P_ALL,
+                                                &matchAll, 1, 1,
+                                                virNetDevBandwidthRateToBytes(rx->average),
+                                                (rx->burst ? rx->burst : rx->average) * 1024) < 0)
+            goto cleanup;
+    }
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+
+
+static int
+virNetDevBandwidthClearNetlink(const char *ifname)
+{
+    virNetDevBandwidthBatch batch;
+    int ret = -1;
+    int rc;
+
+    if ((rc = virNetDevBandwidthBatchInit(&batch, ifname, true)) <= 0)
+        return rc;
+
+    if (virNetDevBandwidthBatchAddClear(&batch) < 0)
+        goto cleanup;
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+
+
+static int
+virNetDevBandwidthPlugNetlink(const char *brname,
+                              virNetDevBandwidthPtr net_bandwidth,
+                              const virMacAddr *ifmac_ptr,
+                              virNetDevBandwidthPtr bandwidth,
+                              unsigned int id)
+{
+    virNetDevBandwidthBatch batch;
+    uint32_t classid = VIR_NETDEV_BANDWIDTH_HANDLE(1, id);
+    unsigned long long floor = virNetDevBandwidthRateToBytes(bandwidth->in->floor);
+    unsigned long long ceil = virNetDevBandwidthRateToBytes(net_bandwidth->in->peak ?
+                                                            net_bandwidth->in->peak :
+                                                            net_bandwidth->in->average);
+    unsigned long long quantum = virNetDevBandwidthGetOptimalQuantum(bandwidth->in);
+    int ret = -1;
+
+    if (virNetDevBandwidthBatchInit(&batch, brname, false) < 0)
+        return -1;
+
+    if (virNetDevBandwidthBatchAddHTBClass(&batch, false,
+                                           VIR_NETDEV_BANDWIDTH_HANDLE(1, 1),
+                                           classid, floor, ceil, 0, quantum) < 0 ||
+        virNetDevBandwidthBatchAddSFQQdisc(&batch, classid,
+                                           VIR_NETDEV_BANDWIDTH_HANDLE(id, 0)) < 0 ||
+        virNetDevBandwidthBatchAddMACFilter(&batch, ifmac_ptr, id, classid) < 0)
+        goto cleanup;
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+
+
+static int
+virNetDevBandwidthUnplugNetlink(const char *brname,
+                                unsigned int id)
+{
+    virNetDevBandwidthBatch batch;
+    uint32_t classid = VIR_NETDEV_BANDWIDTH_HANDLE(1, id);
+    int ret = -1;
+    int rc;
+
+    if ((rc = virNetDevBandwidthBatchInit(&batch, brname, true)) <= 0)
+        return rc;
+
+    /* Don't treat errors as fatal, but try to remove as much as possible */
+    if (!virNetDevBandwidthBatchAdd(&batch, RTM_DELQDISC, 0, classid,
+                                    VIR_NETDEV_BANDWIDTH_HANDLE(id, 0),
+                                    0, NULL, true) ||
+        virNetDevBandwidthBatchDelMACFilter(&batch, id) < 0 ||
+        !virNetDevBandwidthBatchAdd(&batch, RTM_DELTCLASS, 0, 0, classid,
+                                    0, NULL, true))
+        goto cleanup;
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+
+
+static int
+virNetDevBandwidthUpdateRateNetlink(const char *ifname,
+                                   unsigned int id,
+                                   virNetDevBandwidthPtr bandwidth,
+                                   unsigned long long new_rate)
+{
+    virNetDevBandwidthBatch batch;
+    unsigned long long rate = virNetDevBandwidthRateToBytes(new_rate);
+    unsigned long long ceil = virNetDevBandwidthRateToBytes(bandwidth->in->peak ?
+                                                            bandwidth->in->peak :
+                                                            bandwidth->in->average);
+    unsigned long long quantum = virNetDevBandwidthGetOptimalQuantum(bandwidth->in);
+    int ret = -1;
+
+    if (virNetDevBandwidthBatchInit(&batch, ifname, false) < 0)
+        return -1;
+
+    if (virNetDevBandwidthBatchAddHTBClass(&batch, true, 0,
+                                           VIR_NETDEV_BANDWIDTH_HANDLE(1, id),
+                                           rate, ceil, 0, quantum) < 0)
+        goto cleanup;
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+
+
+static int
+virNetDevBandwidthUpdateFilterNetlink(const char *ifname,
+                                      const virMacAddr *ifmac_ptr,
+                                      unsigned int id)
+{
+    virNetDevBandwidthBatch batch;
+    int ret = -1;
+
+    if (virNetDevBandwidthBatchInit(&batch, ifname, false) < 0)
+        return -1;
+
+    if (virNetDevBandwidthBatchDelMACFilter(&batch, id) < 0 ||
+        virNetDevBandwidthBatchAddMACFilter(&batch, ifmac_ptr, id,
+                                            VIR_NETDEV_BANDWIDTH_HANDLE(1, id)) < 0)
+        goto cleanup;
+
+    ret = virNetDevBandwidthBatchRun(&batch);
+
+ cleanup:
+    virNetDevBandwidthBatchClear(&batch);
+    return ret;
+}
+#endif /* defined(__linux__) && defined(HAVE_LIBNL) */
+
+
 /**
  * virNetDevBandwidthSet:
  * @ifname: on which interface
@@ -227,6 +1065,11 @@ virNetDevBandwidthSet(const char *ifname,
         tx = bandwidth->out;
     }
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthSetNetlink(ifname, rx, tx, hierarchical_class);
+#endif
+
     virNetDevBandwidthClear(ifname);
 
     if (tx && tx->average) {
@@ -411,6 +1254,11 @@ virNetDevBandwidthClear(const char *ifname)
     if (!ifname)
        return 0;
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthClearNetlink(ifname);
+#endif
+
     cmd = virCommandNew(TC);
     virCommandAddArgList(cmd, "qdisc", "del", "dev", ifname, "root", NULL);
 
@@ -568,6 +1416,12 @@ virNetDevBandwidthPlug(const char *brname,
         return -1;
     }
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthPlugNetlink(brname, net_bandwidth, ifmac_ptr,
+                                             bandwidth, id);
+#endif
+
     class_id = g_strdup_printf("1:%x", id);
     qdisc_id = g_strdup_printf("%x:", id);
     floor = g_strdup_printf("%llukbps", bandwidth->in->floor);
@@ -632,6 +1486,11 @@ virNetDevBandwidthUnplug(const char *brname,
         return -1;
     }
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthUnplugNetlink(brname, id);
+#endif
+
     class_id = g_strdup_printf("1:%x", id);
     qdisc_id = g_strdup_printf("%x:", id);
 
@@ -691,6 +1550,12 @@ virNetDevBandwidthUpdateRate(const char *ifname,
     char *rate = NULL;
     char *ceil = NULL;
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthUpdateRateNetlink(ifname, id, bandwidth,
+                                                   new_rate);
+#endif
+
     class_id = g_strdup_printf("1:%x", id);
     rate = g_strdup_printf("%llukbps", new_rate);
     ceil = g_strdup_printf("%llukbps", bandwidth->in->peak ?
@@ -741,6 +1606,11 @@ virNetDevBandwidthUpdateFilter(const char *ifname,
     int ret = -1;
     char *class_id = NULL;
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK)
+        return virNetDevBandwidthUpdateFilterNetlink(ifname, ifmac_ptr, id);
+#endif
+
     class_id = g_strdup_printf("1:%x", id);
 
     if (virNetDevBandwidthManipulateFilter(ifname, ifmac_ptr, id,
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "internal.h"
+#include "virenum.h"
 #include "virmacaddr.h"
 
 typedef struct _virNetDevBandwidthRate virNetDevBandwidthRate;
@@ -36,6 +37,17 @@ struct _virNetDevBandwidth {
     virNetDevBandwidthRatePtr in, out;
 };
 
+typedef enum {
+    VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK,
+    VIR_NETDEV_BANDWIDTH_BACKEND_TC,
+
+    VIR_NETDEV_BANDWIDTH_BACKEND_LAST,
+} virNetDevBandwidthBackend;
+
+VIR_ENUM_DECL(virNetDevBandwidthBackend);
+
+int virNetDevBandwidthSetBackend(virNetDevBandwidthBackend newBackend);
+
 void virNetDevBandwidthFree(virNetDevBandwidthPtr def);
 
 int virNetDevBandwidthSet(const char *ifname,
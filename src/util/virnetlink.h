@@ -67,7 +67,8 @@ void virNetlinkShutdown(void);
 int virNetlinkCommand(struct nl_msg *nl_msg,
                       struct nlmsghdr **resp, unsigned int *respbuflen,
                       uint32_t src_pid, uint32_t dst_pid,
-                      unsigned int protocol, unsigned int groups);
+                      unsigned int protocol, unsigned int groups)
+    G_GNUC_NO_INLINE;
 
 typedef int (*virNetlinkDumpCallback)(struct nlmsghdr *resp,
                                       void *data);
@@ -0,0 +1,315 @@
+/*
+ * virnssindex.c: writer of the NSS lease/MAC index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <sys/stat.h>
+
+#include "virnssindex.h"
+#include "virnssindexformat.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virsocketaddr.h"
+
+#define VIR_FROM_THIS VIR_FROM_NETWORK
+
+VIR_LOG_INIT("util.nssindex");
+
+typedef struct _virNSSIndexBuilder virNSSIndexBuilder;
+struct _virNSSIndexBuilder {
+    virNSSIndexRecord *records;
+    size_t nrecords;
+    GByteArray *strtab;
+};
+
+typedef struct _virNSSIndexData virNSSIndexData;
+struct _virNSSIndexData {
+    const char *data;
+    size_t len;
+};
+
+
+char *
+virNSSIndexFileName(const char *srcFile)
+{
+    return g_strdup_printf("%s%s", srcFile, VIR_NSS_INDEX_SUFFIX);
+}
+
+
+static void
+virNSSIndexBuilderInit(virNSSIndexBuilder *builder)
+{
+    memset(builder, 0, sizeof(*builder));
+    builder->strtab = g_byte_array_new();
+
+    /* offset 0 is reserved for the empty string */
+    g_byte_array_append(builder->strtab, (const guint8 *) "", 1);
+}
+
+
+static void
+virNSSIndexBuilderClear(virNSSIndexBuilder *builder)
+{
+    VIR_FREE(builder->records);
+    builder->nrecords = 0;
+    g_byte_array_unref(builder->strtab);
+    builder->strtab = NULL;
+}
+
+
+static uint32_t
+virNSSIndexBuilderAddString(virNSSIndexBuilder *builder,
+                            const char *str)
+{
+    uint32_t off = builder->strtab->len;
+
+    if (!str || !*str)
+        return 0;
+
+    g_byte_array_append(builder->strtab, (const guint8 *) str, strlen(str) + 1);
+    return off;
+}
+
+
+static int
+virNSSIndexWriteHelper(int fd,
+                       const void *opaque)
+{
+    const virNSSIndexData *data = opaque;
+
+    if (safewrite(fd, data->data, data->len) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Lay out the records collected in @builder in the index format and
+ * atomically replace the index belonging to @srcFile. The identity of
+ * @srcFile is recorded so that readers can tell whether the index still
+ * describes it.
+ */
+static int
+virNSSIndexBuilderWrite(virNSSIndexBuilder *builder,
+                        const char *srcFile,
+                        virNSSIndexType type)
+{
+    g_autofree char *file = virNSSIndexFileName(srcFile);
+    g_autofree char *buf = NULL;
+    virNSSIndexData data;
+    virNSSIndexHeader *hdr;
+    virNSSIndexRecord *records;
+    uint32_t *nameBuckets;
+    uint32_t *macBuckets;
+    char *strtab;
+    size_t nbuckets = 8;
+    struct stat sb;
+    size_t i;
+
+    if (stat(srcFile, &sb) < 0) {
+        virReportSystemError(errno, _("cannot stat file '%s'"), srcFile);
+        return -1;
+    }
+
+    if (builder->nrecords >= UINT32_MAX / 2 ||
+        builder->strtab->len >= UINT32_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("too many entries for index '%s'"), file);
+        return -1;
+    }
+
+    /* keep chains short, each record is linked into both tables */
+    while (nbuckets < builder->nrecords)
+        nbuckets *= 2;
+
+    data.len = sizeof(*hdr) +
+        2 * nbuckets * sizeof(*nameBuckets) +
+        builder->nrecords * sizeof(*records) +
+        builder->strtab->len;
+    buf = g_new0(char, data.len);
+    data.data = buf;
+
+    hdr = (virNSSIndexHeader *) buf;
+    nameBuckets = (uint32_t *) (hdr + 1);
+    macBuckets = nameBuckets + nbuckets;
+    records = (virNSSIndexRecord *) (macBuckets + nbuckets);
+    strtab = (char *) (records + builder->nrecords);
+
+    memcpy(hdr->magic, VIR_NSS_INDEX_MAGIC, VIR_NSS_INDEX_MAGIC_LEN);
+    hdr->version = VIR_NSS_INDEX_VERSION;
+    hdr->type = type;
+    hdr->srcDev = sb.st_dev;
+    hdr->srcIno = sb.st_ino;
+    hdr->srcSize = sb.st_size;
+    hdr->srcMtime = sb.st_mtime;
+    hdr->nbuckets = nbuckets;
+    hdr->nrecords = builder->nrecords;
+    hdr->strtabLen = builder->strtab->len;
+
+    if (builder->nrecords)
+        memcpy(records, builder->records,
+               builder->nrecords * sizeof(*records));
+    memcpy(strtab, builder->strtab->data, builder->strtab->len);
+
+    /* Link from the back so that every chain follows the file order */
+    for (i = builder->nrecords; i > 0; i--) {
+        virNSSIndexRecord *rec = &records[i - 1];
+        uint32_t *bucket;
+
+        if (rec->name) {
+            bucket = &nameBuckets[virNSSIndexHash(strtab + rec->name) & (nbuckets - 1)];
+            rec->nextName = *bucket;
+            *bucket = i;
+        }
+
+        if (rec->mac) {
+            bucket = &macBuckets[virNSSIndexHash(strtab + rec->mac) & (nbuckets - 1)];
+            rec->nextMAC = *bucket;
+            *bucket = i;
+        }
+    }
+
+    VIR_DEBUG("Writing %zu records with %zu buckets to %s",
+              builder->nrecords, nbuckets, file);
+
+    return virFileRewrite(file, 0644, virNSSIndexWriteHelper, &data);
+}
+
+
+/**
+ * virNSSIndexWriteLeases:
+ * @srcFile: custom lease file @leases were just written to
+ * @leases: JSON array of leases
+ *
+ * Writes the index the NSS module uses to look up @leases by hostname
+ * or MAC address without parsing @srcFile. Leases lacking an IP or MAC
+ * address can never be matched by the NSS module and are left out.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNSSIndexWriteLeases(const char *srcFile,
+                       virJSONValuePtr leases)
+{
+    virNSSIndexBuilder builder;
+    size_t i;
+    int ret = -1;
+
+    virNSSIndexBuilderInit(&builder);
+
+    for (i = 0; i < virJSONValueArraySize(leases); i++) {
+        virJSONValuePtr lease = virJSONValueArrayGet(leases, i);
+        const char *ip = virJSONValueObjectGetString(lease, "ip-address");
+        const char *mac = virJSONValueObjectGetString(lease, "mac-address");
+        virNSSIndexRecord rec = { 0 };
+        long long expiry = 0;
+        virSocketAddr addr;
+
+        if (!ip || !mac)
+            continue;
+
+        if (virSocketAddrParse(&addr, ip, AF_UNSPEC) < 0)
+            goto cleanup;
+
+        ignore_value(virJSONValueObjectGetNumberLong(lease, "expiry-time",
+                                                     &expiry));
+
+        rec.name = virNSSIndexBuilderAddString(&builder,
+                                               virJSONValueObjectGetString(lease, "hostname"));
+        rec.mac = virNSSIndexBuilderAddString(&builder, mac);
+        rec.expiry = expiry;
+        rec.family = VIR_SOCKET_ADDR_FAMILY(&addr);
+
+        if (rec.family == AF_INET) {
+            memcpy(rec.addr, &addr.data.inet4.sin_addr,
+                   sizeof(addr.data.inet4.sin_addr));
+        } else if (rec.family == AF_INET6) {
+            memcpy(rec.addr, &addr.data.inet6.sin6_addr,
+                   sizeof(addr.data.inet6.sin6_addr));
+        } else {
+            continue;
+        }
+
+        if (VIR_APPEND_ELEMENT(builder.records, builder.nrecords, rec) < 0)
+            goto cleanup;
+    }
+
+    ret = virNSSIndexBuilderWrite(&builder, srcFile, VIR_NSS_INDEX_TYPE_LEASES);
+
+ cleanup:
+    virNSSIndexBuilderClear(&builder);
+    return ret;
+}
+
+
+/**
+ * virNSSIndexWriteMACs:
+ * @srcFile: MAC map file @map was just written to
+ * @map: JSON array of domain name to MAC addresses mappings
+ *
+ * Writes the index the NSS module uses to look up the MAC addresses
+ * of a domain without parsing @srcFile.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNSSIndexWriteMACs(const char *srcFile,
+                     virJSONValuePtr map)
+{
+    virNSSIndexBuilder builder;
+    size_t i;
+    size_t j;
+    int ret = -1;
+
+    virNSSIndexBuilderInit(&builder);
+
+    for (i = 0; i < virJSONValueArraySize(map); i++) {
+        virJSONValuePtr entry = virJSONValueArrayGet(map, i);
+        const char *domain = virJSONValueObjectGetString(entry, "domain");
+        virJSONValuePtr macs = virJSONValueObjectGetArray(entry, "macs");
+        uint32_t name;
+
+        if (!domain || !macs)
+            continue;
+
+        name = virNSSIndexBuilderAddString(&builder, domain);
+
+        for (j = 0; j < virJSONValueArraySize(macs); j++) {
+            const char *mac = virJSONValueGetString(virJSONValueArrayGet(macs, j));
+            virNSSIndexRecord rec = { 0 };
+
+            if (!mac)
+                continue;
+
+            rec.name = name;
+            rec.mac = virNSSIndexBuilderAddString(&builder, mac);
+
+            if (VIR_APPEND_ELEMENT(builder.records, builder.nrecords, rec) < 0)
+                goto cleanup;
+        }
+    }
+
+    ret = virNSSIndexBuilderWrite(&builder, srcFile, VIR_NSS_INDEX_TYPE_MACS);
+
+ cleanup:
+    virNSSIndexBuilderClear(&builder);
+    return ret;
+}
@@ -0,0 +1,98 @@
+/*
+ * virnssindexformat.h: on-disk format of the NSS lease/MAC index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* This header is shared with the NSS module which must not depend on
+ * glib or any other part of libvirt, so keep it self-contained. */
+
+#include <stdint.h>
+
+/*
+ * Next to every <bridge>.status and <bridge>.macs JSON file the network
+ * driver keeps an index file with the same name plus the
+ * VIR_NSS_INDEX_SUFFIX. It is written in native byte order (it is only
+ * ever read on the host that wrote it) and laid out as:
+ *
+ *   virNSSIndexHeader  header;
+ *   uint32_t           nameBuckets[header.nbuckets];
+ *   uint32_t           macBuckets[header.nbuckets];
+ *   virNSSIndexRecord  records[header.nrecords];
+ *   char               strtab[header.strtabLen];
+ *
+ * Buckets and record links hold 1-based record indexes, 0 ends a chain.
+ * Records are stored in the order of the JSON file and every link points
+ * to a record further down the array, so chains always terminate.
+ * Strings are referenced by their offset into the NUL terminated string
+ * table whose first byte is always NUL, so offset 0 is the empty string.
+ *
+ * The header records the identity of the JSON file the index was built
+ * from; readers must ignore an index whose JSON file has changed since.
+ */
+
+#define VIR_NSS_INDEX_MAGIC "LVNSSIDX"
+#define VIR_NSS_INDEX_MAGIC_LEN 8
+#define VIR_NSS_INDEX_VERSION 1
+#define VIR_NSS_INDEX_SUFFIX ".index"
+
+typedef enum {
+    VIR_NSS_INDEX_TYPE_LEASES = 1, /* records keyed by hostname and MAC */
+    VIR_NSS_INDEX_TYPE_MACS = 2,   /* records keyed by domain name and MAC */
+} virNSSIndexType;
+
+typedef struct _virNSSIndexHeader virNSSIndexHeader;
+struct _virNSSIndexHeader {
+    char magic[VIR_NSS_INDEX_MAGIC_LEN];
+    uint32_t version;
+    uint32_t type;          /* virNSSIndexType */
+    uint64_t srcDev;        /* identity of the JSON file */
+    uint64_t srcIno;
+    uint64_t srcSize;
+    int64_t srcMtime;
+    uint32_t nbuckets;      /* power of two */
+    uint32_t nrecords;
+    uint32_t strtabLen;
+    uint32_t reserved;
+};
+
+typedef struct _virNSSIndexRecord virNSSIndexRecord;
+struct _virNSSIndexRecord {
+    uint32_t name;          /* hostname or domain name */
+    uint32_t mac;
+    uint32_t nextName;
+    uint32_t nextMAC;
+    int64_t expiry;         /* leases only */
+    uint32_t family;        /* AF_INET, AF_INET6 or 0 for MACs */
+    uint32_t reserved;
+    uint8_t addr[16];
+};
+
+
+/* 32 bit FNV-1a */
+static inline uint32_t
+virNSSIndexHash(const char *str)
+{
+    uint32_t hash = 2166136261U;
+
+    while (*str) {
+        hash ^= (unsigned char) *str++;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
@@ -47,6 +47,12 @@
 #include "virfile.h"
 #include "virhostmem.h"
 #include "virutil.h"
+#include "virhash.h"
+#include "virthread.h"
+#include "viruuid.h"
+
+#define LIBVIRT_VIRNUMAPRIV_H_ALLOW
+#include "virnumapriv.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -54,9 +60,9 @@ VIR_LOG_INIT("util.numa");
 
 
 #if HAVE_NUMAD
-char *
-virNumaGetAutoPlacementAdvice(unsigned short vcpus,
-                              unsigned long long balloon)
+static char *
+virNumaGetNumadAdvice(unsigned short vcpus,
+                      unsigned long long balloon)
 {
     g_autoptr(virCommand) cmd = NULL;
     char *output = NULL;
@@ -77,16 +83,49 @@ virNumaGetAutoPlacementAdvice(unsigned short vcpus,
     return output;
 }
 #else /* !HAVE_NUMAD */
-char *
-virNumaGetAutoPlacementAdvice(unsigned short vcpus G_GNUC_UNUSED,
-                              unsigned long long balloon G_GNUC_UNUSED)
+static char *
+virNumaGetNumadAdvice(unsigned short vcpus G_GNUC_UNUSED,
+                      unsigned long long balloon G_GNUC_UNUSED)
 {
     virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
-                   _("numad is not available on this host"));
+                   _("NUMA placement advice is not available on this host"));
     return NULL;
 }
 #endif /* !HAVE_NUMAD */
 
+
+/**
+ * virNumaGetAutoPlacementAdvice:
+ * @placement: NUMA load of running domains, or NULL
+ * @vcpus: number of vCPUs of the guest
+ * @balloon: memory of the guest in KiB
+ * @pagesize: size of huge pages backing the guest memory in KiB, or 0
+ *
+ * Suggests a nodeset for a guest with 'auto' placement. The nodeset is
+ * picked by the built-in placement engine using the host topology and the
+ * domains registered in @placement. Only if the host NUMA topology can't
+ * be read numad is asked instead.
+ *
+ * Returns the nodeset formatted as a string, NULL on error.
+ */
+char *
+virNumaGetAutoPlacementAdvice(virNumaPlacementPtr placement,
+                              unsigned short vcpus,
+                              unsigned long long balloon,
+                              unsigned int pagesize)
+{
+    g_autoptr(virBitmap) nodeset = NULL;
+
+    if (!virNumaIsAvailable())
+        return virNumaGetNumadAdvice(vcpus, balloon);
+
+    if (virNumaPlacementPick(placement, NULL, vcpus, balloon, pagesize,
+                             NULL, &nodeset) < 0)
+        return NULL;
+
+    return virBitmapFormat(nodeset);
+}
+
 #if WITH_NUMACTL
 int
 virNumaSetupMemoryPolicy(virDomainNumatuneMemMode mode,
@@ -1040,3 +1079,586 @@ virNumaGetHostMemoryNodeset(void)
 
     return nodeset;
 }
+
+
+/*
+ * Built-in placement engine
+ *
+ * Guests with 'auto' placement are put on the smallest set of host NUMA
+ * nodes which can hold their memory. Among sets of the same size the one
+ * whose nodes are closest to each other wins, then the one whose CPUs are
+ * least loaded by vCPUs of domains placed before. The load of running
+ * domains is tracked in a virNumaPlacement object owned by the driver.
+ */
+
+#define VIR_NUMA_DISTANCE_LOCAL 10
+#define VIR_NUMA_DISTANCE_REMOTE 20
+
+/* Reduction of vCPU load in percent needed to move a running domain */
+#define VIR_NUMA_PLACEMENT_REBALANCE_GAIN 25
+
+typedef struct _virNumaPlacementDomain virNumaPlacementDomain;
+typedef virNumaPlacementDomain *virNumaPlacementDomainPtr;
+struct _virNumaPlacementDomain {
+    virBitmapPtr nodeset;
+    unsigned int vcpus;
+    unsigned long long memory; /* KiB */
+};
+
+struct _virNumaPlacement {
+    virMutex lock;
+    virHashTablePtr domains; /* UUID string -> virNumaPlacementDomain */
+};
+
+typedef struct _virNumaPlacementScore virNumaPlacementScore;
+struct _virNumaPlacementScore {
+    int spread; /* largest distance between two nodes of the set */
+    double load; /* vCPUs per host CPU with the guest added */
+    unsigned int ncpus;
+    unsigned long long memory;
+};
+
+typedef enum {
+    VIR_NUMA_PLACEMENT_FIT_IDLE, /* memory, CPUs, no CPU overcommit */
+    VIR_NUMA_PLACEMENT_FIT_CPUS, /* memory, at least one CPU per vCPU */
+    VIR_NUMA_PLACEMENT_FIT_MEMORY, /* memory only */
+
+    VIR_NUMA_PLACEMENT_FIT_LAST
+} virNumaPlacementFit;
+
+
+static int
+virNumaPlacementDistance(virNumaPlacementNodePtr from,
+                         virNumaPlacementNodePtr to)
+{
+    if (to->id < from->ndistances && from->distances[to->id] > 0)
+        return from->distances[to->id];
+
+    return from == to ? VIR_NUMA_DISTANCE_LOCAL : VIR_NUMA_DISTANCE_REMOTE;
+}
+
+
+/* Whether node @a should be added to a set grown from @seed before @b */
+static bool
+virNumaPlacementCloser(virNumaPlacementNodePtr nodes,
+                       size_t seed,
+                       size_t a,
+                       size_t b)
+{
+    int da = virNumaPlacementDistance(&nodes[seed], &nodes[a]);
+    int db = virNumaPlacementDistance(&nodes[seed], &nodes[b]);
+    unsigned long long la = (unsigned long long) nodes[a].vcpus * nodes[b].ncpus;
+    unsigned long long lb = (unsigned long long) nodes[b].vcpus * nodes[a].ncpus;
+
+    if (a == seed || b == seed)
+        return a == seed;
+
+    if (da != db)
+        return da < db;
+
+    if (la != lb)
+        return la < lb;
+
+    return a < b;
+}
+
+
+static void
+virNumaPlacementScoreNodes(virNumaPlacementNodePtr nodes,
+                           const size_t *set,
+                           size_t nset,
+                           unsigned int vcpus,
+                           virNumaPlacementScore *score)
+{
+    unsigned long long committed = 0;
+    size_t i;
+    size_t j;
+
+    memset(score, 0, sizeof(*score));
+
+    for (i = 0; i < nset; i++) {
+        virNumaPlacementNodePtr node = &nodes[set[i]];
+
+        score->ncpus += node->ncpus;
+        score->memory += node->memory;
+        committed += node->vcpus;
+
+        for (j = 0; j < nset; j++)
+            score->spread = MAX(score->spread,
+                                virNumaPlacementDistance(node, &nodes[set[j]]));
+    }
+
+    score->load = (double) (committed + vcpus) / MAX(score->ncpus, 1);
+}
+
+
+static bool
+virNumaPlacementScoreFits(const virNumaPlacementScore *score,
+                          virNumaPlacementFit fit,
+                          unsigned int vcpus,
+                          unsigned long long memory)
+{
+    if (score->memory < memory)
+        return false;
+
+    if (fit <= VIR_NUMA_PLACEMENT_FIT_CPUS && score->ncpus < vcpus)
+        return false;
+
+    if (fit == VIR_NUMA_PLACEMENT_FIT_IDLE && score->load > 1)
+        return false;
+
+    return true;
+}
+
+
+static bool
+virNumaPlacementScoreBetter(const virNumaPlacementScore *a,
+                            const virNumaPlacementScore *b)
+{
+    if (a->spread != b->spread)
+        return a->spread < b->spread;
+
+    if (a->load != b->load)
+        return a->load < b->load;
+
+    return a->memory > b->memory;
+}
+
+
+/**
+ * virNumaPlacementPickNodes:
+ * @nodes: host NUMA nodes
+ * @nnodes: number of items in @nodes
+ * @vcpus: number of vCPUs of the guest
+ * @memory: memory of the guest in KiB
+ * @current: nodeset the guest is running on, or NULL for a new guest
+ * @nodeset: filled with the picked nodeset
+ *
+ * Picks the nodes for a guest. Every node is used as a seed which is grown
+ * by its nearest neighbours until the set fits the guest, first without
+ * overcommitting CPUs, then with at least one CPU per vCPU, then by memory
+ * alone. If even that fails, all nodes are used.
+ *
+ * If @current is given, @nodeset is set only if the picked nodes are
+ * closer to each other than @current, or as close and lower the vCPU load
+ * by at least VIR_NUMA_PLACEMENT_REBALANCE_GAIN percent. Otherwise it is
+ * left NULL.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaPlacementPickNodes(virNumaPlacementNodePtr nodes,
+                          size_t nnodes,
+                          unsigned int vcpus,
+                          unsigned long long memory,
+                          virBitmapPtr current,
+                          virBitmapPtr *nodeset)
+{
+    g_autofree size_t *order = NULL;
+    virNumaPlacementScore best = { 0 };
+    const size_t *bestSet = NULL;
+    size_t nbest = 0;
+    int maxid = 0;
+    size_t fit;
+    size_t k;
+    size_t i;
+    size_t j;
+
+    *nodeset = NULL;
+
+    if (nnodes == 0) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("no NUMA nodes to place the domain on"));
+        return -1;
+    }
+
+    /* Row i lists all nodes in the order they join a set grown from i */
+    order = g_new0(size_t, nnodes * nnodes);
+    for (i = 0; i < nnodes; i++) {
+        size_t *row = order + i * nnodes;
+
+        for (j = 0; j < nnodes; j++) {
+            size_t pos = j;
+
+            while (pos > 0 && virNumaPlacementCloser(nodes, i, j, row[pos - 1])) {
+                row[pos] = row[pos - 1];
+                pos--;
+            }
+            row[pos] = j;
+        }
+
+        maxid = MAX(maxid, nodes[i].id);
+    }
+
+    for (fit = 0; fit < VIR_NUMA_PLACEMENT_FIT_LAST && !bestSet; fit++) {
+        for (k = 1; k <= nnodes && !bestSet; k++) {
+            for (i = 0; i < nnodes; i++) {
+                virNumaPlacementScore score;
+
+                virNumaPlacementScoreNodes(nodes, order + i * nnodes, k,
+                                           vcpus, &score);
+
+                if (!virNumaPlacementScoreFits(&score, fit, vcpus, memory))
+                    continue;
+
+                if (!bestSet || virNumaPlacementScoreBetter(&score, &best)) {
+                    best = score;
+                    bestSet = order + i * nnodes;
+                    nbest = k;
+                }
+            }
+        }
+    }
+
+    if (!bestSet) {
+        VIR_DEBUG("No NUMA nodes fit %llu KiB of memory, using all of them",
+                  memory);
+        bestSet = order;
+        nbest = nnodes;
+        virNumaPlacementScoreNodes(nodes, bestSet, nbest, vcpus, &best);
+    }
+
+    if (current) {
+        g_autofree size_t *currentSet = g_new0(size_t, nnodes);
+        size_t ncurrent = 0;
+        virNumaPlacementScore score;
+
+        for (i = 0; i < nnodes; i++) {
+            if (virBitmapIsBitSet(current, nodes[i].id))
+                currentSet[ncurrent++] = i;
+        }
+
+        if (ncurrent > 0) {
+            virNumaPlacementScoreNodes(nodes, currentSet, ncurrent,
+                                       vcpus, &score);
+
+            if (best.spread > score.spread ||
+                (best.spread == score.spread &&
+                 best.load * 100 > score.load * (100 - VIR_NUMA_PLACEMENT_REBALANCE_GAIN))) {
+                VIR_DEBUG("Keeping current nodes, load %.2f, best %.2f",
+                          score.load, best.load);
+                return 0;
+            }
+        }
+    }
+
+    if (!(*nodeset = virBitmapNew(maxid + 1)))
+        return -1;
+
+    for (i = 0; i < nbest; i++)
+        ignore_value(virBitmapSetBit(*nodeset, nodes[bestSet[i]].id));
+
+    return 0;
+}
+
+
+static void
+virNumaPlacementDomainFree(void *opaque)
+{
+    virNumaPlacementDomainPtr dom = opaque;
+
+    if (!dom)
+        return;
+
+    virBitmapFree(dom->nodeset);
+    g_free(dom);
+}
+
+
+/**
+ * virNumaPlacementNew:
+ *
+ * Creates a registry of the NUMA nodes used by running domains which
+ * is consulted by virNumaPlacementPick().
+ *
+ * Returns the new object, NULL on error.
+ */
+virNumaPlacementPtr
+virNumaPlacementNew(void)
+{
+    virNumaPlacementPtr placement = g_new0(virNumaPlacement, 1);
+
+    if (virMutexInit(&placement->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        g_free(placement);
+        return NULL;
+    }
+
+    if (!(placement->domains = virHashNew(virNumaPlacementDomainFree))) {
+        virNumaPlacementFree(placement);
+        return NULL;
+    }
+
+    return placement;
+}
+
+
+void
+virNumaPlacementFree(virNumaPlacementPtr placement)
+{
+    if (!placement)
+        return;
+
+    virHashFree(placement->domains);
+    virMutexDestroy(&placement->lock);
+    g_free(placement);
+}
+
+
+/**
+ * virNumaPlacementSetDomain:
+ * @placement: registry of running domains
+ * @uuid: UUID of the domain
+ * @nodeset: host NUMA nodes the domain is placed on
+ * @vcpus: number of vCPUs of the domain
+ * @memory: memory of the domain in KiB
+ *
+ * Records the NUMA nodes used by a running domain, replacing any
+ * previous record of the domain.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaPlacementSetDomain(virNumaPlacementPtr placement,
+                          const unsigned char *uuid,
+                          virBitmapPtr nodeset,
+                          unsigned int vcpus,
+                          unsigned long long memory)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    virNumaPlacementDomainPtr dom = g_new0(virNumaPlacementDomain, 1);
+    int ret;
+
+    virUUIDFormat(uuid, uuidstr);
+
+    if (!(dom->nodeset = virBitmapNewCopy(nodeset))) {
+        virNumaPlacementDomainFree(dom);
+        return -1;
+    }
+    dom->vcpus = vcpus;
+    dom->memory = memory;
+
+    virMutexLock(&placement->lock);
+    ret = virHashUpdateEntry(placement->domains, uuidstr, dom);
+    virMutexUnlock(&placement->lock);
+
+    if (ret < 0)
+        virNumaPlacementDomainFree(dom);
+
+    return ret;
+}
+
+
+void
+virNumaPlacementRemoveDomain(virNumaPlacementPtr placement,
+                             const unsigned char *uuid)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(uuid, uuidstr);
+
+    virMutexLock(&placement->lock);
+    ignore_value(virHashRemoveEntry(placement->domains, uuidstr));
+    virMutexUnlock(&placement->lock);
+}
+
+
+struct virNumaPlacementCommitData {
+    const char *skip;
+    int maxnode;
+    unsigned int *vcpus;
+    unsigned long long *memory;
+};
+
+
+/* Spread the vCPUs and memory of a domain evenly over its nodes */
+static int
+virNumaPlacementCommit(void *payload,
+                       const void *name,
+                       void *opaque)
+{
+    virNumaPlacementDomainPtr dom = payload;
+    struct virNumaPlacementCommitData *data = opaque;
+    size_t count = virBitmapCountBits(dom->nodeset);
+    ssize_t node = -1;
+
+    if (count == 0 || (data->skip && STREQ(name, data->skip)))
+        return 0;
+
+    while ((node = virBitmapNextSetBit(dom->nodeset, node)) >= 0 &&
+           node <= data->maxnode) {
+        data->vcpus[node] += VIR_DIV_UP(dom->vcpus, count);
+        data->memory[node] += dom->memory / count;
+    }
+
+    return 0;
+}
+
+
+static int
+virNumaPlacementGetHugePagesFree(int node,
+                                 unsigned int pagesize,
+                                 unsigned long long *memory)
+{
+    g_autofree unsigned int *pages_size = NULL;
+    g_autofree unsigned long long *pages_free = NULL;
+    size_t npages = 0;
+    size_t i;
+
+    *memory = 0;
+
+    if (virNumaGetPages(node, &pages_size, NULL, &pages_free, &npages) < 0)
+        return -1;
+
+    for (i = 0; i < npages; i++) {
+        if (pages_size[i] == pagesize)
+            *memory = pages_free[i] * pagesize;
+    }
+
+    return 0;
+}
+
+
+static void
+virNumaPlacementNodesFree(virNumaPlacementNodePtr nodes,
+                          size_t nnodes)
+{
+    size_t i;
+
+    for (i = 0; i < nnodes; i++)
+        g_free(nodes[i].distances);
+    g_free(nodes);
+}
+
+
+/*
+ * Take a snapshot of the host NUMA nodes with the load of all domains
+ * in @placement but the one with @uuid accounted.
+ */
+static int
+virNumaPlacementGetNodes(virNumaPlacementPtr placement,
+                         const unsigned char *uuid,
+                         unsigned int pagesize,
+                         virNumaPlacementNodePtr *retNodes,
+                         size_t *retNnodes)
+{
+    struct virNumaPlacementCommitData data = { 0 };
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    g_autofree unsigned int *vcpus = NULL;
+    g_autofree unsigned long long *memory = NULL;
+    virNumaPlacementNodePtr nodes = NULL;
+    size_t nnodes = 0;
+    bool hugepages;
+    int maxnode;
+    size_t i;
+
+    if ((maxnode = virNumaGetMaxNode()) < 0)
+        return -1;
+
+    vcpus = g_new0(unsigned int, maxnode + 1);
+    memory = g_new0(unsigned long long, maxnode + 1);
+
+    if (placement) {
+        if (uuid) {
+            virUUIDFormat(uuid, uuidstr);
+            data.skip = uuidstr;
+        }
+        data.maxnode = maxnode;
+        data.vcpus = vcpus;
+        data.memory = memory;
+
+        virMutexLock(&placement->lock);
+        virHashForEach(placement->domains, virNumaPlacementCommit, &data);
+        virMutexUnlock(&placement->lock);
+    }
+
+    hugepages = pagesize && pagesize != (unsigned int) virGetSystemPageSizeKB();
+    nodes = g_new0(virNumaPlacementNode, maxnode + 1);
+
+    for (i = 0; i <= maxnode; i++) {
+        virNumaPlacementNodePtr node;
+        g_autoptr(virBitmap) cpus = NULL;
+        unsigned long long memsize;
+        unsigned long long memfree;
+        int ncpus;
+
+        if (!virNumaNodeIsAvailable(i))
+            continue;
+
+        node = &nodes[nnodes++];
+        node->id = i;
+        node->vcpus = vcpus[i];
+
+        /* Nodes without CPUs report -2 */
+        if ((ncpus = virNumaGetNodeCPUs(i, &cpus)) == -1 ||
+            virNumaGetNodeMemory(i, &memsize, &memfree) < 0 ||
+            virNumaGetDistances(i, &node->distances, &node->ndistances) < 0)
+            goto error;
+
+        node->ncpus = MAX(ncpus, 0);
+
+        if (hugepages) {
+            if (virNumaPlacementGetHugePagesFree(i, pagesize, &node->memory) < 0)
+                goto error;
+        } else {
+            memsize /= 1024;
+            memfree /= 1024;
+            node->memory = memsize > memory[i] ? memsize - memory[i] : 0;
+            node->memory = MIN(node->memory, memfree);
+        }
+    }
+
+    *retNodes = nodes;
+    *retNnodes = nnodes;
+    return 0;
+
+ error:
+    virNumaPlacementNodesFree(nodes, nnodes);
+    return -1;
+}
+
+
+/**
+ * virNumaPlacementPick:
+ * @placement: registry of running domains, or NULL
+ * @uuid: UUID of the domain to skip in @placement, or NULL
+ * @vcpus: number of vCPUs of the guest
+ * @memory: memory of the guest in KiB
+ * @pagesize: size of huge pages backing the guest memory in KiB, or 0
+ * @current: nodeset the guest is running on, or NULL for a new guest
+ * @nodeset: filled with the picked nodeset
+ *
+ * Picks host NUMA nodes for a guest based on the current host topology,
+ * free memory (or free huge pages of @pagesize) and the load of domains
+ * recorded in @placement. For a running guest pass its @uuid and
+ * @current nodeset; @nodeset is then left NULL unless moving the guest
+ * is worth it. See virNumaPlacementPickNodes().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaPlacementPick(virNumaPlacementPtr placement,
+                     const unsigned char *uuid,
+                     unsigned int vcpus,
+                     unsigned long long memory,
+                     unsigned int pagesize,
+                     virBitmapPtr current,
+                     virBitmapPtr *nodeset)
+{
+    virNumaPlacementNodePtr nodes = NULL;
+    size_t nnodes = 0;
+    int ret;
+
+    *nodeset = NULL;
+
+    if (virNumaPlacementGetNodes(placement, uuid, pagesize,
+                                 &nodes, &nnodes) < 0)
+        return -1;
+
+    ret = virNumaPlacementPickNodes(nodes, nnodes, vcpus, memory,
+                                    current, nodeset);
+
+    virNumaPlacementNodesFree(nodes, nnodes);
+    return ret;
+}
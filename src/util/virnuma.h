@@ -25,8 +25,32 @@
 #include "virbitmap.h"
 
 
-char *virNumaGetAutoPlacementAdvice(unsigned short vcpus,
-                                    unsigned long long balloon);
+typedef struct _virNumaPlacement virNumaPlacement;
+typedef virNumaPlacement *virNumaPlacementPtr;
+
+virNumaPlacementPtr virNumaPlacementNew(void);
+void virNumaPlacementFree(virNumaPlacementPtr placement);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNumaPlacement, virNumaPlacementFree);
+
+int virNumaPlacementSetDomain(virNumaPlacementPtr placement,
+                              const unsigned char *uuid,
+                              virBitmapPtr nodeset,
+                              unsigned int vcpus,
+                              unsigned long long memory);
+void virNumaPlacementRemoveDomain(virNumaPlacementPtr placement,
+                                  const unsigned char *uuid);
+int virNumaPlacementPick(virNumaPlacementPtr placement,
+                         const unsigned char *uuid,
+                         unsigned int vcpus,
+                         unsigned long long memory,
+                         unsigned int pagesize,
+                         virBitmapPtr current,
+                         virBitmapPtr *nodeset);
+
+char *virNumaGetAutoPlacementAdvice(virNumaPlacementPtr placement,
+                                    unsigned short vcpus,
+                                    unsigned long long balloon,
+                                    unsigned int pagesize);
 
 int virNumaSetupMemoryPolicy(virDomainNumatuneMemMode mode,
                              virBitmapPtr nodeset);
@@ -0,0 +1,44 @@
+/*
+ * virnumapriv.h: private NUMA placement APIs for testing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_VIRNUMAPRIV_H_ALLOW
+# error "virnumapriv.h may only be included by virnuma.c or test suites"
+#endif /* LIBVIRT_VIRNUMAPRIV_H_ALLOW */
+
+#pragma once
+
+#include "virnuma.h"
+
+/* Snapshot of one host NUMA node as seen by the placement engine */
+typedef struct _virNumaPlacementNode virNumaPlacementNode;
+typedef virNumaPlacementNode *virNumaPlacementNodePtr;
+struct _virNumaPlacementNode {
+    int id;
+    unsigned int ncpus;
+    unsigned long long memory; /* KiB a new guest can still get */
+    unsigned int vcpus; /* vCPUs of running domains placed here */
+    int *distances; /* indexed by node id, 0 if unknown */
+    int ndistances;
+};
+
+int virNumaPlacementPickNodes(virNumaPlacementNodePtr nodes,
+                              size_t nnodes,
+                              unsigned int vcpus,
+                              unsigned long long memory,
+                              virBitmapPtr current,
+                              virBitmapPtr *nodeset);
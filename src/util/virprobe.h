@@ -95,6 +95,11 @@
         PROBE_EXPAND(LIBVIRT_ ## NAME, \
                      VIR_ADD_CASTS(__VA_ARGS__)); \
     }
+
+/* Whether PROBE(NAME, ...) would be traced or logged, for callers
+ * which need to format its arguments first */
+# define PROBE_ENABLED(NAME) \
+    (LIBVIRT_ ## NAME ## _ENABLED() || VIR_LOG_ENABLED(VIR_LOG_INFO))
 #else
 # define PROBE(NAME, FMT, ...) \
     VIR_INFO_INT(&virLogSelf, \
@@ -102,4 +107,7 @@
                  #NAME ": " FMT, __VA_ARGS__);
 
 # define PROBE_QUIET(NAME, FMT, ...)
+
+# define PROBE_ENABLED(NAME) \
+    VIR_LOG_ENABLED(VIR_LOG_INFO)
 #endif
@@ -45,6 +45,12 @@ int vir_setsockopt(int fd, int level, int optname,
                    const void *optval, socklen_t optlen);
 int vir_socket(int domain, int type, int protocol);
 
+/* Only used to describe buffers, Windows has no readv/writev */
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+
 
 /* Provide our own replacements */
 # define accept vir_accept
@@ -71,6 +77,7 @@ int vir_socket(int domain, int type, int protocol);
 # include <netinet/udp.h>
 # include <netinet/tcp.h>
 # include <sys/un.h>
+# include <sys/uio.h>
 # include <netdb.h>
 
 # define closesocket close
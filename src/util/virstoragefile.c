@@ -40,6 +40,7 @@
 #include "virstorageencryption.h"
 #include "virsecret.h"
 #include "virutil.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -5178,6 +5179,307 @@ virStorageFileReportBrokenChain(int errcode,
 }
 
 
+/*
+ * Process wide cache of image headers read while walking backing chains.
+ * Base images are usually shared by many domains and never change, so
+ * there's no point in reading them again for every domain start or block
+ * job. Entries are keyed by path and the identity of the file as returned
+ * by stat, so that a modified or replaced file is read again. Only local
+ * regular files are cached, block devices don't have a usable mtime.
+ */
+#define VIR_STORAGE_HEADER_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+/* files modified this recently might still change within the timestamp
+ * granularity of the filesystem without their mtime changing */
+#define VIR_STORAGE_HEADER_CACHE_MIN_AGE 2
+
+typedef struct _virStorageFileHeaderCacheEntry virStorageFileHeaderCacheEntry;
+struct _virStorageFileHeaderCacheEntry {
+    char *path;
+    uid_t uid;
+    gid_t gid;
+
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+
+    char *buf;
+    size_t len;
+
+    /* position in the LRU list */
+    virStorageFileHeaderCacheEntry *prev;
+    virStorageFileHeaderCacheEntry *next;
+};
+
+static virMutex virStorageFileHeaderCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStorageFileHeaderCache;
+static size_t virStorageFileHeaderCacheSize;
+/* most and least recently used entries */
+static virStorageFileHeaderCacheEntry *virStorageFileHeaderCacheHead;
+static virStorageFileHeaderCacheEntry *virStorageFileHeaderCacheTail;
+static unsigned long long virStorageFileHeaderCacheHits;
+static unsigned long long virStorageFileHeaderCacheMisses;
+
+
+/* Must be called with virStorageFileHeaderCacheLock held */
+static void
+virStorageFileHeaderCacheUnlink(virStorageFileHeaderCacheEntry *entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else if (virStorageFileHeaderCacheHead == entry)
+        virStorageFileHeaderCacheHead = entry->next;
+
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else if (virStorageFileHeaderCacheTail == entry)
+        virStorageFileHeaderCacheTail = entry->prev;
+
+    entry->prev = entry->next = NULL;
+}
+
+
+/* Must be called with virStorageFileHeaderCacheLock held */
+static void
+virStorageFileHeaderCacheLinkHead(virStorageFileHeaderCacheEntry *entry)
+{
+    entry->next = virStorageFileHeaderCacheHead;
+    if (virStorageFileHeaderCacheHead)
+        virStorageFileHeaderCacheHead->prev = entry;
+    virStorageFileHeaderCacheHead = entry;
+    if (!virStorageFileHeaderCacheTail)
+        virStorageFileHeaderCacheTail = entry;
+}
+
+
+static void
+virStorageFileHeaderCacheEntryFree(void *opaque)
+{
+    virStorageFileHeaderCacheEntry *entry = opaque;
+
+    if (!entry)
+        return;
+
+    virStorageFileHeaderCacheUnlink(entry);
+    virStorageFileHeaderCacheSize -= entry->len;
+    g_free(entry->path);
+    g_free(entry->buf);
+    g_free(entry);
+}
+
+
+static void
+virStorageFileHeaderCacheStatTimes(const struct stat *sb,
+                                   struct timespec *mtime,
+                                   struct timespec *ctime)
+{
+#ifdef __APPLE__
+    *mtime = sb->st_mtimespec;
+    *ctime = sb->st_ctimespec;
+#else /* ! __APPLE__ */
+    *mtime = sb->st_mtim;
+    *ctime = sb->st_ctim;
+#endif /* ! __APPLE__ */
+}
+
+
+static char *
+virStorageFileHeaderCacheKey(const char *path,
+                             uid_t uid,
+                             gid_t gid)
+{
+    return g_strdup_printf("%u:%u:%s", (unsigned int) uid,
+                           (unsigned int) gid, path);
+}
+
+
+static bool
+virStorageFileHeaderCacheGet(const char *path,
+                             const struct stat *sb,
+                             uid_t uid,
+                             gid_t gid,
+                             char **buf,
+                             size_t *len)
+{
+    g_autofree char *key = virStorageFileHeaderCacheKey(path, uid, gid);
+    virStorageFileHeaderCacheEntry *entry;
+    struct timespec mtime;
+    struct timespec ctime;
+    bool ret = false;
+
+    virStorageFileHeaderCacheStatTimes(sb, &mtime, &ctime);
+
+    virMutexLock(&virStorageFileHeaderCacheLock);
+
+    if (virStorageFileHeaderCache &&
+        (entry = virHashLookup(virStorageFileHeaderCache, key)) &&
+        entry->dev == sb->st_dev &&
+        entry->ino == sb->st_ino &&
+        entry->size == sb->st_size &&
+        entry->mtime.tv_sec == mtime.tv_sec &&
+        entry->mtime.tv_nsec == mtime.tv_nsec &&
+        entry->ctime.tv_sec == ctime.tv_sec &&
+        entry->ctime.tv_nsec == ctime.tv_nsec) {
+        virStorageFileHeaderCacheUnlink(entry);
+        virStorageFileHeaderCacheLinkHead(entry);
+        *buf = g_new0(char, entry->len + 1);
+        memcpy(*buf, entry->buf, entry->len);
+        *len = entry->len;
+        virStorageFileHeaderCacheHits++;
+        ret = true;
+    } else {
+        virStorageFileHeaderCacheMisses++;
+    }
+
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+
+    return ret;
+}
+
+
+/* Must be called with virStorageFileHeaderCacheLock held */
+static void
+virStorageFileHeaderCacheEvict(void)
+{
+    while (virStorageFileHeaderCacheSize > VIR_STORAGE_HEADER_CACHE_MAX_SIZE &&
+           virStorageFileHeaderCacheTail) {
+        virStorageFileHeaderCacheEntry *oldest = virStorageFileHeaderCacheTail;
+        g_autofree char *key = NULL;
+
+        key = virStorageFileHeaderCacheKey(oldest->path, oldest->uid, oldest->gid);
+        if (virHashRemoveEntry(virStorageFileHeaderCache, key) < 0) {
+            /* not in the table, which can't happen; don't loop forever */
+            virStorageFileHeaderCacheUnlink(oldest);
+        }
+    }
+}
+
+
+static void
+virStorageFileHeaderCachePut(const char *path,
+                             const struct stat *sb,
+                             uid_t uid,
+                             gid_t gid,
+                             const char *buf,
+                             size_t len)
+{
+    g_autofree char *key = NULL;
+    virStorageFileHeaderCacheEntry *entry;
+
+    entry = g_new0(virStorageFileHeaderCacheEntry, 1);
+    entry->dev = sb->st_dev;
+    entry->ino = sb->st_ino;
+    entry->size = sb->st_size;
+    virStorageFileHeaderCacheStatTimes(sb, &entry->mtime, &entry->ctime);
+
+    if (entry->mtime.tv_sec + VIR_STORAGE_HEADER_CACHE_MIN_AGE >
+        g_get_real_time() / G_USEC_PER_SEC) {
+        g_free(entry);
+        return;
+    }
+
+    entry->path = g_strdup(path);
+    entry->uid = uid;
+    entry->gid = gid;
+    entry->buf = g_new0(char, len + 1);
+    memcpy(entry->buf, buf, len);
+    entry->len = len;
+    key = virStorageFileHeaderCacheKey(path, uid, gid);
+
+    virMutexLock(&virStorageFileHeaderCacheLock);
+
+    if (!virStorageFileHeaderCache)
+        virStorageFileHeaderCache = virHashNew(virStorageFileHeaderCacheEntryFree);
+
+    virStorageFileHeaderCacheSize += len;
+
+    /* replacing an entry for the same key unlinks the old one */
+    if (virHashUpdateEntry(virStorageFileHeaderCache, key, entry) < 0) {
+        virStorageFileHeaderCacheEntryFree(entry);
+        virResetLastError();
+    } else {
+        virStorageFileHeaderCacheLinkHead(entry);
+    }
+
+    virStorageFileHeaderCacheEvict();
+
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+}
+
+
+static int
+virStorageFileHeaderCacheMatchPath(const void *payload,
+                                   const void *name G_GNUC_UNUSED,
+                                   const void *opaque)
+{
+    const virStorageFileHeaderCacheEntry *entry = payload;
+
+    return !opaque || STREQ(entry->path, opaque);
+}
+
+
+/**
+ * virStorageFileHeaderCacheInvalidate:
+ * @path: path of the image, or NULL
+ *
+ * Forget the cached headers of @path, or of all images if @path is NULL.
+ * Callers that modify images should call this, even though changes are
+ * usually detected anyway.
+ */
+void
+virStorageFileHeaderCacheInvalidate(const char *path)
+{
+    virMutexLock(&virStorageFileHeaderCacheLock);
+    if (virStorageFileHeaderCache)
+        virHashRemoveSet(virStorageFileHeaderCache,
+                         virStorageFileHeaderCacheMatchPath, path);
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+}
+
+
+/**
+ * virStorageFileHeaderCacheInvalidateChain:
+ * @src: top of the backing chain
+ *
+ * Forget the cached headers of all local images in the backing chain
+ * of @src.
+ */
+void
+virStorageFileHeaderCacheInvalidateChain(virStorageSourcePtr src)
+{
+    virStorageSourcePtr n;
+
+    for (n = src; virStorageSourceIsBacking(n); n = n->backingStore) {
+        if (virStorageSourceIsLocalStorage(n) && n->path)
+            virStorageFileHeaderCacheInvalidate(n->path);
+    }
+}
+
+
+/**
+ * virStorageFileHeaderCacheGetStats:
+ * @hits: filled with the number of headers found in the cache
+ * @misses: filled with the number of headers which had to be read
+ * @nentries: filled with the number of cached headers
+ * @size: filled with the size of the cached headers in bytes
+ */
+void
+virStorageFileHeaderCacheGetStats(unsigned long long *hits,
+                                  unsigned long long *misses,
+                                  size_t *nentries,
+                                  size_t *size)
+{
+    virMutexLock(&virStorageFileHeaderCacheLock);
+    *hits = virStorageFileHeaderCacheHits;
+    *misses = virStorageFileHeaderCacheMisses;
+    *nentries = virStorageFileHeaderCache ? virHashSize(virStorageFileHeaderCache) : 0;
+    *size = virStorageFileHeaderCacheSize;
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+}
+
+
 static int
 virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
                                            virStorageSourcePtr parent,
@@ -5190,6 +5492,8 @@ virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
     int ret = -1;
     const char *uniqueName;
     ssize_t len;
+    struct stat sb;
+    bool cacheable = false;
 
     if (virStorageFileInitAs(src, uid, gid) < 0)
         return -1;
@@ -5212,9 +5516,23 @@ virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
     if (virHashAddEntry(cycle, uniqueName, NULL) < 0)
         goto cleanup;
 
+    if (virStorageSourceGetActualType(src) == VIR_STORAGE_TYPE_FILE &&
+        virStorageFileStat(src, &sb) == 0 &&
+        S_ISREG(sb.st_mode)) {
+        if (virStorageFileHeaderCacheGet(src->path, &sb, uid, gid,
+                                         buf, headerLen)) {
+            ret = 0;
+            goto cleanup;
+        }
+        cacheable = true;
+    }
+
     if ((len = virStorageFileRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
         goto cleanup;
 
+    if (cacheable)
+        virStorageFileHeaderCachePut(src->path, &sb, uid, gid, *buf, len);
+
     *headerLen = len;
     ret = 0;
 
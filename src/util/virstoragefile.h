@@ -596,4 +596,11 @@ void virStorageFileReportBrokenChain(int errcode,
                                      virStorageSourcePtr src,
                                      virStorageSourcePtr parent);
 
+void virStorageFileHeaderCacheInvalidate(const char *path);
+void virStorageFileHeaderCacheInvalidateChain(virStorageSourcePtr src);
+void virStorageFileHeaderCacheGetStats(unsigned long long *hits,
+                                       unsigned long long *misses,
+                                       size_t *nentries,
+                                       size_t *size);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virStorageAuthDef, virStorageAuthDefFree);
@@ -49,9 +49,22 @@ struct _virThreadPoolJobList {
     virThreadPoolJobPtr firstPrio;
 };
 
+typedef struct _virThreadPoolJobQueue virThreadPoolJobQueue;
+typedef virThreadPoolJobQueue *virThreadPoolJobQueuePtr;
+
+/* In the sharded mode each worker takes jobs from its home queue
+ * and steals from the tail of the other queues once its own is
+ * empty, so that submitters and workers don't all serialize on
+ * the pool mutex. */
+struct _virThreadPoolJobQueue {
+    virMutex lock;
+    virThreadPoolJobList jobList;
+    unsigned long long stolen; /* jobs taken by foreign workers */
+};
+
 
 struct _virThreadPool {
-    bool quit;
+    int quit; /* read atomically in sharded mode */
 
     virThreadPoolJobFunc jobFunc;
     const char *jobName;
@@ -73,12 +86,25 @@ struct _virThreadPool {
     size_t nPrioWorkers;
     virThreadPtr prioWorkers;
     virCond prioCond;
+
+    /* Sharded mode only, all atomic unless stated otherwise */
+    size_t nqueues; /* 0 for a single shared job list */
+    virThreadPoolJobQueuePtr queues;
+    virThreadPoolJobQueue prioQueue; /* lane for priority jobs */
+    size_t nextHome; /* protected by @mutex */
+    int nextQueue;
+    int pending; /* jobs in all of the queues */
+    int prioPending; /* jobs in @prioQueue */
+    int sleepers; /* workers waiting on @cond */
+    int prioSleepers; /* workers waiting on @prioCond */
+    int full; /* nWorkers reached maxWorkers */
 };
 
 struct virThreadPoolWorkerData {
     virThreadPoolPtr pool;
     virCondPtr cond;
     bool priority;
+    size_t home;
 };
 
 /* Test whether the worker needs to quit if the current number of workers @count
@@ -89,6 +115,180 @@ static inline bool virThreadPoolWorkerQuitHelper(size_t count, size_t limit)
     return count > limit;
 }
 
+/* Call with @pool->mutex held whenever nWorkers or maxWorkers change */
+static void
+virThreadPoolUpdateFull(virThreadPoolPtr pool)
+{
+    if (pool->nqueues)
+        g_atomic_int_set(&pool->full, pool->nWorkers >= pool->maxWorkers);
+}
+
+
+static void
+virThreadPoolJobQueuePush(virThreadPoolPtr pool,
+                          virThreadPoolJobQueuePtr queue,
+                          virThreadPoolJobPtr job)
+{
+    virMutexLock(&queue->lock);
+
+    job->prev = queue->jobList.tail;
+    if (queue->jobList.tail)
+        queue->jobList.tail->next = job;
+    queue->jobList.tail = job;
+    if (!queue->jobList.head)
+        queue->jobList.head = job;
+
+    /* Account for the job before anyone can take it, so that
+     * @pending never drops below the real number of jobs */
+    if (job->priority)
+        g_atomic_int_inc(&pool->prioPending);
+    g_atomic_int_inc(&pool->pending);
+
+    virMutexUnlock(&queue->lock);
+}
+
+
+/* The owner of @queue takes jobs from its head, thieves from its
+ * tail to keep interference between the two low. */
+static virThreadPoolJobPtr
+virThreadPoolJobQueuePop(virThreadPoolPtr pool,
+                         virThreadPoolJobQueuePtr queue,
+                         bool steal)
+{
+    virThreadPoolJobPtr job;
+
+    virMutexLock(&queue->lock);
+
+    if (!(job = steal ? queue->jobList.tail : queue->jobList.head)) {
+        virMutexUnlock(&queue->lock);
+        return NULL;
+    }
+
+    if (job->prev)
+        job->prev->next = job->next;
+    else
+        queue->jobList.head = job->next;
+    if (job->next)
+        job->next->prev = job->prev;
+    else
+        queue->jobList.tail = job->prev;
+
+    if (steal)
+        queue->stolen++;
+
+    if (job->priority)
+        g_atomic_int_add(&pool->prioPending, -1);
+    g_atomic_int_add(&pool->pending, -1);
+
+    virMutexUnlock(&queue->lock);
+    return job;
+}
+
+
+static virThreadPoolJobPtr
+virThreadPoolShardedNextJob(virThreadPoolPtr pool,
+                            size_t home,
+                            bool priority)
+{
+    virThreadPoolJobPtr job = NULL;
+    size_t i;
+
+    /* Priority jobs go first, no matter who picks them up */
+    if (g_atomic_int_get(&pool->prioPending) > 0 &&
+        (job = virThreadPoolJobQueuePop(pool, &pool->prioQueue, false)))
+        return job;
+
+    if (priority)
+        return NULL;
+
+    if ((job = virThreadPoolJobQueuePop(pool, &pool->queues[home], false)))
+        return job;
+
+    for (i = 1; i < pool->nqueues && g_atomic_int_get(&pool->pending) > 0; i++) {
+        size_t victim = (home + i) % pool->nqueues;
+
+        if ((job = virThreadPoolJobQueuePop(pool, &pool->queues[victim], true)))
+            return job;
+    }
+
+    return NULL;
+}
+
+
+static void virThreadPoolWorkerSharded(void *opaque)
+{
+    struct virThreadPoolWorkerData *data = opaque;
+    virThreadPoolPtr pool = data->pool;
+    virCondPtr cond = data->cond;
+    bool priority = data->priority;
+    size_t home = data->home;
+    size_t *curWorkers = priority ? &pool->nPrioWorkers : &pool->nWorkers;
+    size_t *maxLimit = priority ? &pool->maxPrioWorkers : &pool->maxWorkers;
+    int *sleepers = priority ? &pool->prioSleepers : &pool->sleepers;
+    int *pending = priority ? &pool->prioPending : &pool->pending;
+    virThreadPoolJobPtr job = NULL;
+
+    VIR_FREE(data);
+
+    while (1) {
+        if (g_atomic_int_get(&pool->quit)) {
+            virMutexLock(&pool->mutex);
+            goto out;
+        }
+
+        if ((job = virThreadPoolShardedNextJob(pool, home, priority))) {
+            (pool->jobFunc)(job->data, pool->jobOpaque);
+            VIR_FREE(job);
+            continue;
+        }
+
+        /* Nothing to do, go to sleep. Workers announce themselves in
+         * @sleepers before checking @pending for the last time while
+         * submitters do the opposite, so at least one of the sides
+         * notices the other and no wakeup is lost. */
+        virMutexLock(&pool->mutex);
+        while (1) {
+            if (pool->quit ||
+                virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
+                goto out;
+
+            g_atomic_int_inc(sleepers);
+            if (!priority)
+                pool->freeWorkers++;
+
+            if (g_atomic_int_get(pending) > 0) {
+                g_atomic_int_add(sleepers, -1);
+                if (!priority)
+                    pool->freeWorkers--;
+                break;
+            }
+
+            if (virCondWait(cond, &pool->mutex) < 0) {
+                g_atomic_int_add(sleepers, -1);
+                if (!priority)
+                    pool->freeWorkers--;
+                goto out;
+            }
+
+            g_atomic_int_add(sleepers, -1);
+            if (!priority)
+                pool->freeWorkers--;
+        }
+        virMutexUnlock(&pool->mutex);
+    }
+
+ out:
+    if (priority)
+        pool->nPrioWorkers--;
+    else
+        pool->nWorkers--;
+    virThreadPoolUpdateFull(pool);
+    if (pool->nWorkers == 0 && pool->nPrioWorkers == 0)
+        virCondSignal(&pool->quit_cond);
+    virMutexUnlock(&pool->mutex);
+}
+
+
 static void virThreadPoolWorker(void *opaque)
 {
     struct virThreadPoolWorkerData *data = opaque;
@@ -194,6 +394,8 @@ virThreadPoolExpand(virThreadPoolPtr pool, size_t gain, bool priority)
         data->pool = pool;
         data->cond = priority ? &pool->prioCond : &pool->cond;
         data->priority = priority;
+        if (pool->nqueues)
+            data->home = pool->nextHome++ % pool->nqueues;
 
         if (priority)
             name = g_strdup_printf("prio-%s", pool->jobName);
@@ -202,7 +404,8 @@ virThreadPoolExpand(virThreadPoolPtr pool, size_t gain, bool priority)
 
         if (virThreadCreateFull(&(*workers)[i],
                                 false,
-                                virThreadPoolWorker,
+                                pool->nqueues ? virThreadPoolWorkerSharded :
+                                                virThreadPoolWorker,
                                 name,
                                 true,
                                 data) < 0) {
@@ -212,13 +415,43 @@ virThreadPoolExpand(virThreadPoolPtr pool, size_t gain, bool priority)
         }
     }
 
+    virThreadPoolUpdateFull(pool);
     return 0;
 
  error:
     *curWorkers -= gain - i;
+    virThreadPoolUpdateFull(pool);
     return -1;
 }
 
+
+static int
+virThreadPoolJobQueueInit(virThreadPoolJobQueuePtr queue)
+{
+    if (virMutexInit(&queue->lock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize job queue mutex"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+virThreadPoolJobQueueClear(virThreadPoolJobQueuePtr queue)
+{
+    virThreadPoolJobPtr job;
+
+    while ((job = queue->jobList.head)) {
+        queue->jobList.head = queue->jobList.head->next;
+        VIR_FREE(job);
+    }
+
+    virMutexDestroy(&queue->lock);
+}
+
+
 virThreadPoolPtr
 virThreadPoolNewFull(size_t minWorkers,
                      size_t maxWorkers,
@@ -226,8 +459,43 @@ virThreadPoolNewFull(size_t minWorkers,
                      virThreadPoolJobFunc func,
                      const char *name,
                      void *opaque)
+{
+    return virThreadPoolNewSharded(minWorkers, maxWorkers, prioWorkers, 0,
+                                   func, name, opaque);
+}
+
+
+/**
+ * virThreadPoolNewSharded:
+ * @minWorkers: number of workers to start right away
+ * @maxWorkers: upper limit of workers
+ * @prioWorkers: number of workers handling only priority jobs
+ * @nqueues: number of job queues
+ * @func: job handler
+ * @name: name of the worker threads
+ * @opaque: data passed to @func
+ *
+ * Creates a new thread pool. If @nqueues is greater than one,
+ * submitted jobs are spread over @nqueues queues, each with its
+ * own lock, and workers steal jobs from each other once their
+ * home queue runs dry. Priority jobs are kept in a separate lane
+ * which is served by all workers first. This avoids contention on
+ * a single lock with many submitters and workers, at the cost of
+ * jobs being no longer processed in strict FIFO order.
+ *
+ * Returns the new pool, or NULL on error.
+ */
+virThreadPoolPtr
+virThreadPoolNewSharded(size_t minWorkers,
+                        size_t maxWorkers,
+                        size_t prioWorkers,
+                        size_t nqueues,
+                        virThreadPoolJobFunc func,
+                        const char *name,
+                        void *opaque)
 {
     virThreadPoolPtr pool;
+    size_t i;
 
     if (minWorkers > maxWorkers)
         minWorkers = maxWorkers;
@@ -248,6 +516,23 @@ virThreadPoolNewFull(size_t minWorkers,
     if (virCondInit(&pool->quit_cond) < 0)
         goto error;
 
+    /* Workers can't be switched from zero to non-zero, in which
+     * case the jobs are never processed anyway */
+    if (nqueues > 1 && maxWorkers > 0) {
+        if (virThreadPoolJobQueueInit(&pool->prioQueue) < 0)
+            goto error;
+
+        pool->queues = g_new0(virThreadPoolJobQueue, nqueues);
+        for (i = 0; i < nqueues; i++) {
+            if (virThreadPoolJobQueueInit(&pool->queues[i]) < 0) {
+                if (pool->nqueues == 0)
+                    virMutexDestroy(&pool->prioQueue.lock);
+                goto error;
+            }
+            pool->nqueues++;
+        }
+    }
+
     pool->minWorkers = minWorkers;
     pool->maxWorkers = maxWorkers;
     pool->maxPrioWorkers = prioWorkers;
@@ -280,7 +565,7 @@ void virThreadPoolFree(virThreadPoolPtr pool)
         return;
 
     virMutexLock(&pool->mutex);
-    pool->quit = true;
+    g_atomic_int_set(&pool->quit, true);
     if (pool->nWorkers > 0)
         virCondBroadcast(&pool->cond);
     if (pool->nPrioWorkers > 0) {
@@ -296,6 +581,15 @@ void virThreadPoolFree(virThreadPoolPtr pool)
         VIR_FREE(job);
     }
 
+    if (pool->nqueues) {
+        size_t i;
+
+        for (i = 0; i < pool->nqueues; i++)
+            virThreadPoolJobQueueClear(&pool->queues[i]);
+        virThreadPoolJobQueueClear(&pool->prioQueue);
+    }
+    VIR_FREE(pool->queues);
+
     VIR_FREE(pool->workers);
     virMutexUnlock(&pool->mutex);
     virMutexDestroy(&pool->mutex);
@@ -368,6 +662,12 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool)
 {
     size_t ret;
 
+    if (pool->nqueues) {
+        int pending = g_atomic_int_get(&pool->pending);
+
+        return pending > 0 ? pending : 0;
+    }
+
     virMutexLock(&pool->mutex);
     ret = pool->jobQueueDepth;
     virMutexUnlock(&pool->mutex);
@@ -375,6 +675,82 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool)
     return ret;
 }
 
+size_t virThreadPoolGetJobQueues(virThreadPoolPtr pool)
+{
+    return pool->nqueues;
+}
+
+unsigned long long virThreadPoolGetStolenJobs(virThreadPoolPtr pool)
+{
+    unsigned long long ret = 0;
+    size_t i;
+
+    for (i = 0; i < pool->nqueues; i++) {
+        virMutexLock(&pool->queues[i].lock);
+        ret += pool->queues[i].stolen;
+        virMutexUnlock(&pool->queues[i].lock);
+    }
+
+    return ret;
+}
+
+
+static int
+virThreadPoolSendJobSharded(virThreadPoolPtr pool,
+                            unsigned int priority,
+                            void *jobData)
+{
+    virThreadPoolJobPtr job;
+    virThreadPoolJobQueuePtr queue;
+
+    if (g_atomic_int_get(&pool->quit))
+        return -1;
+
+    /* Only bother with the pool mutex if no worker is idle and
+     * there's still room for a new one */
+    if (g_atomic_int_get(&pool->sleepers) == 0 &&
+        !g_atomic_int_get(&pool->full)) {
+        int rc = 0;
+
+        virMutexLock(&pool->mutex);
+        if (pool->freeWorkers == 0 &&
+            pool->nWorkers < pool->maxWorkers)
+            rc = virThreadPoolExpand(pool, 1, false);
+        virMutexUnlock(&pool->mutex);
+
+        if (rc < 0)
+            return -1;
+    }
+
+    job = g_new0(virThreadPoolJob, 1);
+    job->data = jobData;
+    job->priority = priority;
+
+    if (priority) {
+        queue = &pool->prioQueue;
+    } else {
+        unsigned int next = g_atomic_int_add(&pool->nextQueue, 1);
+
+        queue = &pool->queues[next % pool->nqueues];
+    }
+
+    virThreadPoolJobQueuePush(pool, queue, job);
+
+    if (priority && g_atomic_int_get(&pool->prioSleepers) > 0) {
+        virMutexLock(&pool->mutex);
+        virCondSignal(&pool->prioCond);
+        virMutexUnlock(&pool->mutex);
+    }
+
+    if (g_atomic_int_get(&pool->sleepers) > 0) {
+        virMutexLock(&pool->mutex);
+        virCondSignal(&pool->cond);
+        virMutexUnlock(&pool->mutex);
+    }
+
+    return 0;
+}
+
 /*
  * @priority - job priority
  * Return: 0 on success, -1 otherwise
@@ -385,6 +761,9 @@ int virThreadPoolSendJob(virThreadPoolPtr pool,
 {
     virThreadPoolJobPtr job;
 
+    if (pool->nqueues)
+        return virThreadPoolSendJobSharded(pool, priority, jobData);
+
     virMutexLock(&pool->mutex);
     if (pool->quit)
         goto error;
@@ -462,6 +841,7 @@ virThreadPoolSetParameters(virThreadPoolPtr pool,
 
     if (maxWorkers >= 0) {
         pool->maxWorkers = maxWorkers;
+        virThreadPoolUpdateFull(pool);
         virCondBroadcast(&pool->cond);
     }
 
@@ -37,6 +37,13 @@ virThreadPoolPtr virThreadPoolNewFull(size_t minWorkers,
                                       virThreadPoolJobFunc func,
                                       const char *name,
                                       void *opaque) ATTRIBUTE_NONNULL(4);
+virThreadPoolPtr virThreadPoolNewSharded(size_t minWorkers,
+                                         size_t maxWorkers,
+                                         size_t prioWorkers,
+                                         size_t nqueues,
+                                         virThreadPoolJobFunc func,
+                                         const char *name,
+                                         void *opaque) ATTRIBUTE_NONNULL(5);
 
 size_t virThreadPoolGetMinWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetMaxWorkers(virThreadPoolPtr pool);
@@ -44,6 +51,8 @@ size_t virThreadPoolGetPriorityWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetCurrentWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetFreeWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool);
+size_t virThreadPoolGetJobQueues(virThreadPoolPtr pool);
+unsigned long long virThreadPoolGetStolenJobs(virThreadPoolPtr pool);
 
 void virThreadPoolFree(virThreadPoolPtr pool);
 
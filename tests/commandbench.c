@@ -0,0 +1,128 @@
+/*
+ * commandbench.c: measure how fast virCommand spawns children
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "internal.h"
+#include "vircommand.h"
+#include "virfile.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+/* A hook forces virCommand to fork, since it has to run in the child */
+static int
+benchNoopHook(void *opaque G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+/* Resident set size of this process in MiB */
+static unsigned long long
+benchGetRSS(void)
+{
+    g_autofree char *buf = NULL;
+    unsigned long long rss = 0;
+    char *tmp;
+
+    if (virFileReadAll("/proc/self/statm", 1024, &buf) < 0)
+        return 0;
+
+    if (virStrToLong_ull(buf, &tmp, 10, NULL) < 0 ||
+        virStrToLong_ull(tmp, NULL, 10, &rss) < 0)
+        return 0;
+
+    return rss * sysconf(_SC_PAGESIZE) / 1024 / 1024;
+}
+
+
+/*
+ * Run /bin/true over and over for @seconds, either through the spawn
+ * path or forcing a fork, and return the number of children per second.
+ */
+static double
+benchSpawn(bool useHook,
+           unsigned int seconds)
+{
+    gint64 end = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+    gint64 start = g_get_monotonic_time();
+    unsigned long long count = 0;
+
+    while (g_get_monotonic_time() < end) {
+        g_autoptr(virCommand) cmd = virCommandNew("true");
+
+        if (useHook)
+            virCommandSetPreExecHook(cmd, benchNoopHook, NULL);
+
+        if (virCommandRun(cmd, NULL) < 0)
+            return -1;
+
+        count++;
+    }
+
+    return (double)count * G_USEC_PER_SEC / (g_get_monotonic_time() - start);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    unsigned int seconds = 1;
+    size_t sizes[] = { 0, 64, 256, 1024 };
+    g_autofree char *ballast = NULL;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &seconds) < 0 ||
+                       seconds == 0))) {
+        fprintf(stderr, "%s [SECONDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        size_t len = sizes[i] * 1024 * 1024;
+        double spawn;
+        double forked;
+
+        /* Grow the process the way a busy daemon does, the pages have
+         * to be touched for fork to pay for them */
+        g_free(ballast);
+        ballast = g_new(char, len + 1);
+        memset(ballast, 1, len + 1);
+
+        if ((spawn = benchSpawn(false, seconds)) < 0 ||
+            (forked = benchSpawn(true, seconds)) < 0) {
+            fprintf(stderr, "%s\n", virGetLastErrorMessage());
+            return EXIT_FAILURE;
+        }
+
+        printf("%6llu MiB RSS: fork %8.1f spawns/s  spawn %8.1f spawns/s  (%.1fx)\n",
+               benchGetRSS(), forked, spawn, forked ? spawn / forked : 0);
+    }
+
+    return EXIT_SUCCESS;
+}
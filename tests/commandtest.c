@@ -1183,6 +1183,73 @@ test28(const void *unused G_GNUC_UNUSED)
 }
 
 
+static int
+test29Hook(void *opaque G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+/*
+ * Run program, no args, inherit all ENV, keep CWD.
+ * stdin/out/err + passed FDs with FDs that must not be inherited
+ * before, between and after them. Run it once without any work to
+ * do in the child, which spawns it without forking where possible,
+ * and once with a hook, which always forks. Both must agree.
+ */
+static int
+test29(const void *unused G_GNUC_UNUSED)
+{
+    int fds[] = { -1, 5, 6, 8 };
+    bool pass[] = { false, true, false, true };
+    int ret = -1;
+    size_t i;
+
+    if ((fds[0] = open("/dev/null", O_RDONLY)) < 0) {
+        perror("open");
+        return -1;
+    }
+
+    for (i = 1; i < G_N_ELEMENTS(fds); i++) {
+        if (dup2(fds[0], fds[i]) < 0) {
+            perror("dup2");
+            while (i-- > 1)
+                VIR_FORCE_CLOSE(fds[i]);
+            VIR_FORCE_CLOSE(fds[0]);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        g_autoptr(virCommand) cmd = virCommandNew(abs_builddir "/commandhelper");
+        size_t j;
+
+        for (j = 0; j < G_N_ELEMENTS(fds); j++) {
+            if (pass[j])
+                virCommandPassFD(cmd, fds[j], 0);
+        }
+
+        if (i == 1)
+            virCommandSetPreExecHook(cmd, test29Hook, NULL);
+
+        if (virCommandRun(cmd, NULL) < 0) {
+            printf("Cannot run child %s\n", virGetLastErrorMessage());
+            goto cleanup;
+        }
+
+        if (checkoutput("test29") < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < G_N_ELEMENTS(fds); i++)
+        VIR_FORCE_CLOSE(fds[i]);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -1281,6 +1348,7 @@ mymain(void)
     DO_TEST(test26);
     DO_TEST(test27);
     DO_TEST(test28);
+    DO_TEST(test29);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,173 @@
+/*
+ * domainformatbench.c: measure formatting of domain XML
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "internal.h"
+#include "domain_conf.h"
+#include "viralloc.h"
+#include "virfile.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define BENCH_DIR abs_srcdir "/qemuxml2xmloutdata"
+
+
+/* Files which the generic parser can't handle are skipped silently */
+static void
+benchErrorFuncQuiet(void *opaque G_GNUC_UNUSED,
+                    virErrorPtr err G_GNUC_UNUSED)
+{
+}
+
+
+static int
+benchLoadDefs(virDomainXMLOptionPtr xmlopt,
+              virDomainDefPtr **defs,
+              size_t *ndefs,
+              size_t *nskipped)
+{
+    DIR *dir = NULL;
+    struct dirent *ent;
+    int rc;
+
+    if (virDirOpen(&dir, BENCH_DIR) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, BENCH_DIR)) > 0) {
+        g_autofree char *path = NULL;
+        virDomainDefPtr def;
+
+        if (!virStringHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        path = g_strdup_printf("%s/%s", BENCH_DIR, ent->d_name);
+
+        if (!(def = virDomainDefParseFile(path, xmlopt, NULL,
+                                          VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                          VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE))) {
+            virResetLastError();
+            (*nskipped)++;
+            continue;
+        }
+
+        if (VIR_APPEND_ELEMENT(*defs, *ndefs, def) < 0) {
+            virDomainDefFree(def);
+            rc = -1;
+            break;
+        }
+    }
+
+    VIR_DIR_CLOSE(dir);
+    return rc;
+}
+
+
+/*
+ * Format all @defs over and over for @seconds and print the number of
+ * documents and bytes formatted per second.
+ */
+static int
+benchFormat(virDomainXMLOptionPtr xmlopt,
+            virDomainDefPtr *defs,
+            size_t ndefs,
+            unsigned int flags,
+            const char *desc,
+            unsigned int seconds)
+{
+    gint64 end = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+    gint64 start = g_get_monotonic_time();
+    unsigned long long docs = 0;
+    unsigned long long bytes = 0;
+    double elapsed;
+
+    while (g_get_monotonic_time() < end) {
+        size_t i;
+
+        for (i = 0; i < ndefs; i++) {
+            g_autofree char *xml = NULL;
+
+            if (!(xml = virDomainDefFormat(defs[i], xmlopt, flags)))
+                return -1;
+
+            bytes += strlen(xml);
+        }
+        docs += ndefs;
+    }
+
+    elapsed = (double)(g_get_monotonic_time() - start) / G_USEC_PER_SEC;
+
+    printf("%-8s %10.0f docs/s  %8.1f MiB/s\n",
+           desc, docs / elapsed, bytes / 1024.0 / 1024.0 / elapsed);
+    return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    virDomainXMLOptionPtr xmlopt = NULL;
+    virDomainDefPtr *defs = NULL;
+    size_t ndefs = 0;
+    size_t nskipped = 0;
+    unsigned int seconds = 1;
+    int ret = EXIT_FAILURE;
+    int rc;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &seconds) < 0 ||
+                       seconds == 0))) {
+        fprintf(stderr, "%s [SECONDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    if (!(xmlopt = virDomainXMLOptionNew(NULL, NULL, NULL, NULL, NULL)))
+        goto cleanup;
+
+    virSetErrorFunc(NULL, benchErrorFuncQuiet);
+    rc = benchLoadDefs(xmlopt, &defs, &ndefs, &nskipped);
+    virSetErrorFunc(NULL, NULL);
+    if (rc < 0)
+        goto cleanup;
+
+    printf("%zu documents from %s, %zu skipped\n", ndefs, BENCH_DIR, nskipped);
+
+    if (benchFormat(xmlopt, defs, ndefs, VIR_DOMAIN_DEF_FORMAT_INACTIVE,
+                    "inactive", seconds) < 0 ||
+        benchFormat(xmlopt, defs, ndefs, VIR_DOMAIN_DEF_FORMAT_SECURE,
+                    "secure", seconds) < 0)
+        goto cleanup;
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "%s\n", virGetLastErrorMessage());
+    for (i = 0; i < ndefs; i++)
+        virDomainDefFree(defs[i]);
+    VIR_FREE(defs);
+    virObjectUnref(xmlopt);
+    return ret;
+}
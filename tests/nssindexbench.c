@@ -0,0 +1,165 @@
+/*
+ * nssindexbench.c: compare NSS lookups in lease files and their index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "internal.h"
+#include "libvirt_nss_leases.h"
+#include "virfile.h"
+#include "virjson.h"
+#include "virnssindex.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define BENCH_EXPIRY 2000000000LL
+
+
+static int
+benchWriteLeases(const char *file,
+                 size_t nleases)
+{
+    g_autoptr(virJSONValue) leases = virJSONValueNewArray();
+    g_autofree char *str = NULL;
+    size_t i;
+
+    for (i = 0; i < nleases; i++) {
+        g_autoptr(virJSONValue) lease = virJSONValueNewObject();
+        g_autofree char *ip = g_strdup_printf("10.%zu.%zu.%zu",
+                                              (i >> 16) & 0xff,
+                                              (i >> 8) & 0xff,
+                                              i & 0xff);
+        g_autofree char *mac = g_strdup_printf("52:54:00:%02zx:%02zx:%02zx",
+                                               (i >> 16) & 0xff,
+                                               (i >> 8) & 0xff,
+                                               i & 0xff);
+        g_autofree char *hostname = g_strdup_printf("guest-%zu", i);
+
+        if (virJSONValueObjectAppendString(lease, "ip-address", ip) < 0 ||
+            virJSONValueObjectAppendString(lease, "mac-address", mac) < 0 ||
+            virJSONValueObjectAppendString(lease, "hostname", hostname) < 0 ||
+            virJSONValueObjectAppendNumberLong(lease, "expiry-time", BENCH_EXPIRY) < 0 ||
+            virJSONValueArrayAppend(leases, lease) < 0)
+            return -1;
+        lease = NULL;
+    }
+
+    if (!(str = virJSONValueToString(leases, true)) ||
+        virFileWriteStr(file, str, 0644) < 0 ||
+        virNSSIndexWriteLeases(file, leases) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Resolve names of the @nleases guests in @file, hitting and missing
+ * alternately, for @seconds and return the number of lookups per second.
+ */
+static double
+benchLookup(const char *file,
+            size_t nleases,
+            bool useIndex,
+            unsigned int seconds)
+{
+    gint64 end = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+    gint64 start = g_get_monotonic_time();
+    unsigned long long lookups = 0;
+    size_t i = 0;
+
+    while (g_get_monotonic_time() < end) {
+        char name[64];
+        leaseAddress *addrs = NULL;
+        size_t naddrs = 0;
+        bool found = false;
+        int rc;
+
+        i = (i + 7919) % (2 * nleases);
+        g_snprintf(name, sizeof(name), "guest-%zu", i);
+
+        if (useIndex)
+            rc = findLeasesIndex(file, name, NULL, 0, AF_UNSPEC, 0,
+                                 &addrs, &naddrs, &found) == 1 ? 0 : -1;
+        else
+            rc = findLeases(file, name, NULL, 0, AF_UNSPEC, 0,
+                            &addrs, &naddrs, &found);
+        free(addrs);
+
+        if (rc < 0 || found != (i < nleases))
+            return -1;
+
+        lookups++;
+    }
+
+    return lookups * (double) G_USEC_PER_SEC / (g_get_monotonic_time() - start);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    g_autofree char *dir = NULL;
+    unsigned int seconds = 1;
+    size_t nleases[] = { 16, 256, 4096, 16384 };
+    int ret = EXIT_FAILURE;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &seconds) < 0 ||
+                       seconds == 0))) {
+        fprintf(stderr, "%s [SECONDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    if (!(dir = g_dir_make_tmp("nssindexbench-XXXXXX", NULL))) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(nleases); i++) {
+        g_autofree char *file = g_strdup_printf("%s/virbr%zu.status", dir, i);
+        double json;
+        double index;
+
+        if (benchWriteLeases(file, nleases[i]) < 0)
+            goto cleanup;
+
+        if ((json = benchLookup(file, nleases[i], false, seconds)) < 0 ||
+            (index = benchLookup(file, nleases[i], true, seconds)) < 0) {
+            fprintf(stderr, "Lookup in %s failed\n", file);
+            goto cleanup;
+        }
+
+        printf("%6zu leases: json %12.0f lookups/s  index %12.0f lookups/s  (%.1fx)\n",
+               nleases[i], json, index, json ? index / json : 0);
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "%s\n", virGetLastErrorMessage());
+    virFileDeleteTree(dir);
+    return ret;
+}
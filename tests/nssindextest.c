@@ -0,0 +1,274 @@
+/*
+ * nssindextest.c: check the NSS index agrees with the JSON files
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#ifdef WITH_NSS
+
+# include "libvirt_nss_leases.h"
+# include "libvirt_nss_macs.h"
+# include "virfile.h"
+# include "virnssindex.h"
+# include "virsocket.h"
+
+# define VIR_FROM_THIS VIR_FROM_NONE
+
+# define SCRATCHDIRTEMPLATE abs_builddir "/nssindextest-XXXXXX"
+
+static char scratchDir[] = SCRATCHDIRTEMPLATE;
+
+struct testLeasesData {
+    const char *network;
+    const char *name;
+    const char *mac;
+    int af;
+};
+
+struct testMACsData {
+    const char *network;
+    const char *name;
+};
+
+
+static int
+testCopyFile(const char *network,
+             const char *suffix,
+             bool macs)
+{
+    g_autofree char *src = g_strdup_printf("%s/nssdata/%s.%s",
+                                           abs_srcdir, network, suffix);
+    g_autofree char *dst = g_strdup_printf("%s/%s.%s",
+                                           scratchDir, network, suffix);
+    g_autofree char *buf = NULL;
+    g_autoptr(virJSONValue) json = NULL;
+
+    if (virTestLoadFile(src, &buf) < 0 ||
+        virFileWriteStr(dst, buf, 0644) < 0 ||
+        !(json = virJSONValueFromString(buf)))
+        return -1;
+
+    if (macs)
+        return virNSSIndexWriteMACs(dst, json);
+
+    return virNSSIndexWriteLeases(dst, json);
+}
+
+
+static void
+testFreeMACs(char **macs,
+             size_t nmacs)
+{
+    size_t i;
+
+    for (i = 0; i < nmacs; i++)
+        free(macs[i]);
+    free(macs);
+}
+
+
+static int
+testLeases(const void *opaque)
+{
+    const struct testLeasesData *data = opaque;
+    g_autofree char *file = g_strdup_printf("%s/%s.status",
+                                            scratchDir, data->network);
+    char *macs[] = { (char *) data->mac };
+    size_t nmacs = data->mac ? 1 : 0;
+    leaseAddress *expect = NULL;
+    leaseAddress *actual = NULL;
+    size_t nexpect = 0;
+    size_t nactual = 0;
+    bool expectFound = false;
+    bool actualFound = false;
+    time_t now = time(NULL);
+    size_t i;
+    int ret = -1;
+
+    if (findLeases(file, data->name, macs, nmacs, data->af, now,
+                   &expect, &nexpect, &expectFound) < 0)
+        goto cleanup;
+
+    if (findLeasesIndex(file, data->name, macs, nmacs, data->af, now,
+                        &actual, &nactual, &actualFound) != 1) {
+        fprintf(stderr, "Index of %s was not used\n", file);
+        goto cleanup;
+    }
+
+    if (expectFound != actualFound || nexpect != nactual) {
+        fprintf(stderr, "Expected %zu addresses (found %d), got %zu (found %d)\n",
+                nexpect, expectFound, nactual, actualFound);
+        goto cleanup;
+    }
+
+    for (i = 0; i < nexpect; i++) {
+        if (expect[i].af != actual[i].af ||
+            expect[i].expirytime != actual[i].expirytime ||
+            memcmp(expect[i].addr, actual[i].addr,
+                   expect[i].af == AF_INET6 ? 16 : 4) != 0) {
+            fprintf(stderr, "Address %zu differs\n", i);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    free(expect);
+    free(actual);
+    return ret;
+}
+
+
+static int
+testMACs(const void *opaque)
+{
+    const struct testMACsData *data = opaque;
+    g_autofree char *file = g_strdup_printf("%s/%s.macs",
+                                            scratchDir, data->network);
+    char **expect = NULL;
+    char **actual = NULL;
+    size_t nexpect = 0;
+    size_t nactual = 0;
+    size_t i;
+    int ret = -1;
+
+    if (findMACs(file, data->name, &expect, &nexpect) < 0)
+        goto cleanup;
+
+    if (findMACsIndex(file, data->name, &actual, &nactual) != 1) {
+        fprintf(stderr, "Index of %s was not used\n", file);
+        goto cleanup;
+    }
+
+    if (nexpect != nactual) {
+        fprintf(stderr, "Expected %zu MACs, got %zu\n", nexpect, nactual);
+        goto cleanup;
+    }
+
+    for (i = 0; i < nexpect; i++) {
+        if (STRNEQ(expect[i], actual[i])) {
+            fprintf(stderr, "Expected %s, got %s\n", expect[i], actual[i]);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    testFreeMACs(expect, nexpect);
+    testFreeMACs(actual, nactual);
+    return ret;
+}
+
+
+static int
+testStale(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *file = g_strdup_printf("%s/virbr0.status", scratchDir);
+    g_autofree char *buf = NULL;
+    leaseAddress *addrs = NULL;
+    size_t naddrs = 0;
+    bool found = false;
+    int rc;
+
+    /* Rewriting the lease file behind the index' back must make it unusable */
+    if (virTestLoadFile(file, &buf) < 0 ||
+        virFileRewriteStr(file, 0644, buf) < 0)
+        return -1;
+
+    rc = findLeasesIndex(file, "fedora", NULL, 0, AF_UNSPEC, time(NULL),
+                         &addrs, &naddrs, &found);
+    free(addrs);
+
+    if (rc != 0) {
+        fprintf(stderr, "Stale index of %s was used\n", file);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (!g_mkdtemp(scratchDir)) {
+        fprintf(stderr, "Cannot create %s\n", scratchDir);
+        return EXIT_FAILURE;
+    }
+
+    if (testCopyFile("virbr0", "status", false) < 0 ||
+        testCopyFile("virbr1", "status", false) < 0 ||
+        testCopyFile("virbr0", "macs", true) < 0 ||
+        testCopyFile("virbr1", "macs", true) < 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+# define DO_TEST_LEASES(network, name, mac, af) \
+    do { \
+        struct testLeasesData data = { network, name, mac, af }; \
+        if (virTestRun("Leases " network " " name " " #af, \
+                       testLeases, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+# define DO_TEST_MACS(network, name) \
+    do { \
+        struct testMACsData data = { network, name }; \
+        if (virTestRun("MACs " network " " name, testMACs, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_LEASES("virbr0", "fedora", NULL, AF_UNSPEC);
+    DO_TEST_LEASES("virbr0", "fedora", NULL, AF_INET6);
+    DO_TEST_LEASES("virbr0", "gentoo", NULL, AF_INET);
+    DO_TEST_LEASES("virbr0", "non-existent", NULL, AF_UNSPEC);
+    DO_TEST_LEASES("virbr0", "debian", "52:54:00:11:22:33", AF_UNSPEC);
+    DO_TEST_LEASES("virbr0", "unknown", "52:54:00:ff:ff:ff", AF_UNSPEC);
+    DO_TEST_LEASES("virbr1", "fedora", NULL, AF_UNSPEC);
+    DO_TEST_LEASES("virbr1", "gentoo", NULL, AF_INET6);
+    DO_TEST_LEASES("virbr1", "fedora", "52:54:00:a4:6f:94", AF_INET);
+    DO_TEST_LEASES("virbr1", "suse", "52:54:00:aa:bb:cc", AF_INET);
+
+    DO_TEST_MACS("virbr0", "fedora");
+    DO_TEST_MACS("virbr0", "debian");
+    DO_TEST_MACS("virbr0", "non-existent");
+    DO_TEST_MACS("virbr1", "fedora");
+    DO_TEST_MACS("virbr1", "suse");
+
+    if (virTestRun("Stale index", testStale, NULL) < 0)
+        ret = -1;
+
+ cleanup:
+    virFileDeleteTree(scratchDir);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+#else
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+#endif
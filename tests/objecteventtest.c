@@ -23,7 +23,9 @@
 
 #include "testutils.h"
 
+#include "domain_event.h"
 #include "virerror.h"
+#include "viruuid.h"
 #include "virxml.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -472,6 +474,133 @@ testDomainStartStopEvent(const void *data)
     return ret;
 }
 
+static int
+testDomainCoalesce(const void *data)
+{
+    const objecteventTest *test = data;
+    lifecycleEventCounter counter;
+    virObjectEventStatePtr state = NULL;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    int id = -1;
+    int ret = -1;
+
+    lifecycleEventCounter_reset(&counter);
+
+    if (virUUIDParse("77a6fc12-07b5-9415-8abb-a803613f2a40", uuid) < 0)
+        return -1;
+
+    if (!(state = virObjectEventStateNew()))
+        return -1;
+
+    if (virDomainEventStateRegisterID(test->conn, state, NULL,
+                                      VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                      VIR_DOMAIN_EVENT_CALLBACK(&domainLifecycleCb),
+                                      &counter, NULL, &id) < 0)
+        goto cleanup;
+
+    virObjectEventStateSetCoalesce(state, virDomainEventCoalesce);
+
+    /* Only the repeated start events are redundant; the second start
+     * after the stop must be kept */
+    virObjectEventStateQueue(state,
+        virDomainEventLifecycleNew(1, "test-domain", uuid,
+                                   VIR_DOMAIN_EVENT_STARTED,
+                                   VIR_DOMAIN_EVENT_STARTED_BOOTED));
+    virObjectEventStateQueue(state,
+        virDomainEventLifecycleNew(1, "test-domain", uuid,
+                                   VIR_DOMAIN_EVENT_STARTED,
+                                   VIR_DOMAIN_EVENT_STARTED_BOOTED));
+    virObjectEventStateQueue(state,
+        virDomainEventLifecycleNew(1, "test-domain", uuid,
+                                   VIR_DOMAIN_EVENT_STOPPED,
+                                   VIR_DOMAIN_EVENT_STOPPED_DESTROYED));
+    virObjectEventStateQueue(state,
+        virDomainEventLifecycleNew(2, "test-domain", uuid,
+                                   VIR_DOMAIN_EVENT_STARTED,
+                                   VIR_DOMAIN_EVENT_STARTED_BOOTED));
+    virObjectEventStateQueue(state,
+        virDomainEventLifecycleNew(2, "test-domain", uuid,
+                                   VIR_DOMAIN_EVENT_STARTED,
+                                   VIR_DOMAIN_EVENT_STARTED_BOOTED));
+
+    if (virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (counter.startEvents != 2 || counter.stopEvents != 1 ||
+        counter.unexpectedEvents > 0)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    if (id >= 0)
+        virObjectEventStateDeregisterID(test->conn, state, id, true);
+    virObjectUnref(state);
+    return ret;
+}
+
+static void
+domainBlockJobCb(virConnectPtr conn G_GNUC_UNUSED,
+                 virDomainPtr dom G_GNUC_UNUSED,
+                 const char *disk G_GNUC_UNUSED,
+                 int type G_GNUC_UNUSED,
+                 int status G_GNUC_UNUSED,
+                 void *opaque)
+{
+    int *counter = opaque;
+
+    (*counter)++;
+}
+
+static int
+testDomainCoalesceBlockJob(const void *data)
+{
+    const objecteventTest *test = data;
+    virObjectEventStatePtr state = NULL;
+    virDomainPtr dom = NULL;
+    int counter = 0;
+    int id = -1;
+    int ret = -1;
+
+    if (!(dom = virDomainLookupByName(test->conn, "test")))
+        return -1;
+
+    if (!(state = virObjectEventStateNew()))
+        goto cleanup;
+
+    if (virDomainEventStateRegisterID(test->conn, state, NULL,
+                                      VIR_DOMAIN_EVENT_ID_BLOCK_JOB_2,
+                                      VIR_DOMAIN_EVENT_CALLBACK(&domainBlockJobCb),
+                                      &counter, NULL, &id) < 0)
+        goto cleanup;
+
+    virObjectEventStateSetCoalesce(state, virDomainEventCoalesce);
+
+    /* Each of these completes a different job, none of them may be
+     * dropped even though they look the same */
+    virObjectEventStateQueue(state,
+        virDomainEventBlockJob2NewFromDom(dom, "vda",
+                                          VIR_DOMAIN_BLOCK_JOB_TYPE_PULL,
+                                          VIR_DOMAIN_BLOCK_JOB_COMPLETED));
+    virObjectEventStateQueue(state,
+        virDomainEventBlockJob2NewFromDom(dom, "vda",
+                                          VIR_DOMAIN_BLOCK_JOB_TYPE_PULL,
+                                          VIR_DOMAIN_BLOCK_JOB_COMPLETED));
+
+    if (virEventRunDefaultImpl() < 0)
+        goto cleanup;
+
+    if (counter != 2)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    if (id >= 0)
+        virObjectEventStateDeregisterID(test->conn, state, id, true);
+    virObjectUnref(state);
+    virDomainFree(dom);
+    return ret;
+}
+
 static int
 testNetworkCreateXML(const void *data)
 {
@@ -864,6 +993,11 @@ mymain(void)
         ret = EXIT_FAILURE;
     if (virTestRun("Domain start stop events", testDomainStartStopEvent, &test) < 0)
         ret = EXIT_FAILURE;
+    if (virTestRun("Domain event coalescing", testDomainCoalesce, &test) < 0)
+        ret = EXIT_FAILURE;
+    if (virTestRun("Domain block job events are not coalesced",
+                   testDomainCoalesceBlockJob, &test) < 0)
+        ret = EXIT_FAILURE;
 
     /* Network event tests */
     /* Tests requiring the test network not to be set up */
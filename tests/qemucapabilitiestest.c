@@ -41,6 +41,7 @@ struct _testQemuData {
     const char *version;
     const char *archName;
     const char *suffix;
+    const char *scratchDir;
     int ret;
 };
 
@@ -168,6 +169,46 @@ testQemuCapsCopy(const void *opaque)
 }
 
 
+static int
+testQemuCapsBinary(const void *opaque)
+{
+    const testQemuData *data = opaque;
+    g_autofree char *capsFile = NULL;
+    g_autofree char *binFile = NULL;
+    g_autofree char *binary = NULL;
+    g_autoptr(virQEMUCaps) orig = NULL;
+    g_autoptr(virQEMUCaps) loaded = NULL;
+    g_autofree char *actual = NULL;
+    virArch arch = virArchFromString(data->archName);
+
+    capsFile = g_strdup_printf("%s/%s_%s.%s.xml",
+                               data->outputDir, data->prefix, data->version,
+                               data->archName);
+    binFile = g_strdup_printf("%s/%s_%s.%s.bin",
+                              data->scratchDir, data->prefix, data->version,
+                              data->archName);
+    binary = g_strdup_printf("/usr/bin/qemu-system-%s", data->archName);
+
+    if (!(orig = qemuTestParseCapabilitiesArch(arch, capsFile)))
+        return -1;
+
+    if (virQEMUCapsSaveBinaryCache(orig, binFile) < 0)
+        return -1;
+
+    if (!(loaded = virQEMUCapsNewBinary(binary)) ||
+        virQEMUCapsLoadBinaryCache(arch, loaded, binFile, true) != 0)
+        return -1;
+
+    if (!(actual = virQEMUCapsFormatCache(loaded)))
+        return -1;
+
+    if (virTestCompareToFile(actual, capsFile) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 static int
 doCapsTest(const char *inputDir,
            const char *prefix,
@@ -179,9 +220,11 @@ doCapsTest(const char *inputDir,
     testQemuDataPtr data = (testQemuDataPtr) opaque;
     g_autofree char *title = NULL;
     g_autofree char *copyTitle = NULL;
+    g_autofree char *binaryTitle = NULL;
 
     title = g_strdup_printf("%s (%s)", version, archName);
     copyTitle = g_strdup_printf("copy %s (%s)", version, archName);
+    binaryTitle = g_strdup_printf("binary %s (%s)", version, archName);
 
     data->inputDir = inputDir;
     data->prefix = prefix;
@@ -195,20 +238,33 @@ doCapsTest(const char *inputDir,
     if (virTestRun(copyTitle, testQemuCapsCopy, data) < 0)
         data->ret = -1;
 
+    if (virTestRun(binaryTitle, testQemuCapsBinary, data) < 0)
+        data->ret = -1;
+
     return 0;
 }
 
 
+#define SCRATCHDIRTEMPLATE abs_builddir "/qemucapabilitiesdir-XXXXXX"
+
 static int
 mymain(void)
 {
     testQemuData data;
+    char scratchDir[] = SCRATCHDIRTEMPLATE;
 
     virEventRegisterDefaultImpl();
 
+    if (!g_mkdtemp(scratchDir)) {
+        fprintf(stderr, "Cannot create qemucapabilitiesdir");
+        return EXIT_FAILURE;
+    }
+
     if (testQemuDataInit(&data) < 0)
         return EXIT_FAILURE;
 
+    data.scratchDir = scratchDir;
+
     if (testQemuCapsIterate(".replies", doCapsTest, &data) < 0)
         return EXIT_FAILURE;
 
@@ -230,6 +286,9 @@ mymain(void)
 
     testQemuDataReset(&data);
 
+    if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
+        virFileDeleteTree(scratchDir);
+
     return (data.ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
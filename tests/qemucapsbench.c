@@ -0,0 +1,176 @@
+/*
+ * qemucapsbench.c: compare loading times of QEMU capabilities cache formats
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "internal.h"
+#include "virarch.h"
+#include "virfile.h"
+#include "virstring.h"
+#include "qemu/qemu_capabilities.h"
+#define LIBVIRT_QEMU_CAPSPRIV_H_ALLOW
+#include "qemu/qemu_capspriv.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define CAPS_DIR abs_srcdir "/qemucapabilitiesdata"
+#define SCRATCHDIRTEMPLATE abs_builddir "/qemucapsbench-XXXXXX"
+
+
+/*
+ * Simulates what virFileCacheLookup does on daemon startup for every
+ * emulator: create an empty qemuCaps object and fill it from the cache
+ * file. Host CPU probing is mocked out so that only the cost of the
+ * cache format itself is measured.
+ */
+static int
+benchLoad(virArch arch,
+          const char *binary,
+          const char *filename,
+          bool useBinary,
+          unsigned int iterations,
+          gint64 *elapsed)
+{
+    gint64 start = g_get_monotonic_time();
+    size_t i;
+
+    for (i = 0; i < iterations; i++) {
+        g_autoptr(virQEMUCaps) caps = NULL;
+        int rc;
+
+        if (!(caps = virQEMUCapsNewBinary(binary)))
+            return -1;
+
+        if (useBinary)
+            rc = virQEMUCapsLoadBinaryCache(arch, caps, filename, true);
+        else
+            rc = virQEMUCapsLoadCache(arch, caps, filename, true);
+
+        if (rc != 0)
+            return -1;
+    }
+
+    *elapsed = g_get_monotonic_time() - start;
+    return 0;
+}
+
+
+static int
+benchFile(const char *scratchDir,
+          const char *name,
+          unsigned int iterations,
+          gint64 *totalXML,
+          gint64 *totalBinary)
+{
+    g_autofree char *xmlFile = g_strdup_printf("%s/%s", CAPS_DIR, name);
+    g_autofree char *binFile = g_strdup_printf("%s/%s.bin", scratchDir, name);
+    g_autofree char *archName = NULL;
+    g_autofree char *binary = NULL;
+    g_autoptr(virQEMUCaps) caps = NULL;
+    gint64 xmlTime;
+    gint64 binTime;
+    char *p;
+    virArch arch;
+
+    /* caps_<version>.<arch>.xml */
+    archName = g_strndup(name, strlen(name) - strlen(".xml"));
+    if (!(p = strrchr(archName, '.')) ||
+        !(arch = virArchFromString(p + 1)))
+        return 0;
+
+    binary = g_strdup_printf("/usr/bin/qemu-system-%s", p + 1);
+
+    if (!(caps = virQEMUCapsNewBinary(binary)) ||
+        virQEMUCapsLoadCache(arch, caps, xmlFile, true) < 0 ||
+        virQEMUCapsSaveBinaryCache(caps, binFile) < 0)
+        return -1;
+
+    if (benchLoad(arch, binary, xmlFile, false, iterations, &xmlTime) < 0 ||
+        benchLoad(arch, binary, binFile, true, iterations, &binTime) < 0)
+        return -1;
+
+    printf("%-40s xml %8.3f ms  binary %8.3f ms  (%.1fx)\n", name,
+           xmlTime / 1000.0 / iterations, binTime / 1000.0 / iterations,
+           binTime ? (double) xmlTime / binTime : 0);
+
+    *totalXML += xmlTime;
+    *totalBinary += binTime;
+    return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    const char *mock = VIR_TEST_MOCK("qemucpumock");
+    char scratchDir[] = SCRATCHDIRTEMPLATE;
+    unsigned int iterations = 20;
+    gint64 totalXML = 0;
+    gint64 totalBinary = 0;
+    DIR *dir = NULL;
+    struct dirent *ent;
+    int ret = EXIT_FAILURE;
+    int rc;
+
+    VIR_TEST_PRELOAD(mock);
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &iterations) < 0 ||
+                       iterations == 0))) {
+        fprintf(stderr, "%s [ITERATIONS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    if (!g_mkdtemp(scratchDir)) {
+        fprintf(stderr, "Cannot create %s\n", scratchDir);
+        return EXIT_FAILURE;
+    }
+
+    if (virDirOpen(&dir, CAPS_DIR) < 0)
+        goto cleanup;
+
+    while ((rc = virDirRead(dir, &ent, CAPS_DIR)) > 0) {
+        if (!virStringHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        if (benchFile(scratchDir, ent->d_name, iterations,
+                      &totalXML, &totalBinary) < 0) {
+            fprintf(stderr, "Failed to benchmark %s: %s\n",
+                    ent->d_name, virGetLastErrorMessage());
+            goto cleanup;
+        }
+    }
+    if (rc < 0)
+        goto cleanup;
+
+    printf("%-40s xml %8.3f ms  binary %8.3f ms\n", "total per startup",
+           totalXML / 1000.0 / iterations, totalBinary / 1000.0 / iterations);
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    VIR_DIR_CLOSE(dir);
+    virFileDeleteTree(scratchDir);
+    return ret;
+}
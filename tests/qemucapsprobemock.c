@@ -79,34 +79,32 @@ qemuMonitorSend(qemuMonitorPtr mon,
 }
 
 
-static int (*realQemuMonitorJSONIOProcessLine)(qemuMonitorPtr mon,
-                                               const char *line,
-                                               qemuMonitorMessagePtr msg);
+static int (*realQemuMonitorJSONIOProcessMessage)(qemuMonitorPtr mon,
+                                                  virJSONValuePtr message,
+                                                  qemuMonitorMessagePtr msg);
 
 int
-qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
-                             const char *line,
-                             qemuMonitorMessagePtr msg)
+qemuMonitorJSONIOProcessMessage(qemuMonitorPtr mon,
+                                virJSONValuePtr message,
+                                qemuMonitorMessagePtr msg)
 {
-    virJSONValuePtr value = NULL;
     char *json = NULL;
+    bool greeting;
     int ret;
 
-    REAL_SYM(realQemuMonitorJSONIOProcessLine);
+    REAL_SYM(realQemuMonitorJSONIOProcessMessage);
 
-    ret = realQemuMonitorJSONIOProcessLine(mon, line, msg);
-
-    if (ret == 0) {
-        if (!(value = virJSONValueFromString(line)) ||
-            !(json = virJSONValueToString(value, true))) {
-            fprintf(stderr, "Failed to reformat reply string '%s'\n", line);
-            abort();
-        }
+    /* @message is consumed by the real function */
+    if (!(json = virJSONValueToString(message, true))) {
+        fprintf(stderr, "Failed to reformat reply\n");
+        abort();
+    }
+    greeting = virJSONValueObjectHasKey(message, "QMP") == 1;
 
-        /* Ignore QMP greeting */
-        if (virJSONValueObjectHasKey(value, "QMP"))
-            goto cleanup;
+    ret = realQemuMonitorJSONIOProcessMessage(mon, message, msg);
 
+    /* Ignore QMP greeting */
+    if (ret == 0 && !greeting) {
         if (first)
             first = false;
         else
@@ -115,8 +113,6 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
         printLineSkipEmpty(json, stdout);
     }
 
- cleanup:
     VIR_FREE(json);
-    virJSONValueFree(value);
     return ret;
 }
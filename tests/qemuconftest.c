@@ -0,0 +1,98 @@
+#include <config.h>
+
+#include "testutils.h"
+
+#ifdef WITH_QEMU
+
+# include "internal.h"
+# include "qemu/qemu_conf.h"
+
+# define VIR_FROM_THIS VIR_FROM_QEMU
+
+struct testInfo {
+    const char *name;
+    bool fail;
+    unsigned int statsWorkers;
+    unsigned int statsTimeout;
+};
+
+
+static int
+testLoadConfig(const void *opaque)
+{
+    const struct testInfo *info = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = NULL;
+    g_autofree char *file = NULL;
+    int rc;
+
+    file = g_strdup_printf("%s/qemuconfdata/%s.conf", abs_srcdir, info->name);
+
+    if (!(cfg = virQEMUDriverConfigNew(false, NULL)))
+        return -1;
+
+    rc = virQEMUDriverConfigLoadFile(cfg, file, false);
+
+    if (info->fail) {
+        if (rc == 0) {
+            VIR_TEST_DEBUG("loading '%s' succeeded unexpectedly", file);
+            return -1;
+        }
+        virResetLastError();
+        return 0;
+    }
+
+    if (rc < 0)
+        return -1;
+
+    if (cfg->statsWorkers != info->statsWorkers ||
+        cfg->statsTimeout != info->statsTimeout) {
+        VIR_TEST_DEBUG("expected stats_workers=%u stats_timeout=%u, "
+                       "got stats_workers=%u stats_timeout=%u",
+                       info->statsWorkers, info->statsTimeout,
+                       cfg->statsWorkers, cfg->statsTimeout);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+# define DO_TEST_FULL(_name, _fail, _workers, _timeout) \
+    do { \
+        struct testInfo info = { \
+            .name = _name, .fail = _fail, \
+            .statsWorkers = _workers, .statsTimeout = _timeout, \
+        }; \
+        if (virTestRun("QEMU config " _name, testLoadConfig, &info) < 0) \
+            ret = -1; \
+    } while (0)
+
+# define DO_TEST(_name, _workers, _timeout) \
+    DO_TEST_FULL(_name, false, _workers, _timeout)
+
+# define DO_TEST_FAIL(_name) \
+    DO_TEST_FULL(_name, true, 0, 0)
+
+    DO_TEST("empty", 0, 0);
+    DO_TEST("stats", 4, 10);
+    DO_TEST_FAIL("stats-invalid");
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+
+#else
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WITH_QEMU */
@@ -0,0 +1,239 @@
+#include <config.h>
+
+#include <unistd.h>
+
+#include "testutils.h"
+
+#ifdef WITH_QEMU
+
+# include "internal.h"
+# include "qemu/qemu_domain.h"
+# include "testutilsqemu.h"
+# include "virfile.h"
+
+# define VIR_FROM_THIS VIR_FROM_NONE
+
+static virQEMUDriver driver;
+
+# define STATUS_IN abs_srcdir "/qemustatusxml2xmldata/modern-in.xml"
+# define STATUS_STALE "stale\n"
+
+
+static virDomainObjPtr
+testStatusLoad(char **statusFile)
+{
+    virDomainObjPtr obj;
+
+    if (!(obj = virDomainObjParseFile(STATUS_IN, driver.xmlopt,
+                                      VIR_DOMAIN_DEF_PARSE_STATUS |
+                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
+                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
+                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL))) {
+        VIR_TEST_DEBUG("failed to parse '%s'", STATUS_IN);
+        return NULL;
+    }
+
+    *statusFile = virDomainConfigFile(driver.config->stateDir, obj->def->name);
+    unlink(*statusFile);
+
+    return obj;
+}
+
+
+/* Replace the status file behind the driver's back, so that any
+ * later write can be told apart from a skipped one */
+static int
+testStatusMarkStale(const char *statusFile)
+{
+    if (virFileWriteStr(statusFile, STATUS_STALE, 0600) < 0) {
+        VIR_TEST_DEBUG("cannot write '%s'", statusFile);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testStatusIsStale(const char *statusFile)
+{
+    g_autofree char *content = NULL;
+
+    if (virFileReadAll(statusFile, 1024 * 1024, &content) < 0)
+        return -1;
+
+    return STREQ(content, STATUS_STALE) ? 1 : 0;
+}
+
+
+static int
+testStatusSkipUnchanged(const void *opaque G_GNUC_UNUSED)
+{
+    virDomainObjPtr obj;
+    g_autofree char *statusFile = NULL;
+    int ret = -1;
+
+    if (!(obj = testStatusLoad(&statusFile)))
+        return -1;
+
+    qemuDomainSaveStatus(obj);
+    if (!virFileExists(statusFile)) {
+        VIR_TEST_DEBUG("status was not saved");
+        goto cleanup;
+    }
+
+    /* Same XML again, the file must be left alone */
+    if (testStatusMarkStale(statusFile) < 0)
+        goto cleanup;
+    qemuDomainSaveStatus(obj);
+    if (testStatusIsStale(statusFile) != 1) {
+        VIR_TEST_DEBUG("unchanged status was rewritten");
+        goto cleanup;
+    }
+
+    /* Any change of the XML must be written though */
+    obj->def->mem.cur_balloon -= 1024;
+    qemuDomainSaveStatus(obj);
+    if (testStatusIsStale(statusFile) != 0) {
+        VIR_TEST_DEBUG("changed status was not rewritten");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    unlink(statusFile);
+    virDomainObjEndAPI(&obj);
+    return ret;
+}
+
+
+static int
+testStatusRewriteDeleted(const void *opaque G_GNUC_UNUSED)
+{
+    virDomainObjPtr obj;
+    g_autofree char *statusFile = NULL;
+    int ret = -1;
+
+    if (!(obj = testStatusLoad(&statusFile)))
+        return -1;
+
+    qemuDomainSaveStatus(obj);
+    if (!virFileExists(statusFile)) {
+        VIR_TEST_DEBUG("status was not saved");
+        goto cleanup;
+    }
+
+    /* The XML is unchanged, but the file is gone */
+    unlink(statusFile);
+    qemuDomainSaveStatus(obj);
+    if (!virFileExists(statusFile)) {
+        VIR_TEST_DEBUG("deleted status was not rewritten");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    unlink(statusFile);
+    virDomainObjEndAPI(&obj);
+    return ret;
+}
+
+
+static int
+testStatusSaveLater(const void *opaque G_GNUC_UNUSED)
+{
+    virDomainObjPtr obj;
+    qemuDomainObjPrivatePtr priv;
+    g_autofree char *statusFile = NULL;
+    int ret = -1;
+
+    if (!(obj = testStatusLoad(&statusFile)))
+        return -1;
+    priv = obj->privateData;
+
+    /* Pretend the timer exists, no event loop is registered so arming
+     * it does nothing and only the explicit saves below write */
+    driver.statusSaveTimer = 0;
+
+    qemuDomainSaveStatus(obj);
+    if (testStatusMarkStale(statusFile) < 0)
+        goto cleanup;
+
+    /* A deferred save only marks the status dirty */
+    obj->def->mem.cur_balloon -= 1024;
+    qemuDomainSaveStatusLater(obj);
+    if (!priv->statusDirty || testStatusIsStale(statusFile) != 1) {
+        VIR_TEST_DEBUG("deferred status was saved immediately");
+        goto cleanup;
+    }
+
+    /* A synchronous save writes it and clears the dirty mark ... */
+    qemuDomainSaveStatus(obj);
+    if (priv->statusDirty || testStatusIsStale(statusFile) != 0) {
+        VIR_TEST_DEBUG("synchronous save did not take over the deferred one");
+        goto cleanup;
+    }
+
+    /* ... so that flushing afterwards has nothing left to do */
+    if (testStatusMarkStale(statusFile) < 0)
+        goto cleanup;
+    obj->def->mem.cur_balloon -= 1024;
+    qemuDomainSaveStatusFlush(obj);
+    if (testStatusIsStale(statusFile) != 1) {
+        VIR_TEST_DEBUG("flush saved status which was not dirty");
+        goto cleanup;
+    }
+
+    /* Flushing a pending deferred save writes it */
+    qemuDomainSaveStatusLater(obj);
+    qemuDomainSaveStatusFlush(obj);
+    if (priv->statusDirty || testStatusIsStale(statusFile) != 0) {
+        VIR_TEST_DEBUG("flush did not save the deferred status");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    driver.statusSaveTimer = -1;
+    g_atomic_int_set(&driver.statusSaveArmed, 0);
+    unlink(statusFile);
+    virDomainObjEndAPI(&obj);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (qemuTestDriverInit(&driver) < 0)
+        return EXIT_FAILURE;
+
+    if (virTestRun("Skip unchanged status", testStatusSkipUnchanged, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Rewrite deleted status", testStatusRewriteDeleted, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Deferred status save", testStatusSaveLater, NULL) < 0)
+        ret = -1;
+
+    qemuTestDriverFree(&driver);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+
+#else
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WITH_QEMU */
@@ -379,6 +379,7 @@ int qemuTestDriverInit(virQEMUDriver *driver)
     char configdir[] = CONFIGDIRTEMPLATE;
 
     memset(driver, 0, sizeof(*driver));
+    driver->statusSaveTimer = -1;
 
     if (!(cpuDefault = virCPUDefCopy(&cpuDefaultData)) ||
         !(cpuHaswell = virCPUDefCopy(&cpuHaswellData)) ||
@@ -291,7 +291,8 @@ testBufEscapeStr(const void *opaque)
 
     virBufferAddLit(&buf, "<c>\n");
     virBufferAdjustIndent(&buf, 2);
-    virBufferEscapeString(&buf, "<el>%s</el>\n", data->data);
+    virBufferEscapeString(&buf, data->arg ? data->arg : "<el>%s</el>\n",
+                          data->data);
     virBufferAdjustIndent(&buf, -2);
     virBufferAddLit(&buf, "</c>");
 
@@ -310,6 +311,84 @@ testBufEscapeStr(const void *opaque)
 }
 
 
+static int
+testBufEscapeAttr(const void *opaque)
+{
+    const struct testBufAddStrData *data = opaque;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+
+    virBufferAddLit(&buf, "<c>\n");
+    virBufferAdjustIndent(&buf, 2);
+    virBufferAddLit(&buf, "<el");
+    virBufferEscapeAttr(&buf, "attr", data->data);
+    virBufferEscapeAttr(&buf, "null", NULL);
+    virBufferAddLit(&buf, "/>\n");
+    virBufferAdjustIndent(&buf, -2);
+    virBufferAddLit(&buf, "</c>");
+
+    if (!(actual = virBufferContentAndReset(&buf))) {
+        VIR_TEST_DEBUG("buf is empty");
+        return -1;
+    }
+
+    if (STRNEQ_NULLABLE(actual, data->expect)) {
+        VIR_TEST_DEBUG("testBufEscapeAttr(): Strings don't match:");
+        virTestDifference(stderr, data->expect, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testBufAddInt(const void *opaque G_GNUC_UNUSED)
+{
+    const long long nums[] = {
+        0, 1, -1, 9, 10, -10, 4096, 123456789, LLONG_MAX, LLONG_MIN,
+    };
+    const unsigned long long unums[] = {
+        0, 9, 10, 1ULL << 32, ULLONG_MAX,
+    };
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) printfbuf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+    g_autofree char *expect = NULL;
+    size_t i;
+
+    virBufferAdjustIndent(&buf, 2);
+    virBufferAdjustIndent(&printfbuf, 2);
+
+    for (i = 0; i < G_N_ELEMENTS(nums); i++) {
+        virBufferAddInt(&buf, nums[i]);
+        virBufferAddIntAttr(&buf, "val", nums[i]);
+        virBufferAddChar(&buf, '\n');
+
+        virBufferAsprintf(&printfbuf, "%lld val='%lld'\n", nums[i], nums[i]);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(unums); i++) {
+        virBufferAddUInt(&buf, unums[i]);
+        virBufferAddUIntAttr(&buf, "val", unums[i]);
+        virBufferAddChar(&buf, '\n');
+
+        virBufferAsprintf(&printfbuf, "%llu val='%llu'\n", unums[i], unums[i]);
+    }
+
+    actual = virBufferContentAndReset(&buf);
+    expect = virBufferContentAndReset(&printfbuf);
+
+    if (STRNEQ_NULLABLE(actual, expect)) {
+        VIR_TEST_DEBUG("testBufAddInt(): Strings don't match:");
+        virTestDifference(stderr, expect, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 testBufEscapeRegex(const void *opaque)
 {
@@ -385,6 +464,7 @@ mymain(void)
     DO_TEST("AddBuffer", testBufAddBuffer);
     DO_TEST("set indent", testBufSetIndent);
     DO_TEST("autoclean", testBufferAutoclean);
+    DO_TEST("AddInt", testBufAddInt);
 
 #define DO_TEST_ADD_STR(_data, _expect) \
     do { \
@@ -414,6 +494,35 @@ mymain(void)
     DO_TEST_ESCAPE("\x01\x01\x02\x03\x05\x08",
                    "<c>\n  <el></el>\n</c>");
 
+#define DO_TEST_ESCAPE_FORMAT(_format, _data, _expect) \
+    do { \
+        struct testBufAddStrData info = { .data = _data, .expect = _expect, .arg = _format }; \
+        if (virTestRun("Buf: EscapeStr: " #_format, testBufEscapeStr, &info) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_ESCAPE_FORMAT("%s", "<&>", "<c>\n  &lt;&amp;&gt;</c>");
+    DO_TEST_ESCAPE_FORMAT("<el a='%s'/>\n", "'\x02'",
+                          "<c>\n  <el a='&apos;&apos;'/>\n</c>");
+    DO_TEST_ESCAPE_FORMAT("<el>%s</el>%%\n", "'&'",
+                          "<c>\n  <el>&apos;&amp;&apos;</el>%\n</c>");
+    DO_TEST_ESCAPE_FORMAT("%%<el>%s</el>\n", "<a>",
+                          "<c>\n  %<el>&lt;a&gt;</el>\n</c>");
+
+#define DO_TEST_ESCAPE_ATTR(_data, _expect) \
+    do { \
+        struct testBufAddStrData info = { .data = _data, .expect = _expect }; \
+        if (virTestRun("Buf: EscapeAttr", testBufEscapeAttr, &info) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_ESCAPE_ATTR("noescape",
+                        "<c>\n  <el attr='noescape'/>\n</c>");
+    DO_TEST_ESCAPE_ATTR("",
+                        "<c>\n  <el attr=''/>\n</c>");
+    DO_TEST_ESCAPE_ATTR("<a href=\"x\">'&'</a>\x03",
+                        "<c>\n  <el attr='&lt;a href=&quot;x&quot;&gt;&apos;&amp;&apos;&lt;/a&gt;'/>\n</c>");
+
 #define DO_TEST_ESCAPE_REGEX(_data, _expect) \
     do { \
         struct testBufAddStrData info = { .data = _data, .expect = _expect }; \
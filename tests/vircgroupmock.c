@@ -248,9 +248,9 @@ static int make_controller_v2(const char *path, mode_t mode)
     MAKE_FILE("cgroup.type", "domain\n");
     MAKE_FILE("cpu.max", "max 100000\n");
     MAKE_FILE("cpu.stat",
-              "usage_usec 0\n"
-              "user_usec 0\n"
-              "system_usec 0\n"
+              "usage_usec 1530000\n"
+              "user_usec 1040000\n"
+              "system_usec 490000\n"
               "nr_periods 0\n"
               "nr_throttled 0\n"
               "throttled_usec 0\n");
@@ -260,7 +260,7 @@ static int make_controller_v2(const char *path, mode_t mode)
     MAKE_FILE("memory.max", "max\n");
     MAKE_FILE("memory.stat",
               "anon 0\n"
-              "file 0\n"
+              "file 1048576\n"
               "kernel_stack 0\n"
               "slab 0\n"
               "sock 0\n"
@@ -268,11 +268,11 @@ static int make_controller_v2(const char *path, mode_t mode)
               "file_mapped 0\n"
               "file_dirty 0\n"
               "file_writeback 0\n"
-              "inactive_anon 0\n"
-              "active_anon 0\n"
-              "inactive_file 0\n"
-              "active_file 0\n"
-              "unevictable 0\n"
+              "inactive_anon 4096\n"
+              "active_anon 8192\n"
+              "inactive_file 524288\n"
+              "active_file 524288\n"
+              "unevictable 2048\n"
               "slab_reclaimable 0\n"
               "slab_unreclaimable 0\n"
               "pgfault 0\n"
@@ -978,6 +978,72 @@ static int testCgroupGetBlkioIoDeviceServiced(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static int
+testCgroupStatsReader(const void *args G_GNUC_UNUSED)
+{
+    virCgroupPtr cgroup = NULL;
+    g_autoptr(virCgroupStatsReader) reader = NULL;
+    virCgroupStats stats;
+    virCgroupStats expected;
+    size_t i;
+    int rv, ret = -1;
+
+    if ((rv = virCgroupNewPartition("/virtualmachines", true,
+                                    (1 << VIR_CGROUP_CONTROLLER_CPUACCT) |
+                                    (1 << VIR_CGROUP_CONTROLLER_MEMORY) |
+                                    (1 << VIR_CGROUP_CONTROLLER_BLKIO),
+                                    &cgroup)) < 0) {
+        fprintf(stderr, "Could not create /virtualmachines cgroup: %d\n", -rv);
+        goto cleanup;
+    }
+
+    memset(&expected, 0, sizeof(expected));
+    if (virCgroupGetCpuacctUsage(cgroup, &expected.cpuTime) < 0 ||
+        virCgroupGetCpuacctStat(cgroup, &expected.cpuUser,
+                                &expected.cpuSystem) < 0 ||
+        virCgroupGetMemoryStat(cgroup, &expected.memCache,
+                               &expected.memActiveAnon,
+                               &expected.memInactiveAnon,
+                               &expected.memActiveFile,
+                               &expected.memInactiveFile,
+                               &expected.memUnevictable) < 0 ||
+        virCgroupGetBlkioIoServiced(cgroup,
+                                    &expected.blkioBytesRead,
+                                    &expected.blkioBytesWrite,
+                                    &expected.blkioRequestsRead,
+                                    &expected.blkioRequestsWrite) < 0) {
+        fprintf(stderr, "Could not retrieve stats for /virtualmachines cgroup\n");
+        goto cleanup;
+    }
+
+    if (!(reader = virCgroupStatsReaderNew(cgroup,
+                                           VIR_CGROUP_STATS_CPU |
+                                           VIR_CGROUP_STATS_MEMORY |
+                                           VIR_CGROUP_STATS_BLKIO))) {
+        fprintf(stderr, "Could not create stats reader for /virtualmachines cgroup\n");
+        goto cleanup;
+    }
+
+    /* The files are kept open, make sure re-reading them works too */
+    for (i = 0; i < 2; i++) {
+        if (virCgroupStatsReaderRead(reader, &stats) < 0) {
+            fprintf(stderr, "Could not read stats for /virtualmachines cgroup\n");
+            goto cleanup;
+        }
+
+        if (memcmp(&stats, &expected, sizeof(stats)) != 0) {
+            fprintf(stderr, "Wrong values from virCgroupStatsReaderRead\n");
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    virCgroupFree(&cgroup);
+    return ret;
+}
+
 # define FAKEROOTDIRTEMPLATE abs_builddir "/fakerootdir-XXXXXX"
 
 static char *
@@ -1090,6 +1156,9 @@ mymain(void)
 
     if (virTestRun("virCgroupGetPercpuStats works", testCgroupGetPercpuStats, NULL) < 0)
         ret = -1;
+
+    if (virTestRun("virCgroupStatsReader works", testCgroupStatsReader, NULL) < 0)
+        ret = -1;
     cleanupFakeFS(fakerootdir);
 
     fakerootdir = initFakeFS(NULL, "all-in-one");
@@ -1113,6 +1182,8 @@ mymain(void)
         ret = -1;
     if (virTestRun("Cgroup available (unified)", testCgroupAvailable, (void*)0x1) < 0)
         ret = -1;
+    if (virTestRun("virCgroupStatsReader works (unified)", testCgroupStatsReader, NULL) < 0)
+        ret = -1;
     cleanupFakeFS(fakerootdir);
 
     /* cgroup hybrid */
@@ -1122,6 +1193,8 @@ mymain(void)
         ret = -1;
     if (virTestRun("Cgroup available (hybrid)", testCgroupAvailable, (void*)0x1) < 0)
         ret = -1;
+    if (virTestRun("virCgroupStatsReader works (hybrid)", testCgroupStatsReader, NULL) < 0)
+        ret = -1;
     cleanupFakeFS(fakerootdir);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
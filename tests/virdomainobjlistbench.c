@@ -0,0 +1,196 @@
+/*
+ * virdomainobjlistbench.c: measure concurrent domain object list lookups
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "internal.h"
+#include "domain_conf.h"
+#include "virdomainobjlist.h"
+#include "virstring.h"
+#include "virthread.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define BENCH_DOMAINS 1000
+#define BENCH_MAX_THREADS 64
+
+typedef struct _benchData benchData;
+struct _benchData {
+    virDomainObjListPtr doms;
+    unsigned char *uuids;
+    char **names;
+    size_t ndoms;
+
+    int started;
+    int stop;
+};
+
+typedef struct _benchThread benchThread;
+struct _benchThread {
+    virThread thread;
+    benchData *data;
+    unsigned int seed;
+    unsigned long long lookups;
+};
+
+
+static void
+benchWorker(void *opaque)
+{
+    benchThread *bt = opaque;
+    benchData *data = bt->data;
+    unsigned long long lookups = 0;
+    size_t i = bt->seed;
+
+    g_atomic_int_inc(&data->started);
+
+    while (!g_atomic_int_get(&data->stop)) {
+        virDomainObjPtr obj;
+
+        /* alternate lookups by UUID and by name over all domains */
+        i = (i + 7919) % data->ndoms;
+        if (i & 1)
+            obj = virDomainObjListFindByUUID(data->doms,
+                                             data->uuids + i * VIR_UUID_BUFLEN);
+        else
+            obj = virDomainObjListFindByName(data->doms, data->names[i]);
+
+        if (!obj)
+            abort();
+
+        virDomainObjEndAPI(&obj);
+        lookups++;
+    }
+
+    /* counted locally so that the threads don't share a cacheline */
+    bt->lookups = lookups;
+}
+
+
+static int
+benchRun(benchData *data,
+         size_t nthreads,
+         unsigned int seconds)
+{
+    benchThread threads[BENCH_MAX_THREADS] = { 0 };
+    unsigned long long total = 0;
+    size_t i;
+
+    data->started = 0;
+    data->stop = 0;
+
+    for (i = 0; i < nthreads; i++) {
+        threads[i].data = data;
+        threads[i].seed = i * 131;
+        if (virThreadCreate(&threads[i].thread, true, benchWorker, &threads[i]) < 0) {
+            g_atomic_int_set(&data->stop, 1);
+            while (i-- > 0)
+                virThreadJoin(&threads[i].thread);
+            return -1;
+        }
+    }
+
+    while (g_atomic_int_get(&data->started) < (int) nthreads)
+        g_usleep(1000);
+
+    g_usleep(seconds * G_USEC_PER_SEC);
+    g_atomic_int_set(&data->stop, 1);
+
+    for (i = 0; i < nthreads; i++) {
+        virThreadJoin(&threads[i].thread);
+        total += threads[i].lookups;
+    }
+
+    printf("%2zu threads: %12.0f lookups/s  %10.0f lookups/s/thread\n",
+           nthreads, (double) total / seconds,
+           (double) total / seconds / nthreads);
+    return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    virDomainXMLOptionPtr xmlopt = NULL;
+    benchData data = { 0 };
+    unsigned int seconds = 1;
+    int ret = EXIT_FAILURE;
+    size_t nthreads;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &seconds) < 0 ||
+                       seconds == 0))) {
+        fprintf(stderr, "%s [SECONDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    if (!(xmlopt = virDomainXMLOptionNew(NULL, NULL, NULL, NULL, NULL)) ||
+        !(data.doms = virDomainObjListNew()))
+        goto cleanup;
+
+    data.ndoms = BENCH_DOMAINS;
+    data.uuids = g_new0(unsigned char, data.ndoms * VIR_UUID_BUFLEN);
+    data.names = g_new0(char *, data.ndoms + 1);
+
+    for (i = 0; i < data.ndoms; i++) {
+        virDomainDefPtr def;
+        virDomainObjPtr obj;
+
+        if (!(def = virDomainDefNew()))
+            goto cleanup;
+
+        def->virtType = VIR_DOMAIN_VIRT_QEMU;
+        def->name = g_strdup_printf("bench-%zu", i);
+        if (virUUIDGenerate(def->uuid) < 0) {
+            virDomainDefFree(def);
+            goto cleanup;
+        }
+
+        data.names[i] = g_strdup(def->name);
+        memcpy(data.uuids + i * VIR_UUID_BUFLEN, def->uuid, VIR_UUID_BUFLEN);
+
+        if (!(obj = virDomainObjListAdd(data.doms, def, xmlopt, 0, NULL))) {
+            virDomainDefFree(def);
+            goto cleanup;
+        }
+        virDomainObjEndAPI(&obj);
+    }
+
+    for (nthreads = 1; nthreads <= BENCH_MAX_THREADS; nthreads *= 2) {
+        if (benchRun(&data, nthreads, seconds) < 0)
+            goto cleanup;
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "%s\n", virGetLastErrorMessage());
+    virObjectUnref(data.doms);
+    virObjectUnref(xmlopt);
+    g_strfreev(data.names);
+    g_free(data.uuids);
+    return ret;
+}
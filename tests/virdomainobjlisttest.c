@@ -0,0 +1,375 @@
+/*
+ * virdomainobjlisttest.c: test concurrent use of domain object lists
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "domain_conf.h"
+#include "virdomainobjlist.h"
+#include "virthread.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+/* domains which are never touched, all of them running */
+#define TEST_STABLE 50
+/* domains added and removed over and over again */
+#define TEST_CHURN 20
+/* domains renamed back and forth */
+#define TEST_RENAME 10
+
+#define TEST_READERS 8
+#define TEST_ROUNDS 200
+
+typedef struct _testData testData;
+struct _testData {
+    virDomainObjListPtr doms;
+    virDomainXMLOptionPtr xmlopt;
+    int stop;
+    int failed;
+};
+
+typedef struct _testThread testThread;
+struct _testThread {
+    virThread thread;
+    testData *data;
+    size_t id;
+};
+
+
+/* UUIDs are derived from the kind and index of the domain, so that
+ * every thread can compute them on its own */
+static void
+testMakeUUID(unsigned char *uuid,
+             unsigned char kind,
+             size_t idx)
+{
+    memset(uuid, 0, VIR_UUID_BUFLEN);
+    uuid[0] = kind;
+    uuid[VIR_UUID_BUFLEN - 2] = idx >> 8;
+    uuid[VIR_UUID_BUFLEN - 1] = idx & 0xff;
+}
+
+
+static void
+testFail(testData *data,
+         const char *msg,
+         const char *name)
+{
+    VIR_TEST_DEBUG("%s: %s", msg, name);
+    g_atomic_int_set(&data->failed, 1);
+    g_atomic_int_set(&data->stop, 1);
+}
+
+
+static virDomainObjPtr
+testAddDomain(testData *data,
+              const char *name,
+              const unsigned char *uuid)
+{
+    virDomainDefPtr def;
+    virDomainObjPtr obj;
+
+    if (!(def = virDomainDefNew()))
+        return NULL;
+
+    def->virtType = VIR_DOMAIN_VIRT_QEMU;
+    def->id = -1;
+    def->name = g_strdup(name);
+    memcpy(def->uuid, uuid, VIR_UUID_BUFLEN);
+
+    if (!(obj = virDomainObjListAdd(data->doms, def, data->xmlopt, 0, NULL)))
+        virDomainDefFree(def);
+
+    return obj;
+}
+
+
+static void
+testReader(void *opaque)
+{
+    testThread *tt = opaque;
+    testData *data = tt->data;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t i = tt->id;
+
+    while (!g_atomic_int_get(&data->stop)) {
+        g_autofree char *name = NULL;
+        g_autofree char *nameA = NULL;
+        g_autofree char *nameB = NULL;
+        virDomainObjPtr obj;
+        size_t idx;
+
+        i++;
+
+        /* Running domains must always be found, whichever way */
+        idx = i % TEST_STABLE;
+        name = g_strdup_printf("stable-%zu", idx);
+        testMakeUUID(uuid, 's', idx);
+
+        if (!(obj = virDomainObjListFindByUUID(data->doms, uuid)) ||
+            STRNEQ(obj->def->name, name)) {
+            testFail(data, "Wrong lookup by UUID", name);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        if (!(obj = virDomainObjListFindByName(data->doms, name)) ||
+            memcmp(obj->def->uuid, uuid, VIR_UUID_BUFLEN) != 0) {
+            testFail(data, "Wrong lookup by name", name);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        if (!(obj = virDomainObjListFindByID(data->doms, idx + 1)) ||
+            STRNEQ(obj->def->name, name)) {
+            testFail(data, "Wrong lookup by ID", name);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        /* Domains which come and go may be missing, but if they are
+         * found they must be the right ones */
+        idx = i % TEST_CHURN;
+        g_free(name);
+        name = g_strdup_printf("churn-%zu", idx);
+        testMakeUUID(uuid, 'c', idx);
+
+        if ((obj = virDomainObjListFindByUUID(data->doms, uuid)) &&
+            STRNEQ(obj->def->name, name)) {
+            testFail(data, "Wrong lookup by UUID", name);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        if ((obj = virDomainObjListFindByName(data->doms, name)) &&
+            memcmp(obj->def->uuid, uuid, VIR_UUID_BUFLEN) != 0) {
+            testFail(data, "Wrong lookup by name", name);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        /* Renamed domains stay in the list under one of their two
+         * names. The name can change again once the lookup is done,
+         * so only check that it is one of them. */
+        idx = i % TEST_RENAME;
+        nameA = g_strdup_printf("rename-a-%zu", idx);
+        nameB = g_strdup_printf("rename-b-%zu", idx);
+        testMakeUUID(uuid, 'r', idx);
+
+        if (!(obj = virDomainObjListFindByUUID(data->doms, uuid)) ||
+            (STRNEQ(obj->def->name, nameA) && STRNEQ(obj->def->name, nameB))) {
+            testFail(data, "Wrong lookup by UUID", nameA);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+
+        if ((obj = virDomainObjListFindByName(data->doms, nameB)) &&
+            memcmp(obj->def->uuid, uuid, VIR_UUID_BUFLEN) != 0) {
+            testFail(data, "Wrong lookup by name", nameB);
+            virDomainObjEndAPI(&obj);
+            return;
+        }
+        virDomainObjEndAPI(&obj);
+    }
+}
+
+
+static void
+testChurner(void *opaque)
+{
+    testThread *tt = opaque;
+    testData *data = tt->data;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t round;
+    size_t idx;
+
+    for (round = 0; round < TEST_ROUNDS; round++) {
+        for (idx = 0; idx < TEST_CHURN; idx++) {
+            g_autofree char *name = g_strdup_printf("churn-%zu", idx);
+            virDomainObjPtr obj;
+
+            if (g_atomic_int_get(&data->stop))
+                return;
+
+            testMakeUUID(uuid, 'c', idx);
+
+            if (!(obj = testAddDomain(data, name, uuid))) {
+                testFail(data, "Cannot add domain", name);
+                return;
+            }
+            virDomainObjEndAPI(&obj);
+
+            if (!(obj = virDomainObjListFindByUUID(data->doms, uuid))) {
+                testFail(data, "Added domain not found", name);
+                return;
+            }
+            virDomainObjListRemove(data->doms, obj);
+            virDomainObjEndAPI(&obj);
+        }
+    }
+}
+
+
+static int
+testRenameCallback(virDomainObjPtr dom,
+                   const char *new_name,
+                   unsigned int flags G_GNUC_UNUSED,
+                   void *opaque G_GNUC_UNUSED)
+{
+    g_free(dom->def->name);
+    dom->def->name = g_strdup(new_name);
+    return 0;
+}
+
+
+static void
+testRenamer(void *opaque)
+{
+    testThread *tt = opaque;
+    testData *data = tt->data;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t round;
+    size_t idx;
+
+    for (round = 0; round < TEST_ROUNDS; round++) {
+        for (idx = 0; idx < TEST_RENAME; idx++) {
+            g_autofree char *name = NULL;
+            virDomainObjPtr obj;
+            int rc;
+
+            if (g_atomic_int_get(&data->stop))
+                return;
+
+            name = g_strdup_printf("rename-%c-%zu",
+                                   round % 2 ? 'a' : 'b', idx);
+            testMakeUUID(uuid, 'r', idx);
+
+            if (!(obj = virDomainObjListFindByUUID(data->doms, uuid))) {
+                testFail(data, "Renamed domain not found", name);
+                return;
+            }
+            rc = virDomainObjListRename(data->doms, obj, name, 0,
+                                        testRenameCallback, NULL);
+            virDomainObjEndAPI(&obj);
+
+            if (rc < 0) {
+                testFail(data, "Cannot rename domain", name);
+                return;
+            }
+        }
+    }
+}
+
+
+static int
+testConcurrentLookups(const void *opaque G_GNUC_UNUSED)
+{
+    testData data = { 0 };
+    testThread readers[TEST_READERS] = { 0 };
+    testThread churner = { .data = &data };
+    testThread renamer = { .data = &data };
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t nreaders = 0;
+    int ret = -1;
+    size_t i;
+
+    if (!(data.xmlopt = virTestGenericDomainXMLConfInit()) ||
+        !(data.doms = virDomainObjListNew()))
+        goto cleanup;
+
+    for (i = 0; i < TEST_STABLE; i++) {
+        g_autofree char *name = g_strdup_printf("stable-%zu", i);
+        virDomainObjPtr obj;
+
+        testMakeUUID(uuid, 's', i);
+        if (!(obj = testAddDomain(&data, name, uuid)))
+            goto cleanup;
+
+        obj->def->id = i + 1;
+        virDomainObjSetState(obj, VIR_DOMAIN_RUNNING,
+                             VIR_DOMAIN_RUNNING_BOOTED);
+        virDomainObjEndAPI(&obj);
+    }
+
+    for (i = 0; i < TEST_RENAME; i++) {
+        g_autofree char *name = g_strdup_printf("rename-a-%zu", i);
+        virDomainObjPtr obj;
+
+        testMakeUUID(uuid, 'r', i);
+        if (!(obj = testAddDomain(&data, name, uuid)))
+            goto cleanup;
+        virDomainObjEndAPI(&obj);
+    }
+
+    for (nreaders = 0; nreaders < TEST_READERS; nreaders++) {
+        readers[nreaders].data = &data;
+        readers[nreaders].id = nreaders * 7;
+        if (virThreadCreate(&readers[nreaders].thread, true,
+                            testReader, &readers[nreaders]) < 0)
+            goto stop;
+    }
+
+    if (virThreadCreate(&churner.thread, true, testChurner, &churner) < 0)
+        goto stop;
+
+    if (virThreadCreate(&renamer.thread, true, testRenamer, &renamer) < 0) {
+        g_atomic_int_set(&data.stop, 1);
+        virThreadJoin(&churner.thread);
+        goto stop;
+    }
+
+    virThreadJoin(&churner.thread);
+    virThreadJoin(&renamer.thread);
+
+    if (!g_atomic_int_get(&data.failed))
+        ret = 0;
+
+ stop:
+    g_atomic_int_set(&data.stop, 1);
+    for (i = 0; i < nreaders; i++)
+        virThreadJoin(&readers[i].thread);
+
+    if (g_atomic_int_get(&data.failed))
+        ret = -1;
+
+ cleanup:
+    virObjectUnref(data.doms);
+    virObjectUnref(data.xmlopt);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("Concurrent lookups", testConcurrentLookups, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -22,6 +22,10 @@
 #include <unistd.h>
 
 #include "internal.h"
+#include "virmock.h"
+#include "virstring.h"
+
+static int (*real_access)(const char *path, int mode);
 
 
 int
@@ -29,3 +33,18 @@ unlink(const char *path G_GNUC_UNUSED)
 {
     return 0;
 }
+
+
+/* Pretend every binary cache file exists but can't be accessed. */
+int
+access(const char *path, int mode)
+{
+    VIR_MOCK_REAL_INIT(access);
+
+    if (virStringHasSuffix(path, ".bin")) {
+        errno = EACCES;
+        return -1;
+    }
+
+    return real_access(path, mode);
+}
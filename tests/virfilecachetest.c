@@ -147,6 +147,37 @@ virFileCacheHandlers testFileCacheHandlers = {
 };
 
 
+static void *
+testFileCacheLoadBinaryFile(const char *filename G_GNUC_UNUSED,
+                            const char *name G_GNUC_UNUSED,
+                            void *priv G_GNUC_UNUSED,
+                            bool *outdated G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   "binary cache must not be loaded");
+    return NULL;
+}
+
+
+static int
+testFileCacheSaveBinaryFile(void *data G_GNUC_UNUSED,
+                            const char *filename G_GNUC_UNUSED,
+                            void *priv G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+virFileCacheHandlers testFileCacheBinaryHandlers = {
+    .isValid = testFileCacheIsValid,
+    .newData = testFileCacheNewData,
+    .loadFile = testFileCacheLoadFile,
+    .saveFile = testFileCacheSaveFile,
+    .loadBinaryFile = testFileCacheLoadBinaryFile,
+    .saveBinaryFile = testFileCacheSaveBinaryFile,
+};
+
+
 struct _testFileCacheData {
     virFileCachePtr cache;
     const char *name;
@@ -196,12 +227,90 @@ testFileCache(const void *opaque)
 }
 
 
+#define TEST_BINARY_FILE abs_builddir "/virfilecachetest.bin"
+
+static int
+testFileCacheBinary(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virFileCacheWriter) writer = virFileCacheWriterNew(3);
+    g_autoptr(virFileCacheReader) reader = NULL;
+    g_autofree char *str1 = NULL;
+    g_autofree char *str2 = NULL;
+    g_autofree char *str3 = NULL;
+    g_autofree char *content = NULL;
+    unsigned long long ull;
+    unsigned int ui;
+    bool b;
+    int len;
+    int ret = -1;
+
+    virFileCacheWriteUInt(writer, 42);
+    virFileCacheWriteULLong(writer, 1ULL << 40);
+    virFileCacheWriteBool(writer, true);
+    virFileCacheWriteString(writer, "foo");
+    virFileCacheWriteString(writer, NULL);
+    virFileCacheWriteString(writer, "");
+
+    if (virFileCacheWriterSave(writer, TEST_BINARY_FILE, 0600) < 0)
+        goto cleanup;
+
+    if (virFileCacheReaderOpen(TEST_BINARY_FILE, 3, &reader) != 1 ||
+        virFileCacheReadUInt(reader, &ui) < 0 ||
+        virFileCacheReadULLong(reader, &ull) < 0 ||
+        virFileCacheReadBool(reader, &b) < 0 ||
+        virFileCacheReadString(reader, &str1) < 0 ||
+        virFileCacheReadString(reader, &str2) < 0 ||
+        virFileCacheReadString(reader, &str3) < 0)
+        goto cleanup;
+
+    if (ui != 42 || ull != 1ULL << 40 || !b ||
+        STRNEQ_NULLABLE(str1, "foo") || str2 ||
+        STRNEQ_NULLABLE(str3, "") ||
+        !virFileCacheReaderAtEnd(reader)) {
+        fprintf(stderr, "Unexpected data read from binary cache\n");
+        goto cleanup;
+    }
+
+    if (virFileCacheReadUInt(reader, &ui) == 0) {
+        fprintf(stderr, "Reading past the end of data succeeded\n");
+        goto cleanup;
+    }
+    virResetLastError();
+    g_clear_pointer(&reader, virFileCacheReaderFree);
+
+    if (virFileCacheReaderOpen(TEST_BINARY_FILE, 4, &reader) != 0) {
+        fprintf(stderr, "Binary cache with wrong version not outdated\n");
+        goto cleanup;
+    }
+
+    /* corrupt the last byte of payload */
+    if ((len = virFileReadAll(TEST_BINARY_FILE, 1024, &content)) < 0)
+        goto cleanup;
+    content[len - 1] ^= 0xff;
+    if (!g_file_set_contents(TEST_BINARY_FILE, content, len, NULL))
+        goto cleanup;
+
+    if (virFileCacheReaderOpen(TEST_BINARY_FILE, 3, &reader) >= 0) {
+        fprintf(stderr, "Corrupted binary cache was accepted\n");
+        goto cleanup;
+    }
+    virResetLastError();
+
+    ret = 0;
+
+ cleanup:
+    remove(TEST_BINARY_FILE);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
     int ret = 0;
     testFileCachePriv testPriv = {0};
     virFileCachePtr cache = NULL;
+    virFileCachePtr binCache = NULL;
 
     if (!(cache = virFileCacheNew(abs_srcdir "/virfilecachedata",
                                   "cache", &testFileCacheHandlers)))
@@ -209,22 +318,46 @@ mymain(void)
 
     virFileCacheSetPriv(cache, &testPriv);
 
-#define TEST_RUN(name, newData, expectData, expectSave) \
+    /* The mock makes every binary cache file inaccessible, which must
+     * be handled as a miss falling back to the regular cache file. */
+    if (!(binCache = virFileCacheNew(abs_srcdir "/virfilecachedata",
+                                     "cache", &testFileCacheBinaryHandlers))) {
+        virObjectUnref(cache);
+        return EXIT_FAILURE;
+    }
+
+    virFileCacheSetPriv(binCache, &testPriv);
+
+#define TEST_RUN_FULL(testCache, testName, name, newData, expectData, \
+                      expectSave) \
     do { \
         testFileCacheData data = { \
-            cache, name, newData, expectData, expectSave \
+            testCache, name, newData, expectData, expectSave \
         }; \
-        if (virTestRun(name, testFileCache, &data) < 0) \
+        if (virTestRun(testName, testFileCache, &data) < 0) \
             ret = -1; \
     } while (0)
 
+#define TEST_RUN(name, newData, expectData, expectSave) \
+    TEST_RUN_FULL(cache, name, name, newData, expectData, expectSave)
+
+#define TEST_RUN_BINARY(name, newData, expectData, expectSave) \
+    TEST_RUN_FULL(binCache, name "Binary", name, newData, expectData, \
+                  expectSave)
+
     /* The cache file name is created using:
      * '$ echo -n $TEST_NAME | sha256sum' */
     TEST_RUN("cacheValid", NULL, "aaa\n", false);
     TEST_RUN("cacheInvalid", "bbb\n", "bbb\n", true);
     TEST_RUN("cacheMissing", "ccc\n", "ccc\n", true);
+    TEST_RUN_BINARY("cacheValid", NULL, "aaa\n", false);
+    TEST_RUN_BINARY("cacheMissing", "ccc\n", "ccc\n", true);
+
+    if (virTestRun("binaryFormat", testFileCacheBinary, NULL) < 0)
+        ret = -1;
 
     virObjectUnref(cache);
+    virObjectUnref(binCache);
 
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -24,6 +24,7 @@
 #include "testutils.h"
 #include "virfile.h"
 #include "virstring.h"
+#include "virutil.h"
 
 #ifdef __linux__
 # include <linux/falloc.h>
@@ -309,6 +310,101 @@ testFileInData(const void *opaque)
 }
 
 
+/* Keep splicing from @fdin to @fdout until EOF or @len bytes moved */
+static ssize_t
+testFileSpliceAll(int fdin, int fdout, size_t len)
+{
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t got = virFileSplice(fdin, fdout, len - total);
+
+        if (got < 0)
+            return -1;
+        if (got == 0)
+            break;
+
+        total += got;
+    }
+
+    return total;
+}
+
+
+static int
+testFileSplice(const void *opaque G_GNUC_UNUSED)
+{
+    char srcPath[] = abs_builddir "/fileSplice.XXXXXX";
+    char dstPath[] = abs_builddir "/fileSplice.XXXXXX";
+    char buf[16 * 1024];
+    char out[sizeof(buf)];
+    int pipefd[2] = { -1, -1 };
+    int srcfd = -1;
+    int dstfd = -1;
+    int ret = -1;
+    size_t i;
+
+    for (i = 0; i < sizeof(buf); i++)
+        buf[i] = 'a' + i % 26;
+
+    if ((srcfd = g_mkstemp_full(srcPath, O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR)) < 0 ||
+        unlink(srcPath) < 0 ||
+        (dstfd = g_mkstemp_full(dstPath, O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR)) < 0 ||
+        unlink(dstPath) < 0 ||
+        safewrite(srcfd, buf, sizeof(buf)) < 0 ||
+        lseek(srcfd, 0, SEEK_SET) < 0 ||
+        virPipe(pipefd) < 0)
+        goto cleanup;
+
+    /* file -> pipe -> file, the data fits into the pipe buffer */
+    if (testFileSpliceAll(srcfd, pipefd[1], sizeof(buf)) != (ssize_t) sizeof(buf)) {
+        if (errno == ENOSYS)
+            ret = EXIT_AM_SKIP;
+        goto cleanup;
+    }
+
+    VIR_FORCE_CLOSE(pipefd[1]);
+
+    if (testFileSpliceAll(pipefd[0], dstfd, sizeof(buf) + 1) != (ssize_t) sizeof(buf))
+        goto cleanup;
+
+    if (lseek(dstfd, 0, SEEK_SET) < 0 ||
+        saferead(dstfd, out, sizeof(out)) != (ssize_t) sizeof(out) ||
+        memcmp(buf, out, sizeof(buf)) != 0) {
+        fprintf(stderr, "Data spliced through a pipe doesn't match\n");
+        goto cleanup;
+    }
+
+    /* file -> file */
+    if (lseek(srcfd, 0, SEEK_SET) < 0 ||
+        ftruncate(dstfd, 0) < 0 ||
+        lseek(dstfd, 0, SEEK_SET) < 0)
+        goto cleanup;
+
+    if (testFileSpliceAll(srcfd, dstfd, sizeof(buf) + 1) != (ssize_t) sizeof(buf)) {
+        if (errno == ENOSYS)
+            ret = EXIT_AM_SKIP;
+        goto cleanup;
+    }
+
+    if (lseek(dstfd, 0, SEEK_SET) < 0 ||
+        saferead(dstfd, out, sizeof(out)) != (ssize_t) sizeof(out) ||
+        memcmp(buf, out, sizeof(buf)) != 0) {
+        fprintf(stderr, "Data copied between files doesn't match\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(pipefd[0]);
+    VIR_FORCE_CLOSE(pipefd[1]);
+    VIR_FORCE_CLOSE(srcfd);
+    VIR_FORCE_CLOSE(dstfd);
+    return ret;
+}
+
+
 struct testFileIsSharedFSType {
     const char *mtabFile;
     const char *filename;
@@ -438,6 +534,9 @@ mymain(void)
         DO_TEST_IN_DATA(false, 8, 16, 32, 64, 128, 256, 512);
     }
 
+    if (virTestRun("virFileSplice", testFileSplice, NULL) < 0)
+        ret = -1;
+
 #define DO_TEST_FILE_IS_SHARED_FS_TYPE(mtab, file, exp) \
     do { \
         struct testFileIsSharedFSType data = { \
@@ -1040,6 +1040,322 @@ testFirewallQuery(const void *opaque G_GNUC_UNUSED)
     return ret;
 }
 
+static void
+testFirewallRestoreHook(const char *const*args,
+                        const char *const*env,
+                        const char *input,
+                        char **output,
+                        char **error,
+                        int *status,
+                        void *opaque)
+{
+    virBufferPtr inbuf = opaque;
+
+    if (!input) {
+        testFirewallRollbackHook(args, env, input, output, error, status, NULL);
+        return;
+    }
+
+    virBufferAdd(inbuf, input, -1);
+
+    /* Fake rejection of the whole table */
+    if (strstr(input, "192.168.122.255"))
+        *status = 1;
+}
+
+static int
+testFirewallRestore(const void *opaque)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) inbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew();
+    int ret = -1;
+    const char *actual = NULL;
+    const char *expected =
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        EBTABLES_RESTORE_PATH " --noflush\n"
+        IPTABLES_PATH " -X LIBVIRT_OLD\n";
+    const char *expectedInput =
+        "*filter\n"
+        "-N LIBVIRT_TEST\n"
+        "-A LIBVIRT_TEST --source-host 192.168.122.1 --jump ACCEPT\n"
+        "-A LIBVIRT_TEST -m comment --comment \"from the test\" --jump DROP\n"
+        "COMMIT\n"
+        "*nat\n"
+        "-A POSTROUTING --jump MASQUERADE\n"
+        "-A POSTROUTING --source-host 10.0.0.1 --jump RETURN\n"
+        "COMMIT\n"
+        "*nat\n"
+        "-N libvirt-I-vnet0\n"
+        "-A libvirt-I-vnet0 -j ACCEPT\n"
+        "COMMIT\n";
+    const struct testFirewallData *data = opaque;
+
+    fwDisabled = data->fwDisabled;
+    if (virFirewallSetBackend(data->tryBackend) < 0)
+        goto cleanup;
+
+    virFirewallSetRestoreOverride(true);
+    virCommandSetDryRun(&cmdbuf, testFirewallRestoreHook, &inbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-N", "LIBVIRT_TEST", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "LIBVIRT_TEST",
+                       "--source-host", "192.168.122.1",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "LIBVIRT_TEST",
+                       "-m", "comment", "--comment", "from the test",
+                       "--jump", "DROP", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "nat",
+                       "-A", "POSTROUTING",
+                       "--jump", "MASQUERADE", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-t", "nat",
+                       "-A", "POSTROUTING",
+                       "--source-host", "10.0.0.1",
+                       "--jump", "RETURN", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_ETHERNET,
+                       "-t", "nat",
+                       "-N", "libvirt-I-vnet0", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_ETHERNET,
+                       "-t", "nat",
+                       "-A", "libvirt-I-vnet0",
+                       "-j", "ACCEPT", NULL);
+
+    virFirewallAddRuleFull(fw, VIR_FIREWALL_LAYER_IPV4,
+                           true, NULL, NULL,
+                           "-X", "LIBVIRT_OLD", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        goto cleanup;
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (STRNEQ_NULLABLE(expected, actual)) {
+        fprintf(stderr, "Unexpected command execution\n");
+        virTestDifference(stderr, expected, actual);
+        goto cleanup;
+    }
+
+    actual = virBufferCurrentContent(&inbuf);
+
+    if (STRNEQ_NULLABLE(expectedInput, actual)) {
+        fprintf(stderr, "Unexpected restore input\n");
+        virTestDifference(stderr, expectedInput, actual);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virFirewallSetRestoreOverride(false);
+    virCommandSetDryRun(NULL, NULL, NULL);
+    return ret;
+}
+
+static int
+testFirewallRestoreTables(const void *opaque)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) inbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew();
+    int ret = -1;
+    const char *actual = NULL;
+    const char *expected =
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        IP6TABLES_PATH " --table filter --insert LIBVIRT_FWO --in-interface virbr0 --jump ACCEPT\n"
+        IPTABLES_PATH " --table filter --delete LIBVIRT_FWI --out-interface virbr0 --jump REJECT\n"
+        IPTABLES_RESTORE_PATH " --noflush\n";
+    const char *expectedInput =
+        "*filter\n"
+        "--insert LIBVIRT_FWO --in-interface virbr0 --jump ACCEPT\n"
+        "--insert LIBVIRT_FWI --out-interface virbr0 --jump ACCEPT\n"
+        "COMMIT\n"
+        "*nat\n"
+        "--insert LIBVIRT_PRT --source 192.168.122.0/24 --jump MASQUERADE\n"
+        "--insert LIBVIRT_PRT --source 192.168.122.0/24 --destination 255.255.255.255/32 --jump RETURN\n"
+        "COMMIT\n"
+        "*filter\n"
+        "--insert LIBVIRT_INP --in-interface virbr0 --jump ACCEPT\n"
+        "--insert LIBVIRT_OUT --out-interface virbr0 --jump ACCEPT\n"
+        "COMMIT\n";
+    const struct testFirewallData *data = opaque;
+
+    fwDisabled = data->fwDisabled;
+    if (virFirewallSetBackend(data->tryBackend) < 0)
+        goto cleanup;
+
+    virFirewallSetRestoreOverride(true);
+    virCommandSetDryRun(&cmdbuf, testFirewallRestoreHook, &inbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "filter",
+                       "--insert", "LIBVIRT_FWO",
+                       "--in-interface", "virbr0",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "nat",
+                       "--insert", "LIBVIRT_PRT",
+                       "--source", "192.168.122.0/24",
+                       "--jump", "MASQUERADE", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "filter",
+                       "--insert", "LIBVIRT_FWI",
+                       "--out-interface", "virbr0",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "nat",
+                       "--insert", "LIBVIRT_PRT",
+                       "--source", "192.168.122.0/24",
+                       "--destination", "255.255.255.255/32",
+                       "--jump", "RETURN", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV6,
+                       "--table", "filter",
+                       "--insert", "LIBVIRT_FWO",
+                       "--in-interface", "virbr0",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRuleFull(fw, VIR_FIREWALL_LAYER_IPV4,
+                           true, NULL, NULL,
+                           "--table", "filter",
+                           "--delete", "LIBVIRT_FWI",
+                           "--out-interface", "virbr0",
+                           "--jump", "REJECT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "filter",
+                       "--insert", "LIBVIRT_INP",
+                       "--in-interface", "virbr0",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "--table", "filter",
+                       "--insert", "LIBVIRT_OUT",
+                       "--out-interface", "virbr0",
+                       "--jump", "ACCEPT", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        goto cleanup;
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (STRNEQ_NULLABLE(expected, actual)) {
+        fprintf(stderr, "Unexpected command execution\n");
+        virTestDifference(stderr, expected, actual);
+        goto cleanup;
+    }
+
+    actual = virBufferCurrentContent(&inbuf);
+
+    if (STRNEQ_NULLABLE(expectedInput, actual)) {
+        fprintf(stderr, "Unexpected restore input\n");
+        virTestDifference(stderr, expectedInput, actual);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virFirewallSetRestoreOverride(false);
+    virCommandSetDryRun(NULL, NULL, NULL);
+    return ret;
+}
+
+static int
+testFirewallRestoreRollback(const void *opaque)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) inbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew();
+    int ret = -1;
+    const char *actual = NULL;
+    const char *expected =
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        IPTABLES_PATH " -A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        IPTABLES_PATH " -A INPUT --source-host 192.168.122.255 --jump REJECT\n"
+        IPTABLES_PATH " -D INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        IPTABLES_PATH " -D INPUT --source-host 192.168.122.255 --jump REJECT\n"
+        IPTABLES_PATH " -D INPUT --source-host '!192.168.122.1' --jump REJECT\n";
+    const struct testFirewallData *data = opaque;
+
+    fwDisabled = data->fwDisabled;
+    if (virFirewallSetBackend(data->tryBackend) < 0)
+        goto cleanup;
+
+    virFirewallSetRestoreOverride(true);
+    virCommandSetDryRun(&cmdbuf, testFirewallRestoreHook, &inbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_ATOMIC);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "192.168.122.1",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "192.168.122.255",
+                       "--jump", "REJECT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "!192.168.122.1",
+                       "--jump", "REJECT", NULL);
+
+    virFirewallStartRollback(fw, 0);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-D", "INPUT",
+                       "--source-host", "192.168.122.1",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-D", "INPUT",
+                       "--source-host", "192.168.122.255",
+                       "--jump", "REJECT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-D", "INPUT",
+                       "--source-host", "!192.168.122.1",
+                       "--jump", "REJECT", NULL);
+
+    if (virFirewallApply(fw) == 0) {
+        fprintf(stderr, "Firewall apply unexpectedly worked\n");
+        goto cleanup;
+    }
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (STRNEQ_NULLABLE(expected, actual)) {
+        fprintf(stderr, "Unexpected command execution\n");
+        virTestDifference(stderr, expected, actual);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virFirewallSetRestoreOverride(false);
+    virCommandSetDryRun(NULL, NULL, NULL);
+    return ret;
+}
+
 static bool
 hasNetfilterTools(void)
 {
@@ -1109,6 +1425,9 @@ mymain(void)
     RUN_TEST("many rollback", testFirewallManyRollback);
     RUN_TEST("chained rollback", testFirewallChainedRollback);
     RUN_TEST("query transaction", testFirewallQuery);
+    RUN_TEST_DIRECT("restore", testFirewallRestore);
+    RUN_TEST_DIRECT("restore rollback", testFirewallRestoreRollback);
+    RUN_TEST_DIRECT("restore tables", testFirewallRestoreTables);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
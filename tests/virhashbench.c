@@ -0,0 +1,172 @@
+/*
+ * virhashbench.c: measure hash table operations at various table sizes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "internal.h"
+#include "virhash.h"
+#include "virstring.h"
+#include "viruuid.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static const size_t benchSizes[] = { 10000, 100000, 1000000 };
+
+
+static int
+benchCountIter(void *payload G_GNUC_UNUSED,
+               const void *name G_GNUC_UNUSED,
+               void *data)
+{
+    size_t *count = data;
+
+    (*count)++;
+    return 0;
+}
+
+
+static void
+benchPrint(const char *keys,
+           size_t nkeys,
+           const char *op,
+           gint64 start,
+           size_t nops)
+{
+    gint64 elapsed = g_get_monotonic_time() - start;
+
+    printf("%-6s %8zu keys  %-8s %8.1f ns/op\n", keys, nkeys, op,
+           elapsed * 1000.0 / nops);
+}
+
+
+/*
+ * Short keys such as domain names or device aliases are kept inline in
+ * the table, UUID strings are too long for that and are allocated.
+ */
+static int
+benchRun(const char *keys,
+         char **names,
+         char **missing,
+         size_t nkeys,
+         unsigned int rounds)
+{
+    g_autoptr(virHashTable) hash = virHashNew(NULL);
+    size_t count = 0;
+    gint64 start;
+    size_t i;
+    unsigned int r;
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < nkeys; i++) {
+        if (virHashAddEntry(hash, names[i], names[i]) < 0)
+            return -1;
+    }
+    benchPrint(keys, nkeys, "add", start, nkeys);
+
+    start = g_get_monotonic_time();
+    for (r = 0; r < rounds; r++) {
+        /* visit the keys in a different order than they were added */
+        for (i = 0; i < nkeys; i++) {
+            size_t idx = (i * 7919) % nkeys;
+
+            if (virHashLookup(hash, names[idx]) != names[idx])
+                return -1;
+        }
+    }
+    benchPrint(keys, nkeys, "lookup", start, nkeys * rounds);
+
+    start = g_get_monotonic_time();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < nkeys; i++) {
+            if (virHashLookup(hash, missing[i]))
+                return -1;
+        }
+    }
+    benchPrint(keys, nkeys, "miss", start, nkeys * rounds);
+
+    start = g_get_monotonic_time();
+    for (r = 0; r < rounds; r++) {
+        if (virHashForEach(hash, benchCountIter, &count) < 0)
+            return -1;
+    }
+    benchPrint(keys, nkeys, "foreach", start, nkeys * rounds);
+
+    if (count != nkeys * rounds)
+        return -1;
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < nkeys; i++) {
+        if (virHashRemoveEntry(hash, names[i]) < 0)
+            return -1;
+    }
+    benchPrint(keys, nkeys, "remove", start, nkeys);
+
+    return 0;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    unsigned int rounds = 5;
+    size_t maxkeys = benchSizes[G_N_ELEMENTS(benchSizes) - 1];
+    char **names = NULL;
+    char **uuids = NULL;
+    char **missing = NULL;
+    int ret = EXIT_FAILURE;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &rounds) < 0 ||
+                       rounds == 0))) {
+        fprintf(stderr, "%s [ROUNDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    names = g_new0(char *, maxkeys + 1);
+    uuids = g_new0(char *, maxkeys + 1);
+    missing = g_new0(char *, maxkeys + 1);
+
+    for (i = 0; i < maxkeys; i++) {
+        unsigned char uuid[VIR_UUID_BUFLEN];
+
+        names[i] = g_strdup_printf("vm-%zu", i);
+        missing[i] = g_strdup_printf("missing-%zu", i);
+
+        if (virUUIDGenerate(uuid) < 0)
+            goto cleanup;
+        uuids[i] = g_new0(char, VIR_UUID_STRING_BUFLEN);
+        virUUIDFormat(uuid, uuids[i]);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(benchSizes); i++) {
+        if (benchRun("short", names, missing, benchSizes[i], rounds) < 0 ||
+            benchRun("uuid", uuids, missing, benchSizes[i], rounds) < 0) {
+            fprintf(stderr, "Hash table operation failed\n");
+            goto cleanup;
+        }
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    g_strfreev(names);
+    g_strfreev(uuids);
+    g_strfreev(missing);
+    return ret;
+}
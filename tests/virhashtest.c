@@ -443,6 +443,45 @@ testHashGetItems(const void *data G_GNUC_UNUSED)
     return ret;
 }
 
+static int
+testHashGetItemsStable(const void *data G_GNUC_UNUSED)
+{
+    g_autoptr(virHashTable) hash = virHashNew(virHashValueFree);
+    g_autofree virHashKeyValuePairPtr array = NULL;
+    size_t i;
+
+    /* Take the items while the table is still small, so that the
+     * additions below are sure to rehash it */
+    for (i = 0; i < 10; i++) {
+        g_autofree char *key = g_strdup_printf("k%zu", i);
+
+        if (virHashAddEntry(hash, key, g_strdup(key)) < 0)
+            return -1;
+    }
+
+    if (!(array = virHashGetItems(hash, NULL)))
+        return -1;
+
+    /* Keys returned before the table was rehashed must stay usable */
+    for (i = 0; i < 1000; i++) {
+        g_autofree char *key = g_strdup_printf("grow-%zu", i);
+
+        if (virHashAddEntry(hash, key, g_strdup(key)) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < 10; i++) {
+        if (!array[i].key ||
+            STRNEQ(array[i].key, array[i].value) ||
+            virHashLookup(hash, array[i].key) != array[i].value) {
+            VIR_TEST_VERBOSE("\nkey %zu changed after rehash", i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int
 testHashEqualCompValue(const void *value1, const void *value2)
 {
@@ -567,6 +606,7 @@ mymain(void)
     DO_TEST("RemoveSet", RemoveSet);
     DO_TEST("Search", Search);
     DO_TEST("GetItems", GetItems);
+    DO_TEST("GetItems stable keys", GetItemsStable);
     DO_TEST("Equal", Equal);
     DO_TEST("Duplicate entry", Duplicate);
 
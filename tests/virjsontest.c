@@ -102,6 +102,63 @@ testJSONFromString(const void *data)
 }
 
 
+static int
+testJSONStream(const void *data)
+{
+    const struct testInfo *info = data;
+    g_autoptr(virJSONStreamParser) stream = NULL;
+    g_autoptr(virJSONValue) json = NULL;
+    const char *expectstr = info->expect ? info->expect : info->doc;
+    g_autofree char *formatted = NULL;
+    size_t len = strlen(info->doc);
+    size_t i;
+    int rc = 0;
+
+    if (!(stream = virJSONStreamParserNew(0)))
+        return -1;
+
+    /* feed the document one byte at a time to make sure that
+     * tokens split across reads are handled */
+    for (i = 0; i < len && rc == 0; i++)
+        rc = virJSONStreamParserFeed(stream, info->doc + i, 1);
+
+    if (virJSONStreamParserFinish(stream, &json) < 0 || rc < 0 || !json) {
+        if (info->pass) {
+            VIR_TEST_VERBOSE("Failed to parse %s", info->doc);
+            return -1;
+        } else {
+            VIR_TEST_DEBUG("As expected, failed to parse %s", info->doc);
+            return 0;
+        }
+    } else {
+        if (!info->pass) {
+            VIR_TEST_VERBOSE("Unexpected success while parsing %s", info->doc);
+            return -1;
+        }
+    }
+
+    if (!(formatted = virJSONValueToString(json, false))) {
+        VIR_TEST_VERBOSE("Failed to format json data");
+        return -1;
+    }
+
+    if (STRNEQ(expectstr, formatted)) {
+        virTestDifference(stderr, expectstr, formatted);
+        return -1;
+    }
+
+    /* the parser must be ready to take the next document */
+    virJSONValueFree(g_steal_pointer(&json));
+    if (virJSONStreamParserFeed(stream, "{}", 2) < 0 ||
+        virJSONStreamParserFinish(stream, &json) < 0 || !json) {
+        VIR_TEST_VERBOSE("Failed to parse a document after %s", info->doc);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 testJSONAddRemove(const void *data)
 {
@@ -500,6 +557,12 @@ mymain(void)
 #define DO_TEST_PARSE_FILE(name) \
     DO_TEST_FULL(name, FromFile, NULL, NULL, true)
 
+#define DO_TEST_STREAM(name, doc, expect) \
+    DO_TEST_FULL(name, Stream, doc, expect, true)
+
+#define DO_TEST_STREAM_FAIL(name, doc) \
+    DO_TEST_FULL(name, Stream, doc, NULL, false)
+
 
     DO_TEST_PARSE_FILE("Simple");
     DO_TEST_PARSE_FILE("NotSoSimple");
@@ -577,6 +640,17 @@ mymain(void)
     DO_TEST_PARSE_FAIL("object with unterminated key", "{ \"key:7 }");
     DO_TEST_PARSE_FAIL("duplicate key", "{ \"a\": 1, \"a\": 1 }");
 
+    DO_TEST_STREAM("stream object",
+                   "{\"return\": {\"id\": 1, \"name\": \"disk0\"}}\r\n",
+                   "{\"return\":{\"id\":1,\"name\":\"disk0\"}}");
+    DO_TEST_STREAM("stream escaping symbols", "[\"\\\"\\t\\n\\\\\"]", NULL);
+    DO_TEST_STREAM("stream big number", "[ 18446744073709551615 ]",
+                   "[18446744073709551615]");
+    DO_TEST_STREAM_FAIL("stream whitespace only", " \r\n");
+    DO_TEST_STREAM_FAIL("stream unterminated object", "{ \"1\":1, \"2\":1");
+    DO_TEST_STREAM_FAIL("stream trailing garbage", "{} {}");
+    DO_TEST_STREAM_FAIL("stream garbage", "\xff{}");
+
     DO_TEST_FULL("lookup on array", Lookup,
                  "[ 1 ]", NULL, false);
     DO_TEST_FULL("lookup on string", Lookup,
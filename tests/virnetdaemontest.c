@@ -97,7 +97,7 @@ testCreateServer(const char *server_name, const char *host, int family)
     }
 
     if (!(srv = virNetServerNew(server_name, 1,
-                                10, 50, 5, 100, 10,
+                                10, 50, 5, 0, 100, 10,
                                 120, 5,
                                 testClientNew,
                                 testClientPreExec,
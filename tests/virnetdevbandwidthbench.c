@@ -0,0 +1,151 @@
+/*
+ * virnetdevbandwidthbench.c: compare programming QoS with tc and rtnetlink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "internal.h"
+#include "virfile.h"
+#include "virnetdevbandwidth.h"
+#include "virnetlink.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define BENCH_IFNAME "vbwbench%zu"
+
+
+/* Number of processes forked system wide since boot */
+static long long
+benchGetForks(void)
+{
+    g_autofree char *buf = NULL;
+    const char *line;
+    long long forks;
+
+    if (virFileReadAll("/proc/stat", 1024 * 1024, &buf) < 0 ||
+        !(line = strstr(buf, "\nprocesses ")) ||
+        virStrToLong_ll(line + strlen("\nprocesses "), NULL, 10, &forks) < 0)
+        return -1;
+
+    return forks;
+}
+
+
+/*
+ * Set up QoS like a guest NIC with inbound and outbound limits on each of
+ * the @nnics interfaces with @backend and tear it down again. Returns the
+ * time it took in microseconds.
+ */
+static long long
+benchSetClear(virNetDevBandwidthBackend backend,
+              size_t nnics,
+              long long *forks)
+{
+    virNetDevBandwidthRate in = { .average = 1000, .peak = 2000, .burst = 256 };
+    virNetDevBandwidthRate out = { .average = 500 };
+    virNetDevBandwidth bandwidth = { .in = &in, .out = &out };
+    long long startForks;
+    gint64 start;
+    size_t i;
+
+    if (virNetDevBandwidthSetBackend(backend) < 0)
+        return -1;
+
+    if ((startForks = benchGetForks()) < 0)
+        return -1;
+    start = g_get_monotonic_time();
+
+    for (i = 0; i < nnics; i++) {
+        g_autofree char *ifname = g_strdup_printf(BENCH_IFNAME, i);
+
+        if (virNetDevBandwidthSet(ifname, &bandwidth, false, true) < 0 ||
+            virNetDevBandwidthClear(ifname) < 0)
+            return -1;
+    }
+
+    *forks = benchGetForks() - startForks;
+    return g_get_monotonic_time() - start;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    unsigned int nnics = 64;
+    size_t ncreated = 0;
+    long long tcTime;
+    long long tcForks;
+    long long nlTime;
+    long long nlForks;
+    int ret = EXIT_FAILURE;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &nnics) < 0 ||
+                       nnics == 0))) {
+        fprintf(stderr, "%s [NICS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (geteuid() != 0) {
+        fprintf(stderr, "%s must be run as root\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0 ||
+        virNetlinkStartup() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    for (ncreated = 0; ncreated < nnics; ncreated++) {
+        g_autofree char *ifname = g_strdup_printf(BENCH_IFNAME, ncreated);
+        int error = 0;
+
+        if (virNetlinkNewLink(ifname, "dummy", NULL, &error) < 0)
+            goto cleanup;
+    }
+
+    if ((tcTime = benchSetClear(VIR_NETDEV_BANDWIDTH_BACKEND_TC,
+                                nnics, &tcForks)) < 0 ||
+        (nlTime = benchSetClear(VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK,
+                                nnics, &nlForks)) < 0)
+        goto cleanup;
+
+    printf("%u NICs: tc %8.2f ms/NIC %6.1f forks/NIC  "
+           "netlink %8.2f ms/NIC %6.1f forks/NIC  (%.1fx)\n",
+           nnics,
+           tcTime / 1000.0 / nnics, (double) tcForks / nnics,
+           nlTime / 1000.0 / nnics, (double) nlForks / nnics,
+           nlTime ? (double) tcTime / nlTime : 0);
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "%s\n", virGetLastErrorMessage());
+    for (i = 0; i < ncreated; i++) {
+        g_autofree char *ifname = g_strdup_printf(BENCH_IFNAME, i);
+
+        virNetlinkDelLink(ifname, NULL);
+    }
+    virNetlinkShutdown();
+    return ret;
+}
@@ -22,8 +22,16 @@
 #define LIBVIRT_VIRCOMMANDPRIV_H_ALLOW
 #include "vircommandpriv.h"
 #include "virnetdevbandwidth.h"
+#include "virnetlink.h"
 #include "netdev_bandwidth_conf.c"
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+# include <net/if.h>
+# include <linux/pkt_cls.h>
+# include <linux/pkt_sched.h>
+# include <linux/rtnetlink.h>
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_NONE
 
 struct testMinimalStruct {
@@ -37,6 +45,7 @@ struct testSetStruct {
     const char *exp_cmd;
     const char *iface;
     const bool hierarchical_class;
+    virNetDevBandwidthBackend backend;
 };
 
 #define PARSE(xml, var) \
@@ -63,6 +72,178 @@ struct testSetStruct {
             goto cleanup; \
     } while (0)
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+/* Requests sent by virNetDevBandwidth, formatted a bit like tc would */
+static virBuffer netlinkBuf = VIR_BUFFER_INITIALIZER;
+
+
+unsigned int
+if_nametoindex(const char *ifname G_GNUC_UNUSED)
+{
+    return 7;
+}
+
+
+static void
+testFormatHandle(virBufferPtr buf,
+                 const char *name,
+                 uint32_t handle)
+{
+    virBufferAsprintf(buf, " %s %x:%x", name,
+                      TC_H_MAJ(handle) >> 16, TC_H_MIN(handle));
+}
+
+
+static struct rtattr *
+testFindAttr(struct rtattr *rta,
+             int len,
+             unsigned short type)
+{
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if ((rta->rta_type & NLA_TYPE_MASK) == type)
+            return rta;
+    }
+
+    return NULL;
+}
+
+
+static void
+testFormatRequest(virBufferPtr buf,
+                  struct nlmsghdr *nlh)
+{
+    struct tcmsg *tcm = NLMSG_DATA(nlh);
+    struct rtattr *rta = (struct rtattr *) ((char *) tcm + NLMSG_ALIGN(sizeof(*tcm)));
+    int len = nlh->nlmsg_len - NLMSG_SPACE(sizeof(*tcm));
+    struct rtattr *kind = testFindAttr(rta, len, TCA_KIND);
+    struct rtattr *opts = testFindAttr(rta, len, TCA_OPTIONS);
+    const char *kindstr = kind ? RTA_DATA(kind) : NULL;
+    bool create = nlh->nlmsg_flags & NLM_F_CREATE;
+
+    switch (nlh->nlmsg_type) {
+    case RTM_NEWQDISC:
+    case RTM_DELQDISC:
+        virBufferAsprintf(buf, "qdisc %s",
+                          nlh->nlmsg_type == RTM_NEWQDISC ? "add" : "del");
+        break;
+    case RTM_NEWTCLASS:
+    case RTM_DELTCLASS:
+        virBufferAsprintf(buf, "class %s",
+                          nlh->nlmsg_type == RTM_DELTCLASS ? "del" :
+                          create ? "add" : "change");
+        break;
+    case RTM_NEWTFILTER:
+    case RTM_DELTFILTER:
+        virBufferAsprintf(buf, "filter %s",
+                          nlh->nlmsg_type == RTM_NEWTFILTER ? "add" : "del");
+        break;
+    default:
+        virBufferAsprintf(buf, "unexpected %u\n", nlh->nlmsg_type);
+        return;
+    }
+
+    virBufferAsprintf(buf, " dev %d", tcm->tcm_ifindex);
+    testFormatHandle(buf, "parent", tcm->tcm_parent);
+    testFormatHandle(buf, "handle", tcm->tcm_handle);
+
+    if (nlh->nlmsg_type == RTM_NEWTFILTER || nlh->nlmsg_type == RTM_DELTFILTER)
+        virBufferAsprintf(buf, " prio %u protocol 0x%x",
+                          TC_H_MAJ(tcm->tcm_info) >> 16,
+                          ntohs(TC_H_MIN(tcm->tcm_info)));
+
+    if (kindstr)
+        virBufferAsprintf(buf, " %s", kindstr);
+
+    if (opts && kindstr && STREQ(kindstr, "htb") &&
+        nlh->nlmsg_type == RTM_NEWTCLASS) {
+        struct rtattr *parms = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                            TCA_HTB_PARMS);
+        struct rtattr *rate64 = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                             TCA_HTB_RATE64);
+        struct rtattr *ceil64 = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                             TCA_HTB_CEIL64);
+        struct tc_htb_opt *opt = RTA_DATA(parms);
+        unsigned long long rate = opt->rate.rate;
+        unsigned long long ceil = opt->ceil.rate;
+
+        if (rate64)
+            rate = *(uint64_t *) RTA_DATA(rate64);
+        if (ceil64)
+            ceil = *(uint64_t *) RTA_DATA(ceil64);
+
+        virBufferAsprintf(buf, " rate %llu ceil %llu quantum %u",
+                          rate, ceil, opt->quantum);
+    } else if (opts && kindstr && STREQ(kindstr, "htb")) {
+        struct rtattr *init = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                           TCA_HTB_INIT);
+        struct tc_htb_glob *glob = RTA_DATA(init);
+
+        virBufferAsprintf(buf, " default %x", glob->defcls);
+    } else if (opts && kindstr && STREQ(kindstr, "fw")) {
+        struct rtattr *classid = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                              TCA_FW_CLASSID);
+
+        testFormatHandle(buf, "flowid", *(uint32_t *) RTA_DATA(classid));
+    } else if (opts && kindstr && STREQ(kindstr, "u32")) {
+        struct rtattr *classid = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                              TCA_U32_CLASSID);
+        struct rtattr *sel = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                          TCA_U32_SEL);
+        struct rtattr *police = testFindAttr(RTA_DATA(opts), RTA_PAYLOAD(opts),
+                                             TCA_U32_POLICE);
+        struct tc_u32_sel *u32sel = RTA_DATA(sel);
+        size_t i;
+
+        for (i = 0; i < u32sel->nkeys; i++)
+            virBufferAsprintf(buf, " match %08x/%08x at %d",
+                              ntohl(u32sel->keys[i].val),
+                              ntohl(u32sel->keys[i].mask),
+                              u32sel->keys[i].off);
+
+        if (police) {
+            struct rtattr *tbf = testFindAttr(RTA_DATA(police),
+                                              RTA_PAYLOAD(police),
+                                              TCA_POLICE_TBF);
+            struct tc_police *p = RTA_DATA(tbf);
+
+            virBufferAsprintf(buf, " police rate %u mtu %u drop",
+                              p->rate.rate, p->mtu);
+        }
+
+        testFormatHandle(buf, "flowid", *(uint32_t *) RTA_DATA(classid));
+    }
+
+    virBufferAddLit(buf, "\n");
+}
+
+
+int
+virNetlinkCommand(struct nl_msg *nl_msg,
+                  struct nlmsghdr **resp,
+                  unsigned int *respbuflen,
+                  uint32_t src_pid G_GNUC_UNUSED,
+                  uint32_t dst_pid G_GNUC_UNUSED,
+                  unsigned int protocol G_GNUC_UNUSED,
+                  unsigned int groups G_GNUC_UNUSED)
+{
+    struct nlmsghdr *ack;
+    struct nlmsgerr *err;
+
+    testFormatRequest(&netlinkBuf, nlmsg_hdr(nl_msg));
+
+    *respbuflen = NLMSG_SPACE(sizeof(*err));
+    ack = g_malloc0(*respbuflen);
+    ack->nlmsg_type = NLMSG_ERROR;
+    ack->nlmsg_len = *respbuflen;
+    err = NLMSG_DATA(ack);
+    err->error = 0;
+
+    *resp = ack;
+    return 0;
+}
+#endif /* defined(__linux__) && defined(HAVE_LIBNL) */
+
+
 static int
 testVirNetDevBandwidthSet(const void *data)
 {
@@ -79,6 +260,8 @@ testVirNetDevBandwidthSet(const void *data)
         iface = "eth0";
 
     virCommandSetDryRun(&buf, NULL, NULL);
+    if (virNetDevBandwidthSetBackend(info->backend) < 0)
+        goto cleanup;
 
     if (virNetDevBandwidthSet(iface, band, info->hierarchical_class, true) < 0)
         goto cleanup;
@@ -88,6 +271,17 @@ testVirNetDevBandwidthSet(const void *data)
          * Maybe that's expected, actually. */
     }
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (info->backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        if (actual_cmd) {
+            fprintf(stderr, "Unexpected commands:\n%s", actual_cmd);
+            goto cleanup;
+        }
+
+        actual_cmd = virBufferContentAndReset(&netlinkBuf);
+    }
+#endif
+
     if (STRNEQ_NULLABLE(info->exp_cmd, actual_cmd)) {
         virTestDifference(stderr,
                           NULLSTR(info->exp_cmd),
@@ -103,15 +297,58 @@ testVirNetDevBandwidthSet(const void *data)
     return ret;
 }
 
+/* The bandwidth_backend setting of the daemons goes through these */
+static int
+testVirNetDevBandwidthBackend(const void *data G_GNUC_UNUSED)
+{
+    int rc;
+
+    if (virNetDevBandwidthBackendTypeFromString("netlink") !=
+        VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK ||
+        virNetDevBandwidthBackendTypeFromString("tc") !=
+        VIR_NETDEV_BANDWIDTH_BACKEND_TC ||
+        virNetDevBandwidthBackendTypeFromString("ip") >= 0 ||
+        virNetDevBandwidthBackendTypeFromString("") >= 0) {
+        fprintf(stderr, "Unexpected backend names\n");
+        return -1;
+    }
+
+    if (STRNEQ_NULLABLE(virNetDevBandwidthBackendTypeToString(VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK),
+                        "netlink") ||
+        STRNEQ_NULLABLE(virNetDevBandwidthBackendTypeToString(VIR_NETDEV_BANDWIDTH_BACKEND_TC),
+                        "tc")) {
+        fprintf(stderr, "Unexpected backend names\n");
+        return -1;
+    }
+
+    if (virNetDevBandwidthSetBackend(VIR_NETDEV_BANDWIDTH_BACKEND_TC) < 0)
+        return -1;
+
+    rc = virNetDevBandwidthSetBackend(VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK);
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    if (rc < 0)
+        return -1;
+#else
+    if (rc == 0) {
+        fprintf(stderr, "Netlink backend accepted without netlink support\n");
+        return -1;
+    }
+    virResetLastError();
+#endif
+
+    return 0;
+}
+
 static int
 mymain(void)
 {
     int ret = 0;
 
-#define DO_TEST_SET(Band, Exp_cmd, ...) \
+#define DO_TEST_SET_FULL(Backend, Band, Exp_cmd, ...) \
     do { \
         struct testSetStruct data = {.band = Band, \
                                      .exp_cmd = Exp_cmd, \
+                                     .backend = Backend, \
                                      __VA_ARGS__}; \
         if (virTestRun("virNetDevBandwidthSet", \
                        testVirNetDevBandwidthSet, \
@@ -119,6 +356,14 @@ mymain(void)
             ret = -1; \
     } while (0)
 
+#define DO_TEST_SET(Band, Exp_cmd, ...) \
+    DO_TEST_SET_FULL(VIR_NETDEV_BANDWIDTH_BACKEND_TC, \
+                     Band, Exp_cmd, __VA_ARGS__)
+
+#define DO_TEST_SET_NETLINK(Band, Exp_cmd, ...) \
+    DO_TEST_SET_FULL(VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK, \
+                     Band, Exp_cmd, __VA_ARGS__)
+
 
     DO_TEST_SET(NULL, NULL);
 
@@ -157,6 +402,70 @@ mymain(void)
                  TC " filter add dev eth0 parent ffff: protocol all u32 match u32 0 0 "
                  "police rate 5kbps burst 7kb mtu 64kb drop flowid :1\n"));
 
+#if defined(__linux__) && defined(HAVE_LIBNL)
+    DO_TEST_SET_NETLINK(NULL, NULL);
+
+    DO_TEST_SET_NETLINK("<bandwidth/>", NULL);
+
+    DO_TEST_SET_NETLINK(("<bandwidth>"
+                         "  <inbound average='1024'/>"
+                         "</bandwidth>"),
+                        ("qdisc del dev 7 parent ffff:ffff handle 0:0\n"
+                         "qdisc del dev 7 parent ffff:fff1 handle ffff:0\n"
+                         "qdisc add dev 7 parent ffff:ffff handle 1:0 htb default 1\n"
+                         "class add dev 7 parent 1:0 handle 1:1 htb rate 1024000 ceil 1024000 quantum 87\n"
+                         "qdisc add dev 7 parent 1:1 handle 2:0 sfq\n"
+                         "filter add dev 7 parent 1:0 handle 0:1 prio 1 protocol 0x3 fw flowid 0:1\n"));
+
+    DO_TEST_SET_NETLINK(("<bandwidth>"
+                         "  <outbound average='1024'/>"
+                         "</bandwidth>"),
+                        ("qdisc del dev 7 parent ffff:ffff handle 0:0\n"
+                         "qdisc del dev 7 parent ffff:fff1 handle ffff:0\n"
+                         "qdisc add dev 7 parent ffff:fff1 handle ffff:0 ingress\n"
+                         "filter add dev 7 parent ffff:0 handle 0:0 prio 0 protocol 0x3 u32 "
+                         "match 00000000/00000000 at 0 police rate 1024000 mtu 65536 drop flowid 0:1\n"));
+
+    DO_TEST_SET_NETLINK(("<bandwidth>"
+                         "  <inbound average='1' peak='2' floor='3' burst='4'/>"
+                         "  <outbound average='5' peak='6' burst='7'/>"
+                         "</bandwidth>"),
+                        ("qdisc del dev 7 parent ffff:ffff handle 0:0\n"
+                         "qdisc del dev 7 parent ffff:fff1 handle ffff:0\n"
+                         "qdisc add dev 7 parent ffff:ffff handle 1:0 htb default 1\n"
+                         "class add dev 7 parent 1:0 handle 1:1 htb rate 1000 ceil 2000 quantum 1\n"
+                         "qdisc add dev 7 parent 1:1 handle 2:0 sfq\n"
+                         "filter add dev 7 parent 1:0 handle 0:1 prio 1 protocol 0x3 fw flowid 0:1\n"
+                         "qdisc add dev 7 parent ffff:fff1 handle ffff:0 ingress\n"
+                         "filter add dev 7 parent ffff:0 handle 0:0 prio 0 protocol 0x3 u32 "
+                         "match 00000000/00000000 at 0 police rate 5000 mtu 65536 drop flowid 0:1\n"));
+
+    DO_TEST_SET_NETLINK(("<bandwidth>"
+                         "  <inbound average='8000000'/>"
+                         "</bandwidth>"),
+                        ("qdisc del dev 7 parent ffff:ffff handle 0:0\n"
+                         "qdisc del dev 7 parent ffff:fff1 handle ffff:0\n"
+                         "qdisc add dev 7 parent ffff:ffff handle 1:0 htb default 1\n"
+                         "class add dev 7 parent 1:0 handle 1:1 htb rate 8000000000 ceil 8000000000 quantum 682666\n"
+                         "qdisc add dev 7 parent 1:1 handle 2:0 sfq\n"
+                         "filter add dev 7 parent 1:0 handle 0:1 prio 1 protocol 0x3 fw flowid 0:1\n"));
+
+    DO_TEST_SET_NETLINK(("<bandwidth>"
+                         "  <inbound average='1024' peak='2048'/>"
+                         "</bandwidth>"),
+                        ("qdisc del dev 7 parent ffff:ffff handle 0:0\n"
+                         "qdisc del dev 7 parent ffff:fff1 handle ffff:0\n"
+                         "qdisc add dev 7 parent ffff:ffff handle 1:0 htb default 2\n"
+                         "class add dev 7 parent 1:0 handle 1:1 htb rate 1024000 ceil 2048000 quantum 87\n"
+                         "class add dev 7 parent 1:1 handle 1:2 htb rate 1024000 ceil 2048000 quantum 87\n"
+                         "qdisc add dev 7 parent 1:2 handle 2:0 sfq\n"
+                         "filter add dev 7 parent 1:0 handle 0:1 prio 1 protocol 0x3 fw flowid 0:1\n"),
+                        .hierarchical_class = true);
+#endif
+
+    if (virTestRun("Backend selection", testVirNetDevBandwidthBackend, NULL) < 0)
+        ret = -1;
+
     return ret;
 }
 
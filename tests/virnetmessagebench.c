@@ -0,0 +1,185 @@
+/*
+ * virnetmessagebench.c: compare copying and attaching stream payloads
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+
+#include "internal.h"
+#include "virfile.h"
+#include "virstring.h"
+#include "virthread.h"
+#include "rpc/virnetmessage.h"
+#include "rpc/virnetsocket.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define BENCH_PROGRAM 0x62656e63
+#define BENCH_VERSION 1
+
+
+/* Drain everything written to @opaque until EOF */
+static void
+benchDrain(void *opaque)
+{
+    int fd = *(int *)opaque;
+    g_autofree char *buf = g_new(char, 1024 * 1024);
+
+    while (saferead(fd, buf, 1024 * 1024) > 0)
+        ;
+}
+
+
+static int
+benchSendMessage(virNetSocketPtr sock,
+                 virNetMessagePtr msg)
+{
+    struct iovec iov[VIR_NET_MESSAGE_NIOV];
+    size_t niov;
+
+    while ((niov = virNetMessageGetIOV(msg, iov)) > 0) {
+        ssize_t ret = virNetSocketWritev(sock, iov, niov);
+
+        if (ret < 0)
+            return -1;
+        virNetMessageAdvance(msg, ret);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Send stream packets carrying @len bytes of data each through @sock for
+ * @seconds, either copying the data into the message buffer like before
+ * or attaching it to the message, and return the throughput in MiB/s.
+ */
+static double
+benchStream(virNetSocketPtr sock,
+            const char *data,
+            size_t len,
+            bool attach,
+            unsigned int seconds)
+{
+    gint64 end = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+    gint64 start = g_get_monotonic_time();
+    unsigned long long bytes = 0;
+    unsigned int serial = 0;
+
+    while (g_get_monotonic_time() < end) {
+        virNetMessagePtr msg;
+        int rc;
+
+        if (!(msg = virNetMessageNew(false)))
+            return -1;
+
+        msg->header.prog = BENCH_PROGRAM;
+        msg->header.vers = BENCH_VERSION;
+        msg->header.type = VIR_NET_STREAM;
+        msg->header.status = VIR_NET_CONTINUE;
+        msg->header.serial = serial++;
+
+        if (virNetMessageEncodeHeader(msg) < 0)
+            rc = -1;
+        else if (attach)
+            rc = virNetMessageEncodePayloadRef(msg, data, len);
+        else
+            rc = virNetMessageEncodePayloadRaw(msg, data, len);
+
+        if (rc == 0)
+            rc = benchSendMessage(sock, msg);
+
+        virNetMessageFree(msg);
+        if (rc < 0)
+            return -1;
+
+        bytes += len;
+    }
+
+    return bytes / 1024.0 / 1024.0 * G_USEC_PER_SEC /
+        (g_get_monotonic_time() - start);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    virNetSocketPtr sock = NULL;
+    virThread drain;
+    bool draining = false;
+    g_autofree char *data = NULL;
+    unsigned int seconds = 1;
+    size_t lens[] = { 4096, 65536, VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX, 4 * 1024 * 1024 };
+    int fds[2] = { -1, -1 };
+    int ret = EXIT_FAILURE;
+    size_t i;
+
+    if (argc > 2 ||
+        (argc == 2 && (virStrToLong_ui(argv[1], NULL, 10, &seconds) < 0 ||
+                       seconds == 0))) {
+        fprintf(stderr, "%s [SECONDS]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (virInitialize() < 0) {
+        fprintf(stderr, "Failed to initialize libvirt");
+        return EXIT_FAILURE;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        fprintf(stderr, "Cannot create socket pair\n");
+        return EXIT_FAILURE;
+    }
+
+    if (virNetSocketNewConnectSockFD(fds[0], &sock) < 0)
+        goto cleanup;
+    fds[0] = -1;
+
+    if (virNetSocketSetBlocking(sock, true) < 0 ||
+        virThreadCreate(&drain, true, benchDrain, &fds[1]) < 0)
+        goto cleanup;
+    draining = true;
+
+    data = g_new0(char, lens[G_N_ELEMENTS(lens) - 1]);
+
+    for (i = 0; i < G_N_ELEMENTS(lens); i++) {
+        double copy;
+        double attach;
+
+        if ((copy = benchStream(sock, data, lens[i], false, seconds)) < 0 ||
+            (attach = benchStream(sock, data, lens[i], true, seconds)) < 0)
+            goto cleanup;
+
+        printf("%8zu bytes/packet: copy %9.1f MiB/s  attach %9.1f MiB/s  (%.1fx)\n",
+               lens[i], copy, attach, copy ? attach / copy : 0);
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, "%s\n", virGetLastErrorMessage());
+    if (sock)
+        virNetSocketClose(sock);
+    virObjectUnref(sock);
+    VIR_FORCE_CLOSE(fds[0]);
+    if (draining)
+        virThreadJoin(&drain);
+    VIR_FORCE_CLOSE(fds[1]);
+    return ret;
+}
@@ -26,6 +26,7 @@
 #include "virlog.h"
 #include "virstring.h"
 #include "rpc/virnetmessage.h"
+#include "remote_protocol.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -453,31 +454,32 @@ static int testMessagePayloadDecode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static const char streamText[] = "The quick brown fox jumps over the lazy dog";
+static const char streamExpect[] = {
+    0x00, 0x00, 0x00, 0x47,  /* Length */
+    0x11, 0x22, 0x33, 0x44,  /* Program */
+    0x00, 0x00, 0x00, 0x01,  /* Version */
+    0x00, 0x00, 0x06, 0x66,  /* Procedure */
+    0x00, 0x00, 0x00, 0x03,  /* Type */
+    0x00, 0x00, 0x00, 0x99,  /* Serial */
+    0x00, 0x00, 0x00, 0x02,  /* Status */
+
+    'T', 'h', 'e', ' ',
+    'q', 'u', 'i', 'c',
+    'k', ' ', 'b', 'r',
+    'o', 'w', 'n', ' ',
+    'f', 'o', 'x', ' ',
+    'j', 'u', 'm', 'p',
+    's', ' ', 'o', 'v',
+    'e', 'r', ' ', 't',
+    'h', 'e', ' ', 'l',
+    'a', 'z', 'y', ' ',
+    'd', 'o', 'g',
+};
+
 static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
 {
-    char stream[] = "The quick brown fox jumps over the lazy dog";
     virNetMessagePtr msg = virNetMessageNew(true);
-    static const char expect[] = {
-        0x00, 0x00, 0x00, 0x47,  /* Length */
-        0x11, 0x22, 0x33, 0x44,  /* Program */
-        0x00, 0x00, 0x00, 0x01,  /* Version */
-        0x00, 0x00, 0x06, 0x66,  /* Procedure */
-        0x00, 0x00, 0x00, 0x03,  /* Type */
-        0x00, 0x00, 0x00, 0x99,  /* Serial */
-        0x00, 0x00, 0x00, 0x02,  /* Status */
-
-        'T', 'h', 'e', ' ',
-        'q', 'u', 'i', 'c',
-        'k', ' ', 'b', 'r',
-        'o', 'w', 'n', ' ',
-        'f', 'o', 'x', ' ',
-        'j', 'u', 'm', 'p',
-        's', ' ', 'o', 'v',
-        'e', 'r', ' ', 't',
-        'h', 'e', ' ', 'l',
-        'a', 'z', 'y', ' ',
-        'd', 'o', 'g',
-    };
     int ret = -1;
 
     if (!msg)
@@ -493,12 +495,12 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     if (virNetMessageEncodeHeader(msg) < 0)
         goto cleanup;
 
-    if (virNetMessageEncodePayloadRaw(msg, stream, strlen(stream)) < 0)
+    if (virNetMessageEncodePayloadRaw(msg, streamText, strlen(streamText)) < 0)
         goto cleanup;
 
-    if (G_N_ELEMENTS(expect) != msg->bufferLength) {
+    if (G_N_ELEMENTS(streamExpect) != msg->bufferLength) {
         VIR_DEBUG("Expect message length %zu got %zu",
-                  sizeof(expect), msg->bufferLength);
+                  sizeof(streamExpect), msg->bufferLength);
         goto cleanup;
     }
 
@@ -508,8 +510,8 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
         goto cleanup;
     }
 
-    if (memcmp(expect, msg->buffer, sizeof(expect)) != 0) {
-        virTestDifferenceBin(stderr, expect, msg->buffer, sizeof(expect));
+    if (memcmp(streamExpect, msg->buffer, sizeof(streamExpect)) != 0) {
+        virTestDifferenceBin(stderr, streamExpect, msg->buffer, sizeof(streamExpect));
         goto cleanup;
     }
 
@@ -519,6 +521,200 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static int testMessagePayloadStreamRef(const void *args G_GNUC_UNUSED)
+{
+    virNetMessagePtr msg = virNetMessageNew(true);
+    char *payload = g_strdup(streamText);
+    char sent[sizeof(streamExpect)];
+    size_t nsent = 0;
+    size_t remaining = sizeof(streamExpect);
+    int ret = -1;
+
+    if (!msg)
+        goto cleanup;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayloadSteal(msg, &payload, strlen(streamText)) < 0)
+        goto cleanup;
+
+    if (payload) {
+        VIR_DEBUG("Expect payload to be taken over");
+        goto cleanup;
+    }
+
+    /* Gather the message in small pieces the way a writer would */
+    while (remaining > 0) {
+        struct iovec iov[VIR_NET_MESSAGE_NIOV];
+        size_t niov = virNetMessageGetIOV(msg, iov);
+        size_t len = MIN(iov[0].iov_len, 5);
+
+        if (niov == 0) {
+            VIR_DEBUG("Expect %zu more bytes to send", remaining);
+            goto cleanup;
+        }
+
+        memcpy(sent + nsent, iov[0].iov_base, len);
+        nsent += len;
+        remaining = virNetMessageAdvance(msg, len);
+
+        if (remaining != sizeof(streamExpect) - nsent) {
+            VIR_DEBUG("Expect %zu bytes remaining got %zu",
+                      sizeof(streamExpect) - nsent, remaining);
+            goto cleanup;
+        }
+    }
+
+    if (memcmp(streamExpect, sent, sizeof(streamExpect)) != 0) {
+        virTestDifferenceBin(stderr, streamExpect, sent, sizeof(streamExpect));
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    g_free(payload);
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+static const char eventBatchExpect[] = {
+    0x00, 0x00, 0x00, 0x70,  /* Length */
+    0x20, 0x00, 0x80, 0x86,  /* Program */
+    0x00, 0x00, 0x00, 0x01,  /* Version */
+    0x00, 0x00, 0x01, 0xa7,  /* Procedure */
+    0x00, 0x00, 0x00, 0x01,  /* Type */
+    0x00, 0x00, 0x00, 0x00,  /* Serial */
+    0x00, 0x00, 0x00, 0x00,  /* Status */
+
+    0x00, 0x00, 0x00, 0x02,  /* Number of events */
+
+    0x00, 0x00, 0x00, 0x07,  /* Event 1 callback ID */
+    0x00, 0x00, 0x00, 0x04,  /* Event 1 domain name length */
+    'd', 'o', 'm', '1',  /* Event 1 domain name */
+    0x01, 0x01, 0x01, 0x01,  /* Event 1 domain UUID */
+    0x01, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01,
+    0x01, 0x01, 0x01, 0x01,
+    0x00, 0x00, 0x00, 0x03,  /* Event 1 domain ID */
+    0x00, 0x00, 0x00, 0x02,  /* Event 1 type */
+    0x00, 0x00, 0x00, 0x00,  /* Event 1 detail */
+
+    0x00, 0x00, 0x00, 0x07,  /* Event 2 callback ID */
+    0x00, 0x00, 0x00, 0x04,  /* Event 2 domain name length */
+    'd', 'o', 'm', '2',  /* Event 2 domain name */
+    0x02, 0x02, 0x02, 0x02,  /* Event 2 domain UUID */
+    0x02, 0x02, 0x02, 0x02,
+    0x02, 0x02, 0x02, 0x02,
+    0x02, 0x02, 0x02, 0x02,
+    0x00, 0x00, 0x00, 0x04,  /* Event 2 domain ID */
+    0x00, 0x00, 0x00, 0x05,  /* Event 2 type */
+    0x00, 0x00, 0x00, 0x01,  /* Event 2 detail */
+};
+
+static int testMessagePayloadEventBatch(const void *args G_GNUC_UNUSED)
+{
+    remote_domain_event_callback_lifecycle_msg events[2];
+    remote_domain_event_callback_lifecycle_batch_msg batch;
+    remote_domain_event_callback_lifecycle_batch_msg decoded;
+    char name1[] = "dom1";
+    char name2[] = "dom2";
+    virNetMessagePtr msg = virNetMessageNew(true);
+    virNetMessagePtr reply = virNetMessageNew(true);
+    int ret = -1;
+
+    memset(events, 0, sizeof(events));
+    memset(&batch, 0, sizeof(batch));
+    memset(&decoded, 0, sizeof(decoded));
+
+    if (!msg || !reply)
+        goto cleanup;
+
+    events[0].callbackID = 7;
+    events[0].msg.dom.name = name1;
+    memset(events[0].msg.dom.uuid, 0x01, VIR_UUID_BUFLEN);
+    events[0].msg.dom.id = 3;
+    events[0].msg.event = VIR_DOMAIN_EVENT_STARTED;
+    events[0].msg.detail = VIR_DOMAIN_EVENT_STARTED_BOOTED;
+
+    events[1].callbackID = 7;
+    events[1].msg.dom.name = name2;
+    memset(events[1].msg.dom.uuid, 0x02, VIR_UUID_BUFLEN);
+    events[1].msg.dom.id = 4;
+    events[1].msg.event = VIR_DOMAIN_EVENT_STOPPED;
+    events[1].msg.detail = VIR_DOMAIN_EVENT_STOPPED_DESTROYED;
+
+    batch.events.events_val = events;
+    batch.events.events_len = G_N_ELEMENTS(events);
+
+    msg->header.prog = REMOTE_PROGRAM;
+    msg->header.vers = REMOTE_PROTOCOL_VERSION;
+    msg->header.proc = REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE_BATCH;
+    msg->header.type = VIR_NET_MESSAGE;
+    msg->header.serial = 0;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayload(msg,
+                                   (xdrproc_t)xdr_remote_domain_event_callback_lifecycle_batch_msg,
+                                   &batch) < 0)
+        goto cleanup;
+
+    if (msg->bufferLength != sizeof(eventBatchExpect)) {
+        VIR_DEBUG("Expect message length %zu got %zu",
+                  sizeof(eventBatchExpect), msg->bufferLength);
+        goto cleanup;
+    }
+
+    if (memcmp(eventBatchExpect, msg->buffer, sizeof(eventBatchExpect)) != 0) {
+        virTestDifferenceBin(stderr, eventBatchExpect, msg->buffer,
+                             sizeof(eventBatchExpect));
+        goto cleanup;
+    }
+
+    /* Now read it back the way the client does */
+    reply->bufferLength = 4;
+    if (VIR_ALLOC_N(reply->buffer, reply->bufferLength) < 0)
+        goto cleanup;
+    memcpy(reply->buffer, msg->buffer, reply->bufferLength);
+
+    if (virNetMessageDecodeLength(reply) < 0)
+        goto cleanup;
+    memcpy(reply->buffer, msg->buffer, reply->bufferLength);
+
+    if (virNetMessageDecodeHeader(reply) < 0 ||
+        virNetMessageDecodePayload(reply,
+                                   (xdrproc_t)xdr_remote_domain_event_callback_lifecycle_batch_msg,
+                                   &decoded) < 0)
+        goto cleanup;
+
+    if (reply->header.proc != REMOTE_PROC_DOMAIN_EVENT_CALLBACK_LIFECYCLE_BATCH ||
+        decoded.events.events_len != 2 ||
+        STRNEQ(decoded.events.events_val[0].msg.dom.name, "dom1") ||
+        decoded.events.events_val[0].msg.event != VIR_DOMAIN_EVENT_STARTED ||
+        STRNEQ(decoded.events.events_val[1].msg.dom.name, "dom2") ||
+        decoded.events.events_val[1].msg.event != VIR_DOMAIN_EVENT_STOPPED) {
+        VIR_DEBUG("Decoded batch doesn't match the encoded one");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    xdr_free((xdrproc_t)xdr_remote_domain_event_callback_lifecycle_batch_msg,
+             (char *)&decoded);
+    virNetMessageFree(msg);
+    virNetMessageFree(reply);
+    return ret;
+}
+
 
 static int
 mymain(void)
@@ -544,6 +740,12 @@ mymain(void)
     if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Payload Stream Ref", testMessagePayloadStreamRef, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Payload Event Batch", testMessagePayloadEventBatch, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -0,0 +1,673 @@
+/*
+ * virnetservertest.c: test RPC server dispatch and pipelined client calls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virthread.h"
+#include "rpc/virnetclient.h"
+#include "rpc/virnetclientprogram.h"
+#include "rpc/virnetserver.h"
+#include "rpc/virnetserverprogram.h"
+#include "rpc/virnetserverservice.h"
+
+#define VIR_FROM_THIS VIR_FROM_RPC
+
+VIR_LOG_INIT("tests.netservertest");
+
+#ifndef WIN32
+
+# define TEST_PROGRAM 0x74657374
+# define TEST_VERSION 1
+# define TEST_PROC_ECHO 1
+# define TEST_PROC_SLOW 2
+# define TEST_CLIENTS 8
+# define TEST_PIPELINE 16
+
+typedef struct _testServer testServer;
+struct _testServer {
+    virNetServerPtr srv;
+    virThread loop;
+    int timer;
+    int quit;
+};
+
+typedef struct _testClientThread testClientThread;
+struct _testClientThread {
+    virThread thread;
+    const char *path;
+    size_t ncalls;
+    bool reconnect;
+    bool failed;
+
+    /* for threads sharing one connection */
+    virNetClientPtr client;
+    virNetClientProgramPtr prog;
+    size_t id;
+};
+
+typedef struct _testServerData testServerData;
+struct _testServerData {
+    const char *path;
+    size_t ioThreads;
+    bool reconnect;
+};
+
+
+static void *
+testClientPrivNew(virNetServerClientPtr client G_GNUC_UNUSED,
+                  void *opaque G_GNUC_UNUSED)
+{
+    return g_new0(int, 1);
+}
+
+
+static int
+testDispatchEcho(virNetServerPtr server G_GNUC_UNUSED,
+                 virNetServerClientPtr client G_GNUC_UNUSED,
+                 virNetMessagePtr msg G_GNUC_UNUSED,
+                 virNetMessageErrorPtr rerr G_GNUC_UNUSED,
+                 void *args,
+                 void *ret)
+{
+    *(int *)ret = *(int *)args;
+    return 0;
+}
+
+
+/* Number of slow calls being dispatched and whether they may reply */
+static int testSlowStarted;
+static int testSlowRelease;
+
+
+static int
+testDispatchSlow(virNetServerPtr server G_GNUC_UNUSED,
+                 virNetServerClientPtr client G_GNUC_UNUSED,
+                 virNetMessagePtr msg G_GNUC_UNUSED,
+                 virNetMessageErrorPtr rerr G_GNUC_UNUSED,
+                 void *args,
+                 void *ret)
+{
+    gint64 deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+
+    g_atomic_int_inc(&testSlowStarted);
+    while (!g_atomic_int_get(&testSlowRelease) &&
+           g_get_monotonic_time() < deadline)
+        g_usleep(1000);
+
+    *(int *)ret = *(int *)args;
+    return 0;
+}
+
+
+static virNetServerProgramProc testProcs[] = {
+    { NULL, 0, NULL, 0, NULL, false, 0 },
+    { testDispatchEcho,
+      sizeof(int), (xdrproc_t)xdr_int,
+      sizeof(int), (xdrproc_t)xdr_int,
+      false, 0 },
+    { testDispatchSlow,
+      sizeof(int), (xdrproc_t)xdr_int,
+      sizeof(int), (xdrproc_t)xdr_int,
+      false, 0 },
+};
+
+
+static void
+testServerTimer(int timer G_GNUC_UNUSED,
+                void *opaque G_GNUC_UNUSED)
+{
+    /* just wakes up the loop to reap closed clients */
+}
+
+
+static void
+testServerLoop(void *opaque)
+{
+    testServer *ts = opaque;
+
+    while (!g_atomic_int_get(&ts->quit)) {
+        if (virEventRunDefaultImpl() < 0)
+            break;
+        virNetServerProcessClients(ts->srv);
+    }
+}
+
+
+static void
+testServerStop(testServer *ts)
+{
+    if (!ts->srv)
+        return;
+
+    g_atomic_int_set(&ts->quit, 1);
+    virThreadJoin(&ts->loop);
+    virEventRemoveTimeout(ts->timer);
+    virNetServerClose(ts->srv);
+    virObjectUnref(ts->srv);
+    ts->srv = NULL;
+}
+
+
+static int
+testServerStart(testServer *ts,
+                const char *path,
+                size_t ioThreads)
+{
+    virNetServerServicePtr svc = NULL;
+    virNetServerProgramPtr prog = NULL;
+    int ret = -1;
+
+    memset(ts, 0, sizeof(*ts));
+    ts->timer = -1;
+    unlink(path);
+
+    if (!(ts->srv = virNetServerNew("test", 1,
+                                    2, 4, 0, 0,
+                                    100, 100,
+                                    -1, 0,
+                                    testClientPrivNew,
+                                    NULL,
+                                    g_free,
+                                    NULL)))
+        goto cleanup;
+
+    if (ioThreads &&
+        virNetServerSetIOThreads(ts->srv, ioThreads) < 0)
+        goto cleanup;
+
+    if (!(svc = virNetServerServiceNewUNIX(path, 0077, 0,
+                                           VIR_NET_SERVER_SERVICE_AUTH_NONE,
+                                           NULL, false, 100, 5)) ||
+        virNetServerAddService(ts->srv, svc) < 0)
+        goto cleanup;
+
+    if (!(prog = virNetServerProgramNew(TEST_PROGRAM, TEST_VERSION,
+                                        testProcs, G_N_ELEMENTS(testProcs))) ||
+        virNetServerAddProgram(ts->srv, prog) < 0)
+        goto cleanup;
+
+    virNetServerUpdateServices(ts->srv, true);
+
+    if ((ts->timer = virEventAddTimeout(10, testServerTimer, NULL, NULL)) < 0)
+        goto cleanup;
+
+    if (virThreadCreate(&ts->loop, true, testServerLoop, ts) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(svc);
+    virObjectUnref(prog);
+    if (ret < 0) {
+        if (ts->timer >= 0)
+            virEventRemoveTimeout(ts->timer);
+        virObjectUnref(ts->srv);
+        ts->srv = NULL;
+    }
+    return ret;
+}
+
+
+static int
+testClientOpen(const char *path,
+               virNetClientPtr *client,
+               virNetClientProgramPtr *prog)
+{
+    if (!(*client = virNetClientNewUNIX(path, false, NULL)))
+        return -1;
+
+    if (!(*prog = virNetClientProgramNew(TEST_PROGRAM, TEST_VERSION,
+                                         NULL, 0, NULL)) ||
+        virNetClientAddProgram(*client, *prog) < 0) {
+        virObjectUnref(*prog);
+        virNetClientClose(*client);
+        virObjectUnref(*client);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+testClientClose(virNetClientPtr client,
+                virNetClientProgramPtr prog)
+{
+    virObjectUnref(prog);
+    virNetClientClose(client);
+    virObjectUnref(client);
+}
+
+
+static int
+testClientEcho(virNetClientPtr client,
+               virNetClientProgramPtr prog,
+               int serial)
+{
+    int reply = -1;
+
+    if (virNetClientProgramCall(prog, client, serial, TEST_PROC_ECHO,
+                                0, NULL, NULL, NULL,
+                                (xdrproc_t)xdr_int, &serial,
+                                (xdrproc_t)xdr_int, &reply) < 0)
+        return -1;
+
+    if (reply != serial) {
+        VIR_TEST_DEBUG("Expected reply %d, got %d", serial, reply);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Make @ncalls calls of @proc at once over @client, with consecutive
+ * serials starting at @serial, and check every reply.
+ */
+static int
+testClientEchoMulti(virNetClientPtr client,
+                    virNetClientProgramPtr prog,
+                    int proc,
+                    int serial,
+                    size_t ncalls)
+{
+    virNetClientProgramCallData calls[TEST_PIPELINE];
+    int args[TEST_PIPELINE];
+    int replies[TEST_PIPELINE];
+    size_t i;
+
+    for (i = 0; i < ncalls; i++) {
+        args[i] = serial + i;
+        replies[i] = -1;
+
+        calls[i].serial = serial + i;
+        calls[i].proc = proc;
+        calls[i].args_filter = (xdrproc_t)xdr_int;
+        calls[i].args = &args[i];
+        calls[i].ret_filter = (xdrproc_t)xdr_int;
+        calls[i].ret = &replies[i];
+    }
+
+    if (virNetClientProgramCallMulti(prog, client, calls, ncalls) < 0)
+        return -1;
+
+    for (i = 0; i < ncalls; i++) {
+        if (calls[i].rv < 0)
+            return -1;
+
+        if (replies[i] != args[i]) {
+            VIR_TEST_DEBUG("Expected reply %d, got %d", args[i], replies[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void
+testClientWorker(void *opaque)
+{
+    testClientThread *tc = opaque;
+    virNetClientPtr client = NULL;
+    virNetClientProgramPtr prog = NULL;
+    size_t i;
+
+    for (i = 0; i < tc->ncalls; i++) {
+        if (!client && testClientOpen(tc->path, &client, &prog) < 0)
+            goto error;
+
+        if (testClientEcho(client, prog, i) < 0)
+            goto error;
+
+        if (tc->reconnect) {
+            testClientClose(client, prog);
+            client = NULL;
+            prog = NULL;
+        }
+    }
+
+    if (client)
+        testClientClose(client, prog);
+    return;
+
+ error:
+    VIR_TEST_DEBUG("Client failed: %s", virGetLastErrorMessage());
+    tc->failed = true;
+    if (client)
+        testClientClose(client, prog);
+}
+
+
+/*
+ * Share one connection between threads making pipelined calls and
+ * threads making one call at a time. Serials are made unique per
+ * thread so that every reply can only match a single call.
+ */
+static void
+testClientPipelineWorker(void *opaque)
+{
+    testClientThread *tc = opaque;
+    size_t i;
+
+    for (i = 0; i < tc->ncalls; i++) {
+        int serial = (tc->id + 1) * 100000 + i * TEST_PIPELINE;
+        int rc;
+
+        if (tc->id % 2)
+            rc = testClientEcho(tc->client, tc->prog, serial);
+        else
+            rc = testClientEchoMulti(tc->client, tc->prog, TEST_PROC_ECHO,
+                                     serial, TEST_PIPELINE);
+
+        if (rc < 0) {
+            VIR_TEST_DEBUG("Client failed: %s", virGetLastErrorMessage());
+            tc->failed = true;
+            return;
+        }
+    }
+}
+
+
+/*
+ * Make pipelined calls which can't complete until the connection
+ * is closed from another thread, they all have to fail.
+ */
+static void
+testClientPipelineCloseWorker(void *opaque)
+{
+    testClientThread *tc = opaque;
+
+    if (testClientEchoMulti(tc->client, tc->prog, TEST_PROC_SLOW,
+                            1, tc->ncalls) == 0) {
+        VIR_TEST_DEBUG("Pipelined calls succeeded on a closed connection");
+        tc->failed = true;
+    }
+}
+
+
+static int
+testServerWaitClients(testServer *ts)
+{
+    gint64 deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+
+    while (virNetServerGetCurrentClients(ts->srv) > 0) {
+        if (g_get_monotonic_time() > deadline) {
+            VIR_TEST_DEBUG("%zu clients were not reaped",
+                           virNetServerGetCurrentClients(ts->srv));
+            return -1;
+        }
+        g_usleep(10 * 1000);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Run several clients against a server spreading its connections over
+ * @ioThreads I/O threads, each either making all its calls over one
+ * connection or connecting anew for every call, then check that the
+ * server reaps every connection once the clients went away.
+ */
+static int
+testServerClients(const void *opaque)
+{
+    const testServerData *data = opaque;
+    testClientThread threads[TEST_CLIENTS] = { 0 };
+    testServer ts = { 0 };
+    int ret = -1;
+    size_t i;
+
+    if (testServerStart(&ts, data->path, data->ioThreads) < 0)
+        return -1;
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+        threads[i].path = data->path;
+        threads[i].ncalls = data->reconnect ? 20 : 200;
+        threads[i].reconnect = data->reconnect;
+
+        if (virThreadCreate(&threads[i].thread, true,
+                            testClientWorker, &threads[i]) < 0) {
+            while (i-- > 0)
+                virThreadJoin(&threads[i].thread);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < TEST_CLIENTS; i++)
+        virThreadJoin(&threads[i].thread);
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+        if (threads[i].failed)
+            goto cleanup;
+    }
+
+    if (testServerWaitClients(&ts) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    testServerStop(&ts);
+    return ret;
+}
+
+
+/*
+ * Pipeline calls over one connection from several threads at once,
+ * mixed with plain calls from other threads.
+ */
+static int
+testServerPipeline(const void *opaque)
+{
+    const testServerData *data = opaque;
+    testClientThread threads[TEST_CLIENTS] = { 0 };
+    virNetClientPtr client = NULL;
+    virNetClientProgramPtr prog = NULL;
+    testServer ts = { 0 };
+    int ret = -1;
+    size_t i;
+
+    if (testServerStart(&ts, data->path, data->ioThreads) < 0)
+        return -1;
+
+    if (testClientOpen(data->path, &client, &prog) < 0)
+        goto cleanup;
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+        threads[i].client = client;
+        threads[i].prog = prog;
+        threads[i].ncalls = 50;
+        threads[i].id = i;
+
+        if (virThreadCreate(&threads[i].thread, true,
+                            testClientPipelineWorker, &threads[i]) < 0) {
+            while (i-- > 0)
+                virThreadJoin(&threads[i].thread);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < TEST_CLIENTS; i++)
+        virThreadJoin(&threads[i].thread);
+
+    for (i = 0; i < TEST_CLIENTS; i++) {
+        if (threads[i].failed)
+            goto cleanup;
+    }
+
+    testClientClose(client, prog);
+    client = NULL;
+    prog = NULL;
+
+    if (testServerWaitClients(&ts) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    if (client)
+        testClientClose(client, prog);
+    testServerStop(&ts);
+    return ret;
+}
+
+
+/*
+ * Close a connection while pipelined calls are waiting for their
+ * replies and check that they fail instead of hanging.
+ */
+static int
+testServerPipelineClose(const void *opaque)
+{
+    const testServerData *data = opaque;
+    testClientThread thread = { 0 };
+    virNetClientPtr client = NULL;
+    virNetClientProgramPtr prog = NULL;
+    testServer ts = { 0 };
+    gint64 deadline;
+    int ret = -1;
+
+    g_atomic_int_set(&testSlowStarted, 0);
+    g_atomic_int_set(&testSlowRelease, 0);
+
+    if (testServerStart(&ts, data->path, data->ioThreads) < 0)
+        return -1;
+
+    if (testClientOpen(data->path, &client, &prog) < 0)
+        goto cleanup;
+
+    thread.client = client;
+    thread.prog = prog;
+    thread.ncalls = TEST_PIPELINE;
+
+    if (virThreadCreate(&thread.thread, true,
+                        testClientPipelineCloseWorker, &thread) < 0)
+        goto cleanup;
+
+    /* wait for the server to dispatch some of the calls */
+    deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+    while (!g_atomic_int_get(&testSlowStarted) &&
+           g_get_monotonic_time() < deadline)
+        g_usleep(1000);
+
+    virNetClientClose(client);
+    g_atomic_int_set(&testSlowRelease, 1);
+    virThreadJoin(&thread.thread);
+
+    if (thread.failed)
+        goto cleanup;
+
+    if (!g_atomic_int_get(&testSlowStarted)) {
+        VIR_TEST_DEBUG("No call was dispatched");
+        goto cleanup;
+    }
+
+    testClientClose(client, prog);
+    client = NULL;
+    prog = NULL;
+
+    if (testServerWaitClients(&ts) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    g_atomic_int_set(&testSlowRelease, 1);
+    if (client)
+        testClientClose(client, prog);
+    testServerStop(&ts);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    g_autofree char *dir = NULL;
+    g_autofree char *path = NULL;
+    int ret = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (virInitialize() < 0 ||
+        virEventRegisterDefaultImpl() < 0) {
+        virDispatchError(NULL);
+        return EXIT_FAILURE;
+    }
+
+    if (!(dir = g_dir_make_tmp("virnetservertest-XXXXXX", NULL))) {
+        fprintf(stderr, "Cannot create temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    path = g_strdup_printf("%s/sock", dir);
+
+# define DO_TEST(ioThreads, reconnect) \
+    do { \
+        testServerData data = { path, ioThreads, reconnect }; \
+        if (virTestRun("Clients io_threads=" #ioThreads \
+                       " reconnect=" #reconnect, \
+                       testServerClients, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST(0, false);
+    DO_TEST(0, true);
+    DO_TEST(1, false);
+    DO_TEST(1, true);
+    DO_TEST(4, false);
+    DO_TEST(4, true);
+
+# define DO_TEST_PIPELINE(ioThreads) \
+    do { \
+        testServerData data = { path, ioThreads, false }; \
+        if (virTestRun("Pipeline io_threads=" #ioThreads, \
+                       testServerPipeline, &data) < 0) \
+            ret = -1; \
+        if (virTestRun("Pipeline close io_threads=" #ioThreads, \
+                       testServerPipelineClose, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST_PIPELINE(0);
+    DO_TEST_PIPELINE(1);
+
+    virFileDeleteTree(dir);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+#else
+static int
+mymain(void)
+{
+    return EXIT_AM_SKIP;
+}
+VIR_TEST_MAIN(mymain);
+#endif
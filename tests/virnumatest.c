@@ -0,0 +1,125 @@
+/*
+ * virnumatest.c: Test the built-in NUMA placement engine
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#define LIBVIRT_VIRNUMAPRIV_H_ALLOW
+#include "virnumapriv.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define TEST_NODES 4
+#define TEST_NODE_CPUS 8
+#define TEST_NODE_MEMORY (16ULL * 1024 * 1024)
+
+/* Two sockets with two nodes each */
+static int testDistances[TEST_NODES][TEST_NODES] = {
+    { 10, 16, 32, 32 },
+    { 16, 10, 32, 32 },
+    { 32, 32, 10, 16 },
+    { 32, 32, 16, 10 },
+};
+
+struct testPlacementData {
+    unsigned int vcpus;
+    unsigned long long memory;
+    unsigned int load[TEST_NODES];
+    const char *current;
+    const char *expect;
+};
+
+
+static int
+testPlacement(const void *opaque)
+{
+    const struct testPlacementData *data = opaque;
+    virNumaPlacementNode nodes[TEST_NODES];
+    g_autoptr(virBitmap) current = NULL;
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autofree char *actual = NULL;
+    size_t i;
+
+    for (i = 0; i < TEST_NODES; i++) {
+        nodes[i].id = i;
+        nodes[i].ncpus = TEST_NODE_CPUS;
+        nodes[i].memory = TEST_NODE_MEMORY;
+        nodes[i].vcpus = data->load[i];
+        nodes[i].distances = testDistances[i];
+        nodes[i].ndistances = TEST_NODES;
+    }
+
+    if (data->current &&
+        virBitmapParse(data->current, &current, TEST_NODES) < 0)
+        return -1;
+
+    if (virNumaPlacementPickNodes(nodes, TEST_NODES, data->vcpus,
+                                  data->memory, current, &nodeset) < 0)
+        return -1;
+
+    if (nodeset && !(actual = virBitmapFormat(nodeset)))
+        return -1;
+
+    if (STRNEQ_NULLABLE(data->expect, actual)) {
+        VIR_TEST_VERBOSE("Expected nodeset '%s', got '%s'",
+                         NULLSTR(data->expect), NULLSTR(actual));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+#define DO_TEST_FULL(name, _vcpus, _memoryGiB, _current, _expect, ...) \
+    do { \
+        struct testPlacementData data = { \
+            .vcpus = _vcpus, \
+            .memory = _memoryGiB * 1024ULL * 1024, \
+            .load = { __VA_ARGS__ }, \
+            .current = _current, \
+            .expect = _expect, \
+        }; \
+        if (virTestRun(name, testPlacement, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+#define DO_TEST(name, vcpus, memoryGiB, expect, ...) \
+    DO_TEST_FULL(name, vcpus, memoryGiB, NULL, expect, __VA_ARGS__)
+
+    DO_TEST("idle host", 4, 8, "0", 0, 0, 0, 0);
+    DO_TEST("least loaded node", 4, 8, "1", 8, 0, 4, 4);
+    DO_TEST("memory spans nodes", 4, 24, "0-1", 0, 0, 0, 0);
+    DO_TEST("memory spans nodes loaded", 4, 24, "2-3", 0, 8, 0, 0);
+    DO_TEST("vcpus span nodes", 12, 8, "0-1", 0, 0, 0, 0);
+    DO_TEST("overcommit closest node", 4, 8, "3", 8, 8, 8, 6);
+    DO_TEST("too much memory", 4, 100, "0-3", 0, 0, 0, 0);
+
+    DO_TEST_FULL("rebalance", 4, 8, "0", "1", 8, 0, 4, 4);
+    DO_TEST_FULL("rebalance small gain", 4, 8, "0", NULL, 4, 3, 3, 3);
+    DO_TEST_FULL("rebalance same nodes", 4, 8, "1", NULL, 8, 0, 4, 4);
+    DO_TEST_FULL("rebalance spread", 4, 24, "1,2", "0-1", 0, 0, 0, 0);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -19,6 +19,7 @@
 #include <config.h>
 
 #include <unistd.h>
+#include <sys/time.h>
 
 #include "testutils.h"
 #include "vircommand.h"
@@ -633,6 +634,60 @@ testBackingParse(const void *args)
 }
 
 
+static int
+testStorageHeaderCache(const void *args G_GNUC_UNUSED)
+{
+    struct timeval times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    unsigned long long hits, misses;
+    unsigned long long expHits, expMisses;
+    size_t nentries, size;
+    g_autoptr(virStorageSource) first = NULL;
+    g_autoptr(virStorageSource) second = NULL;
+    g_autoptr(virStorageSource) third = NULL;
+
+    /* recently modified files are not cached */
+    if (utimes(absraw, times) < 0) {
+        fprintf(stderr, "unable to set timestamps of %s\n", absraw);
+        return -1;
+    }
+
+    virStorageFileHeaderCacheInvalidate(NULL);
+    virStorageFileHeaderCacheGetStats(&expHits, &expMisses, &nentries, &size);
+
+    if (!(first = testStorageFileGetMetadata(absraw, VIR_STORAGE_FILE_RAW,
+                                             -1, -1)) ||
+        !(second = testStorageFileGetMetadata(absraw, VIR_STORAGE_FILE_RAW,
+                                              -1, -1)))
+        return -1;
+
+    expHits++;
+    expMisses++;
+    virStorageFileHeaderCacheGetStats(&hits, &misses, &nentries, &size);
+    if (hits != expHits || misses != expMisses ||
+        nentries != 1 || size != 1024) {
+        fprintf(stderr,
+                "unexpected cache state: hits=%llu misses=%llu entries=%zu size=%zu\n",
+                hits, misses, nentries, size);
+        return -1;
+    }
+
+    virStorageFileHeaderCacheInvalidate(absraw);
+
+    if (!(third = testStorageFileGetMetadata(absraw, VIR_STORAGE_FILE_RAW,
+                                             -1, -1)))
+        return -1;
+
+    expMisses++;
+    virStorageFileHeaderCacheGetStats(&hits, &misses, &nentries, &size);
+    if (hits != expHits || misses != expMisses) {
+        fprintf(stderr, "header was not read again after invalidation\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -1685,6 +1740,9 @@ mymain(void)
 
 #endif /* WITH_YAJL */
 
+    if (virTestRun("Storage header cache", testStorageHeaderCache, NULL) < 0)
+        ret = -1;
+
  cleanup:
     /* Final cleanup */
     testCleanupImages();
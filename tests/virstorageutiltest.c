@@ -16,6 +16,8 @@
 
 #include <config.h>
 
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "testutils.h"
 #include "virerror.h"
@@ -70,11 +72,361 @@ testGlusterExtractPoolSources(const void *opaque)
 }
 
 
+#define TEST_COPY_CHUNK (1024 * 1024)
+
+/*
+ * Copy a file made of a data chunk, an allocated chunk of zeros, a hole
+ * and another data chunk with a sparse copy and check that the result
+ * has the same contents while neither the zeros nor the hole take up
+ * space in it.
+ */
+static int
+testCopySparse(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = NULL;
+    g_autofree char *data = g_new0(char, TEST_COPY_CHUNK);
+    g_autofree char *zeros = g_new0(char, TEST_COPY_CHUNK);
+    g_autofree char *input = NULL;
+    g_autofree char *output = NULL;
+    g_autofree char *actual = NULL;
+    g_autofree char *expected = NULL;
+    virStorageVolDef vol = { 0 };
+    virStorageVolDef inputvol = { 0 };
+    unsigned long long size = 5 * TEST_COPY_CHUNK;
+    unsigned long long remain = size;
+    unsigned long long allocated;
+    int len;
+    struct stat inst;
+    struct stat outst;
+    VIR_AUTOCLOSE fd = -1;
+    int ret = -1;
+
+    if (!(dir = g_dir_make_tmp("virstorageutiltest-XXXXXX", NULL)))
+        return -1;
+
+    input = g_strdup_printf("%s/input", dir);
+    output = g_strdup_printf("%s/output", dir);
+    memset(data, 'x', TEST_COPY_CHUNK);
+
+    if ((fd = open(input, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0 ||
+        safewrite(fd, data, TEST_COPY_CHUNK) < 0 ||
+        safewrite(fd, zeros, TEST_COPY_CHUNK) < 0 ||
+        lseek(fd, 4 * TEST_COPY_CHUNK, SEEK_SET) < 0 ||
+        safewrite(fd, data, TEST_COPY_CHUNK) < 0 ||
+        VIR_CLOSE(fd) < 0) {
+        VIR_TEST_DEBUG("cannot create '%s'", input);
+        goto cleanup;
+    }
+
+    if ((fd = open(output, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0 ||
+        ftruncate(fd, size) < 0) {
+        VIR_TEST_DEBUG("cannot create '%s'", output);
+        goto cleanup;
+    }
+
+    vol.target.path = output;
+    inputvol.target.path = input;
+
+    if (virStorageBackendCopyToFD(&vol, &inputvol, fd, &remain,
+                                  true, false) < 0)
+        goto cleanup;
+
+    if (remain != 0) {
+        VIR_TEST_DEBUG("%llu bytes left to copy", remain);
+        goto cleanup;
+    }
+
+    if (VIR_CLOSE(fd) < 0 ||
+        stat(input, &inst) < 0 ||
+        stat(output, &outst) < 0)
+        goto cleanup;
+
+    if (virFileReadAll(input, size + 1, &expected) < 0 ||
+        (len = virFileReadAll(output, size + 1, &actual)) < 0)
+        goto cleanup;
+
+    if (len != inst.st_size || memcmp(expected, actual, len) != 0) {
+        VIR_TEST_DEBUG("contents of '%s' differ from '%s'", output, input);
+        goto cleanup;
+    }
+
+    /* Only the two data chunks should be allocated, unless the
+     * filesystem doesn't support holes at all and the input is
+     * fully allocated too. */
+    allocated = (unsigned long long) outst.st_blocks * 512;
+    if (allocated > 2 * TEST_COPY_CHUNK + 64 * 1024 &&
+        (unsigned long long) inst.st_blocks * 512 < size) {
+        VIR_TEST_DEBUG("'%s' has %llu bytes allocated, expected %d",
+                       output, allocated, 2 * TEST_COPY_CHUNK);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virFileDeleteTree(dir);
+    return ret;
+}
+
+
+/*
+ * Wipe a fully allocated file with the zero algorithm, which takes
+ * whichever of the kernel offload, O_DIRECT and buffered paths the
+ * filesystem supports, and check that nothing but zeroes is left.
+ */
+static int
+testWipeZero(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = NULL;
+    g_autofree char *path = NULL;
+    g_autofree char *data = g_new0(char, TEST_COPY_CHUNK);
+    g_autofree char *actual = NULL;
+    virStorageVolDef vol = { 0 };
+    size_t nchunks = 4;
+    size_t i;
+    int len;
+    VIR_AUTOCLOSE fd = -1;
+    int ret = -1;
+
+    if (!(dir = g_dir_make_tmp("virstorageutiltest-XXXXXX", NULL)))
+        return -1;
+
+    path = g_strdup_printf("%s/vol", dir);
+    memset(data, 'x', TEST_COPY_CHUNK);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+        goto cleanup;
+    for (i = 0; i < nchunks; i++) {
+        if (safewrite(fd, data, TEST_COPY_CHUNK) < 0)
+            goto cleanup;
+    }
+    if (VIR_CLOSE(fd) < 0)
+        goto cleanup;
+
+    vol.target.path = path;
+    vol.target.allocation = nchunks * TEST_COPY_CHUNK;
+
+    if (virStorageBackendVolWipeLocal(NULL, &vol,
+                                      VIR_STORAGE_VOL_WIPE_ALG_ZERO, 0) < 0)
+        goto cleanup;
+
+    memset(data, 0, TEST_COPY_CHUNK);
+    if ((len = virFileReadAll(path, nchunks * TEST_COPY_CHUNK + 1, &actual)) < 0)
+        goto cleanup;
+
+    if ((size_t) len != nchunks * TEST_COPY_CHUNK) {
+        VIR_TEST_DEBUG("'%s' is %d bytes long after wiping", path, len);
+        goto cleanup;
+    }
+
+    for (i = 0; i < nchunks; i++) {
+        if (memcmp(actual + i * TEST_COPY_CHUNK, data, TEST_COPY_CHUNK) != 0) {
+            VIR_TEST_DEBUG("'%s' was not wiped", path);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    virFileDeleteTree(dir);
+    return ret;
+}
+
+
+#define TEST_REFRESH_VOLS 40
+
+static void
+testPutBE(unsigned char *buf,
+          size_t len,
+          unsigned long long val)
+{
+    while (len-- > 0) {
+        buf[len] = val & 0xff;
+        val >>= 8;
+    }
+}
+
+
+static int
+testWriteQcow2(const char *path,
+               unsigned long long capacity,
+               const char *backing)
+{
+    unsigned char header[72] = { 0 };
+    VIR_AUTOCLOSE fd = -1;
+
+    testPutBE(header, 4, 0x514649fb);       /* magic */
+    testPutBE(header + 4, 4, 2);            /* version */
+    testPutBE(header + 8, 8, sizeof(header)); /* backing file offset */
+    testPutBE(header + 16, 4, strlen(backing));
+    testPutBE(header + 20, 4, 16);          /* cluster bits */
+    testPutBE(header + 24, 8, capacity);
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0 ||
+        safewrite(fd, header, sizeof(header)) < 0 ||
+        safewrite(fd, backing, strlen(backing)) < 0 ||
+        VIR_CLOSE(fd) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testCheckVol(virStoragePoolObjPtr obj,
+             const char *name,
+             unsigned long long capacity,
+             unsigned long long backingCapacity)
+{
+    virStorageVolDefPtr vol;
+
+    if (!(vol = virStorageVolDefFindByName(obj, name))) {
+        VIR_TEST_DEBUG("volume '%s' is missing", name);
+        return -1;
+    }
+
+    if (vol->target.capacity != capacity) {
+        VIR_TEST_DEBUG("volume '%s' has capacity %llu, expected %llu",
+                       name, vol->target.capacity, capacity);
+        return -1;
+    }
+
+    if (backingCapacity &&
+        (!vol->target.backingStore ||
+         vol->target.backingStore->capacity != backingCapacity)) {
+        VIR_TEST_DEBUG("backing file of volume '%s' has capacity %llu, "
+                       "expected %llu", name,
+                       vol->target.backingStore ?
+                       vol->target.backingStore->capacity : 0,
+                       backingCapacity);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testRefreshPool(virStoragePoolObjPtr obj)
+{
+    virStoragePoolObjClearVols(obj);
+
+    return virStorageBackendRefreshLocal(obj);
+}
+
+
+static int
+testWriteRaw(const char *path,
+             off_t size)
+{
+    VIR_AUTOCLOSE fd = -1;
+
+    if ((fd = open(path, O_WRONLY | O_CREAT, 0600)) < 0 ||
+        ftruncate(fd, size) < 0 ||
+        VIR_CLOSE(fd) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Refresh a directory pool with enough volumes to be probed from
+ * several threads, then refresh it again after changing some of them.
+ * Unchanged volumes come from the probe cache then, which must not
+ * hide changes to a volume's backing file.
+ */
+static int
+testRefreshLocal(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = NULL;
+    g_autofree char *xml = NULL;
+    g_autofree char *base = NULL;
+    g_autofree char *overlay = NULL;
+    virStoragePoolDefPtr def = NULL;
+    virStoragePoolObjPtr obj = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (!(dir = g_dir_make_tmp("virstorageutiltest-XXXXXX", NULL)))
+        return -1;
+
+    for (i = 0; i < TEST_REFRESH_VOLS; i++) {
+        g_autofree char *path = g_strdup_printf("%s/vol%zu.img", dir, i);
+
+        if (testWriteRaw(path, (i + 1) * 1024) < 0)
+            goto cleanup;
+    }
+
+    base = g_strdup_printf("%s/base.img", dir);
+    overlay = g_strdup_printf("%s/overlay.qcow2", dir);
+    if (testWriteRaw(base, 64 * 1024) < 0 ||
+        testWriteQcow2(overlay, 1024 * 1024, "base.img") < 0)
+        goto cleanup;
+
+    xml = g_strdup_printf("<pool type='dir'>"
+                          "  <name>test</name>"
+                          "  <target><path>%s</path></target>"
+                          "</pool>", dir);
+
+    if (!(def = virStoragePoolDefParseString(xml)) ||
+        !(obj = virStoragePoolObjNew()))
+        goto cleanup;
+    virStoragePoolObjSetDef(obj, g_steal_pointer(&def));
+
+    if (testRefreshPool(obj) < 0)
+        goto cleanup;
+
+    for (i = 0; i < TEST_REFRESH_VOLS; i++) {
+        g_autofree char *name = g_strdup_printf("vol%zu.img", i);
+
+        if (testCheckVol(obj, name, (i + 1) * 1024, 0) < 0)
+            goto cleanup;
+    }
+    if (testCheckVol(obj, "overlay.qcow2", 1024 * 1024, 64 * 1024) < 0)
+        goto cleanup;
+
+    /* change the overlay and its backing file, then the backing file only */
+    if (testWriteRaw(base, 128 * 1024) < 0 ||
+        testWriteQcow2(overlay, 2 * 1024 * 1024, "base.img") < 0)
+        goto cleanup;
+
+    if (testRefreshPool(obj) < 0 ||
+        testCheckVol(obj, "overlay.qcow2", 2 * 1024 * 1024, 128 * 1024) < 0)
+        goto cleanup;
+
+    if (testWriteRaw(base, 256 * 1024) < 0)
+        goto cleanup;
+
+    if (testRefreshPool(obj) < 0 ||
+        testCheckVol(obj, "overlay.qcow2", 2 * 1024 * 1024, 256 * 1024) < 0 ||
+        testCheckVol(obj, "base.img", 256 * 1024, 0) < 0 ||
+        testCheckVol(obj, "vol0.img", 1024, 0) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virStoragePoolDefFree(def);
+    virStoragePoolObjEndAPI(&obj);
+    virFileDeleteTree(dir);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
     int ret = 0;
 
+    if (virTestRun("copy-sparse", testCopySparse, NULL) < 0)
+        ret = -1;
+    if (virTestRun("wipe-zero", testWipeZero, NULL) < 0)
+        ret = -1;
+    if (virTestRun("refresh-local", testRefreshLocal, NULL) < 0)
+        ret = -1;
+
 #define DO_TEST_GLUSTER_EXTRACT_POOL_SOURCES_FULL(testname, sffx, pooltype) \
     do { \
         struct testGlusterExtractPoolSourcesData data; \
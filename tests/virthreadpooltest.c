@@ -0,0 +1,404 @@
+/*
+ * virthreadpooltest.c: test the sharded thread pool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virthread.h"
+#include "virthreadpool.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define TEST_SUBMITTERS 8
+#define TEST_JOBS 2000
+
+typedef struct _testJob testJob;
+struct _testJob {
+    int runs; /* how many times the job ran */
+    bool block; /* wait for testPool.release before finishing */
+};
+
+typedef struct _testPool testPool;
+struct _testPool {
+    virThreadPoolPtr pool;
+    int done; /* jobs finished */
+    int blocked; /* blocking jobs which started */
+    int release; /* blocking jobs may finish */
+};
+
+typedef struct _testSubmitter testSubmitter;
+struct _testSubmitter {
+    virThread thread;
+    testPool *tp;
+    testJob *jobs;
+    size_t njobs;
+    bool failed;
+};
+
+
+static void
+testJobFunc(void *jobdata,
+            void *opaque)
+{
+    testJob *job = jobdata;
+    testPool *tp = opaque;
+
+    if (job->block) {
+        g_atomic_int_inc(&tp->blocked);
+        while (!g_atomic_int_get(&tp->release))
+            g_usleep(1000);
+    }
+
+    g_atomic_int_inc(&job->runs);
+    g_atomic_int_inc(&tp->done);
+}
+
+
+/* Wait until *@counter reaches @value, for up to 10 seconds */
+static int
+testWaitFor(int *counter,
+            int value)
+{
+    gint64 deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+
+    while (g_atomic_int_get(counter) < value) {
+        if (g_get_monotonic_time() > deadline) {
+            VIR_TEST_DEBUG("Timed out at %d of %d",
+                           g_atomic_int_get(counter), value);
+            return -1;
+        }
+        g_usleep(1000);
+    }
+
+    return 0;
+}
+
+
+static int
+testCheckRuns(testJob *jobs,
+              size_t njobs)
+{
+    size_t i;
+
+    for (i = 0; i < njobs; i++) {
+        if (g_atomic_int_get(&jobs[i].runs) != 1) {
+            VIR_TEST_DEBUG("Job %zu ran %d times", i,
+                           g_atomic_int_get(&jobs[i].runs));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void
+testSubmitterWorker(void *opaque)
+{
+    testSubmitter *ts = opaque;
+    size_t i;
+
+    for (i = 0; i < ts->njobs; i++) {
+        if (virThreadPoolSendJob(ts->tp->pool, 0, &ts->jobs[i]) < 0) {
+            ts->failed = true;
+            return;
+        }
+    }
+}
+
+
+/*
+ * Submit jobs from several threads at once and check that each of
+ * them runs exactly once, whichever shard it went to.
+ */
+static int
+testShardedSubmitters(const void *opaque G_GNUC_UNUSED)
+{
+    testSubmitter submitters[TEST_SUBMITTERS] = { 0 };
+    g_autofree testJob *jobs = g_new0(testJob, TEST_SUBMITTERS * TEST_JOBS);
+    testPool tp = { 0 };
+    int ret = -1;
+    size_t i;
+
+    if (!(tp.pool = virThreadPoolNewSharded(2, 8, 0, 4, testJobFunc,
+                                            "test", &tp)))
+        return -1;
+
+    if (virThreadPoolGetJobQueues(tp.pool) != 4) {
+        VIR_TEST_DEBUG("Expected 4 job queues, got %zu",
+                       virThreadPoolGetJobQueues(tp.pool));
+        goto cleanup;
+    }
+
+    for (i = 0; i < TEST_SUBMITTERS; i++) {
+        submitters[i].tp = &tp;
+        submitters[i].jobs = jobs + i * TEST_JOBS;
+        submitters[i].njobs = TEST_JOBS;
+
+        if (virThreadCreate(&submitters[i].thread, true,
+                            testSubmitterWorker, &submitters[i]) < 0) {
+            while (i-- > 0)
+                virThreadJoin(&submitters[i].thread);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < TEST_SUBMITTERS; i++)
+        virThreadJoin(&submitters[i].thread);
+
+    for (i = 0; i < TEST_SUBMITTERS; i++) {
+        if (submitters[i].failed) {
+            VIR_TEST_DEBUG("Submitter %zu failed", i);
+            goto cleanup;
+        }
+    }
+
+    if (testWaitFor(&tp.done, TEST_SUBMITTERS * TEST_JOBS) < 0 ||
+        testCheckRuns(jobs, TEST_SUBMITTERS * TEST_JOBS) < 0)
+        goto cleanup;
+
+    if (virThreadPoolGetJobQueueDepth(tp.pool) != 0) {
+        VIR_TEST_DEBUG("Queue depth is %zu after all jobs ran",
+                       virThreadPoolGetJobQueueDepth(tp.pool));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virThreadPoolFree(tp.pool);
+    return ret;
+}
+
+
+/*
+ * Keep the only regular worker busy and check that a priority job
+ * is still picked up by the priority worker.
+ */
+static int
+testShardedPriority(const void *opaque G_GNUC_UNUSED)
+{
+    testJob blocker = { .block = true };
+    testJob jobs[10] = { 0 };
+    testJob prio = { 0 };
+    testPool tp = { 0 };
+    int ret = -1;
+    size_t i;
+
+    if (!(tp.pool = virThreadPoolNewSharded(1, 1, 1, 2, testJobFunc,
+                                            "test", &tp)))
+        return -1;
+
+    if (virThreadPoolSendJob(tp.pool, 0, &blocker) < 0 ||
+        testWaitFor(&tp.blocked, 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+        if (virThreadPoolSendJob(tp.pool, 0, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    if (virThreadPoolSendJob(tp.pool, 1, &prio) < 0 ||
+        testWaitFor(&prio.runs, 1) < 0)
+        goto cleanup;
+
+    /* priority workers never take regular jobs */
+    if (g_atomic_int_get(&tp.done) != 1) {
+        VIR_TEST_DEBUG("Expected only the priority job to finish, got %d",
+                       g_atomic_int_get(&tp.done));
+        goto cleanup;
+    }
+
+    g_atomic_int_set(&tp.release, 1);
+
+    if (testWaitFor(&tp.done, G_N_ELEMENTS(jobs) + 2) < 0 ||
+        testCheckRuns(jobs, G_N_ELEMENTS(jobs)) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    g_atomic_int_set(&tp.release, 1);
+    virThreadPoolFree(tp.pool);
+    return ret;
+}
+
+
+/*
+ * With a single worker, whose home is the first queue, jobs spread
+ * round robin over the other queues can only run by being stolen.
+ */
+static int
+testShardedSteal(const void *opaque G_GNUC_UNUSED)
+{
+    testJob blocker = { .block = true };
+    testJob jobs[40] = { 0 };
+    testPool tp = { 0 };
+    unsigned long long stolen;
+    int ret = -1;
+    size_t i;
+
+    if (!(tp.pool = virThreadPoolNewSharded(1, 1, 0, 4, testJobFunc,
+                                            "test", &tp)))
+        return -1;
+
+    /* Queue everything up before the worker gets to it. The blocker
+     * is the first job and therefore lands in the worker's queue. */
+    if (virThreadPoolSendJob(tp.pool, 0, &blocker) < 0 ||
+        testWaitFor(&tp.blocked, 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+        if (virThreadPoolSendJob(tp.pool, 0, &jobs[i]) < 0)
+            goto cleanup;
+    }
+
+    g_atomic_int_set(&tp.release, 1);
+
+    if (testWaitFor(&tp.done, G_N_ELEMENTS(jobs) + 1) < 0 ||
+        testCheckRuns(jobs, G_N_ELEMENTS(jobs)) < 0)
+        goto cleanup;
+
+    /* jobs 1..40 went to queues 1, 2, 3, 0, 1, ... */
+    stolen = virThreadPoolGetStolenJobs(tp.pool);
+    if (stolen != G_N_ELEMENTS(jobs) / 4 * 3) {
+        VIR_TEST_DEBUG("Expected %zu stolen jobs, got %llu",
+                       G_N_ELEMENTS(jobs) / 4 * 3, stolen);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    g_atomic_int_set(&tp.release, 1);
+    virThreadPoolFree(tp.pool);
+    return ret;
+}
+
+
+static void
+testFreeWorker(void *opaque)
+{
+    testPool *tp = opaque;
+
+    virThreadPoolFree(tp->pool);
+    g_atomic_int_set(&tp->release, 2);
+}
+
+
+/*
+ * Free the pool while jobs are running and more are queued. It has
+ * to wait for the running ones, drop the queued ones without running
+ * them and no job may run once it returned.
+ */
+static int
+testShardedFree(const void *opaque G_GNUC_UNUSED)
+{
+    testJob blockers[2] = { { .block = true }, { .block = true } };
+    testJob jobs[100] = { 0 };
+    virThread thread;
+    testPool tp = { 0 };
+    int done;
+    size_t i;
+
+    if (!(tp.pool = virThreadPoolNewSharded(2, 2, 0, 2, testJobFunc,
+                                            "test", &tp)))
+        return -1;
+
+    for (i = 0; i < G_N_ELEMENTS(blockers); i++) {
+        if (virThreadPoolSendJob(tp.pool, 0, &blockers[i]) < 0)
+            goto error;
+    }
+
+    if (testWaitFor(&tp.blocked, G_N_ELEMENTS(blockers)) < 0)
+        goto error;
+
+    for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+        if (virThreadPoolSendJob(tp.pool, 0, &jobs[i]) < 0)
+            goto error;
+    }
+
+    if (virThreadCreate(&thread, true, testFreeWorker, &tp) < 0)
+        goto error;
+
+    /* Freeing has to wait for the blocked jobs */
+    g_usleep(100 * 1000);
+    if (g_atomic_int_get(&tp.release) == 2) {
+        VIR_TEST_DEBUG("Pool was freed with jobs still running");
+        g_atomic_int_set(&tp.release, 1);
+        virThreadJoin(&thread);
+        return -1;
+    }
+
+    g_atomic_int_set(&tp.release, 1);
+    virThreadJoin(&thread);
+
+    done = g_atomic_int_get(&tp.done);
+    for (i = 0; i < G_N_ELEMENTS(blockers); i++) {
+        if (blockers[i].runs != 1) {
+            VIR_TEST_DEBUG("Running job %zu did not finish", i);
+            return -1;
+        }
+    }
+
+    /* the workers are gone, nothing may run anymore */
+    g_usleep(10 * 1000);
+    if (g_atomic_int_get(&tp.done) != done ||
+        done > (int) (G_N_ELEMENTS(jobs) + G_N_ELEMENTS(blockers))) {
+        VIR_TEST_DEBUG("Jobs ran after the pool was freed");
+        return -1;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(jobs); i++) {
+        if (jobs[i].runs > 1) {
+            VIR_TEST_DEBUG("Job %zu ran %d times", i, jobs[i].runs);
+            return -1;
+        }
+    }
+
+    return 0;
+
+ error:
+    g_atomic_int_set(&tp.release, 1);
+    virThreadPoolFree(tp.pool);
+    return -1;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("Sharded concurrent submitters",
+                   testShardedSubmitters, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Sharded priority jobs",
+                   testShardedPriority, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Sharded work stealing",
+                   testShardedSteal, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Sharded free with pending jobs",
+                   testShardedFree, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -111,6 +111,7 @@ findLease(const char *name,
     size_t nmacs = 0;
     size_t i;
     time_t now;
+    int rv;
 
     *address = NULL;
     *naddress = 0;
@@ -148,11 +149,11 @@ findLease(const char *name,
                 goto cleanup;
 
             DEBUG("Processing %s", path);
-            if (findMACs(path, name, &macs, &nmacs) < 0) {
-                free(path);
-                goto cleanup;
-            }
+            if ((rv = findMACsIndex(path, name, &macs, &nmacs)) == 0)
+                rv = findMACs(path, name, &macs, &nmacs);
             free(path);
+            if (rv < 0)
+                goto cleanup;
 #endif /* LIBVIRT_NSS_GUEST */
         }
 
@@ -175,11 +176,18 @@ findLease(const char *name,
     }
 
     for (i = 0; i < nleaseFiles; i++) {
-        if (findLeases(leaseFiles[i],
-                       name, macs, nmacs,
-                       af, now,
-                       address, naddress,
-                       found) < 0)
+        /* Parse the lease file only if there's no up to date index */
+        if ((rv = findLeasesIndex(leaseFiles[i],
+                                  name, macs, nmacs,
+                                  af, now,
+                                  address, naddress,
+                                  found)) == 0)
+            rv = findLeases(leaseFiles[i],
+                            name, macs, nmacs,
+                            af, now,
+                            address, naddress,
+                            found);
+        if (rv < 0)
             goto cleanup;
     }
 
@@ -0,0 +1,223 @@
+/*
+ * libvirt_nss_index.c: Name Service Switch plugin lease/MAC index reader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libvirt_nss_index.h"
+#include "libvirt_nss.h"
+
+
+/**
+ * nssIndexOpen:
+ * @idx: index to fill
+ * @file: JSON file the index belongs to
+ * @type: expected type of the index
+ *
+ * Maps the index written next to @file, provided it is of @type and
+ * was built from the current contents of @file. The index is only ever
+ * replaced by renaming a new file over it, so the mapping stays valid
+ * for as long as it is held.
+ *
+ * Returns 0 on success,
+ *        -1 if there is no usable index, in which case callers are
+ *           expected to parse @file instead.
+ */
+int
+nssIndexOpen(nssIndex *idx,
+             const char *file,
+             virNSSIndexType type)
+{
+    char path[PATH_MAX];
+    const virNSSIndexHeader *hdr;
+    struct stat src;
+    struct stat sb;
+    uint64_t len;
+    void *map;
+    int fd = -1;
+    int ret = -1;
+
+    memset(idx, 0, sizeof(*idx));
+
+    if (snprintf(path, sizeof(path), "%s%s",
+                 file, VIR_NSS_INDEX_SUFFIX) >= (int) sizeof(path))
+        return -1;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        DEBUG("No index %s", path);
+        return -1;
+    }
+
+    if (fstat(fd, &sb) < 0 ||
+        stat(file, &src) < 0)
+        goto cleanup;
+
+    if (sb.st_size < (off_t) sizeof(*hdr)) {
+        DEBUG("Index %s is truncated", path);
+        goto cleanup;
+    }
+
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        DEBUG("Cannot map %s", path);
+        goto cleanup;
+    }
+    idx->map = map;
+    idx->len = sb.st_size;
+    hdr = map;
+
+    if (memcmp(hdr->magic, VIR_NSS_INDEX_MAGIC, VIR_NSS_INDEX_MAGIC_LEN) != 0 ||
+        hdr->version != VIR_NSS_INDEX_VERSION ||
+        hdr->type != type) {
+        DEBUG("Index %s has unsupported format", path);
+        goto cleanup;
+    }
+
+    if (hdr->srcDev != (uint64_t) src.st_dev ||
+        hdr->srcIno != (uint64_t) src.st_ino ||
+        hdr->srcSize != (uint64_t) src.st_size ||
+        hdr->srcMtime != (int64_t) src.st_mtime) {
+        DEBUG("Index %s is stale", path);
+        goto cleanup;
+    }
+
+    len = sizeof(*hdr) +
+        2 * (uint64_t) hdr->nbuckets * sizeof(uint32_t) +
+        (uint64_t) hdr->nrecords * sizeof(virNSSIndexRecord) +
+        hdr->strtabLen;
+
+    if (hdr->nbuckets == 0 ||
+        (hdr->nbuckets & (hdr->nbuckets - 1)) != 0 ||
+        hdr->strtabLen == 0 ||
+        len != idx->len) {
+        DEBUG("Index %s is corrupted", path);
+        goto cleanup;
+    }
+
+    idx->hdr = hdr;
+    idx->nameBuckets = (const uint32_t *) (hdr + 1);
+    idx->macBuckets = idx->nameBuckets + hdr->nbuckets;
+    idx->records = (const virNSSIndexRecord *) (idx->macBuckets + hdr->nbuckets);
+    idx->strtab = (const char *) (idx->records + hdr->nrecords);
+
+    /* guarantees every string within the table is terminated */
+    if (idx->strtab[hdr->strtabLen - 1] != '\0') {
+        DEBUG("Index %s is corrupted", path);
+        goto cleanup;
+    }
+
+    DEBUG("Using index %s with %u records", path, hdr->nrecords);
+    ret = 0;
+
+ cleanup:
+    close(fd);
+    if (ret < 0)
+        nssIndexClose(idx);
+    return ret;
+}
+
+
+void
+nssIndexClose(nssIndex *idx)
+{
+    if (idx->map)
+        munmap(idx->map, idx->len);
+    memset(idx, 0, sizeof(*idx));
+}
+
+
+const char *
+nssIndexString(const nssIndex *idx,
+               uint32_t off)
+{
+    if (off >= idx->hdr->strtabLen)
+        return NULL;
+
+    return idx->strtab + off;
+}
+
+
+/*
+ * Walk the chain of @buckets @key hashes into, starting after @prev if
+ * given, and return the first record whose name or MAC is @key. Links
+ * must point forward, which is all the validation needed to make sure
+ * the walk stays within the mapping and terminates.
+ */
+static const virNSSIndexRecord *
+nssIndexFind(const nssIndex *idx,
+             const uint32_t *buckets,
+             bool byName,
+             const char *key,
+             const virNSSIndexRecord *prev)
+{
+    uint32_t last = 0;
+    uint32_t i;
+
+    if (prev) {
+        last = prev - idx->records + 1;
+        i = byName ? prev->nextName : prev->nextMAC;
+    } else {
+        i = buckets[virNSSIndexHash(key) & (idx->hdr->nbuckets - 1)];
+    }
+
+    while (i) {
+        const virNSSIndexRecord *rec;
+        const char *str;
+
+        if (i <= last || i > idx->hdr->nrecords) {
+            DEBUG("Corrupted chain at record %u", i);
+            return NULL;
+        }
+
+        rec = &idx->records[i - 1];
+        str = nssIndexString(idx, byName ? rec->name : rec->mac);
+        if (str && !strcmp(str, key))
+            return rec;
+
+        last = i;
+        i = byName ? rec->nextName : rec->nextMAC;
+    }
+
+    return NULL;
+}
+
+
+const virNSSIndexRecord *
+nssIndexFindName(const nssIndex *idx,
+                 const char *name,
+                 const virNSSIndexRecord *prev)
+{
+    return nssIndexFind(idx, idx->nameBuckets, true, name, prev);
+}
+
+
+const virNSSIndexRecord *
+nssIndexFindMAC(const nssIndex *idx,
+                const char *mac,
+                const virNSSIndexRecord *prev)
+{
+    return nssIndexFind(idx, idx->macBuckets, false, mac, prev);
+}
@@ -0,0 +1,55 @@
+/*
+ * libvirt_nss_index.h: Name Service Switch plugin lease/MAC index reader
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include "virnssindexformat.h"
+
+typedef struct {
+    void *map;
+    size_t len;
+    const virNSSIndexHeader *hdr;
+    const uint32_t *nameBuckets;
+    const uint32_t *macBuckets;
+    const virNSSIndexRecord *records;
+    const char *strtab;
+} nssIndex;
+
+int
+nssIndexOpen(nssIndex *idx,
+             const char *file,
+             virNSSIndexType type);
+
+void
+nssIndexClose(nssIndex *idx);
+
+const char *
+nssIndexString(const nssIndex *idx,
+               uint32_t off);
+
+const virNSSIndexRecord *
+nssIndexFindName(const nssIndex *idx,
+                 const char *name,
+                 const virNSSIndexRecord *prev);
+
+const virNSSIndexRecord *
+nssIndexFindMAC(const nssIndex *idx,
+                const char *mac,
+                const virNSSIndexRecord *prev);
@@ -30,6 +30,7 @@
 #include <yajl/yajl_parse.h>
 
 #include "libvirt_nss_leases.h"
+#include "libvirt_nss_index.h"
 #include "libvirt_nss.h"
 
 enum {
@@ -60,6 +61,46 @@ typedef struct {
 } findLeasesParser;
 
 
+static int
+appendAddrBytes(leaseAddress **tmpAddress,
+                size_t *ntmpAddress,
+                int family,
+                const unsigned char *addr,
+                long long expirytime,
+                int af)
+{
+    size_t addrlen = family == AF_INET6 ? 16 : 4;
+    leaseAddress *newAddr;
+    size_t i;
+
+    if (af != AF_UNSPEC && af != family) {
+        DEBUG("Skipping address which family is %d, %d requested", family, af);
+        return 0;
+    }
+
+    for (i = 0; i < *ntmpAddress; i++) {
+        if ((*tmpAddress)[i].af == family &&
+            memcmp((*tmpAddress)[i].addr, addr, addrlen) == 0) {
+            DEBUG("IP address already in the list");
+            return 0;
+        }
+    }
+
+    newAddr = realloc(*tmpAddress, sizeof(*newAddr) * (*ntmpAddress + 1));
+    if (!newAddr) {
+        ERROR("Out of memory");
+        return -1;
+    }
+    *tmpAddress = newAddr;
+
+    (*tmpAddress)[*ntmpAddress].expirytime = expirytime;
+    (*tmpAddress)[*ntmpAddress].af = family;
+    memcpy((*tmpAddress)[*ntmpAddress].addr, addr, addrlen);
+    (*ntmpAddress)++;
+    return 0;
+}
+
+
 static int
 appendAddr(const char *name __attribute__((unused)),
            leaseAddress **tmpAddress,
@@ -69,7 +110,6 @@ appendAddr(const char *name __attribute__((unused)),
            int af)
 {
     int family;
-    size_t i;
     struct addrinfo hints = {0};
     struct addrinfo *res = NULL;
     union {
@@ -79,7 +119,6 @@ appendAddr(const char *name __attribute__((unused)),
     } sa;
     unsigned char addr[16];
     int err;
-    leaseAddress *newAddr;
 
     DEBUG("IP address: %s", ipAddr);
 
@@ -109,50 +148,8 @@ appendAddr(const char *name __attribute__((unused)),
         return 0;
     }
 
-    if (af != AF_UNSPEC && af != family) {
-        DEBUG("Skipping address which family is %d, %d requested", family, af);
-        return 0;
-    }
-
-    for (i = 0; i < *ntmpAddress; i++) {
-        if (family == AF_INET) {
-            if ((*tmpAddress)[i].af == AF_INET &&
-                memcmp((*tmpAddress)[i].addr,
-                       &sa.sin.sin_addr,
-                       sizeof(sa.sin.sin_addr)) == 0) {
-                DEBUG("IP address already in the list");
-                return 0;
-            }
-        } else {
-            if ((*tmpAddress)[i].af == AF_INET6 &&
-                memcmp((*tmpAddress)[i].addr,
-                       &sa.sin6.sin6_addr,
-                       sizeof(sa.sin6.sin6_addr)) == 0) {
-                DEBUG("IP address already in the list");
-                return 0;
-            }
-        }
-    }
-
-    newAddr = realloc(*tmpAddress, sizeof(*newAddr) * (*ntmpAddress + 1));
-    if (!newAddr) {
-        ERROR("Out of memory");
-        return -1;
-    }
-    *tmpAddress = newAddr;
-
-    (*tmpAddress)[*ntmpAddress].expirytime = expirytime;
-    (*tmpAddress)[*ntmpAddress].af = family;
-    if (family == AF_INET)
-        memcpy((*tmpAddress)[*ntmpAddress].addr,
-               &sa.sin.sin_addr,
-               sizeof(sa.sin.sin_addr));
-    else
-        memcpy((*tmpAddress)[*ntmpAddress].addr,
-               &sa.sin6.sin6_addr,
-               sizeof(sa.sin6.sin6_addr));
-    (*ntmpAddress)++;
-    return 0;
+    return appendAddrBytes(tmpAddress, ntmpAddress,
+                           family, addr, expirytime, af);
 }
 
 
@@ -436,3 +433,87 @@ findLeases(const char *file,
         close(fd);
     return ret;
 }
+
+
+static int
+findLeasesIndexAppend(const virNSSIndexRecord *rec,
+                      time_t now,
+                      int af,
+                      leaseAddress **addrs,
+                      size_t *naddrs,
+                      bool *found)
+{
+    if (rec->expiry < now) {
+        DEBUG("Entry expired at %lld vs now %lld",
+              (long long) rec->expiry, (long long) now);
+        return 0;
+    }
+
+    if (rec->family != AF_INET && rec->family != AF_INET6)
+        return 0;
+
+    *found = true;
+
+    return appendAddrBytes(addrs, naddrs, rec->family, rec->addr,
+                           rec->expiry, af);
+}
+
+
+/**
+ * findLeasesIndex:
+ *
+ * Same as findLeases, except that the leases are looked up in the index
+ * written next to @file which avoids parsing it.
+ *
+ * Returns 1 if the index was used,
+ *         0 if there is no usable index and @file has to be parsed,
+ *        -1 on error.
+ */
+int
+findLeasesIndex(const char *file,
+                const char *name,
+                char **macs,
+                size_t nmacs,
+                int af,
+                time_t now,
+                leaseAddress **addrs,
+                size_t *naddrs,
+                bool *found)
+{
+    nssIndex idx;
+    const virNSSIndexRecord *rec;
+    size_t i;
+    int ret = -1;
+
+    if (nssIndexOpen(&idx, file, VIR_NSS_INDEX_TYPE_LEASES) < 0)
+        return 0;
+
+    if (nmacs) {
+        for (i = 0; i < nmacs; i++) {
+            rec = NULL;
+            while ((rec = nssIndexFindMAC(&idx, macs[i], rec))) {
+                if (findLeasesIndexAppend(rec, now, af,
+                                          addrs, naddrs, found) < 0)
+                    goto cleanup;
+            }
+        }
+    } else {
+        rec = NULL;
+        while ((rec = nssIndexFindName(&idx, name, rec))) {
+            if (findLeasesIndexAppend(rec, now, af,
+                                      addrs, naddrs, found) < 0)
+                goto cleanup;
+        }
+    }
+
+    ret = 1;
+
+ cleanup:
+    if (ret < 0) {
+        free(*addrs);
+        *addrs = NULL;
+        *naddrs = 0;
+    }
+    nssIndexClose(&idx);
+    return ret;
+}
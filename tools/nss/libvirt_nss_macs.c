@@ -29,6 +29,7 @@
 #include <yajl/yajl_parse.h>
 
 #include "libvirt_nss_macs.h"
+#include "libvirt_nss_index.h"
 #include "libvirt_nss.h"
 
 enum {
@@ -289,3 +290,58 @@ findMACs(const char *file,
         close(fd);
     return ret;
 }
+
+
+/**
+ * findMACsIndex:
+ *
+ * Same as findMACs, except that the MACs are looked up in the index
+ * written next to @file which avoids parsing it.
+ *
+ * Returns 1 if the index was used,
+ *         0 if there is no usable index and @file has to be parsed,
+ *        -1 on error.
+ */
+int
+findMACsIndex(const char *file,
+              const char *name,
+              char ***macs,
+              size_t *nmacs)
+{
+    nssIndex idx;
+    const virNSSIndexRecord *rec = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (nssIndexOpen(&idx, file, VIR_NSS_INDEX_TYPE_MACS) < 0)
+        return 0;
+
+    while ((rec = nssIndexFindName(&idx, name, rec))) {
+        const char *mac = nssIndexString(&idx, rec->mac);
+        char **tmp;
+
+        if (!mac || !*mac)
+            continue;
+
+        if (!(tmp = realloc(*macs, sizeof(char *) * (*nmacs + 1))))
+            goto cleanup;
+        *macs = tmp;
+
+        if (!((*macs)[*nmacs] = strdup(mac)))
+            goto cleanup;
+        (*nmacs)++;
+    }
+
+    ret = 1;
+
+ cleanup:
+    if (ret < 0) {
+        for (i = 0; i < *nmacs; i++)
+            free((*macs)[i]);
+        free(*macs);
+        *macs = NULL;
+        *nmacs = 0;
+    }
+    nssIndexClose(&idx);
+    return ret;
+}
@@ -27,3 +27,9 @@ findMACs(const char *file,
          const char *name,
          char ***macs,
          size_t *nmacs);
+
+int
+findMACsIndex(const char *file,
+              const char *name,
+              char ***macs,
+              size_t *nmacs);
@@ -428,8 +428,11 @@ cmdSrvThreadpoolInfo(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
     }
 
-    for (i = 0; i < nparams; i++)
-        vshPrint(ctl, "%-15s: %u\n", params[i].field, params[i].value.ui);
+    for (i = 0; i < nparams; i++) {
+        g_autofree char *value = vshGetTypedParamValue(ctl, &params[i]);
+
+        vshPrint(ctl, "%-15s: %s\n", params[i].field, NULLSTR(value));
+    }
 
     ret = true;
 